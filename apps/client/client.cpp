@@ -1,7 +1,13 @@
 #include <getopt.h>
 
+#include <cstddef>
+#include <cstdint>
 #include <cstdlib>
+#include <fstream>
 #include <iostream>
+#include <iterator>
+#include <memory>
+#include <optional>
 #include <sstream>
 #include <string>
 #include <string_view>
@@ -9,7 +15,14 @@
 
 #include "client/cmd.h"
 #include "client/config.h"
+#include "client/metrics.h"
+#include "client/pacer.h"
+#include "client/scheduler.h"
+#include "client/script.h"
+#include "client/server_pool.h"
+#include "client/transfer.h"
 #include "common/parse.h"
+#include "common/tracer.h"
 #include "common/types.h"
 
 static void PrintUsage() {
@@ -17,7 +30,8 @@ static void PrintUsage() {
   std::cout << "trivial transfer protocol client" << std::endl;
   std::cout
       << "\t-n, --hostname HOSTNAME\n\t\thostname as either an IPv4 address or "
-         "a domain name to be resolved\n\t\tby DNS"
+         "a domain name to be resolved\n\t\tby DNS, or a comma separated list "
+         "of servers to choose from"
       << std::endl;
   std::cout << "\t-m, --mode MODE\n\t\ttransfer mode one of 'ascii' or 'binary'"
             << std::endl;
@@ -35,6 +49,57 @@ static void PrintUsage() {
             << std::endl;
   std::cout << "\t-l, --literal-mode\n\t\tinterpret the ':' character literally"
             << std::endl;
+  std::cout << "\t-v, --verbose\n\t\tprint a summary after each transfer"
+            << std::endl;
+  std::cout << "\t-M, --metrics TARGET\n\t\twrite per-transfer metrics to "
+               "TARGET, a file path, '-' for stdout\n\t\tor 'fd:N' for an "
+               "open file descriptor"
+            << std::endl;
+  std::cout << "\t-F, --metrics-format FORMAT\n\t\tmetrics format one of "
+               "'json' (JSON lines) or 'prometheus', which a pipe\n\t\tonly "
+               "gets at exit"
+            << std::endl;
+  std::cout << "\t-L, --metrics-files MAX_SERIES\n\t\tlabel Prometheus series "
+               "by file as well as by host, keeping\n\t\tthe MAX_SERIES most "
+               "recently written, series are per host\n\t\totherwise"
+            << std::endl;
+  std::cout << "\t-c, --command SCRIPT\n\t\trun the ';' separated commands in "
+               "SCRIPT and exit"
+            << std::endl;
+  std::cout << "\t-f, --file SCRIPT_FILE\n\t\trun the commands in SCRIPT_FILE "
+               "and exit"
+            << std::endl;
+  std::cout << "\t-j, --jobs NUM_JOBS\n\t\tmax number of concurrent transfers "
+               "across all hosts"
+            << std::endl;
+  std::cout << "\t-J, --host-jobs NUM_JOBS\n\t\tmax number of concurrent "
+               "transfers to any one host"
+            << std::endl;
+  std::cout << "\t-w, --windowsize BLOCKS\n\t\tnumber of blocks to request "
+               "per window (RFC 7440)"
+            << std::endl;
+  std::cout << "\t-b, --rate BYTES_PER_SEC\n\t\tpace each transfer to this "
+               "rate, e.g. 512k or 10M"
+            << std::endl;
+  std::cout << "\t-B, --total-rate BYTES_PER_SEC\n\t\tpace all concurrent "
+               "transfers together to this rate"
+            << std::endl;
+  std::cout << "\t-O, --rollover 0|1\n\t\task the server to continue block "
+               "numbers at 0 or 1 after 65535"
+            << std::endl;
+  std::cout << "\t-D, --direct\n\t\twrite downloads with O_DIRECT, "
+               "bypassing the page cache"
+            << std::endl;
+  std::cout << "\t-S, --fsync never|file|dir\n\t\tsync downloads to disk "
+               "before renaming them into place"
+            << std::endl;
+  std::cout << "\t-P, --busy-poll USECS\n\t\tspin up to USECS microseconds "
+               "for each packet before\n\t\tsleeping, for latency bound "
+               "transfers of small files"
+            << std::endl;
+  std::cout << "\t-T, --trace-file FILE\n\t\trecord every packet sent and "
+               "received to FILE, decode it\n\t\twith tftpc-trace"
+            << std::endl;
   std::cout << "\t-h, --help\n\t\tprint this help message" << std::endl;
 }
 
@@ -88,6 +153,28 @@ static std::expected<tftp::client::CmdPtr, tftp::ParseStatus> LoadCmd(
     cmd = CreateCmd<tftp::client::TimeoutCmd>(cmdline);
   } else if (cmd_id == tftp::client::CmdId::kRexmt) {
     cmd = CreateCmd<tftp::client::RexmtCmd>(cmdline);
+  } else if (cmd_id == tftp::client::CmdId::kVerbose) {
+    cmd = CreateCmd<tftp::client::VerboseCmd>();
+  } else if (cmd_id == tftp::client::CmdId::kTrace) {
+    cmd = CreateCmd<tftp::client::TraceCmd>();
+  } else if (cmd_id == tftp::client::CmdId::kMulticast) {
+    cmd = CreateCmd<tftp::client::MulticastCmd>();
+  } else if (cmd_id == tftp::client::CmdId::kWindowSize) {
+    cmd = CreateCmd<tftp::client::WindowSizeCmd>(cmdline);
+  } else if (cmd_id == tftp::client::CmdId::kCongestion) {
+    cmd = CreateCmd<tftp::client::CongestionCmd>(cmdline);
+  } else if (cmd_id == tftp::client::CmdId::kRate) {
+    cmd = CreateCmd<tftp::client::RateCmd>(cmdline);
+  } else if (cmd_id == tftp::client::CmdId::kRollover) {
+    cmd = CreateCmd<tftp::client::RolloverCmd>(cmdline);
+  } else if (cmd_id == tftp::client::CmdId::kDirect) {
+    cmd = CreateCmd<tftp::client::DirectCmd>();
+  } else if (cmd_id == tftp::client::CmdId::kSync) {
+    cmd = CreateCmd<tftp::client::SyncCmd>(cmdline);
+  } else if (cmd_id == tftp::client::CmdId::kFsync) {
+    cmd = CreateCmd<tftp::client::FsyncCmd>(cmdline);
+  } else if (cmd_id == tftp::client::CmdId::kBusyPoll) {
+    cmd = CreateCmd<tftp::client::BusyPollCmd>(cmdline);
   } else {
     return std::unexpected(ParseStatus::kUnknownCmd);
   }
@@ -119,6 +206,25 @@ static void RunCmdShell(tftp::client::Config& conf) {
   }
 }
 
+static bool RunBatch(tftp::client::Config& conf, std::string_view script) {
+  /* Parse the whole script up front so that a typo fails before transfers. */
+  tftp::client::CmdList cmds;
+  for (const std::string& line : tftp::client::SplitScript(script)) {
+    if (line == "quit") {
+      break;
+    }
+
+    auto cmd = LoadCmd(line);
+    if (!cmd) {
+      PrintError("'" + line + "': " + tftp::kParseStatusToStr[cmd.error()]);
+      return false;
+    }
+    cmds.push_back(std::move(*cmd));
+  }
+
+  return tftp::client::RunScript(cmds, conf);
+}
+
 int main(int argc, char** argv) {
   const std::vector<struct option> kLongOpts{
       {"hostname", required_argument, 0, 'n'},
@@ -128,6 +234,22 @@ int main(int argc, char** argv) {
       {"timeout", required_argument, 0, 't'},
       {"rexmt-timeout", required_argument, 0, 'r'},
       {"literal-mode", no_argument, 0, 'l'},
+      {"verbose", no_argument, 0, 'v'},
+      {"metrics", required_argument, 0, 'M'},
+      {"metrics-format", required_argument, 0, 'F'},
+      {"metrics-files", required_argument, 0, 'L'},
+      {"command", required_argument, 0, 'c'},
+      {"file", required_argument, 0, 'f'},
+      {"jobs", required_argument, 0, 'j'},
+      {"host-jobs", required_argument, 0, 'J'},
+      {"windowsize", required_argument, 0, 'w'},
+      {"rate", required_argument, 0, 'b'},
+      {"total-rate", required_argument, 0, 'B'},
+      {"rollover", required_argument, 0, 'O'},
+      {"direct", no_argument, 0, 'D'},
+      {"fsync", required_argument, 0, 'S'},
+      {"busy-poll", required_argument, 0, 'P'},
+      {"trace-file", required_argument, 0, 'T'},
       {"help", no_argument, 0, 'h'},
       {0, 0, 0, 0},
   };
@@ -138,11 +260,29 @@ int main(int argc, char** argv) {
   tftp::Seconds timeout = 60;
   tftp::Seconds rexmt_timeout = 10;
   bool literal_mode = false;
+  bool verbose = false;
+  std::string metrics_target;
+  tftp::client::MetricsFormat metrics_format =
+      tftp::client::MetricsFormat::kJsonLines;
+  std::size_t metrics_files = 0;
+  std::string script;
+  bool batch_mode = false;
+  std::size_t jobs = tftp::client::kDefaultJobs;
+  std::size_t host_jobs = 0;
+  uint16_t windowsize = 1;
+  uint64_t rate = 0;
+  uint64_t total_rate = 0;
+  std::optional<tftp::Rollover> rollover;
+  bool direct_io = false;
+  tftp::FsyncPolicy fsync = tftp::FsyncPolicy::kNever;
+  uint32_t busy_poll = 0;
+  std::string trace_file;
 
   int opt = 0;
   int long_index = 0;
-  while ((opt = ::getopt_long(argc, argv, "n:m:p:R:t:r:lh", &kLongOpts[0],
-                              &long_index)) != -1) {
+  while ((opt = ::getopt_long(argc, argv,
+                              "n:m:p:R:t:r:lvM:F:L:c:f:j:J:w:b:B:O:DS:P:T:h",
+                              &kLongOpts[0], &long_index)) != -1) {
     switch (opt) {
       case 'n':
         hostname = optarg;
@@ -190,6 +330,99 @@ int main(int argc, char** argv) {
       case 'l':
         literal_mode = true;
         break;
+      case 'v':
+        verbose = true;
+        break;
+      case 'M':
+        metrics_target = optarg;
+        break;
+      case 'F': {
+        auto parsed_format = tftp::client::ParseMetricsFormat(optarg);
+        if (!parsed_format) {
+          PrintErrAndExit(tftp::kParseStatusToStr[parsed_format.error()]);
+        }
+        metrics_format = *parsed_format;
+        break;
+      }
+      case 'L': {
+        auto parsed_series = tftp::client::ParseFileSeries(optarg);
+        if (!parsed_series) {
+          PrintErrAndExit(tftp::kParseStatusToStr[parsed_series.error()]);
+        }
+        metrics_files = *parsed_series;
+        break;
+      }
+      case 'c':
+        script += std::string(optarg) + "\n";
+        batch_mode = true;
+        break;
+      case 'f': {
+        std::ifstream script_file(optarg);
+        if (!script_file) {
+          PrintErrAndExit("unable to open script '" + std::string(optarg) +
+                          "'");
+        }
+        script.append(std::istreambuf_iterator<char>(script_file), {});
+        script += "\n";
+        batch_mode = true;
+        break;
+      }
+      case 'j':
+      case 'J': {
+        auto parsed_jobs = tftp::client::ParseJobs(optarg);
+        if (!parsed_jobs) {
+          PrintErrAndExit(tftp::kParseStatusToStr[parsed_jobs.error()]);
+        }
+        ((opt == 'j') ? jobs : host_jobs) = *parsed_jobs;
+        break;
+      }
+      case 'w': {
+        auto parsed_window = tftp::ParseWindowSize(optarg);
+        if (!parsed_window) {
+          PrintErrAndExit(tftp::kParseStatusToStr[parsed_window.error()]);
+        }
+        windowsize = *parsed_window;
+        break;
+      }
+      case 'b':
+      case 'B': {
+        auto parsed_rate = tftp::ParseRate(optarg);
+        if (!parsed_rate) {
+          PrintErrAndExit(tftp::kParseStatusToStr[parsed_rate.error()]);
+        }
+        ((opt == 'b') ? rate : total_rate) = *parsed_rate;
+        break;
+      }
+      case 'O': {
+        auto parsed_rollover = tftp::ParseRollover(optarg);
+        if (!parsed_rollover) {
+          PrintErrAndExit(tftp::kParseStatusToStr[parsed_rollover.error()]);
+        }
+        rollover = *parsed_rollover;
+        break;
+      }
+      case 'D':
+        direct_io = true;
+        break;
+      case 'S': {
+        auto parsed_fsync = tftp::ParseFsyncPolicy(optarg);
+        if (!parsed_fsync) {
+          PrintErrAndExit(tftp::kParseStatusToStr[parsed_fsync.error()]);
+        }
+        fsync = *parsed_fsync;
+        break;
+      }
+      case 'P': {
+        auto parsed_busy_poll = tftp::ParseBusyPoll(optarg);
+        if (!parsed_busy_poll) {
+          PrintErrAndExit(tftp::kParseStatusToStr[parsed_busy_poll.error()]);
+        }
+        busy_poll = *parsed_busy_poll;
+        break;
+      }
+      case 'T':
+        trace_file = optarg;
+        break;
       case 'h':
         PrintUsage();
         std::exit(EXIT_SUCCESS);
@@ -202,7 +435,47 @@ int main(int argc, char** argv) {
 
   tftp::client::Config conf(mode, port_range, literal_mode, hostname, timeout,
                             rexmt_timeout);
-  RunCmdShell(conf);
+  conf.verbose = verbose;
+  conf.windowsize = windowsize;
+  conf.rate = rate;
+  conf.rollover = rollover;
+  conf.direct_io = direct_io;
+  conf.fsync = fsync;
+  conf.busy_poll = busy_poll;
+  conf.scheduler = std::make_shared<tftp::client::TransferScheduler>(
+      jobs, tftp::client::JobLimits(jobs, host_jobs));
+  if (total_rate) {
+    conf.global_pacer = std::make_shared<tftp::client::TokenBucket>(total_rate);
+  }
+  if (!metrics_target.empty()) {
+    auto sink = tftp::client::MetricsSink::Create(
+        metrics_target, metrics_format, metrics_files);
+    if (!sink) {
+      PrintErrAndExit(sink.error());
+    }
+    conf.metrics = std::move(*sink);
+  }
+  if (!trace_file.empty()) {
+    auto tracer = tftp::Tracer::Create(trace_file);
+    if (!tracer) {
+      PrintErrAndExit(tracer.error());
+    }
+    conf.tracer = std::move(*tracer);
+  }
+  conf.servers = tftp::client::ServerPool::FromList(hostname);
+  if (conf.servers) {
+    conf.servers->Probe(conf, conf.server_port);
+  }
+
+  bool success = true;
+  if (batch_mode) {
+    success = RunBatch(conf, script);
+  } else {
+    RunCmdShell(conf);
+  }
+  /* exit() skips destructors, flush the trace and the metrics now. */
+  conf.tracer.reset();
+  conf.metrics.reset();
 
-  std::exit(EXIT_SUCCESS);
+  std::exit(success ? EXIT_SUCCESS : EXIT_FAILURE);
 }
@@ -0,0 +1,136 @@
+#include <getopt.h>
+
+#include <atomic>
+#include <csignal>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "common/parse.h"
+#include "common/types.h"
+#include "common/udp_socket.h"
+#include "proxy/impairment.h"
+#include "proxy/proxy.h"
+
+static std::atomic<bool> stop = false;
+
+static void PrintUsage() {
+  std::cout << "usage: tftpc-proxy [OPTION]..." << std::endl;
+  std::cout << "impair the traffic between a tftp client and server"
+            << std::endl;
+  std::cout << "\t-n, --hostname HOSTNAME\n\t\tthe server's IPv4 address or "
+               "domain name"
+            << std::endl;
+  std::cout << "\t-p, --port PORTNUM\n\t\tthe server's port, 6969 by default"
+            << std::endl;
+  std::cout << "\t-l, --listen-port PORTNUM\n\t\tthe port clients send "
+               "requests to, 69 by default"
+            << std::endl;
+  std::cout << "\t-i, --impair PROFILE\n\t\ta preset ('clean', 'lan', 'wan' "
+               "or 'lossy') and/or settings,\n\t\te.g. "
+               "'wan,loss=0.02,dup=0.01,reorder=0.01,delay=20,jitter=5'"
+            << std::endl;
+  std::cout << "\t-s, --seed SEED\n\t\tseed for the impairment decisions"
+            << std::endl;
+  std::cout << "\t-v, --verbose\n\t\tlog what happens to every packet"
+            << std::endl;
+  std::cout << "\t-h, --help\n\t\tprint this help message" << std::endl;
+}
+
+static void PrintErrAndExit(std::string_view err_msg) {
+  std::cout << "error: " << err_msg << std::endl;
+  std::exit(EXIT_FAILURE);
+}
+
+static void Stop(int) { stop = true; }
+
+int main(int argc, char** argv) {
+  const std::vector<struct option> kLongOpts{
+      {"hostname", required_argument, 0, 'n'},
+      {"port", required_argument, 0, 'p'},
+      {"listen-port", required_argument, 0, 'l'},
+      {"impair", required_argument, 0, 'i'},
+      {"seed", required_argument, 0, 's'},
+      {"verbose", no_argument, 0, 'v'},
+      {"help", no_argument, 0, 'h'},
+      {0, 0, 0, 0},
+  };
+
+  tftp::Hostname hostname = "localhost";
+  uint16_t port = 6969;
+  uint16_t listen_port = 69;
+  std::string spec = "clean";
+  std::string seed;
+  bool verbose = false;
+
+  int opt = 0;
+  int long_index = 0;
+  while ((opt = ::getopt_long(argc, argv, "n:p:l:i:s:vh", &kLongOpts[0],
+                              &long_index)) != -1) {
+    switch (opt) {
+      case 'n':
+        hostname = optarg;
+        break;
+      case 'p':
+      case 'l': {
+        auto parsed_port = tftp::ParsePort(optarg);
+        if (!parsed_port) {
+          PrintErrAndExit(tftp::kParseStatusToStr[parsed_port.error()]);
+        }
+        ((opt == 'p') ? port : listen_port) = *parsed_port;
+        break;
+      }
+      case 'i':
+        spec = optarg;
+        break;
+      case 's':
+        seed = optarg;
+        break;
+      case 'v':
+        verbose = true;
+        break;
+      case 'h':
+        PrintUsage();
+        std::exit(EXIT_SUCCESS);
+        break;
+      case '?':
+        std::cerr << "run 'tftpc-proxy --help' for usage info" << std::endl;
+        std::exit(EXIT_FAILURE);
+    }
+  }
+
+  auto profile =
+      tftp::proxy::ParseProfile(seed.empty() ? spec : spec + ",seed=" + seed);
+  if (!profile) {
+    PrintErrAndExit(profile.error());
+  }
+
+  auto server = tftp::ResolveAddr(hostname);
+  if (!server) {
+    PrintErrAndExit(server.error());
+  }
+  server->SetPort(port);
+
+  auto proxy = tftp::proxy::Proxy::Create(listen_port, *server, *profile,
+                                          (verbose) ? &std::cout : nullptr);
+  if (!proxy) {
+    PrintErrAndExit(proxy.error());
+  }
+
+  std::signal(SIGINT, Stop);
+  std::signal(SIGTERM, Stop);
+  auto ran = proxy->Run(stop);
+  if (!ran) {
+    PrintErrAndExit(ran.error());
+  }
+
+  const tftp::proxy::ProxyStats& stats = proxy->Stats();
+  std::cout << "received " << stats.received << ", forwarded "
+            << stats.forwarded << ", dropped " << stats.dropped
+            << ", duplicated " << stats.duplicated << ", reordered "
+            << stats.reordered << std::endl;
+  std::exit(EXIT_SUCCESS);
+}
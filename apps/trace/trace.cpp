@@ -0,0 +1,236 @@
+#include <getopt.h>
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <ctime>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "client/config.h"
+#include "client/replay.h"
+#include "common/tracer.h"
+#include "common/types.h"
+
+static void PrintUsage() {
+  std::cout << "usage: tftpc-trace [OPTION]... TRACE_FILE" << std::endl;
+  std::cout << "print the transfers recorded in a tftpc trace file"
+            << std::endl;
+  std::cout << "\t-g, --gap MILLISECONDS\n\t\treport silences at least this "
+               "long within a transfer, 200 by\n\t\tdefault"
+            << std::endl;
+  std::cout << "\t-s, --summary\n\t\tprint only each transfer's summary, "
+               "not its events"
+            << std::endl;
+  std::cout << "\t-r, --replay COUNT\n\t\treplay each transfer through the "
+               "client's engine COUNT times\n\t\tand report what it costs "
+               "per event"
+            << std::endl;
+  std::cout << "\t-w, --windowsize NUM\n\t\tthe windowsize the traced "
+               "transfers asked for, 1 by\n\t\tdefault"
+            << std::endl;
+  std::cout << "\t-h, --help\n\t\tprint this help message" << std::endl;
+}
+
+static void PrintErrAndExit(std::string_view err_msg) {
+  std::cout << "error: " << err_msg << std::endl;
+  std::exit(EXIT_FAILURE);
+}
+
+static std::string_view OpcodeName(uint8_t opcode) {
+  static constexpr std::array<std::string_view, 7> kNames = {
+      "?", "RRQ", "WRQ", "DATA", "ACK", "ERROR", "OACK"};
+  return (opcode < kNames.size()) ? kNames[opcode] : kNames[0];
+}
+
+static std::string_view EventName(tftp::TraceEvent event) {
+  switch (event) {
+    case tftp::TraceEvent::kSend:
+      return "sent";
+    case tftp::TraceEvent::kResend:
+      return "resent";
+    case tftp::TraceEvent::kRecv:
+      return "received";
+    case tftp::TraceEvent::kTimeout:
+      return "timed out";
+  }
+  return "?";
+}
+
+static double Seconds(uint64_t ns) { return ns / 1e9; }
+static double Millis(uint64_t ns) { return ns / 1e6; }
+
+static void PrintEvent(const tftp::TraceRecord& record) {
+  std::cout << "  " << std::setw(12) << Seconds(record.time_ns) << "  "
+            << std::left << std::setw(9) << EventName(record.event);
+  if (record.event != tftp::TraceEvent::kTimeout) {
+    std::string packet(OpcodeName(record.opcode));
+    if (record.opcode == tftp::OpCode::kData ||
+        record.opcode == tftp::OpCode::kAck) {
+      packet += " " + std::to_string(record.block);
+    }
+    std::cout << std::setw(11) << packet << std::right << std::setw(6)
+              << record.length << " bytes  " << tftp::TracePeer(record);
+  }
+  std::cout << std::right << std::endl;
+}
+
+static void PrintTimeline(const tftp::TraceTimeline& timeline,
+                          bool summary_only) {
+  std::cout << "transfer on port " << timeline.local_port << " with "
+            << tftp::TracePeer(timeline.events.front()) << ", "
+            << timeline.events.size() << " events" << std::endl;
+  if (!summary_only) {
+    for (const tftp::TraceRecord& record : timeline.events) {
+      PrintEvent(record);
+    }
+  }
+
+  uint64_t span =
+      timeline.events.back().time_ns - timeline.events.front().time_ns;
+  std::cout << "  " << Seconds(span) << " s, sent " << timeline.sent
+            << ", resent " << timeline.resent << ", received "
+            << timeline.received << ", timeouts " << timeline.timeouts
+            << std::endl;
+
+  const std::vector<uint64_t>& rtts = timeline.rtts_ns;
+  if (!rtts.empty()) {
+    auto [min, max] = std::ranges::minmax(rtts);
+    uint64_t sum = std::accumulate(rtts.cbegin(), rtts.cend(), uint64_t{0});
+    std::cout << "  rtt min " << Millis(min) << " ms, avg "
+              << Millis(sum / rtts.size()) << " ms, max " << Millis(max)
+              << " ms over " << rtts.size() << " samples" << std::endl;
+  }
+  for (const tftp::TraceGap& gap : timeline.gaps) {
+    std::cout << "  gap of " << Millis(gap.length_ns) << " ms after "
+              << Seconds(gap.after_ns) << " s" << std::endl;
+  }
+}
+
+template <typename T>
+static T ParseNumber(std::string_view arg, std::string_view err_msg) {
+  T value = 0;
+  auto [end, err] = std::from_chars(arg.data(), arg.data() + arg.size(), value);
+  if (err != std::errc() || end != arg.data() + arg.size()) {
+    PrintErrAndExit(err_msg);
+  }
+  return value;
+}
+
+/* Replays are octet and on the default timers, traces don't record the
+   mode or the options asked for. */
+static void ReplayTimeline(const tftp::TraceTimeline& timeline,
+                           uint64_t count, uint16_t windowsize) {
+  tftp::client::Config conf(tftp::SendMode::kOctet, {.start = 0, .end = 0},
+                            false, "127.0.0.1", 0, 1);
+  conf.windowsize = windowsize;
+  auto scenario = tftp::client::ScenarioFromTimeline(timeline, conf);
+  if (!scenario) {
+    std::cout << "  can't replay: " << scenario.error().msg << std::endl;
+    return;
+  }
+
+  std::chrono::nanoseconds busy{0};
+  std::chrono::nanoseconds slowest{0};
+  uint64_t events = 0;
+  for (uint64_t i = 0; i < count; ++i) {
+    tftp::client::ReplayResult result = tftp::client::Replay(conf, *scenario);
+    if (!i) {
+      if (!result.outcome) {
+        std::cout << "  replay failed: " << result.outcome.error().msg
+                  << std::endl;
+      }
+      if (result.divergence) {
+        std::cout << "  replay diverged, " << *result.divergence
+                  << std::endl;
+      }
+    }
+    busy += result.busy;
+    slowest = std::max(slowest, result.slowest);
+    events += result.events;
+  }
+  if (events) {
+    std::cout << "  replayed " << count << " times, "
+              << busy.count() / 1e3 / events << " us per event, slowest "
+              << slowest.count() / 1e3 << " us, "
+              << events / (busy.count() / 1e9) << " events/s" << std::endl;
+  }
+}
+
+int main(int argc, char** argv) {
+  const std::vector<struct option> kLongOpts{
+      {"gap", required_argument, 0, 'g'},
+      {"summary", no_argument, 0, 's'},
+      {"replay", required_argument, 0, 'r'},
+      {"windowsize", required_argument, 0, 'w'},
+      {"help", no_argument, 0, 'h'},
+      {0, 0, 0, 0},
+  };
+
+  uint64_t gap_ms = 200;
+  bool summary_only = false;
+  uint64_t replays = 0;
+  uint16_t windowsize = 1;
+
+  int opt = 0;
+  int long_index = 0;
+  while ((opt = ::getopt_long(argc, argv, "g:sr:w:h", &kLongOpts[0],
+                              &long_index)) != -1) {
+    switch (opt) {
+      case 'g':
+        gap_ms = ParseNumber<uint64_t>(
+            optarg, "gap must be a whole number of milliseconds");
+        break;
+      case 's':
+        summary_only = true;
+        break;
+      case 'r':
+        replays = ParseNumber<uint64_t>(optarg, "invalid replay count");
+        break;
+      case 'w':
+        windowsize = ParseNumber<uint16_t>(optarg, "invalid windowsize");
+        if (!windowsize) {
+          PrintErrAndExit("invalid windowsize");
+        }
+        break;
+      case 'h':
+        PrintUsage();
+        std::exit(EXIT_SUCCESS);
+        break;
+      case '?':
+        std::cerr << "run 'tftpc-trace --help' for usage info" << std::endl;
+        std::exit(EXIT_FAILURE);
+    }
+  }
+  if (optind != argc - 1) {
+    PrintErrAndExit("expected one trace file");
+  }
+
+  auto trace = tftp::ReadTrace(argv[optind]);
+  if (!trace) {
+    PrintErrAndExit(trace.error());
+  }
+
+  std::time_t start = trace->start_unix_ns / 1000000000;
+  std::tm local = {};
+  localtime_r(&start, &local);
+  std::cout << "trace started " << std::put_time(&local, "%F %T %Z") << ", "
+            << trace->records.size() << " events" << std::endl;
+
+  std::cout << std::fixed << std::setprecision(6);
+  for (const tftp::TraceTimeline& timeline :
+       tftp::BuildTimelines(*trace, gap_ms * 1000000)) {
+    PrintTimeline(timeline, summary_only);
+    if (replays) {
+      ReplayTimeline(timeline, replays, windowsize);
+    }
+  }
+  std::exit(EXIT_SUCCESS);
+}
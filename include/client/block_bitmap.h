@@ -0,0 +1,30 @@
+#ifndef BLOCK_BITMAP_H_
+#define BLOCK_BITMAP_H_
+
+#include <cstdint>
+#include <vector>
+
+namespace tftp {
+namespace client {
+
+class BlockBitmap {
+ public:
+  bool Set(uint64_t block);
+  bool Test(uint64_t block) const;
+
+  uint64_t FirstMissing() const { return first_missing_; }
+  uint64_t Count() const { return count_; }
+  bool Complete(uint64_t last_block) const {
+    return first_missing_ > last_block;
+  }
+
+ private:
+  std::vector<uint64_t> words_;
+  uint64_t first_missing_ = 1;
+  uint64_t count_ = 0;
+};
+
+}  // namespace client
+}  // namespace tftp
+
+#endif
@@ -4,11 +4,13 @@
 #include <cstdint>
 #include <expected>
 #include <memory>
+#include <optional>
 #include <string>
 #include <string_view>
 #include <vector>
 
 #include "client/config.h"
+#include "client/congestion.h"
 #include "common/parse.h"
 #include "common/types.h"
 
@@ -34,18 +36,32 @@ constexpr Id kStatus = "status";
 constexpr Id kTimeout = "timeout";
 constexpr Id kRexmt = "rexmt";
 constexpr Id kHelp = "help";
+constexpr Id kVerbose = "verbose";
+constexpr Id kTrace = "trace";
+constexpr Id kMulticast = "multicast";
+constexpr Id kWindowSize = "windowsize";
+constexpr Id kCongestion = "congestion";
+constexpr Id kRate = "rate";
+constexpr Id kRollover = "rollover";
+constexpr Id kDirect = "direct";
+constexpr Id kSync = "sync";
+constexpr Id kFsync = "fsync";
+constexpr Id kBusyPoll = "busypoll";
 }  // namespace CmdId
 
 enum ExecStatus : int {
   kSuccessfulExec = 0,
   kNotImplemented,
   kUnknownCmdHelp,
+  kTransferFailed,
+  kInvalidManifest,
   kExecStatusCnt,
 };
 
 constexpr std::array<const char*, ExecStatus::kExecStatusCnt> kExecStatusToStr =
     {"success", "command not implemented",
-     "cannot output help message, unknown cmd"};
+     "cannot output help message, unknown cmd", "transfer failed",
+     "invalid manifest"};
 
 class Cmd {
  public:
@@ -223,6 +239,193 @@ class RexmtCmd : public Cmd {
   Seconds rexmt_timeout_;
 };
 
+class VerboseCmd : public Cmd {
+ public:
+  static ExpectedCmd<VerboseCmd> Create();
+  static void PrintUsage();
+
+  virtual ~VerboseCmd() = default;
+
+  ExecStatus Execute(Config& conf) final;
+
+ private:
+  VerboseCmd() : Cmd(CmdId::kVerbose) {}
+};
+
+class TraceCmd : public Cmd {
+ public:
+  static ExpectedCmd<TraceCmd> Create();
+  static void PrintUsage();
+
+  virtual ~TraceCmd() = default;
+
+  ExecStatus Execute(Config& conf) final;
+
+ private:
+  TraceCmd() : Cmd(CmdId::kTrace) {}
+};
+
+class MulticastCmd : public Cmd {
+ public:
+  static ExpectedCmd<MulticastCmd> Create();
+  static void PrintUsage();
+
+  virtual ~MulticastCmd() = default;
+
+  ExecStatus Execute(Config& conf) final;
+
+ private:
+  MulticastCmd() : Cmd(CmdId::kMulticast) {}
+};
+
+class WindowSizeCmd : public Cmd {
+ public:
+  static ExpectedCmd<WindowSizeCmd> Create(std::string_view cmdline);
+  static void PrintUsage();
+
+  virtual ~WindowSizeCmd() = default;
+
+  ExecStatus Execute(Config& conf) final;
+
+  uint16_t WindowSize() const { return windowsize_; }
+
+ private:
+  WindowSizeCmd() = delete;
+  explicit WindowSizeCmd(uint16_t windowsize)
+      : Cmd(CmdId::kWindowSize), windowsize_(windowsize) {}
+
+  uint16_t windowsize_;
+};
+
+class CongestionCmd : public Cmd {
+ public:
+  static ExpectedCmd<CongestionCmd> Create(std::string_view cmdline);
+  static void PrintUsage();
+
+  virtual ~CongestionCmd() = default;
+
+  ExecStatus Execute(Config& conf) final;
+
+  CongestionMode Mode() const { return mode_; }
+
+ private:
+  CongestionCmd() = delete;
+  explicit CongestionCmd(CongestionMode mode)
+      : Cmd(CmdId::kCongestion), mode_(mode) {}
+
+  CongestionMode mode_;
+};
+
+class RateCmd : public Cmd {
+ public:
+  static ExpectedCmd<RateCmd> Create(std::string_view cmdline);
+  static void PrintUsage();
+
+  virtual ~RateCmd() = default;
+
+  ExecStatus Execute(Config& conf) final;
+
+  uint64_t Rate() const { return rate_; }
+  std::optional<uint64_t> GlobalRate() const { return global_rate_; }
+
+ private:
+  RateCmd() = delete;
+  RateCmd(uint64_t rate, std::optional<uint64_t> global_rate)
+      : Cmd(CmdId::kRate), rate_(rate), global_rate_(global_rate) {}
+
+  uint64_t rate_;
+  std::optional<uint64_t> global_rate_;
+};
+
+class RolloverCmd : public Cmd {
+ public:
+  static ExpectedCmd<RolloverCmd> Create(std::string_view cmdline);
+  static void PrintUsage();
+
+  virtual ~RolloverCmd() = default;
+
+  ExecStatus Execute(Config& conf) final;
+
+  std::optional<Rollover> Value() const { return rollover_; }
+
+ private:
+  RolloverCmd() = delete;
+  explicit RolloverCmd(std::optional<Rollover> rollover)
+      : Cmd(CmdId::kRollover), rollover_(rollover) {}
+
+  std::optional<Rollover> rollover_;
+};
+
+class DirectCmd : public Cmd {
+ public:
+  static ExpectedCmd<DirectCmd> Create();
+  static void PrintUsage();
+
+  virtual ~DirectCmd() = default;
+
+  ExecStatus Execute(Config& conf) final;
+
+ private:
+  DirectCmd() : Cmd(CmdId::kDirect) {}
+};
+
+class FsyncCmd : public Cmd {
+ public:
+  static ExpectedCmd<FsyncCmd> Create(std::string_view cmdline);
+  static void PrintUsage();
+
+  virtual ~FsyncCmd() = default;
+
+  ExecStatus Execute(Config& conf) final;
+
+  FsyncPolicy Policy() const { return policy_; }
+
+ private:
+  FsyncCmd() = delete;
+  explicit FsyncCmd(FsyncPolicy policy)
+      : Cmd(CmdId::kFsync), policy_(policy) {}
+
+  FsyncPolicy policy_;
+};
+
+class BusyPollCmd : public Cmd {
+ public:
+  static ExpectedCmd<BusyPollCmd> Create(std::string_view cmdline);
+  static void PrintUsage();
+
+  virtual ~BusyPollCmd() = default;
+
+  ExecStatus Execute(Config& conf) final;
+
+  uint32_t Usecs() const { return usecs_; }
+
+ private:
+  BusyPollCmd() = delete;
+  explicit BusyPollCmd(uint32_t usecs)
+      : Cmd(CmdId::kBusyPoll), usecs_(usecs) {}
+
+  uint32_t usecs_;
+};
+
+class SyncCmd : public Cmd {
+ public:
+  static ExpectedCmd<SyncCmd> Create(std::string_view cmdline);
+  static void PrintUsage();
+
+  virtual ~SyncCmd() = default;
+
+  ExecStatus Execute(Config& conf) final;
+
+  const File& ManifestFile() const { return manifest_file_; }
+
+ private:
+  SyncCmd() = delete;
+  explicit SyncCmd(const File& manifest_file)
+      : Cmd(CmdId::kSync), manifest_file_(manifest_file) {}
+
+  File manifest_file_;
+};
+
 class HelpCmd : public Cmd {
  public:
   static ExpectedCmd<HelpCmd> Create(std::string_view cmdline);
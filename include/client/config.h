@@ -1,18 +1,61 @@
 #ifndef CONFIG_H_
 #define CONFIG_H_
 
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <optional>
+
+#include "client/congestion.h"
+#include "client/packet_cache.h"
+#include "client/pacer.h"
+#include "client/scheduler.h"
+#include "client/stats.h"
+#include "common/resolver.h"
+#include "common/tracer.h"
 #include "common/types.h"
 
 namespace tftp {
 namespace client {
 
+class MetricsSink;
+class ServerPool;
+
+constexpr uint16_t kDefaultServerPort = 69;
+
 struct Config {
   tftp::Mode mode = SendMode::kNetAscii;
   struct PortRange ports = {.start = 0, .end = 0};
   bool literal_mode = false;
   Hostname hostname = "localhost";
+  std::shared_ptr<ServerPool> servers; /* Set when hostname lists several. */
+  uint16_t server_port = kDefaultServerPort;
   Seconds timeout = 0;
   Seconds rexmt_timeout = 0;
+  /* Resends of an unanswered request before giving up on the server, 0
+     waits out the timeout. */
+  uint32_t request_retries = 0;
+  bool verbose = false;
+  bool trace = false;
+  /* Where transfers report, stderr while a get streams to stdout. */
+  std::ostream* console = &std::cout;
+  bool multicast = false;
+  bool direct_io = false; /* Downloads bypass the page cache. */
+  FsyncPolicy fsync = FsyncPolicy::kNever;
+  uint16_t windowsize = 1;
+  std::optional<Rollover> rollover; /* Requested when set. */
+  CongestionMode congestion = CongestionMode::kAimd;
+  uint64_t rate = 0; /* Per transfer pacing in bytes per second, 0 is off. */
+  uint32_t busy_poll = 0; /* Microseconds reads spin before sleeping. */
+  std::shared_ptr<TokenBucket> global_pacer;
+  std::shared_ptr<TransferScheduler> scheduler; /* Null runs serially. */
+  /* Shared by every copy, like the console. */
+  std::shared_ptr<SessionStats> stats = std::make_shared<SessionStats>();
+  TransferTally* tally = nullptr; /* Set while the scheduler runs a copy. */
+  std::shared_ptr<MetricsSink> metrics;
+  std::shared_ptr<Tracer> tracer; /* Null records nothing. */
+  std::shared_ptr<ResolverCache> resolver = std::make_shared<ResolverCache>();
+  std::shared_ptr<PacketCache> packets = std::make_shared<PacketCache>();
 
   Config(const tftp::Mode& mode_, const struct PortRange& port_range_,
          bool literal_mode_, const Hostname& hostname_, Seconds timeout_,
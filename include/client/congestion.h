@@ -0,0 +1,54 @@
+#ifndef CONGESTION_H_
+#define CONGESTION_H_
+
+#include <cstdint>
+#include <expected>
+#include <optional>
+#include <string_view>
+
+#include "client/stats.h"
+#include "common/parse.h"
+
+namespace tftp {
+namespace client {
+
+enum class CongestionMode {
+  kFixed,
+  kAimd,
+  kDelay,
+};
+
+std::expected<CongestionMode, ParseStatus> ParseCongestionMode(
+    std::string_view val);
+std::string_view CongestionModeName(CongestionMode mode);
+
+/* Sizes the sender's effective window within the negotiated windowsize. */
+class CongestionController {
+ public:
+  static constexpr uint16_t kInitialWindow = 4;
+
+  CongestionController(CongestionMode mode, uint16_t max_window);
+
+  uint16_t Window() const { return cwnd_; }
+
+  void OnAck(uint64_t acked, std::optional<Micros> rtt);
+  void OnDupAck(uint64_t acked_block, uint64_t next_block);
+  void OnTimeout(uint64_t next_block);
+
+ private:
+  void Decrease(uint64_t next_block);
+  void SampleDelay(Micros rtt);
+
+  CongestionMode mode_;
+  uint16_t max_window_;
+  uint16_t cwnd_;
+  uint64_t credit_ = 0;
+  uint64_t recover_ = 0;
+  Micros base_rtt_ = Micros::max();
+  Micros rtt_ = Micros::zero();
+};
+
+}  // namespace client
+}  // namespace tftp
+
+#endif
@@ -0,0 +1,244 @@
+#ifndef FILE_SINK_H_
+#define FILE_SINK_H_
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <expected>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "client/transfer.h"
+#include "common/types.h"
+
+namespace tftp {
+namespace client {
+
+/* Where a download's bytes go. */
+class FileSink {
+ public:
+  virtual ~FileSink() = default;
+
+  virtual std::expected<void, TransferErr> Write(const uint8_t* data,
+                                                 std::size_t len) = 0;
+
+  /* Writes at offset without moving on, for blocks that arrive out of
+     order. Only sinks on a plain file can. */
+  virtual std::expected<void, TransferErr> WriteAt(
+      [[gnu::unused]] uint64_t offset, [[gnu::unused]] const uint8_t* data,
+      [[gnu::unused]] std::size_t len) {
+    return std::unexpected("unable to write out of order");
+  }
+
+  /* Sets aside disk space for a file about this big, so it ends up in one
+     piece. Only a hint, the file still ends where the writes do. */
+  virtual void Reserve([[gnu::unused]] uint64_t size) {}
+
+  /* Writes out whatever is still buffered, the file is complete once this
+     succeeds. */
+  virtual std::expected<void, TransferErr> Close() = 0;
+};
+
+/* Writes through the page cache like any other file. Blocks are gathered
+   and written kBufferSize at a time, not a syscall per block. */
+class StreamSink : public FileSink {
+ public:
+  static constexpr std::size_t kBufferSize = 256 << 10;
+
+  static std::expected<std::unique_ptr<StreamSink>, TransferErr> Open(
+      const std::string& path);
+
+  ~StreamSink() override;
+  StreamSink(const StreamSink&) = delete;
+  StreamSink& operator=(const StreamSink&) = delete;
+
+  std::expected<void, TransferErr> Write(const uint8_t* data,
+                                         std::size_t len) override;
+  std::expected<void, TransferErr> WriteAt(uint64_t offset,
+                                           const uint8_t* data,
+                                           std::size_t len) override;
+  void Reserve(uint64_t size) override;
+  std::expected<void, TransferErr> Close() override;
+
+ private:
+  StreamSink(const std::string& path, int fd) : path_(path), fd_(fd) {
+    buffer_.reserve(kBufferSize);
+  }
+
+  std::expected<void, TransferErr> Flush();
+
+  std::string path_;
+  int fd_ = -1;
+  std::vector<uint8_t> buffer_;
+};
+
+/* Gathers blocks into aligned chunks and writes them with O_DIRECT, so a
+   huge download streams to disk without filling the page cache. A writer
+   thread drains one chunk while the next fills. The tail at EOF is padded
+   out to the alignment and the file truncated back to its real size.
+   Filesystems that refuse O_DIRECT get buffered writes that are flushed
+   and dropped from the cache chunk by chunk instead. */
+class DirectSink : public FileSink {
+ public:
+  static constexpr std::size_t kChunkSize = 1 << 20;
+  static constexpr std::size_t kDefaultAlignment = 4096;
+
+  static std::expected<std::unique_ptr<DirectSink>, TransferErr> Open(
+      const std::string& path);
+
+  ~DirectSink() override;
+  DirectSink(const DirectSink&) = delete;
+  DirectSink& operator=(const DirectSink&) = delete;
+
+  /* False when the filesystem refused O_DIRECT. */
+  bool Direct() const { return direct_; }
+  std::size_t Alignment() const { return alignment_; }
+
+  std::expected<void, TransferErr> Write(const uint8_t* data,
+                                         std::size_t len) override;
+  void Reserve(uint64_t size) override;
+  std::expected<void, TransferErr> Close() override;
+
+ private:
+  struct Free {
+    void operator()(uint8_t* p) const { std::free(p); }
+  };
+  using Buffer = std::unique_ptr<uint8_t[], Free>;
+
+  struct Chunk {
+    uint8_t* data = nullptr;
+    std::size_t len = 0;
+    uint64_t offset = 0;
+  };
+
+  DirectSink(const std::string& path, int fd, bool direct,
+             std::size_t alignment, Buffer front, Buffer back);
+
+  void Loop();
+  std::expected<void, TransferErr> Submit(std::size_t len);
+  std::expected<void, TransferErr> Drain();
+
+  std::string path_;
+  int fd_ = -1;
+  bool direct_ = true;
+  std::size_t alignment_ = kDefaultAlignment;
+  Buffer front_; /* Filling. */
+  Buffer back_;  /* With the writer. */
+  std::size_t fill_ = 0;
+  uint64_t offset_ = 0; /* Of front_ in the file. */
+  uint64_t size_ = 0;
+  bool closed_ = false;
+
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::optional<Chunk> pending_;
+  std::optional<std::string> error_;
+  bool stop_ = false;
+  std::jthread writer_;
+};
+
+/* Streams to a pipe or terminal through a bounded buffer drained by a
+   writer thread. Write blocks while the buffer is full, so a slow reader
+   slows the transfer down instead of growing memory. The descriptor is
+   left open. */
+class PipeSink : public FileSink {
+ public:
+  static constexpr std::size_t kDefaultCapacity = 4 << 20;
+
+  static std::expected<std::unique_ptr<PipeSink>, TransferErr> Open(
+      int fd, const std::string& name,
+      std::size_t capacity = kDefaultCapacity);
+
+  ~PipeSink() override;
+  PipeSink(const PipeSink&) = delete;
+  PipeSink& operator=(const PipeSink&) = delete;
+
+  std::expected<void, TransferErr> Write(const uint8_t* data,
+                                         std::size_t len) override;
+  std::expected<void, TransferErr> Close() override;
+
+ private:
+  PipeSink(int fd, const std::string& name, std::size_t capacity);
+
+  void Loop();
+
+  int fd_ = -1;
+  std::string name_;
+  std::vector<uint8_t> ring_;
+  std::size_t head_ = 0;     /* Next byte to write out. */
+  std::size_t buffered_ = 0; /* Bytes from head_ on, wrapping. */
+  bool closing_ = false;
+
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::optional<std::string> error_;
+  std::jthread writer_;
+};
+
+/* A PipeSink on stdout for kStdStream, else a DirectSink when direct is
+   set and a StreamSink otherwise. */
+std::expected<std::unique_ptr<FileSink>, TransferErr> OpenFileSink(
+    const std::string& path, bool direct);
+
+/* A name beside path no other download, in this process or another, is
+   writing to. */
+std::string TempPath(const std::string& path);
+
+/* Writes the file under a TempPath and renames it over path on Publish, so
+   no one sees a partial download and a failed one leaves the old copy be.
+   Every download has its own temporary, nothing locks the directory. The
+   temporary is removed if the sink goes away unpublished. Unicast and
+   multicast gets, sync and local copies all publish this way, only a get
+   to stdout writes straight through. */
+class AtomicSink : public FileSink {
+ public:
+  static std::expected<std::unique_ptr<AtomicSink>, TransferErr> Open(
+      const std::string& path, bool direct, FsyncPolicy fsync);
+
+  ~AtomicSink() override;
+  AtomicSink(const AtomicSink&) = delete;
+  AtomicSink& operator=(const AtomicSink&) = delete;
+
+  const std::string& Temp() const { return temp_; }
+
+  std::expected<void, TransferErr> Write(const uint8_t* data,
+                                         std::size_t len) override;
+  std::expected<void, TransferErr> WriteAt(uint64_t offset,
+                                           const uint8_t* data,
+                                           std::size_t len) override {
+    return out_->WriteAt(offset, data, len);
+  }
+  void Reserve(uint64_t size) override { out_->Reserve(size); }
+  std::expected<void, TransferErr> Close() override { return out_->Close(); }
+
+  /* Once closed, syncs the file as the policy says and renames it into
+     place. */
+  std::expected<void, TransferErr> Publish();
+
+ private:
+  AtomicSink(const std::string& path, const std::string& temp,
+             FsyncPolicy fsync, std::unique_ptr<FileSink> out)
+      : path_(path), temp_(temp), fsync_(fsync), out_(std::move(out)) {}
+
+  std::string path_;
+  std::string temp_;
+  FsyncPolicy fsync_ = FsyncPolicy::kNever;
+  std::unique_ptr<FileSink> out_;
+  bool published_ = false;
+};
+
+/* Copies a finished download to another path the way AtomicSink publishes
+   one, for a file several local names asked for. */
+std::expected<void, TransferErr> PublishCopy(const std::string& from,
+                                             const std::string& to,
+                                             FsyncPolicy fsync);
+
+}  // namespace client
+}  // namespace tftp
+
+#endif
@@ -0,0 +1,99 @@
+#ifndef METRICS_H_
+#define METRICS_H_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <utility>
+
+#include "client/stats.h"
+#include "client/transfer.h"
+#include "common/parse.h"
+#include "common/types.h"
+
+namespace tftp {
+namespace client {
+
+using MetricsErr = std::string;
+
+enum class MetricsFormat {
+  kJsonLines,
+  kPrometheus,
+};
+
+struct TransferRecord {
+  std::string direction;
+  Hostname host;
+  std::string file;
+  TransferStats stats = {};
+  std::optional<TransferErr> err = std::nullopt;
+};
+
+/* Prometheus series are per host unless up to this many per file are
+   asked for. */
+constexpr std::size_t kMaxFileSeries = 10000;
+
+std::expected<MetricsFormat, ParseStatus> ParseMetricsFormat(
+    std::string_view val);
+std::expected<std::size_t, ParseStatus> ParseFileSeries(std::string_view val);
+
+std::string FormatJson(const TransferRecord& record);
+
+class MetricsSink {
+ public:
+  /* With file_series, Prometheus gauges are labeled by file as well and
+     the least recently written series goes once there are that many. */
+  static std::expected<std::unique_ptr<MetricsSink>, MetricsErr> Create(
+      std::string_view target, MetricsFormat format,
+      std::size_t file_series = 0);
+
+  ~MetricsSink();
+  MetricsSink(const MetricsSink&) = delete;
+  MetricsSink& operator=(const MetricsSink&) = delete;
+
+  void Write(const TransferRecord& record);
+
+ private:
+  /* Per direction and host, and per file only when bounded by
+     file_series_, a series per file would grow without bound. */
+  using SeriesKey = std::tuple<std::string, Hostname, std::string>;
+  static constexpr std::size_t kNumGauges = 6;
+  /* The sample lines of each gauge for the last transfer of a key. */
+  struct Series {
+    std::array<std::string, kNumGauges> samples;
+    uint64_t written = 0; /* When, in writes, for evicting the oldest. */
+  };
+
+  MetricsSink(int fd, bool owns_fd, bool seekable, MetricsFormat format)
+      : fd_(fd), owns_fd_(owns_fd), seekable_(seekable), format_(format) {}
+  explicit MetricsSink(const std::string& path)
+      : path_(path), format_(MetricsFormat::kPrometheus) {}
+
+  std::string FormatPrometheus() const;
+  std::expected<void, MetricsErr> Publish(const std::string& text);
+  void Emit(const std::string& text);
+
+  int fd_ = -1;
+  bool owns_fd_ = false;
+  bool seekable_ = false;
+  std::string path_; /* A Prometheus textfile, replaced on each write. */
+  MetricsFormat format_ = MetricsFormat::kJsonLines;
+  std::mutex mutex_;
+  std::size_t file_series_ = 0;
+  uint64_t writes_ = 0;
+  std::map<SeriesKey, Series> latest_;
+  SessionStats totals_;
+};
+
+}  // namespace client
+}  // namespace tftp
+
+#endif
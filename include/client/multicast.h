@@ -0,0 +1,35 @@
+#ifndef MULTICAST_H_
+#define MULTICAST_H_
+
+#include <cstdint>
+#include <expected>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include "client/config.h"
+#include "client/stats.h"
+#include "client/transfer.h"
+
+namespace tftp {
+namespace client {
+
+struct MulticastOption {
+  std::string group;
+  uint16_t port = 0;
+  bool master = false;
+};
+
+std::optional<MulticastOption> ParseMulticastOption(std::string_view value);
+
+std::expected<void, TransferErr> GetFileMulticast(const Config& conf,
+                                                  std::string_view host,
+                                                  uint16_t port,
+                                                  std::string_view remote_file,
+                                                  std::string_view local_file,
+                                                  TransferStats& stats);
+
+}  // namespace client
+}  // namespace tftp
+
+#endif
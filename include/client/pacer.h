@@ -0,0 +1,46 @@
+#ifndef PACER_H_
+#define PACER_H_
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+
+#include "client/stats.h"
+
+namespace tftp {
+namespace client {
+
+/* Spends tokens at a fixed rate in bytes per second. Callers may overdraw
+   the bucket, the debt is what they wait off before sending, so concurrent
+   senders sharing a bucket are served in the order they asked. The bucket
+   starts full and its clock starts at the first Take(), so it runs on
+   whatever clock the caller passes in. */
+class TokenBucket {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  /* One millisecond's worth of tokens, at least a full Ethernet frame. */
+  static constexpr uint64_t kMinBurst = 1500;
+
+  explicit TokenBucket(uint64_t rate, uint64_t burst = 0);
+
+  uint64_t Rate() const { return rate_; }
+  uint64_t Burst() const { return burst_; }
+
+  /* Takes bytes from the bucket, returns how long to wait before sending. */
+  Micros Take(std::size_t bytes, Clock::time_point now = Clock::now());
+
+ private:
+  uint64_t rate_;
+  uint64_t burst_;
+  std::mutex mutex_;
+  double tokens_;
+  std::optional<Clock::time_point> last_;
+};
+
+}  // namespace client
+}  // namespace tftp
+
+#endif
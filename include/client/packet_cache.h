@@ -0,0 +1,103 @@
+#ifndef PACKET_CACHE_H_
+#define PACKET_CACHE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+#include "common/block_seq.h"
+#include "common/codec.h"
+#include "common/types.h"
+
+namespace tftp {
+namespace client {
+
+/* Reads a local file as a sequence of blocks, netascii encoding if asked. */
+class BlockReader {
+ public:
+  BlockReader(std::istream& in, bool netascii)
+      : in_(in), netascii_(netascii) {}
+
+  BlockData Next(std::size_t block_size);
+
+ private:
+  std::istream& in_;
+  bool netascii_ = false;
+  BlockData pending_;
+};
+
+/* A file's DATA packets, headers and all, back to back in one buffer.
+   Sending a block hands the socket a view into it. */
+class PacketArena {
+ public:
+  /* Null once the packets would take more than limit bytes. */
+  static std::shared_ptr<const PacketArena> Build(std::istream& in,
+                                                  bool netascii, BlockSeq seq,
+                                                  std::size_t limit);
+
+  BlockSeq Seq() const { return seq_; }
+  uint64_t Blocks() const { return offsets_.size() - 1; }
+  std::size_t Size() const { return packets_.size(); }
+
+  /* Block indices count from 1, as in SendWindow. */
+  codec::Bytes Packet(uint64_t block) const;
+
+ private:
+  explicit PacketArena(BlockSeq seq) : seq_(seq) {}
+
+  BlockSeq seq_;
+  std::vector<uint8_t> packets_;
+  std::vector<std::size_t> offsets_ = {0};
+};
+
+/* The packet arenas of files put recently, so putting a file again, or to
+   several servers at once, reads and packs it once. Entries are keyed by
+   path, mode and rollover, and rebuilt when the file changes. A transfer
+   keeps its arena alive even after the cache evicts it. */
+class PacketCache {
+ public:
+  static constexpr std::size_t kDefaultCapacity = 32 << 20;
+
+  explicit PacketCache(std::size_t capacity = kDefaultCapacity)
+      : capacity_(capacity) {}
+
+  /* Null for files that can't be read or would take more than a quarter
+     of the cache, those are read as they are sent. */
+  std::shared_ptr<const PacketArena> Get(const std::string& path,
+                                         const Mode& mode, BlockSeq seq);
+
+  std::size_t Size() const;
+  uint64_t Hits() const;
+
+ private:
+  /* Tells one version of a file from the next. */
+  using FileId = std::tuple<uint64_t, uint64_t, int64_t, int64_t, int64_t>;
+
+  struct Entry {
+    FileId id;
+    std::shared_ptr<const PacketArena> arena;
+    uint64_t used = 0;
+  };
+
+  static std::optional<FileId> Stat(const std::string& path);
+  void Evict();
+
+  std::size_t capacity_;
+  mutable std::mutex mutex_;
+  std::unordered_map<std::string, Entry> entries_;
+  std::size_t size_ = 0;
+  uint64_t clock_ = 0;
+  uint64_t hits_ = 0;
+};
+
+}  // namespace client
+}  // namespace tftp
+
+#endif
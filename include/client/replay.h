@@ -0,0 +1,81 @@
+#ifndef REPLAY_H_
+#define REPLAY_H_
+
+#include <chrono>
+#include <cstdint>
+#include <expected>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "client/config.h"
+#include "client/stats.h"
+#include "client/transfer.h"
+#include "common/tracer.h"
+#include "common/types.h"
+
+namespace tftp {
+namespace client {
+
+/* Something that happens to the engine during a replay. */
+struct ReplayEvent {
+  enum class Kind { kDatagram, kTimeout };
+
+  Kind kind = Kind::kDatagram;
+  Micros at{0};           /* When a datagram arrives, since the start. */
+  uint16_t from_port = 0; /* The server's TID. */
+  TftpPacket packet;
+};
+
+/* A packet the engine sends, as far as the tracer records it. */
+struct ReplaySend {
+  uint8_t opcode = 0;
+  uint16_t block = 0; /* For DATA and ACK, else 0. */
+
+  bool operator==(const ReplaySend&) const = default;
+};
+
+enum class ReplayDirection { kGet, kPut };
+
+struct ReplayScenario {
+  ReplayDirection direction = ReplayDirection::kGet;
+  std::string remote_file = "file";
+  uint64_t put_size = 0; /* Bytes a put sends. */
+  /* A datagram due after the retransmit timer fires waits for a later
+     receive. Traces hold every timeout their transfer saw, so replays of
+     them keep to the traced order instead. */
+  bool timer_first = true;
+  std::vector<ReplayEvent> events;  /* In the order they reach the engine. */
+  std::vector<ReplaySend> expected; /* Every packet sent, empty to skip. */
+};
+
+struct ReplayResult {
+  std::expected<void, TransferErr> outcome;
+  std::vector<TftpPacket> sent;
+  std::optional<std::string> divergence; /* The first unexpected send. */
+  TransferStats stats;                   /* Timed on the virtual clock. */
+  std::vector<uint8_t> received;         /* What a get wrote. */
+  uint64_t events = 0; /* Datagrams and timeouts fed in. */
+  std::chrono::nanoseconds busy{0};    /* Real time spent in the engine. */
+  std::chrono::nanoseconds slowest{0}; /* On any one event. */
+};
+
+/* Runs the transfer engine inline through a scenario on a virtual clock,
+   with no sockets. Each receive takes the next event: a datagram arrives
+   once the clock reaches its time and a timeout event times out. Pacing
+   waits advance the clock too, but token buckets read the real one, so set
+   no rate. Running out of events fails the transfer. */
+ReplayResult Replay(const Config& conf, const ReplayScenario& scenario);
+
+/* The scenario a traced transfer went through: what it received becomes
+   datagrams at their traced times, its timeouts timeout events and what it
+   sent the expected sends. Traces keep only packet headers, so DATA
+   carries filler of the traced length and an OACK grants what conf asks
+   for. */
+std::expected<ReplayScenario, TransferErr> ScenarioFromTimeline(
+    const TraceTimeline& timeline, const Config& conf);
+
+}  // namespace client
+}  // namespace tftp
+
+#endif
@@ -0,0 +1,115 @@
+#ifndef SCHEDULER_H_
+#define SCHEDULER_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "client/work_deque.h"
+
+namespace tftp {
+namespace client {
+
+struct SchedulerLimits {
+  std::size_t per_host = 0; /* Transfers to any one host, 0 is unlimited. */
+  std::size_t global = 0;   /* Transfers overall, 0 is unlimited. */
+};
+
+/* A pool of workers that each drain their own job deque and steal from the
+   others when it runs dry. Jobs tagged with a host are transfers and count
+   against the limits; a transfer that would exceed one is parked until a
+   running transfer finishes. Parked hosts take turns at freed slots, and
+   each host's limit shrinks when its transfers report retransmits and
+   grows back while they run clean. */
+class TransferScheduler {
+ public:
+  struct Job {
+    std::string host; /* Empty for jobs that only group other jobs. */
+    std::function<bool()> task;
+  };
+
+  /* Retransmits per block above which a host counts as overloaded. */
+  static constexpr double kCongestedRate = 0.05;
+
+  explicit TransferScheduler(std::size_t workers, SchedulerLimits limits = {});
+  ~TransferScheduler();
+
+  TransferScheduler(const TransferScheduler&) = delete;
+  TransferScheduler& operator=(const TransferScheduler&) = delete;
+
+  std::size_t Workers() const { return workers_.size(); }
+  const SchedulerLimits& Limits() const { return limits_; }
+  uint64_t Steals() const { return steals_; }
+
+  /* The transfers a host may run right now, 0 is unlimited. */
+  std::size_t HostLimit(const std::string& host);
+
+  /* Called by a transfer before it returns so later ones to the same host
+     run with more or less company. */
+  void Feedback(const std::string& host, uint64_t blocks,
+                uint64_t retransmits);
+
+  /* Runs the jobs and returns whether they all succeeded. Called from
+     inside a job, the worker keeps running queued jobs while it waits. */
+  bool Run(std::vector<Job> jobs);
+
+ private:
+  struct Batch {
+    std::atomic<std::size_t> remaining = 0;
+    std::atomic<bool> ok = true;
+  };
+
+  struct Pending {
+    Job job;
+    Batch* batch = nullptr;
+    bool admitted = false; /* Given a slot when unparked. */
+  };
+
+  struct Host {
+    std::size_t running = 0;
+    double window = 0; /* Adaptive limit, 0 until the host is overloaded. */
+    std::size_t stale = 0; /* Reports that predate the last backoff. */
+    std::deque<Pending*> parked;
+  };
+
+  struct Worker {
+    WorkDeque<Pending*> deque;
+    std::jthread thread;
+  };
+
+  void Loop(std::size_t self);
+  Pending* FindWork(std::size_t self);
+  bool Acquire(Pending* pending);
+  bool Admits(const Host& host) const;
+  std::size_t Limit(const Host& host) const;
+  std::vector<Pending*> Unpark();
+  void Execute(std::size_t self, Pending* pending);
+  void Signal();
+
+  SchedulerLimits limits_;
+  std::vector<std::unique_ptr<Worker>> workers_;
+  std::atomic<bool> stop_ = false;
+  std::atomic<uint64_t> signal_ = 0;
+  std::atomic<uint64_t> steals_ = 0;
+
+  std::mutex injected_mutex_; /* Jobs from threads outside the pool. */
+  std::deque<Pending*> injected_;
+
+  std::mutex limits_mutex_;
+  std::size_t running_ = 0;
+  std::unordered_map<std::string, Host> hosts_;
+  std::deque<std::string> turns_; /* Hosts with parked transfers. */
+};
+
+}  // namespace client
+}  // namespace tftp
+
+#endif
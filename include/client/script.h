@@ -0,0 +1,39 @@
+#ifndef SCRIPT_H_
+#define SCRIPT_H_
+
+#include <cstddef>
+#include <expected>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "client/cmd.h"
+#include "client/config.h"
+#include "client/scheduler.h"
+#include "common/parse.h"
+
+namespace tftp {
+namespace client {
+
+using CmdList = std::vector<CmdPtr>;
+using ScriptLines = std::vector<std::string>;
+
+constexpr std::size_t kDefaultJobs = 4;
+constexpr std::size_t kMaxJobs = 1024;
+
+std::expected<std::size_t, ParseStatus> ParseJobs(std::string_view val);
+/* -j workers that together run at most -j transfers, -J of them to any one
+   host. */
+SchedulerLimits JobLimits(std::size_t jobs, std::size_t host_jobs);
+
+ScriptLines SplitScript(std::string_view script);
+/* Multicast receivers share the group's port, so with multicast on each
+   transfer is a group of its own. */
+std::size_t TransferGroupEnd(const CmdList& cmds, std::size_t begin,
+                             bool literal_mode, bool multicast = false);
+bool RunScript(const CmdList& cmds, Config& conf);
+
+}  // namespace client
+}  // namespace tftp
+
+#endif
@@ -0,0 +1,62 @@
+#ifndef SEND_WINDOW_H_
+#define SEND_WINDOW_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <optional>
+
+#include "client/session.h"
+#include "client/stats.h"
+#include "common/block_seq.h"
+#include "common/codec.h"
+#include "common/types.h"
+
+namespace tftp {
+namespace client {
+
+/* DATA packets not yet acknowledged, numbered without wrapping. Blocks in
+   [Base(), Cursor()) are in flight, [Cursor(), Next()) are due to be sent
+   again after a Rewind(). */
+class SendWindow {
+ public:
+  struct Entry {
+    TftpPacket packet; /* Empty when wire points into a PacketArena. */
+    codec::Bytes wire = {};
+    Clock::time_point sent_at = {};
+    uint32_t transmissions = 0;
+  };
+
+  explicit SendWindow(BlockSeq seq = BlockSeq()) : seq_(seq) {}
+
+  uint64_t Base() const { return base_; }
+  uint64_t Cursor() const { return cursor_; }
+  uint64_t Next() const { return base_ + entries_.size(); }
+  std::size_t Outstanding() const { return entries_.size(); }
+  std::size_t InFlight() const { return cursor_ - base_; }
+
+  void Push(TftpPacket packet);
+  void Push(codec::Bytes packet);
+  Entry& At(uint64_t block) { return entries_[block - base_]; }
+  Entry& Advance(Clock::time_point now);
+  void Rewind() { cursor_ = base_; }
+
+  std::optional<uint64_t> Match(BlockNum block_num) const;
+  std::optional<Micros> Rtt(uint64_t block, Clock::time_point now) const;
+  uint64_t Ack(uint64_t block);
+
+  /* Counts repeated ACKs of Base() - 1, reset whenever the window slides. */
+  uint32_t CountDupAck() { return ++dup_acks_; }
+
+ private:
+  BlockSeq seq_;
+  uint64_t base_ = 1;
+  uint64_t cursor_ = 1;
+  uint32_t dup_acks_ = 0;
+  std::deque<Entry> entries_;
+};
+
+}  // namespace client
+}  // namespace tftp
+
+#endif
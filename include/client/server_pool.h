@@ -0,0 +1,76 @@
+#ifndef SERVER_POOL_H_
+#define SERVER_POOL_H_
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "client/stats.h"
+#include "client/transport.h"
+#include "common/types.h"
+
+namespace tftp {
+namespace client {
+
+struct Config;
+
+/* Servers that hold the same files, as given to connect in a comma
+   separated list. Each transfer goes to the healthy server with the lowest
+   smoothed RTT, scaled by the transfers already running on it so a batch
+   spreads out. A server that stops answering is skipped for a while and
+   its transfers move on to the next one. */
+class ServerPool {
+ public:
+  /* Resends of an unanswered request before a server counts as down. */
+  static constexpr uint32_t kRequestRetries = 2;
+  /* How long a down server is skipped before it gets another chance. */
+  static constexpr std::chrono::seconds kDownTime{30};
+
+  struct Server {
+    Hostname host;
+    std::optional<Micros> srtt; /* Unknown until probed or used. */
+    std::size_t active = 0;     /* Transfers running on it. */
+    std::optional<Clock::time_point> down_until;
+  };
+
+  /* Null for a single host, there is nothing to choose between. */
+  static std::shared_ptr<ServerPool> FromList(std::string_view list);
+
+  const std::string& Name() const { return name_; }
+  std::vector<Server> Servers() const;
+
+  /* Asks every server for a file concurrently and times the first reply,
+     an error reply counts. Servers that don't answer within the retransmit
+     timeout are marked down. */
+  void Probe(const Config& conf, uint16_t port);
+
+  /* Picks a server for a transfer, skipping those already tried; nothing
+     when every other server is down. Release it when the transfer ends,
+     with down set if the server stopped answering. */
+  std::optional<Hostname> Acquire(const std::vector<Hostname>& tried,
+                                  Clock::time_point now = Clock::now());
+  void Release(const Hostname& host, const TransferStats& stats, bool down,
+               Clock::time_point now = Clock::now());
+
+ private:
+  explicit ServerPool(std::string_view name, std::vector<Server> servers)
+      : name_(name), servers_(std::move(servers)) {}
+
+  Server* Find(const Hostname& host);
+  void SampleRtt(Server& server, Micros rtt);
+
+  std::string name_;
+  mutable std::mutex mutex_;
+  std::vector<Server> servers_;
+};
+
+}  // namespace client
+}  // namespace tftp
+
+#endif
@@ -0,0 +1,119 @@
+#ifndef SESSION_H_
+#define SESSION_H_
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include "client/config.h"
+#include "client/pacer.h"
+#include "client/stats.h"
+#include "client/transfer.h"
+#include "client/transport.h"
+#include "common/codec.h"
+#include "common/event_loop.h"
+#include "common/tracer.h"
+#include "common/types.h"
+#include "common/udp_socket.h"
+
+namespace tftp {
+namespace client {
+
+/* Waits shorter than this are left as debt in the bucket for the next
+   packet to pay off, the scheduler can't sleep that finely. */
+constexpr std::chrono::microseconds kMinPacingSleep{200};
+
+TransferErr ServerError(const codec::ErrorView& err);
+
+/* How long to wait on a reply before retransmitting, at least a second. */
+uint32_t RexmtTimeoutMs(const Config& conf);
+
+/* Sends and receives are awaited, see Transport. */
+class Session {
+ public:
+  /* On a loop, the session's packets suspend the transfer instead of
+     blocking the thread. */
+  static std::expected<Session, TransferErr> Open(const Config& conf,
+                                                  std::string_view host,
+                                                  uint16_t port,
+                                                  TransferStats& stats,
+                                                  EventLoop* loop = nullptr);
+  /* Runs over a transport the caller made, such as a replay. */
+  static Session Attach(const Config& conf, const SockAddr& server,
+                        std::unique_ptr<Transport> transport,
+                        uint32_t rexmt_ms, TransferStats& stats);
+
+  Task<std::expected<void, TransferErr>> Send(TftpPacket packet);
+  Task<std::expected<void, TransferErr>> Resend();
+  Task<std::expected<void, TransferErr>> Transmit(codec::Bytes packet,
+                                                  bool resend);
+  Task<std::expected<TftpPacket, TransferErr>> Recv();
+
+  /* Runs one of the session's tasks to its end on the calling thread. A
+     task on a loop session would suspend with nothing to resume it, so
+     that is refused here rather than left to abort in SyncWait. */
+  template <typename T>
+  std::expected<T, TransferErr> Wait(
+      Task<std::expected<T, TransferErr>> task) const {
+    if (transport_->OnLoop()) {
+      return std::unexpected("session is on an event loop, await it there");
+    }
+    return SyncWait(std::move(task));
+  }
+
+  void SampleRtt();
+  bool Expired() const;
+
+  /* Into the trace file, if tracing. */
+  void Record(TraceEvent event, const SockAddr& peer,
+              codec::Bytes packet = {});
+
+  Clock::time_point Now() const { return transport_->Now(); }
+  int Fd() const { return transport_->Fd(); }
+  std::expected<std::string, UdpSocketErr> LocalAddr() const {
+    return transport_->LocalAddr();
+  }
+  uint16_t Tid() const { return tid_; }
+  const SockAddr& Peer() const { return peer_; }
+  uint32_t RexmtMs() const { return rexmt_ms_; }
+  const Config& Conf() const { return *conf_; }
+  TransferStats& Stats() { return *stats_; }
+
+ private:
+  Session(const Config& conf, const SockAddr& server,
+          std::unique_ptr<Transport> transport, uint32_t rexmt_ms,
+          TransferStats& stats)
+      : conf_(&conf),
+        peer_(server),
+        transport_(std::move(transport)),
+        rexmt_ms_(rexmt_ms),
+        stats_(&stats),
+        start_(transport_->Now()) {}
+
+  Task<> Pace(std::size_t bytes);
+  void RejectStray(const SockAddr& sender);
+  Task<std::expected<void, TransferErr>> Timed(codec::Bytes packet);
+
+  const Config* conf_ = nullptr;
+  SockAddr peer_; /* The server's TID once it answers. */
+  std::unique_ptr<Transport> transport_;
+  uint32_t rexmt_ms_ = 0;
+  uint16_t tid_ = 0;
+  uint32_t unanswered_ = 0; /* Timeouts before the server's first reply. */
+  TransferStats* stats_ = nullptr;
+  TftpPacket last_sent_;
+  bool rexmitted_ = false;
+  Clock::time_point start_;
+  Clock::time_point sent_at_;
+  std::shared_ptr<TokenBucket> pacer_;
+};
+
+}  // namespace client
+}  // namespace tftp
+
+#endif
@@ -0,0 +1,77 @@
+#ifndef STATS_H_
+#define STATS_H_
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+
+#include "common/histogram.h"
+
+namespace tftp {
+namespace client {
+
+using Micros = std::chrono::microseconds;
+
+/* Socket buffer sizes in bytes, as asked for and as the kernel granted. */
+struct SocketBuffers {
+  int wanted = 0;
+  int recv = 0;
+  int send = 0;
+
+  bool Clamped() const { return recv < wanted || send < wanted; }
+};
+
+struct TransferStats {
+  uint64_t bytes = 0;
+  uint64_t blocks = 0;
+  uint64_t duplicates = 0;
+  uint64_t retransmits = 0;
+  uint64_t fast_retransmits = 0;
+  uint64_t timeouts = 0;
+  uint64_t rtt_samples = 0;
+  Micros rtt_min = Micros::max();
+  Micros rtt_max = Micros::zero();
+  Micros rtt_total = Micros::zero();
+  Micros elapsed = Micros::zero();
+  uint16_t window = 1;
+  uint16_t cwnd = 1;
+  SocketBuffers buffers;
+  Histogram rtts;
+  Histogram send_time;     /* In sendto. */
+  Histogram recv_time;     /* In recvfrom, waiting for the packet included. */
+  Histogram write_time;    /* Handing blocks to the local file. */
+  Histogram transfer_time; /* One sample per transfer. */
+
+  void RecordRtt(Micros rtt);
+  /* Sets elapsed once the transfer is over. */
+  void Finish(Micros duration);
+  void Merge(const TransferStats& other);
+
+  Micros RttMin() const;
+  Micros RttAvg() const;
+  double Throughput() const;
+};
+
+/* What a scheduled transfer tells the scheduler about how it went. */
+struct TransferTally {
+  uint64_t blocks = 0;
+  uint64_t retransmits = 0;
+};
+
+/* Big enough with its histograms to be shared rather than copied, so
+   concurrent transfers fold into it under the lock. */
+struct SessionStats {
+  uint64_t transfers = 0;
+  uint64_t failures = 0;
+  TransferStats last;
+  TransferStats totals;
+  std::mutex mutex;
+
+  void Merge(const TransferStats& stats, bool succeeded);
+  void Merge(const SessionStats& other);
+};
+
+}  // namespace client
+}  // namespace tftp
+
+#endif
@@ -0,0 +1,50 @@
+#ifndef SYNC_H_
+#define SYNC_H_
+
+#include <cstdint>
+#include <expected>
+#include <iosfwd>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "client/config.h"
+#include "client/stats.h"
+#include "client/transfer.h"
+#include "common/sha256.h"
+
+namespace tftp {
+namespace client {
+
+using SyncErr = std::string;
+
+/* One line of a manifest, 'remote local size [sha256]'. */
+struct ManifestEntry {
+  std::string remote;
+  std::string local;
+  uint64_t size = 0;
+  std::optional<Sha256Digest> sha256 = std::nullopt;
+};
+
+using Manifest = std::vector<ManifestEntry>;
+
+/* Blank lines and lines starting with '#' are skipped. */
+std::expected<Manifest, SyncErr> ParseManifest(std::istream& in);
+std::expected<Manifest, SyncErr> ReadManifest(const std::string& path);
+
+/* The local file has the entry's size and, if it gives one, checksum. */
+bool UpToDate(const ManifestEntry& entry);
+
+/* Downloads entry.remote to a temporary file next to entry.local, checks it
+   against the manifest and renames it into place. A failed transfer or
+   check leaves any old copy of the file untouched. */
+std::expected<void, TransferErr> SyncFile(const Config& conf,
+                                          std::string_view host, uint16_t port,
+                                          const ManifestEntry& entry,
+                                          TransferStats& stats);
+
+}  // namespace client
+}  // namespace tftp
+
+#endif
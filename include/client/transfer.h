@@ -0,0 +1,86 @@
+#ifndef TRANSFER_H_
+#define TRANSFER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <iosfwd>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include "client/config.h"
+#include "client/stats.h"
+#include "common/block_seq.h"
+#include "common/codec.h"
+#include "common/event_loop.h"
+#include "common/types.h"
+
+namespace tftp {
+namespace client {
+
+struct TransferErr {
+  TransferErr(const char* msg_) : msg(msg_) {}
+  TransferErr(const std::string& msg_,
+              ErrorCode code_ = ErrorCode::kNotDefined)
+      : code(code_), msg(msg_) {}
+
+  ErrorCode code = ErrorCode::kNotDefined;
+  std::string msg;
+  bool unresponsive = false; /* The server went quiet, another may not. */
+};
+
+TransferErr Unresponsive(const std::string& msg);
+
+constexpr std::size_t kDefaultBlockSize = 512;
+constexpr std::size_t kDataHeaderSize = 4; /* Opcode and block number. */
+
+/* As a local file, stdin for put and stdout for get. */
+constexpr std::string_view kStdStream = "-";
+
+Options RequestOptions(const Config& conf);
+std::expected<BlockSeq, TransferErr> NegotiatedRollover(
+    const codec::OptionAckView& oack, const Config& conf);
+/* The file's size when the server told it. */
+std::optional<uint64_t> NegotiatedTsize(const codec::OptionAckView& oack);
+
+class FileSink;
+class PacketArena;
+class Session;
+
+/* The engines behind GetFile and PutFile, on a session already open to the
+   server. ReceiveFile closes the sink once the file is complete. SendFile
+   sends prebuilt packets when given them, in is then only read if they
+   don't suit the rollover the server agreed to. Both are coroutines that
+   finish without suspending on a blocking session, run them with
+   Session::Wait there. */
+Task<std::expected<void, TransferErr>> ReceiveFile(
+    Session& session, std::string_view remote_file, FileSink& out);
+Task<std::expected<void, TransferErr>> SendFile(
+    Session& session, std::string_view remote_file, std::istream& in,
+    const PacketArena* packets = nullptr);
+
+std::expected<void, TransferErr> GetFile(const Config& conf,
+                                         std::string_view host, uint16_t port,
+                                         std::string_view remote_file,
+                                         std::string_view local_file,
+                                         TransferStats& stats);
+std::expected<void, TransferErr> PutFile(const Config& conf,
+                                         std::string_view host, uint16_t port,
+                                         std::string_view local_file,
+                                         std::string_view remote_file,
+                                         TransferStats& stats);
+
+/* GetFile and PutFile for an event loop, which runs many of them on one
+   thread. conf and stats must outlive the transfer. */
+Task<std::expected<void, TransferErr>> AsyncGetFile(
+    EventLoop& loop, const Config& conf, std::string host, uint16_t port,
+    std::string remote_file, std::string local_file, TransferStats& stats);
+Task<std::expected<void, TransferErr>> AsyncPutFile(
+    EventLoop& loop, const Config& conf, std::string host, uint16_t port,
+    std::string local_file, std::string remote_file, TransferStats& stats);
+
+}  // namespace client
+}  // namespace tftp
+
+#endif
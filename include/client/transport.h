@@ -0,0 +1,144 @@
+#ifndef TRANSPORT_H_
+#define TRANSPORT_H_
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "client/config.h"
+#include "client/stats.h"
+#include "client/transfer.h"
+#include "common/codec.h"
+#include "common/event_loop.h"
+#include "common/types.h"
+#include "common/udp_socket.h"
+
+namespace tftp {
+namespace client {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr std::size_t kMaxPacketSize = 65536;
+
+/* The network and the clock as a Session sees them. The transfer engine
+   reaches the server only through one, so it runs the same on sockets
+   and on a scripted replay. Sends, receives and sleeps are awaited: a
+   blocking transport is done with them before the caller resumes, one on
+   an event loop suspends the caller instead. */
+class Transport {
+ public:
+  virtual ~Transport() = default;
+
+  /* Whether a call may suspend, so nothing but a loop can resume it. */
+  virtual bool OnLoop() const = 0;
+  virtual Clock::time_point Now() const = 0;
+  /* Holds the next packet back, for pacing. */
+  virtual Task<> Sleep(Micros duration) = 0;
+
+  virtual Task<std::expected<void, TransferErr>> SendPacket(
+      codec::Bytes packet) = 0;
+  /* To someone other than the peer, such as a stray sender. */
+  virtual std::expected<void, TransferErr> SendTo(codec::Bytes packet,
+                                                  const SockAddr& to) = 0;
+  /* An empty packet means nothing arrived within the timeout. */
+  virtual Task<std::expected<TftpPacket, TransferErr>> RecvPacket(
+      Micros timeout) = 0;
+  virtual const SockAddr& LastSender() const = 0;
+  /* Sends to the server's TID from now on. */
+  virtual std::expected<void, TransferErr> SetPeer(const SockAddr& peer) = 0;
+
+  virtual uint16_t LocalPort() const = 0;
+  /* For polling alongside other sockets, -1 when there's none. */
+  virtual int Fd() const = 0;
+  virtual std::expected<std::string, UdpSocketErr> LocalAddr() const = 0;
+};
+
+class UdpTransport : public Transport {
+ public:
+  /* Binds the first free port in the configured source port range. */
+  static std::expected<std::unique_ptr<UdpTransport>, TransferErr> Create(
+      const Config& conf, const SockAddr& server, uint32_t rexmt_ms);
+
+  bool OnLoop() const override { return false; }
+  Clock::time_point Now() const override { return Clock::now(); }
+  Task<> Sleep(Micros duration) override;
+
+  Task<std::expected<void, TransferErr>> SendPacket(
+      codec::Bytes packet) override;
+  std::expected<void, TransferErr> SendTo(codec::Bytes packet,
+                                          const SockAddr& to) override;
+  Task<std::expected<TftpPacket, TransferErr>> RecvPacket(
+      Micros timeout) override;
+  const SockAddr& LastSender() const override { return recver_.LastSender(); }
+  std::expected<void, TransferErr> SetPeer(const SockAddr& peer) override;
+
+  uint16_t LocalPort() const override { return recver_.RecvPort(); }
+  int Fd() const override { return recver_.Fd(); }
+  std::expected<std::string, UdpSocketErr> LocalAddr() const override {
+    return sender_.RouteSourceAddr();
+  }
+
+  /* What the socket got of the buffer space two windows need. */
+  const SocketBuffers& Buffers() const { return buffers_; }
+
+ private:
+  UdpTransport(UdpSocketRecver recver, UdpSocketSender sender,
+               uint32_t timeout_ms)
+      : recver_(std::move(recver)),
+        sender_(std::move(sender)),
+        timeout_ms_(timeout_ms),
+        buffer_(kMaxPacketSize) {}
+
+  UdpSocketRecver recver_;
+  UdpSocketSender sender_;
+  uint32_t timeout_ms_ = 0; /* The socket's, changed only when asked. */
+  SocketBuffers buffers_;
+  std::vector<uint8_t> buffer_;
+};
+
+/* Runs on an event loop, where many transfers share one thread: sends,
+   receives and sleeps suspend the transfer rather than block. */
+class AsyncTransport : public Transport {
+ public:
+  /* Binds the first free port in the configured source port range. */
+  static std::expected<std::unique_ptr<AsyncTransport>, TransferErr> Create(
+      EventLoop& loop, const Config& conf, const SockAddr& server);
+
+  bool OnLoop() const override { return true; }
+  Clock::time_point Now() const override { return Clock::now(); }
+  Task<> Sleep(Micros duration) override;
+
+  Task<std::expected<void, TransferErr>> SendPacket(
+      codec::Bytes packet) override;
+  std::expected<void, TransferErr> SendTo(codec::Bytes packet,
+                                          const SockAddr& to) override;
+  Task<std::expected<TftpPacket, TransferErr>> RecvPacket(
+      Micros timeout) override;
+  const SockAddr& LastSender() const override { return socket_.LastSender(); }
+  std::expected<void, TransferErr> SetPeer(const SockAddr& peer) override;
+
+  uint16_t LocalPort() const override { return socket_.Port(); }
+  int Fd() const override { return socket_.Fd(); }
+  std::expected<std::string, UdpSocketErr> LocalAddr() const override {
+    return socket_.LocalAddr();
+  }
+
+  const SocketBuffers& Buffers() const { return buffers_; }
+
+ private:
+  AsyncTransport(EventLoop& loop, AsyncSocket socket)
+      : loop_(&loop), socket_(std::move(socket)) {}
+
+  EventLoop* loop_ = nullptr;
+  AsyncSocket socket_;
+  SocketBuffers buffers_;
+};
+
+}  // namespace client
+}  // namespace tftp
+
+#endif
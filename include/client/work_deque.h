@@ -0,0 +1,134 @@
+#ifndef WORK_DEQUE_H_
+#define WORK_DEQUE_H_
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <type_traits>
+#include <vector>
+
+namespace tftp {
+namespace client {
+
+/* The Chase-Lev work stealing deque, with the memory orderings from Le et
+   al., "Correct and Efficient Work-Stealing for Weak Memory Models". The
+   owning thread pushes and takes at the bottom, any thread may steal from
+   the top. Only trivially copyable items such as pointers are supported. */
+template <typename T>
+class WorkDeque {
+  static_assert(std::is_trivially_copyable_v<T>);
+
+ public:
+  explicit WorkDeque(std::size_t capacity = 64)
+      : array_(NewArray(std::bit_ceil(std::max<std::size_t>(capacity, 2)))) {}
+
+  WorkDeque(const WorkDeque&) = delete;
+  WorkDeque& operator=(const WorkDeque&) = delete;
+
+  /* A snapshot, only exact when no other thread is touching the deque. */
+  std::size_t Size() const {
+    int64_t bottom = bottom_.load(std::memory_order_relaxed);
+    int64_t top = top_.load(std::memory_order_relaxed);
+    return (bottom > top) ? bottom - top : 0;
+  }
+
+  /* Owner only. */
+  void Push(T item) {
+    int64_t bottom = bottom_.load(std::memory_order_relaxed);
+    int64_t top = top_.load(std::memory_order_acquire);
+    Array* array = array_.load(std::memory_order_relaxed);
+    if (bottom - top > static_cast<int64_t>(array->mask)) {
+      array = Grow(array, top, bottom);
+    }
+    array->Put(bottom, item);
+    std::atomic_thread_fence(std::memory_order_release);
+    bottom_.store(bottom + 1, std::memory_order_relaxed);
+  }
+
+  /* Owner only, newest first. */
+  std::optional<T> Take() {
+    int64_t bottom = bottom_.load(std::memory_order_relaxed) - 1;
+    Array* array = array_.load(std::memory_order_relaxed);
+    bottom_.store(bottom, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t top = top_.load(std::memory_order_relaxed);
+
+    std::optional<T> item;
+    if (top <= bottom) {
+      item = array->Get(bottom);
+      if (top == bottom) { /* The last item, race the thieves for it. */
+        if (!top_.compare_exchange_strong(top, top + 1,
+                                          std::memory_order_seq_cst,
+                                          std::memory_order_relaxed)) {
+          item.reset();
+        }
+        bottom_.store(bottom + 1, std::memory_order_relaxed);
+      }
+    } else {
+      bottom_.store(bottom + 1, std::memory_order_relaxed);
+    }
+    return item;
+  }
+
+  /* Any thread, oldest first. Fails when empty or on losing a race. */
+  std::optional<T> Steal() {
+    int64_t top = top_.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t bottom = bottom_.load(std::memory_order_acquire);
+    if (top >= bottom) {
+      return std::nullopt;
+    }
+
+    Array* array = array_.load(std::memory_order_acquire);
+    T item = array->Get(top);
+    if (!top_.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst,
+                                      std::memory_order_relaxed)) {
+      return std::nullopt;
+    }
+    return item;
+  }
+
+ private:
+  struct Array {
+    std::size_t mask;
+    std::unique_ptr<std::atomic<T>[]> slots;
+
+    T Get(int64_t i) const {
+      return slots[i & mask].load(std::memory_order_relaxed);
+    }
+    void Put(int64_t i, T item) {
+      slots[i & mask].store(item, std::memory_order_relaxed);
+    }
+  };
+
+  Array* NewArray(std::size_t capacity) {
+    retired_.push_back(std::make_unique<Array>(
+        Array{capacity - 1, std::make_unique<std::atomic<T>[]>(capacity)}));
+    return retired_.back().get();
+  }
+
+  /* Thieves may still be reading the old array, so it lives as long as the
+     deque does. */
+  Array* Grow(Array* old, int64_t top, int64_t bottom) {
+    Array* array = NewArray(2 * (old->mask + 1));
+    for (int64_t i = top; i < bottom; ++i) {
+      array->Put(i, old->Get(i));
+    }
+    array_.store(array, std::memory_order_release);
+    return array;
+  }
+
+  alignas(64) std::atomic<int64_t> top_ = 0;
+  alignas(64) std::atomic<int64_t> bottom_ = 0;
+  std::vector<std::unique_ptr<Array>> retired_; /* Owner only. */
+  alignas(64) std::atomic<Array*> array_;
+};
+
+}  // namespace client
+}  // namespace tftp
+
+#endif
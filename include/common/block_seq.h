@@ -0,0 +1,38 @@
+#ifndef BLOCK_SEQ_H_
+#define BLOCK_SEQ_H_
+
+#include <cstdint>
+#include <optional>
+
+#include "common/types.h"
+
+namespace tftp {
+
+/* Maps block indices, which count up from 1 and never wrap, onto the 16
+   bit block numbers on the wire and back. Index 0 is the OACK's ACK. */
+class BlockSeq {
+ public:
+  BlockSeq() = default;
+  explicit BlockSeq(Rollover rollover) : rollover_(rollover) {}
+
+  Rollover Mode() const { return rollover_; }
+
+  BlockNum Wire(uint64_t index) const;
+
+  /* The first index at or after from that goes out as block_num. */
+  std::optional<uint64_t> After(BlockNum block_num, uint64_t from) const;
+
+  /* The index within half a cycle of near that goes out as block_num. */
+  std::optional<uint64_t> Nearest(BlockNum block_num, uint64_t near) const;
+
+ private:
+  uint64_t Period() const {
+    return (rollover_ == Rollover::kToZero) ? 65536 : 65535;
+  }
+
+  Rollover rollover_ = Rollover::kToZero;
+};
+
+}  // namespace tftp
+
+#endif
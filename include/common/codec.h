@@ -0,0 +1,292 @@
+#ifndef CODEC_H_
+#define CODEC_H_
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <variant>
+
+#include "common/types.h"
+
+namespace tftp {
+namespace codec {
+
+using Bytes = std::span<const uint8_t>;
+
+/* A run of name/value string pairs left in the packet, see RFC 2347. */
+class OptionsView {
+ public:
+  OptionsView() = default;
+  explicit OptionsView(Bytes raw) : raw_(raw) {}
+
+  Bytes Raw() const { return raw_; }
+  bool Empty() const { return raw_.empty(); }
+  Options ToOptions() const;
+
+ private:
+  Bytes raw_;
+};
+
+struct ReadRequestView {
+  std::string_view filename;
+  std::string_view mode;
+  OptionsView options = {};
+};
+
+struct WriteRequestView {
+  std::string_view filename;
+  std::string_view mode;
+  OptionsView options = {};
+};
+
+struct DataView {
+  BlockNum block_num = 0;
+  Bytes data = {};
+};
+
+struct AckView {
+  BlockNum block_num = 0;
+};
+
+struct ErrorView {
+  ErrorCode err_code = ErrorCode::kNotDefined;
+  std::string_view err_msg;
+};
+
+struct OptionAckView {
+  OptionsView options = {};
+};
+
+/* Wire format of each field type. Decode returns the bytes consumed. */
+template <typename T>
+struct FieldCodec;
+
+template <>
+struct FieldCodec<uint16_t> {
+  static std::size_t Size(uint16_t) { return sizeof(uint16_t); }
+  static std::size_t Encode(uint16_t value, uint8_t* out) {
+    out[0] = value >> 8;
+    out[1] = value & 0xFF;
+    return sizeof(uint16_t);
+  }
+  static std::optional<std::size_t> Decode(Bytes in, uint16_t& value) {
+    if (in.size() < sizeof(uint16_t)) {
+      return std::nullopt;
+    }
+    value = (in[0] << 8) | in[1];
+    return sizeof(uint16_t);
+  }
+};
+
+template <>
+struct FieldCodec<ErrorCode> {
+  static std::size_t Size(ErrorCode) { return sizeof(uint16_t); }
+  static std::size_t Encode(ErrorCode value, uint8_t* out) {
+    return FieldCodec<uint16_t>::Encode(value, out);
+  }
+  static std::optional<std::size_t> Decode(Bytes in, ErrorCode& value) {
+    uint16_t raw = 0;
+    auto len = FieldCodec<uint16_t>::Decode(in, raw);
+    if (!len || raw > ErrorCode::kOptionNegotiation) {
+      return std::nullopt;
+    }
+    value = static_cast<ErrorCode>(raw);
+    return len;
+  }
+};
+
+template <>
+struct FieldCodec<std::string_view> {
+  static std::size_t Size(std::string_view value) { return value.size() + 1; }
+  static std::size_t Encode(std::string_view value, uint8_t* out) {
+    std::copy(value.cbegin(), value.cend(), out);
+    out[value.size()] = 0; /* Append the null terminator. */
+    return value.size() + 1;
+  }
+  static std::optional<std::size_t> Decode(Bytes in, std::string_view& value) {
+    auto nul = std::find(in.begin(), in.end(), 0);
+    if (nul == in.end()) {
+      return std::nullopt;
+    }
+    value = std::string_view(reinterpret_cast<const char*>(in.data()),
+                             nul - in.begin());
+    return value.size() + 1;
+  }
+};
+
+/* Raw bytes always run to the end of the packet. */
+template <>
+struct FieldCodec<Bytes> {
+  static std::size_t Size(Bytes value) { return value.size(); }
+  static std::size_t Encode(Bytes value, uint8_t* out) {
+    std::copy(value.begin(), value.end(), out);
+    return value.size();
+  }
+  static std::optional<std::size_t> Decode(Bytes in, Bytes& value) {
+    value = in;
+    return in.size();
+  }
+};
+
+template <>
+struct FieldCodec<OptionsView> {
+  static std::size_t Size(OptionsView value) { return value.Raw().size(); }
+  static std::size_t Encode(OptionsView value, uint8_t* out) {
+    return FieldCodec<Bytes>::Encode(value.Raw(), out);
+  }
+  static std::optional<std::size_t> Decode(Bytes in, OptionsView& value) {
+    /* Every string must be terminated and every name needs a value. */
+    std::size_t count = 0;
+    for (std::size_t offset = 0; offset < in.size(); ++count) {
+      std::string_view str;
+      auto len = FieldCodec<std::string_view>::Decode(in.subspan(offset), str);
+      if (!len) {
+        return std::nullopt;
+      }
+      offset += *len;
+    }
+    if (count % 2) {
+      return std::nullopt;
+    }
+    value = OptionsView(in);
+    return in.size();
+  }
+};
+
+template <auto Member>
+struct Field;
+
+template <typename View, typename T, T View::*Member>
+struct Field<Member> {
+  using Codec = FieldCodec<T>;
+
+  static std::size_t Size(const View& view) {
+    return Codec::Size(view.*Member);
+  }
+  static std::size_t Encode(const View& view, uint8_t* out) {
+    return Codec::Encode(view.*Member, out);
+  }
+  static bool Decode(Bytes in, std::size_t& offset, View& view) {
+    auto len = Codec::Decode(in.subspan(offset), view.*Member);
+    if (!len) {
+      return false;
+    }
+    offset += *len;
+    return true;
+  }
+};
+
+/* Checks that go beyond the wire format, such as a known transfer mode. */
+template <typename View>
+bool Validate(const View&) {
+  return true;
+}
+bool Validate(const ReadRequestView& view);
+bool Validate(const WriteRequestView& view);
+
+template <OpCode Op, typename View, typename... Fields>
+struct Layout {
+  static constexpr OpCode kOp = Op;
+  using ViewType = View;
+
+  static std::size_t Size(const View& view) {
+    return sizeof(uint16_t) + (Fields::Size(view) + ... + 0);
+  }
+
+  static TftpPacket Encode(const View& view) {
+    TftpPacket packet(Size(view), 0);
+    uint8_t* out = packet.data();
+    out += FieldCodec<uint16_t>::Encode(kOp, out);
+    ((out += Fields::Encode(view, out)), ...);
+    return packet;
+  }
+
+  /* Decodes the fields that follow the opcode. */
+  static std::optional<View> DecodeBody(Bytes body) {
+    View view;
+    std::size_t offset = 0;
+    if (!(Fields::Decode(body, offset, view) && ...) || !Validate(view)) {
+      return std::nullopt;
+    }
+    return view;
+  }
+};
+
+using ReadRequestLayout =
+    Layout<OpCode::kReadReq, ReadRequestView, Field<&ReadRequestView::filename>,
+           Field<&ReadRequestView::mode>, Field<&ReadRequestView::options>>;
+using WriteRequestLayout =
+    Layout<OpCode::kWriteReq, WriteRequestView,
+           Field<&WriteRequestView::filename>, Field<&WriteRequestView::mode>,
+           Field<&WriteRequestView::options>>;
+using DataLayout = Layout<OpCode::kData, DataView, Field<&DataView::block_num>,
+                          Field<&DataView::data>>;
+using AckLayout = Layout<OpCode::kAck, AckView, Field<&AckView::block_num>>;
+using ErrorLayout =
+    Layout<OpCode::kError, ErrorView, Field<&ErrorView::err_code>,
+           Field<&ErrorView::err_msg>>;
+using OptionAckLayout = Layout<OpCode::kOptionAck, OptionAckView,
+                               Field<&OptionAckView::options>>;
+
+/* Adding a message means declaring its layout and listing it here. */
+using Layouts = std::tuple<ReadRequestLayout, WriteRequestLayout, DataLayout,
+                           AckLayout, ErrorLayout, OptionAckLayout>;
+
+template <typename Tuple>
+struct MessageOf;
+
+template <typename... Ls>
+struct MessageOf<std::tuple<Ls...>> {
+  using Type = std::variant<typename Ls::ViewType...>;
+};
+
+using Message = MessageOf<Layouts>::Type;
+
+template <typename View, typename Tuple = Layouts>
+struct LayoutOf;
+
+template <typename View, typename L, typename... Ls>
+struct LayoutOf<View, std::tuple<L, Ls...>> {
+  using Type =
+      std::conditional_t<std::is_same_v<View, typename L::ViewType>, L,
+                         typename LayoutOf<View, std::tuple<Ls...>>::Type>;
+};
+
+template <typename View>
+struct LayoutOf<View, std::tuple<>> {
+  using Type = void;
+};
+
+template <typename View>
+TftpPacket Encode(const View& view) {
+  return LayoutOf<View>::Type::Encode(view);
+}
+
+template <typename View>
+std::optional<View> DecodeAs(Bytes packet) {
+  using L = typename LayoutOf<View>::Type;
+  uint16_t opcode = 0;
+  if (!FieldCodec<uint16_t>::Decode(packet, opcode) || opcode != L::kOp) {
+    return std::nullopt;
+  }
+  return L::DecodeBody(packet.subspan(sizeof(opcode)));
+}
+
+/* Reads the opcode once and decodes the matching message in place. The
+   views point into the packet, which must outlive them. */
+std::optional<Message> Decode(Bytes packet);
+
+/* A one line summary of a packet for traces and logs. */
+std::string Describe(Bytes packet);
+
+}  // namespace codec
+}  // namespace tftp
+
+#endif
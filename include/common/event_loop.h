@@ -0,0 +1,297 @@
+#ifndef EVENT_LOOP_H_
+#define EVENT_LOOP_H_
+
+#include <sys/epoll.h>
+
+#include <array>
+#include <chrono>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <expected>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <queue>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "common/codec.h"
+#include "common/types.h"
+#include "common/udp_socket.h"
+
+namespace tftp {
+
+using EventLoopErr = std::string;
+
+/* Coroutine frames come from per-thread free lists in kQuantum sized
+   classes, so a loop that runs thousands of transfers recycles frames
+   instead of going back to the heap for each one. */
+class FramePool {
+ public:
+  static constexpr std::size_t kQuantum = 256;
+  static constexpr std::size_t kClasses = 32; /* Pooled frames up to 8 KiB. */
+
+  static FramePool& Local();
+
+  FramePool() = default;
+  ~FramePool();
+  FramePool(const FramePool&) = delete;
+  FramePool& operator=(const FramePool&) = delete;
+
+  void* Allocate(std::size_t size);
+  void Free(void* frame, std::size_t size);
+
+  std::size_t Fresh() const { return fresh_; }
+  std::size_t Reused() const { return reused_; }
+
+ private:
+  struct Node {
+    Node* next;
+  };
+
+  std::array<Node*, kClasses> free_ = {};
+  std::size_t fresh_ = 0;
+  std::size_t reused_ = 0;
+};
+
+namespace detail {
+
+template <typename T>
+struct TaskResult {
+  std::optional<T> value;
+  void return_value(T v) { value = std::move(v); }
+};
+
+template <>
+struct TaskResult<void> {
+  void return_void() {}
+};
+
+struct PooledFrame {
+  static void* operator new(std::size_t size) {
+    return FramePool::Local().Allocate(size);
+  }
+  static void operator delete(void* frame, std::size_t size) {
+    FramePool::Local().Free(frame, size);
+  }
+};
+
+}  // namespace detail
+
+/* A lazily started coroutine. Awaiting a task runs it and resumes the
+   awaiter with its result once it finishes. */
+template <typename T = void>
+class [[nodiscard]] Task {
+ public:
+  struct promise_type : detail::TaskResult<T>, detail::PooledFrame {
+    std::coroutine_handle<> continuation = std::noop_coroutine();
+
+    Task get_return_object() {
+      return Task(std::coroutine_handle<promise_type>::from_promise(*this));
+    }
+    std::suspend_always initial_suspend() noexcept { return {}; }
+    auto final_suspend() noexcept {
+      struct Resumer {
+        bool await_ready() noexcept { return false; }
+        std::coroutine_handle<> await_suspend(
+            std::coroutine_handle<promise_type> self) noexcept {
+          return self.promise().continuation;
+        }
+        void await_resume() noexcept {}
+      };
+      return Resumer{};
+    }
+    void unhandled_exception() { std::terminate(); }
+  };
+
+  Task(Task&& other) : handle_(std::exchange(other.handle_, {})) {}
+  Task& operator=(Task&& other) {
+    Task tmp(std::move(other));
+    std::swap(handle_, tmp.handle_);
+    return *this;
+  }
+  ~Task() {
+    if (handle_) {
+      handle_.destroy();
+    }
+  }
+
+  bool await_ready() const noexcept { return !handle_ || handle_.done(); }
+  std::coroutine_handle<> await_suspend(std::coroutine_handle<> caller) {
+    handle_.promise().continuation = caller;
+    return handle_;
+  }
+  T await_resume() {
+    if constexpr (!std::is_void_v<T>) {
+      return std::move(*handle_.promise().value);
+    }
+  }
+
+ private:
+  template <typename U>
+  friend U SyncWait(Task<U> task);
+
+  explicit Task(std::coroutine_handle<promise_type> handle) : handle_(handle) {}
+
+  std::coroutine_handle<promise_type> handle_;
+};
+
+/* Runs a task to its end on the calling thread, for tasks that never wait
+   on a loop, such as a transfer over a blocking transport. Nothing would
+   resume one that did, so that ends the program. */
+template <typename T>
+T SyncWait(Task<T> task) {
+  task.handle_.resume();
+  if (!task.handle_.done()) {
+    std::terminate();
+  }
+  return task.await_resume();
+}
+
+/* Runs coroutines on the calling thread, resuming them as their sockets
+   become readable or their deadlines pass. */
+class EventLoop {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  static std::expected<std::unique_ptr<EventLoop>, EventLoopErr> Create();
+
+  ~EventLoop();
+  EventLoop(const EventLoop&) = delete;
+  EventLoop& operator=(const EventLoop&) = delete;
+
+  /* Queues the task, the loop owns it until it finishes. */
+  void Spawn(Task<> task);
+
+  /* Runs until every spawned task has finished. */
+  void Run();
+
+  std::size_t Active() const { return active_; }
+  std::vector<uint8_t>& Buffer() { return buffer_; }
+
+ private:
+  struct Waiter {
+    std::coroutine_handle<> handle;
+    int fd = -1;
+    uint32_t slot = kNoSlot;
+    bool timed_out = false;
+  };
+
+  class WaitAwaiter {
+   public:
+    WaitAwaiter(EventLoop& loop, int fd, uint32_t events,
+                Clock::time_point deadline)
+        : loop_(loop), events_(events), deadline_(deadline) {
+      waiter_.fd = fd;
+    }
+
+    bool await_ready() const noexcept { return false; }
+    bool await_suspend(std::coroutine_handle<> handle) {
+      waiter_.handle = handle;
+      return loop_.Arm(waiter_, events_, deadline_);
+    }
+    bool await_resume() const noexcept { return !waiter_.timed_out; }
+
+   private:
+    EventLoop& loop_;
+    uint32_t events_;
+    Clock::time_point deadline_;
+    Waiter waiter_;
+  };
+
+ public:
+  /* Resolve to false if the deadline passes first. */
+  WaitAwaiter Readable(int fd, Clock::time_point deadline) {
+    return WaitAwaiter(*this, fd, EPOLLIN, deadline);
+  }
+  WaitAwaiter Writable(int fd, Clock::time_point deadline) {
+    return WaitAwaiter(*this, fd, EPOLLOUT, deadline);
+  }
+  WaitAwaiter Sleep(std::chrono::microseconds duration) {
+    return WaitAwaiter(*this, -1, 0, Clock::now() + duration);
+  }
+
+ private:
+  static constexpr uint32_t kNoSlot = UINT32_MAX;
+
+  /* Deadlines are kept in a heap of slot references, a slot's generation
+     changes when its waiter wakes so stale heap entries are skipped. */
+  struct Timer {
+    Clock::time_point deadline;
+    uint32_t slot;
+    uint32_t gen;
+
+    bool operator>(const Timer& other) const {
+      return deadline > other.deadline;
+    }
+  };
+
+  struct Slot {
+    Waiter* waiter = nullptr;
+    uint32_t gen = 0;
+  };
+
+  explicit EventLoop(int epoll_fd);
+
+  bool Arm(Waiter& waiter, uint32_t events, Clock::time_point deadline);
+  void Wake(Waiter& waiter, bool timed_out);
+  void ReleaseSlot(Waiter& waiter);
+  void FireTimers(Clock::time_point now);
+  int WaitMs(Clock::time_point now) const;
+
+  int epoll_fd_ = -1;
+  std::size_t active_ = 0;
+  std::deque<std::coroutine_handle<>> ready_;
+  std::priority_queue<Timer, std::vector<Timer>, std::greater<>> timers_;
+  std::vector<Slot> slots_;
+  std::vector<uint32_t> free_slots_;
+  std::vector<uint8_t> buffer_;
+};
+
+/* A UDP socket whose sends and receives suspend the calling coroutine
+   rather than block the thread. Only one coroutine may wait on a socket
+   at a time. */
+class AsyncSocket {
+ public:
+  static std::expected<AsyncSocket, UdpSocketErr> Create(EventLoop& loop,
+                                                         uint16_t port = 0);
+  /* Takes over a socket the caller bound and set up. */
+  static std::expected<AsyncSocket, UdpSocketErr> Create(
+      EventLoop& loop, UdpSocketRecver recver);
+
+  int Fd() const { return recver_.Fd(); }
+  uint16_t Port() const { return recver_.RecvPort(); }
+  const SockAddr& LastSender() const { return recver_.LastSender(); }
+  const SockAddr& Peer() const { return peer_; }
+  std::expected<std::string, UdpSocketErr> LocalAddr() const;
+
+  /* Where SendPacket goes from now on. */
+  std::expected<void, UdpSocketErr> SetPeer(const SockAddr& peer);
+
+  /* Hands back an empty packet if nothing arrives within the timeout. */
+  Task<std::expected<TftpPacket, UdpSocketErr>> RecvPacket(
+      std::chrono::microseconds timeout);
+  Task<std::expected<void, UdpSocketErr>> SendPacket(codec::Bytes packet);
+  /* A one-off to someone other than the peer, dropped if the socket's
+     buffer is full. */
+  std::expected<void, UdpSocketErr> SendPacketTo(codec::Bytes packet,
+                                                 const SockAddr& to);
+
+ private:
+  AsyncSocket(EventLoop& loop, UdpSocketRecver recver)
+      : loop_(&loop), recver_(std::move(recver)) {}
+
+  EventLoop* loop_ = nullptr;
+  UdpSocketRecver recver_;
+  std::optional<UdpSocketSender> sender_;
+  SockAddr peer_;
+};
+
+}  // namespace tftp
+
+#endif
@@ -0,0 +1,49 @@
+#ifndef HISTOGRAM_H_
+#define HISTOGRAM_H_
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace tftp {
+
+/* Counts latencies in log-linear buckets, like an HDR histogram. Every
+   power of two is split into 32 buckets, so a percentile is off by at most
+   1/32 of its value. Recording is a few shifts and increments into storage
+   the histogram holds inline, it never allocates. */
+class Histogram {
+ public:
+  using Nanos = std::chrono::nanoseconds;
+
+  static constexpr int kSubBucketBits = 5;
+  /* Longer values, past about 18 minutes, count as this long. */
+  static constexpr int kMaxBits = 40;
+
+  void Record(Nanos value);
+  void Merge(const Histogram& other);
+
+  uint64_t Count() const { return count_; }
+  Nanos Sum() const { return Nanos(sum_); }
+  Nanos Max() const { return Nanos(max_); }
+  /* The value p percent of samples are at or below, rounded up to the top
+     of its bucket; 0 with no samples. */
+  Nanos Percentile(double p) const;
+
+ private:
+  static constexpr std::size_t kSubBuckets = std::size_t{1} << kSubBucketBits;
+  static constexpr std::size_t kBuckets =
+      (kMaxBits - kSubBucketBits + 1) * kSubBuckets;
+
+  static std::size_t Index(uint64_t value);
+  static uint64_t Highest(std::size_t index);
+
+  std::array<uint64_t, kBuckets> counts_ = {};
+  uint64_t count_ = 0;
+  uint64_t sum_ = 0;
+  uint64_t max_ = 0;
+};
+
+}  // namespace tftp
+
+#endif
@@ -0,0 +1,24 @@
+#ifndef NETASCII_H_
+#define NETASCII_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#include "common/types.h"
+
+namespace tftp {
+
+void NetasciiEncode(const uint8_t* data, std::size_t len, BlockData& out);
+
+class NetasciiDecoder {
+ public:
+  void Decode(const uint8_t* data, std::size_t len, BlockData& out);
+  void Flush(BlockData& out);
+
+ private:
+  bool pending_cr_ = false;
+};
+
+}  // namespace tftp
+
+#endif
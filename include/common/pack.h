@@ -12,12 +12,14 @@ TftpPacket PackWriteRequest(const WriteRequestMsg& msg);
 TftpPacket PackData(const DataMsg& msg);
 TftpPacket PackAck(const AckMsg& msg);
 TftpPacket PackError(const ErrorMsg& msg);
+TftpPacket PackOptionAck(const OptionAckMsg& msg);
 
 std::optional<ReadRequestMsg> UnpackReadRequest(const TftpPacket& packet);
 std::optional<WriteRequestMsg> UnpackWriteRequest(const TftpPacket& packet);
 std::optional<DataMsg> UnpackData(const TftpPacket& packet);
 std::optional<AckMsg> UnpackAck(const TftpPacket& packet);
 std::optional<ErrorMsg> UnpackError(const TftpPacket& packet);
+std::optional<OptionAckMsg> UnpackOptionAck(const TftpPacket& packet);
 
 }  // namespace tftp
 
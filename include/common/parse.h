@@ -18,6 +18,16 @@ enum ParseStatus : int {
   kPortRangeMissingSeperator,
   kUnknownMode,
   kTimeoutOutOfRange,
+  kUnknownMetricsFormat,
+  kFileSeriesOutOfRange,
+  kJobsOutOfRange,
+  kWindowSizeOutOfRange,
+  kUnknownCongestionMode,
+  kInvalidRate,
+  kInvalidRollover,
+  kStdinNeedsRemoteName,
+  kUnknownFsyncPolicy,
+  kBusyPollOutOfRange,
   kParseStatusCnt,
 };
 
@@ -31,12 +41,29 @@ constexpr std::array<const char*, ParseStatus::kParseStatusCnt>
         "port range is missing seperator ':'",
         "unknown transfer mode",
         "timeout is out of range [0, 65535]",
+        "unknown metrics format",
+        "metrics file series is out of range [1, 10000]",
+        "job count is out of range [1, 1024]",
+        "window size is out of range [1, 65535]",
+        "unknown congestion control mode",
+        "rate must be bytes per second such as 512k or 10M, or 'off'",
+        "rollover must be 0 or 1",
+        "put from stdin needs a remote file name",
+        "unknown fsync policy",
+        "busy poll must be microseconds in [1, 1000000] or 'off'",
 };
 
 std::expected<tftp::Mode, ParseStatus> ParseMode(std::string_view val);
 std::expected<uint16_t, ParseStatus> ParsePort(std::string_view val);
 std::expected<PortRange, ParseStatus> ParsePortRange(std::string_view val);
 std::expected<Seconds, ParseStatus> ParseTimeValue(std::string_view val);
+std::expected<uint16_t, ParseStatus> ParseWindowSize(std::string_view val);
+std::expected<uint64_t, ParseStatus> ParseRate(std::string_view val);
+std::expected<Rollover, ParseStatus> ParseRollover(std::string_view val);
+std::expected<FsyncPolicy, ParseStatus> ParseFsyncPolicy(std::string_view val);
+std::string_view FsyncPolicyName(FsyncPolicy policy);
+/* Microseconds, 'off' is 0. */
+std::expected<uint32_t, ParseStatus> ParseBusyPoll(std::string_view val);
 
 }  // namespace tftp
 
@@ -0,0 +1,62 @@
+#ifndef RESOLVER_H_
+#define RESOLVER_H_
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+
+#include "common/udp_socket.h"
+
+namespace tftp {
+
+/* Remembers lookups for a while, failed ones for less. Concurrent misses
+   on a host wait for the one lookup in flight instead of starting their
+   own. */
+class ResolverCache {
+ public:
+  using Clock = std::chrono::steady_clock;
+  using Lookup =
+      std::function<std::expected<SockAddr, UdpSocketErr>(std::string_view)>;
+
+  static constexpr std::chrono::seconds kDefaultTtl{300};
+  static constexpr std::chrono::seconds kDefaultNegativeTtl{5};
+
+  explicit ResolverCache(std::chrono::milliseconds ttl = kDefaultTtl,
+                         std::chrono::milliseconds negative_ttl =
+                             kDefaultNegativeTtl,
+                         Lookup lookup = ResolveAddr)
+      : ttl_(ttl), negative_ttl_(negative_ttl), lookup_(std::move(lookup)) {}
+
+  std::expected<SockAddr, UdpSocketErr> Resolve(std::string_view host,
+                                                uint16_t port);
+  void Clear();
+  std::size_t Size() const;
+
+ private:
+  using Result = std::expected<SockAddr, UdpSocketErr>;
+
+  struct Entry {
+    std::shared_future<Result> addr;
+    Clock::time_point expires; /* Never while the lookup is in flight. */
+    uint64_t lookup = 0;
+  };
+
+  std::chrono::milliseconds ttl_;
+  std::chrono::milliseconds negative_ttl_;
+  Lookup lookup_;
+  mutable std::mutex mutex_;
+  std::unordered_map<std::string, Entry> entries_;
+  uint64_t lookups_ = 0;
+};
+
+}  // namespace tftp
+
+#endif
@@ -0,0 +1,39 @@
+#ifndef SHA256_H_
+#define SHA256_H_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace tftp {
+
+using Sha256Digest = std::array<uint8_t, 32>;
+
+/* FIPS 180-4 SHA-256, fed incrementally. */
+class Sha256 {
+ public:
+  Sha256();
+
+  void Update(const uint8_t* data, std::size_t len);
+  /* The hasher is spent afterwards. */
+  Sha256Digest Final();
+
+ private:
+  void Compress(const uint8_t* block);
+
+  std::array<uint32_t, 8> state_;
+  std::array<uint8_t, 64> buffer_ = {};
+  std::size_t buffered_ = 0;
+  uint64_t length_ = 0; /* In bytes. */
+};
+
+/* Lowercase hex, as sha256sum prints it. */
+std::string ToHex(const Sha256Digest& digest);
+std::optional<Sha256Digest> ParseSha256(std::string_view hex);
+
+}  // namespace tftp
+
+#endif
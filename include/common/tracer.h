@@ -0,0 +1,136 @@
+#ifndef TRACER_H_
+#define TRACER_H_
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "common/codec.h"
+#include "common/udp_socket.h"
+
+namespace tftp {
+
+using TracerErr = std::string;
+
+enum class TraceEvent : uint8_t {
+  kSend = 0,
+  kResend,
+  kRecv,
+  kTimeout,
+};
+
+/* One packet event as stored in a trace file, in host byte order. */
+struct TraceRecord {
+  uint64_t time_ns = 0;  /* Since the trace started. */
+  std::array<uint8_t, 16> peer = {}; /* IPv6, or IPv4 mapped. */
+  uint16_t local_port = 0; /* Our end, it names the transfer. */
+  uint16_t peer_port = 0;
+  uint16_t block = 0;  /* For DATA and ACK, else 0. */
+  uint16_t length = 0; /* Of the whole packet. */
+  TraceEvent event = TraceEvent::kSend;
+  uint8_t opcode = 0; /* 0 for timeouts. */
+  std::array<uint8_t, 6> reserved = {};
+};
+static_assert(sizeof(TraceRecord) == 40);
+
+/* A trace file is this header followed by records, unordered across the
+   threads that recorded them. */
+struct TraceHeader {
+  std::array<char, 8> magic = {'T', 'F', 'T', 'P', 'T', 'R', 'C', '1'};
+  uint64_t start_unix_ns = 0;
+};
+static_assert(sizeof(TraceHeader) == 16);
+
+/* Records packet events into a ring per recording thread, which a
+   background thread drains to the trace file every flush interval.
+   Recording takes no locks and never blocks; events that find their
+   ring full are dropped and counted. */
+class Tracer {
+ public:
+  static constexpr std::size_t kRingSize = 8192; /* Records, a power of 2. */
+  static constexpr std::chrono::milliseconds kFlushInterval{50};
+
+  static std::expected<std::unique_ptr<Tracer>, TracerErr> Create(
+      const std::string& path);
+
+  /* Drains what's left and closes the file. */
+  ~Tracer();
+  Tracer(const Tracer&) = delete;
+  Tracer& operator=(const Tracer&) = delete;
+
+  void Record(TraceEvent event, uint16_t local_port, const SockAddr& peer,
+              codec::Bytes packet = {});
+
+  uint64_t Dropped() const { return dropped_; }
+
+ private:
+  struct Ring {
+    std::array<TraceRecord, kRingSize> records;
+    std::atomic<uint64_t> head = 0; /* Written by the recording thread. */
+    std::atomic<uint64_t> tail = 0; /* Written by the flusher. */
+  };
+
+  Tracer(int fd, std::chrono::steady_clock::time_point start);
+
+  Ring& LocalRing();
+  void Loop(std::stop_token stop);
+  void Drain();
+
+  const uint64_t id_;
+  int fd_ = -1;
+  std::chrono::steady_clock::time_point start_;
+  std::atomic<uint64_t> dropped_ = 0;
+
+  std::mutex mutex_; /* Guards rings_ and the file. */
+  std::vector<std::unique_ptr<Ring>> rings_;
+  std::vector<TraceRecord> batch_;
+  std::condition_variable_any cv_;
+  std::jthread flusher_;
+};
+
+struct Trace {
+  uint64_t start_unix_ns = 0;
+  std::vector<TraceRecord> records; /* In time order. */
+};
+
+std::expected<Trace, TracerErr> ReadTrace(const std::string& path);
+
+struct TraceGap {
+  uint64_t after_ns = 0; /* Time of the event the silence followed. */
+  uint64_t length_ns = 0;
+};
+
+/* The events of one transfer and what can be read from them. RTTs pair
+   each DATA sent with the ACK for its block and any other packet sent
+   with the next one received, skipping resent packets (Karn's rule). */
+struct TraceTimeline {
+  uint16_t local_port = 0;
+  std::vector<TraceRecord> events;
+  std::vector<uint64_t> rtts_ns;
+  std::vector<TraceGap> gaps;
+  uint64_t sent = 0;
+  uint64_t resent = 0;
+  uint64_t received = 0;
+  uint64_t timeouts = 0;
+};
+
+/* Splits a trace by transfer, in order of their first event. Silences of
+   at least gap_ns between a transfer's events are reported as gaps. */
+std::vector<TraceTimeline> BuildTimelines(const Trace& trace,
+                                          uint64_t gap_ns);
+
+/* The peer as text, e.g. 127.0.0.1:69 or [::1]:69. */
+std::string TracePeer(const TraceRecord& record);
+
+}  // namespace tftp
+
+#endif
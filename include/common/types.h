@@ -2,6 +2,7 @@
 #define TYPES_H_
 
 #include <cstdint>
+#include <map>
 #include <string>
 #include <vector>
 
@@ -13,6 +14,7 @@ using TftpPacket = std::vector<uint8_t>;
 using Mode = std::string;
 using Hostname = std::string;
 using Seconds = uint16_t;
+using Options = std::map<std::string, std::string>;
 
 struct PortRange {
   uint16_t start = 0;
@@ -28,6 +30,7 @@ enum ErrorCode : uint16_t {
   kUnknownTransferId,
   kFileAlreadyExists,
   kNoSuchUser,
+  kOptionNegotiation,
 };
 
 enum OpCode : uint16_t {
@@ -36,6 +39,7 @@ enum OpCode : uint16_t {
   kData,
   kAck,
   kError,
+  kOptionAck,
 };
 
 namespace SendMode {
@@ -44,16 +48,40 @@ constexpr Mode kOctet = "octet";
 constexpr Mode kMail = "mail";
 }  // namespace SendMode
 
+namespace OptionName {
+constexpr std::string kMulticast = "multicast";
+constexpr std::string kTsize = "tsize";
+constexpr std::string kWindowSize = "windowsize";
+constexpr std::string kRollover = "rollover";
+}  // namespace OptionName
+
+/* The block number that follows 65535. Most servers wrap to 0, some to 1
+   so that 0 only ever acknowledges an OACK. */
+enum class Rollover : uint8_t {
+  kToZero = 0,
+  kToOne = 1,
+};
+
+/* How far a finished download is pushed to disk before it replaces the old
+   copy of the file. */
+enum class FsyncPolicy : uint8_t {
+  kNever,     /* Left to the page cache. */
+  kFile,      /* The file is fsynced before the rename. */
+  kDirectory, /* And its directory after, so the rename survives a crash. */
+};
+
 struct ReadRequestMsg {
   OpCode op = OpCode::kReadReq;
   std::string filename;
   Mode mode;
+  Options options = {};
 };
 
 struct WriteRequestMsg {
   OpCode op = OpCode::kWriteReq;
   std::string filename;
   Mode mode;
+  Options options = {};
 };
 
 struct DataMsg {
@@ -73,6 +101,11 @@ struct ErrorMsg {
   std::string err_msg;
 };
 
+struct OptionAckMsg {
+  OpCode op = OpCode::kOptionAck;
+  Options options = {};
+};
+
 };  // namespace tftp
 
 #endif
@@ -2,6 +2,8 @@
 #define UDP_SOCKET_H_
 
 #include <netdb.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
 #include <sys/types.h>
 
 #include <cstddef>
@@ -14,6 +16,24 @@ namespace tftp {
 
 using UdpSocketErr = std::string;
 
+struct SockAddr {
+  sockaddr_storage storage = {};
+  socklen_t len = 0;
+
+  const sockaddr* Addr() const {
+    return reinterpret_cast<const sockaddr*>(&storage);
+  }
+  int Family() const { return storage.ss_family; }
+  uint16_t Port() const;
+  void SetPort(uint16_t port);
+  std::string Ip() const;
+};
+
+/* Same family, address and port. */
+bool SameAddr(const SockAddr& a, const SockAddr& b);
+
+std::expected<SockAddr, UdpSocketErr> ResolveAddr(std::string_view host);
+
 class UdpSocketRecver {
  public:
   static std::expected<UdpSocketRecver, UdpSocketErr> Create(
@@ -25,26 +45,79 @@ class UdpSocketRecver {
   UdpSocketRecver(UdpSocketRecver&&);
   UdpSocketRecver& operator=(UdpSocketRecver&&);
 
+  int Fd() const { return socket_; }
   uint16_t RecvPort() const { return port_; }
-  uint16_t LastSenderPort() const { return last_sender_port_; }
+  uint16_t LastSenderPort() const { return last_sender_.Port(); }
+  const SockAddr& LastSender() const { return last_sender_; }
 
   std::expected<ssize_t, UdpSocketErr> Recv(void* buffer, std::size_t len);
+  std::expected<void, UdpSocketErr> SetNonBlocking();
+  /* How long Recv waits before reporting no data, 0 waits for good. */
+  std::expected<void, UdpSocketErr> SetRecvTimeout(uint32_t timeout_ms);
+  /* Raise the socket's buffers to at least bytes and return the size the
+     kernel settled on, which its limits may hold below bytes. */
+  std::expected<int, UdpSocketErr> GrowRecvBuffer(int bytes);
+  std::expected<int, UdpSocketErr> GrowSendBuffer(int bytes);
+  std::expected<void, UdpSocketErr> SetBusyPoll(uint32_t usecs);
 
   friend void Swap(UdpSocketRecver& r1, UdpSocketRecver& r2);
 
  private:
   explicit UdpSocketRecver(int socket = -1, uint16_t port = 0)
-      : socket_(socket), port_(port), last_sender_port_(0) {}
+      : socket_(socket), port_(port) {}
+
+  int socket_ = -1;
+  uint16_t port_ = 0;
+  SockAddr last_sender_;
+};
+
+class UdpSocketMcastRecver {
+ public:
+  static std::expected<UdpSocketMcastRecver, UdpSocketErr> Create(
+      std::string_view group, uint16_t port,
+      std::string_view iface_addr = "0.0.0.0");
+
+  ~UdpSocketMcastRecver();
+  UdpSocketMcastRecver(const UdpSocketMcastRecver&) = delete;
+  UdpSocketMcastRecver& operator=(const UdpSocketMcastRecver&) = delete;
+  UdpSocketMcastRecver(UdpSocketMcastRecver&&);
+  UdpSocketMcastRecver& operator=(UdpSocketMcastRecver&&);
+
+  int Fd() const { return socket_; }
+  std::string_view Group() const { return group_; }
+  uint16_t RecvPort() const { return port_; }
+  uint16_t LastSenderPort() const { return last_sender_.Port(); }
+  const SockAddr& LastSender() const { return last_sender_; }
+
+  std::expected<ssize_t, UdpSocketErr> Recv(void* buffer, std::size_t len);
+
+  friend void Swap(UdpSocketMcastRecver& r1, UdpSocketMcastRecver& r2);
+
+ private:
+  explicit UdpSocketMcastRecver(int socket = -1, std::string_view group = "",
+                                uint16_t port = 0, ip_mreq membership = {})
+      : socket_(socket),
+        group_(group),
+        port_(port),
+        membership_(membership) {}
 
   int socket_ = -1;
+  std::string group_;
   uint16_t port_ = 0;
-  uint16_t last_sender_port_ = 0;
+  SockAddr last_sender_;
+  ip_mreq membership_ = {};
 };
 
 class UdpSocketSender {
  public:
   static std::expected<UdpSocketSender, UdpSocketErr> Create(
       std::string_view ip_addr, uint16_t port);
+  static std::expected<UdpSocketSender, UdpSocketErr> Create(
+      std::string_view ip_addr, uint16_t port, const UdpSocketRecver& src);
+  static std::expected<UdpSocketSender, UdpSocketErr> Create(
+      const SockAddr& addr);
+  static std::expected<UdpSocketSender, UdpSocketErr> Create(
+      const SockAddr& addr, const UdpSocketRecver& src);
 
   ~UdpSocketSender();
   UdpSocketSender(const UdpSocketSender&) = delete;
@@ -53,28 +126,27 @@ class UdpSocketSender {
   UdpSocketSender& operator=(UdpSocketSender&&);
 
   std::string_view IpAddr() const { return ip_addr_; }
-  uint16_t SendPort() const { return port_; }
+  uint16_t SendPort() const { return addr_.Port(); }
+  const SockAddr& Addr() const { return addr_; }
 
-  std::expected<ssize_t, UdpSocketErr> Send(void* buffer, std::size_t len);
+  std::expected<ssize_t, UdpSocketErr> Send(const void* buffer,
+                                            std::size_t len);
+  std::expected<void, UdpSocketErr> SetMulticastInterface(
+      std::string_view iface_addr, bool loop);
+  std::expected<void, UdpSocketErr> SetMaxPacingRate(uint64_t rate);
+  std::expected<std::string, UdpSocketErr> RouteSourceAddr() const;
 
   friend void Swap(UdpSocketSender& r1, UdpSocketSender& r2);
 
  private:
   explicit UdpSocketSender(int socket = -1,
                            std::string_view ip_addr = "127.0.0.1",
-                           uint16_t port = 0, addrinfo* servinfo = nullptr,
-                           addrinfo* addr = nullptr)
-      : socket_(socket),
-        ip_addr_(ip_addr),
-        port_(port),
-        servinfo_(servinfo),
-        addr_(addr) {}
+                           const SockAddr& addr = {})
+      : socket_(socket), ip_addr_(ip_addr), addr_(addr) {}
 
   int socket_ = -1;
   std::string ip_addr_;
-  uint16_t port_ = 0;
-  addrinfo* servinfo_ = nullptr;
-  addrinfo* addr_ = nullptr;
+  SockAddr addr_;
 };
 
 }  // namespace tftp
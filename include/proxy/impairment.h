@@ -0,0 +1,67 @@
+#ifndef IMPAIRMENT_H_
+#define IMPAIRMENT_H_
+
+#include <chrono>
+#include <cstdint>
+#include <expected>
+#include <optional>
+#include <random>
+#include <string>
+#include <string_view>
+
+namespace tftp {
+namespace proxy {
+
+using Micros = std::chrono::microseconds;
+using ProfileErr = std::string;
+
+struct ImpairmentProfile {
+  double loss = 0.0;      /* Probability a packet is dropped. */
+  double duplicate = 0.0; /* Probability a packet is delivered twice. */
+  double reorder = 0.0;   /* Probability a packet is held back. */
+  Micros delay = Micros::zero();
+  Micros jitter = Micros::zero();
+  Micros hold = std::chrono::milliseconds(10);
+  uint64_t seed = 1;
+};
+
+/* A spec is an optional preset ('clean', 'lan', 'wan' or 'lossy') followed
+   by comma separated overrides, e.g. 'wan,loss=0.02,seed=7'. Times are in
+   milliseconds and may be fractional. */
+std::expected<ImpairmentProfile, ProfileErr> ParseProfile(
+    std::string_view spec);
+std::string FormatProfile(const ImpairmentProfile& profile);
+
+struct Verdict {
+  bool drop = false;
+  bool reordered = false;
+  Micros delay = Micros::zero();
+  std::optional<Micros> duplicate = std::nullopt; /* Delay of the copy. */
+};
+
+/* Decides the fate of each packet. Jitter varies the delay but the proxy
+   keeps jittered packets in order, held back packets are the only ones
+   that arrive out of order. Every decision draws the same number of
+   values from the generator, so a seed replays the same sequence of
+   verdicts whatever the profile. */
+class Impairer {
+ public:
+  explicit Impairer(const ImpairmentProfile& profile)
+      : profile_(profile), rng_(profile.seed) {}
+
+  const ImpairmentProfile& Profile() const { return profile_; }
+
+  Verdict Next();
+
+ private:
+  double Uniform();
+  Micros Delay(double draw) const;
+
+  ImpairmentProfile profile_;
+  std::mt19937_64 rng_;
+};
+
+}  // namespace proxy
+}  // namespace tftp
+
+#endif
@@ -0,0 +1,101 @@
+#ifndef PROXY_H_
+#define PROXY_H_
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <expected>
+#include <functional>
+#include <optional>
+#include <ostream>
+#include <queue>
+#include <utility>
+#include <vector>
+
+#include "common/types.h"
+#include "common/udp_socket.h"
+#include "proxy/impairment.h"
+
+namespace tftp {
+namespace proxy {
+
+using Clock = std::chrono::steady_clock;
+
+struct ProxyStats {
+  uint64_t received = 0;
+  uint64_t forwarded = 0;
+  uint64_t dropped = 0;
+  uint64_t duplicated = 0;
+  uint64_t reordered = 0;
+};
+
+/* Relays one TFTP client at a time to a server through an Impairer. The
+   client talks to the listen port only. Upstream traffic leaves from a
+   second port and follows the server's TID, so neither end needs to know
+   the proxy is there. */
+class Proxy {
+ public:
+  static std::expected<Proxy, UdpSocketErr> Create(
+      uint16_t listen_port, const SockAddr& server,
+      const ImpairmentProfile& profile, std::ostream* log = nullptr);
+
+  uint16_t Port() const { return downstream_.RecvPort(); }
+  const ProxyStats& Stats() const { return stats_; }
+
+  /* Waits up to max_wait for traffic, then delivers whatever is due. */
+  std::expected<void, UdpSocketErr> Poll(Micros max_wait);
+  std::expected<void, UdpSocketErr> Run(const std::atomic<bool>& stop);
+
+ private:
+  enum class Direction { kToServer, kToClient };
+
+  struct Pending {
+    Clock::time_point due;
+    uint64_t seq = 0;
+    Direction dir = Direction::kToServer;
+    TftpPacket packet;
+
+    bool operator>(const Pending& other) const {
+      return (due != other.due) ? due > other.due : seq > other.seq;
+    }
+  };
+
+  Proxy(UdpSocketRecver downstream, UdpSocketRecver upstream,
+        const SockAddr& server, const ImpairmentProfile& profile,
+        std::ostream* log)
+      : downstream_(std::move(downstream)),
+        upstream_(std::move(upstream)),
+        server_(server),
+        impairer_(profile),
+        log_(log),
+        start_(Clock::now()),
+        buffer_(65536) {}
+
+  std::expected<void, UdpSocketErr> Receive(Direction dir);
+  void Schedule(Direction dir, TftpPacket packet);
+  std::expected<void, UdpSocketErr> Deliver(const Pending& pending);
+  void Log(Direction dir, const TftpPacket& packet, const Verdict& verdict);
+
+  UdpSocketRecver downstream_;
+  UdpSocketRecver upstream_;
+  SockAddr server_;
+  SockAddr client_;
+  uint16_t server_tid_ = 0;
+  std::optional<UdpSocketSender> to_server_;
+  std::optional<UdpSocketSender> to_client_;
+  Impairer impairer_;
+  std::ostream* log_ = nullptr;
+  Clock::time_point start_;
+  std::array<Clock::time_point, 2> last_due_ = {};
+  uint64_t seq_ = 0;
+  std::priority_queue<Pending, std::vector<Pending>, std::greater<Pending>>
+      pending_;
+  ProxyStats stats_;
+  std::vector<uint8_t> buffer_;
+};
+
+}  // namespace proxy
+}  // namespace tftp
+
+#endif
@@ -0,0 +1,38 @@
+#include "client/block_bitmap.h"
+
+#include <cstdint>
+
+namespace tftp {
+namespace client {
+
+static constexpr uint64_t kBitsPerWord = 64;
+
+bool BlockBitmap::Set(uint64_t block) {
+  if (Test(block)) {
+    return false;
+  }
+
+  uint64_t word = block / kBitsPerWord;
+  if (word >= words_.size()) {
+    words_.resize(word + 1, 0);
+  }
+  words_[word] |= (uint64_t{1} << (block % kBitsPerWord));
+  count_++;
+
+  /* Skip over the run of blocks that this one made contiguous. */
+  while (Test(first_missing_)) {
+    first_missing_++;
+  }
+  return true;
+}
+
+bool BlockBitmap::Test(uint64_t block) const {
+  uint64_t word = block / kBitsPerWord;
+  if (word >= words_.size()) {
+    return false;
+  }
+  return words_[word] & (uint64_t{1} << (block % kBitsPerWord));
+}
+
+}  // namespace client
+}  // namespace tftp
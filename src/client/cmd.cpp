@@ -1,15 +1,32 @@
 #include "client/cmd.h"
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <cstdint>
 #include <expected>
+#include <functional>
+#include <iomanip>
 #include <iostream>
 #include <iterator>
 #include <memory>
 #include <sstream>
 #include <string>
 #include <string_view>
+#include <utility>
 #include <vector>
 
+#include "client/congestion.h"
+#include "client/file_sink.h"
+#include "client/metrics.h"
+#include "client/multicast.h"
+#include "client/pacer.h"
+#include "client/scheduler.h"
+#include "client/server_pool.h"
+#include "client/stats.h"
+#include "client/sync.h"
+#include "client/transfer.h"
+#include "common/histogram.h"
 #include "common/parse.h"
 #include "common/types.h"
 
@@ -25,10 +42,222 @@ static TokenList Tokenize(std::string_view cmdline) {
   return {std::istream_iterator<Token>(buffer), {}};
 }
 
+/* Strips the host from a host:file argument making it the default host. */
+static File ResolveHost(const File& arg, Config& conf) {
+  std::size_t seperator = arg.find(':');
+  if (conf.literal_mode || seperator == File::npos) {
+    return arg;
+  }
+  conf.hostname = arg.substr(0, seperator);
+  return arg.substr(seperator + 1);
+}
+
+static File Basename(const File& path) {
+  std::size_t seperator = path.find_last_of('/');
+  return (seperator == File::npos) ? path : path.substr(seperator + 1);
+}
+
+static double ToSeconds(Micros usecs) {
+  return std::chrono::duration_cast<std::chrono::duration<double>>(usecs)
+      .count();
+}
+
+static double ToMillis(std::chrono::nanoseconds nsecs) {
+  return std::chrono::duration_cast<std::chrono::duration<double, std::milli>>(
+             nsecs)
+      .count();
+}
+
+static std::string RateName(uint64_t rate) {
+  return (rate) ? std::to_string(rate) : "off";
+}
+
+static void PrintPercentiles(std::string_view name, const Histogram& hist) {
+  if (!hist.Count()) {
+    return;
+  }
+  std::cout << "\t\t" << name << " p50/p99/p99.9/max (ms): " << std::fixed
+            << std::setprecision(3) << ToMillis(hist.Percentile(50)) << "/"
+            << ToMillis(hist.Percentile(99)) << "/"
+            << ToMillis(hist.Percentile(99.9)) << "/" << ToMillis(hist.Max())
+            << std::endl;
+}
+
+static void PrintServers(const ServerPool& pool) {
+  std::cout << "\tservers:";
+  for (const ServerPool::Server& server : pool.Servers()) {
+    std::cout << " " << server.host << " (";
+    if (server.down_until && Clock::now() < *server.down_until) {
+      std::cout << "down";
+    } else if (server.srtt) {
+      std::cout << std::fixed << std::setprecision(3) << ToMillis(*server.srtt)
+                << " ms" << std::defaultfloat;
+    } else {
+      std::cout << "unprobed";
+    }
+    std::cout << ")";
+  }
+  std::cout << std::endl;
+}
+
+static void PrintStats(const TransferStats& stats) {
+  std::cout << "\t\tbytes: " << stats.bytes << std::endl;
+  std::cout << "\t\tblocks: " << stats.blocks << std::endl;
+  std::cout << "\t\tduplicates received: " << stats.duplicates << std::endl;
+  std::cout << "\t\tretransmits sent: " << stats.retransmits << " ("
+            << stats.fast_retransmits << " fast)" << std::endl;
+  std::cout << "\t\ttimeouts: " << stats.timeouts << std::endl;
+  std::cout << "\t\twindow/cwnd (blocks): " << stats.window << "/"
+            << stats.cwnd << std::endl;
+  std::cout << "\t\tsocket buffers recv/send (bytes): " << stats.buffers.recv
+            << "/" << stats.buffers.send << " of " << stats.buffers.wanted
+            << ((stats.buffers.Clamped()) ? " wanted, clamped" : " wanted")
+            << std::endl;
+  std::cout << "\t\trtt min/avg/max (ms): " << std::fixed
+            << std::setprecision(3) << ToMillis(stats.RttMin()) << "/"
+            << ToMillis(stats.RttAvg()) << "/" << ToMillis(stats.rtt_max)
+            << std::endl;
+  PrintPercentiles("rtt", stats.rtts);
+  PrintPercentiles("sendto", stats.send_time);
+  PrintPercentiles("recvfrom", stats.recv_time);
+  PrintPercentiles("disk write", stats.write_time);
+  PrintPercentiles("transfer", stats.transfer_time);
+  std::cout << "\t\tthroughput (bytes/sec): " << std::setprecision(1)
+            << stats.Throughput() << std::endl;
+  std::cout << "\t\telapsed (sec): " << std::setprecision(3)
+            << ToSeconds(stats.elapsed) << std::defaultfloat << std::endl;
+}
+
+/* Folds a finished transfer into the session stats and reports on it. */
+static bool RecordTransfer(Config& conf, std::string_view verb,
+                           const TransferRecord& record) {
+  conf.stats->Merge(record.stats, !record.err);
+  if (conf.tally) {
+    conf.tally->blocks += record.stats.blocks;
+    conf.tally->retransmits += record.stats.retransmits;
+  }
+  if (conf.metrics) {
+    conf.metrics->Write(record);
+  }
+
+  if (record.err) {
+    *conf.console << record.file << ": " << record.err->msg << std::endl;
+    return false;
+  }
+
+  if (conf.verbose) {
+    const TransferStats& stats = record.stats;
+    *conf.console << verb << " " << stats.bytes << " bytes in "
+                  << std::fixed << std::setprecision(1)
+                  << ToSeconds(stats.elapsed) << " seconds ["
+                  << std::setprecision(0) << (8 * stats.Throughput())
+                  << " bit/s], " << stats.retransmits << " retransmits, "
+                  << stats.duplicates << " duplicates, " << stats.timeouts
+                  << " timeouts" << std::defaultfloat << std::endl;
+  }
+  return true;
+}
+
+/* Copies a fetched file to the other local names it was wanted under. */
+static bool PublishCopies(const File& from, const std::vector<File>& to,
+                          FsyncPolicy fsync, std::ostream& console) {
+  bool success = true;
+  for (const File& local : to) {
+    if (local == from) {
+      continue;
+    }
+    auto copied = PublishCopy(from, local, fsync);
+    if (!copied) {
+      console << local << ": " << copied.error().msg << std::endl;
+      success = false;
+    }
+  }
+  return success;
+}
+
+using Attempt = std::function<std::expected<void, TransferErr>(
+    const Config& conf, const Hostname& host, TransferStats& stats)>;
+
+/* Runs a transfer on record.host or, when that names the connected server
+   pool, on the pool's best server, moving on to the next one while servers
+   stop answering. A stream can't be read or written twice, so a transfer
+   from stdin or to stdout only gets its first server. */
+static std::expected<void, TransferErr> OnServers(const Config& conf,
+                                                  TransferRecord& record,
+                                                  bool retry,
+                                                  const Attempt& attempt) {
+  ServerPool* pool = conf.servers.get();
+  if (!pool || record.host != pool->Name()) {
+    return attempt(conf, record.host, record.stats);
+  }
+
+  /* Give up on a silent server after a few resends of the request, not
+     once the whole transfer has timed out. */
+  Config failover = conf;
+  failover.request_retries = ServerPool::kRequestRetries;
+  std::vector<Hostname> tried;
+  std::expected<void, TransferErr> result =
+      std::unexpected("no server in " + pool->Name() + " is answering");
+  while (auto host = pool->Acquire(tried)) {
+    tried.push_back(*host);
+    record.host = *host;
+    TransferStats stats;
+    result = attempt(failover, *host, stats);
+    record.stats.Merge(stats);
+    bool down = !result && result.error().unresponsive;
+    pool->Release(*host, stats, down);
+    if (!down || !retry) {
+      break;
+    }
+  }
+  return result;
+}
+
+struct Transfer {
+  File host;
+  std::function<bool(Config&)> run;
+};
+
+/* Runs the transfers through the scheduler when there is one, each on its
+   own copy of conf. */
+static bool RunTransfers(Config& conf, std::vector<Transfer>& transfers) {
+  /* Multicast receivers share the group's port, keep them one at a time. */
+  if (!conf.scheduler || conf.multicast) {
+    bool success = true;
+    for (Transfer& transfer : transfers) {
+      success &= transfer.run(conf);
+    }
+    return success;
+  }
+
+  std::vector<Config> confs(transfers.size(), conf);
+  std::vector<TransferTally> tallies(transfers.size());
+  std::vector<TransferScheduler::Job> jobs;
+  for (std::size_t i = 0; i < transfers.size(); ++i) {
+    confs[i].tally = &tallies[i];
+    jobs.push_back({.host = transfers[i].host, .task = [&, i] {
+                      bool ok = transfers[i].run(confs[i]);
+                      conf.scheduler->Feedback(transfers[i].host,
+                                               tallies[i].blocks,
+                                               tallies[i].retransmits);
+                      return ok;
+                    }});
+  }
+  return conf.scheduler->Run(std::move(jobs));
+}
+
 ExecStatus ConnectCmd::Execute(Config& conf) {
   conf.hostname = host_;
-  conf.ports.start = port_;
-  conf.ports.end = port_;
+  if (port_) {
+    conf.server_port = port_;
+  }
+  conf.servers = ServerPool::FromList(host_);
+  if (conf.servers) {
+    conf.servers->Probe(conf, conf.server_port);
+    if (conf.verbose) {
+      PrintServers(*conf.servers);
+    }
+  }
 
   return ExecStatus::kSuccessfulExec;
 }
@@ -51,7 +280,7 @@ ExpectedCmd<ConnectCmd> ConnectCmd::Create(std::string_view cmdline) {
 }
 
 void ConnectCmd::PrintUsage() {
-  std::cout << "connect host [port]" << std::endl;
+  std::cout << "connect host[,host...] [port]" << std::endl;
   std::cout << "    Set the host (and optionally port) for transfers. Note "
                "that the TFTP"
             << std::endl;
@@ -68,10 +297,92 @@ void ConnectCmd::PrintUsage() {
                "specified as part of the"
             << std::endl;
   std::cout << "    get or put commands." << std::endl;
+  std::cout << "    Given several comma separated hosts holding the same "
+               "files, connect probes"
+            << std::endl;
+  std::cout << "    them and each transfer goes to the fastest one that "
+               "isn't busy, moving on"
+            << std::endl;
+  std::cout << "    to another when a server stops answering." << std::endl;
 }
 
-ExecStatus GetCmd::Execute([[gnu::unused]] Config& conf) {
-  return ExecStatus::kNotImplemented;
+ExecStatus GetCmd::Execute(Config& conf) {
+  /* Pair each remote file with the local file it is written to. */
+  std::vector<std::pair<File, File>> transfers;
+  if (!remote_file_.empty()) {
+    transfers.emplace_back(remote_file_, local_file_);
+  }
+  for (const File& file : files_) {
+    transfers.emplace_back(file, File{});
+  }
+
+  /* A file wanted under several local names is fetched once and copied to
+     the others, a stream to stdout keeps its own transfer. */
+  struct Fetch {
+    std::string host;
+    File remote;
+    std::vector<File> locals;
+  };
+  std::vector<Fetch> fetches;
+  for (auto& [remote, local] : transfers) {
+    File remote_path = ResolveHost(remote, conf);
+    if (local.empty()) {
+      local = Basename(remote_path);
+    }
+    auto same = std::ranges::find_if(fetches, [&](const Fetch& fetch) {
+      return fetch.host == conf.hostname && fetch.remote == remote_path &&
+             fetch.locals[0] != kStdStream && local != kStdStream;
+    });
+    if (same == fetches.end()) {
+      fetches.push_back(
+          {.host = conf.hostname, .remote = remote_path, .locals = {local}});
+    } else if (std::ranges::find(same->locals, local) == same->locals.end()) {
+      same->locals.push_back(local);
+    }
+  }
+
+  std::vector<Transfer> jobs;
+  for (const Fetch& fetch : fetches) {
+    jobs.push_back({.host = fetch.host, .run = [&fetch](Config& conf) {
+                      const File& local = fetch.locals[0];
+                      TransferRecord record = {.direction = CmdId::kGet,
+                                               .host = fetch.host,
+                                               .file = fetch.remote};
+                      auto get = (conf.multicast) ? GetFileMulticast : GetFile;
+                      std::expected<void, TransferErr> result;
+                      if (conf.multicast && local == kStdStream) {
+                        /* Its blocks arrive out of order. */
+                        result = std::unexpected(
+                            "multicast can't stream to stdout");
+                      } else {
+                        result = OnServers(
+                            conf, record, local != kStdStream,
+                            [&](const Config& conf, const Hostname& host,
+                                TransferStats& stats) {
+                              return get(conf, host, conf.server_port,
+                                         fetch.remote, local, stats);
+                            });
+                      }
+                      if (!result) {
+                        record.err = result.error();
+                      }
+                      return RecordTransfer(conf, "Received", record) &&
+                             PublishCopies(local, fetch.locals, conf.fsync,
+                                           *conf.console);
+                    }});
+  }
+
+  bool to_stdout = std::ranges::any_of(transfers, [](const auto& transfer) {
+    return transfer.second == kStdStream;
+  });
+  /* Keep the command's own reports out of the file. */
+  std::ostream* console = conf.console;
+  if (to_stdout) {
+    conf.console = &std::cerr;
+  }
+  bool success = RunTransfers(conf, jobs);
+  conf.console = console;
+  return (success) ? ExecStatus::kSuccessfulExec : ExecStatus::kTransferFailed;
 }
 
 ExpectedCmd<GetCmd> GetCmd::Create(std::string_view cmdline) {
@@ -122,11 +433,51 @@ void GetCmd::PrintUsage() {
   std::cout << "    literal mode to prevent special treatment of the ':' "
                "character (e.g."
             << std::endl;
-  std::cout << "    C:\\dir\\file)." << std::endl;
+  std::cout << "    C:\\dir\\file). A localfile of '-' streams the file "
+               "to stdout."
+            << std::endl;
 }
 
-ExecStatus PutCmd::Execute([[gnu::unused]] Config& conf) {
-  return ExecStatus::kNotImplemented;
+ExecStatus PutCmd::Execute(Config& conf) {
+  /* Pair each local file with the remote file it is written to. */
+  std::vector<std::pair<File, File>> transfers;
+  if (!local_file_.empty()) {
+    transfers.emplace_back(local_file_, ResolveHost(remote_file_, conf));
+  }
+  if (remote_dir_.empty()) {
+    for (const File& file : files_) {
+      transfers.emplace_back(file, file);
+    }
+  } else {
+    File dir = ResolveHost(remote_dir_, conf);
+    for (const File& file : files_) {
+      transfers.emplace_back(file, dir + "/" + Basename(file));
+    }
+  }
+
+  std::vector<Transfer> jobs;
+  for (const auto& [local, remote] : transfers) {
+    jobs.push_back(
+        {.host = conf.hostname,
+         .run = [host = conf.hostname, local, remote](Config& conf) {
+           TransferRecord record = {
+               .direction = CmdId::kPut, .host = host, .file = remote};
+           auto result = OnServers(
+               conf, record, local != kStdStream,
+               [&](const Config& conf, const Hostname& host,
+                   TransferStats& stats) {
+                 return PutFile(conf, host, conf.server_port, local, remote,
+                                stats);
+               });
+           if (!result) {
+             record.err = result.error();
+           }
+           return RecordTransfer(conf, "Sent", record);
+         }});
+  }
+
+  return (RunTransfers(conf, jobs)) ? ExecStatus::kSuccessfulExec
+                                    : ExecStatus::kTransferFailed;
 }
 
 ExpectedCmd<PutCmd> PutCmd::Create(std::string_view cmdline) {
@@ -154,6 +505,11 @@ ExpectedCmd<PutCmd> PutCmd::Create(std::string_view cmdline) {
     files = FileList(args.cbegin(), args.cbegin() + args.size() - 1);
   }
 
+  /* stdin has no name to reuse on the server. */
+  if (std::ranges::find(files, kStdStream) != files.cend()) {
+    return std::unexpected(ParseStatus::kStdinNeedsRemoteName);
+  }
+
   return std::unique_ptr<PutCmd>(
       new PutCmd(remote_file, local_file, remote_dir, files));
 }
@@ -186,6 +542,8 @@ void PutCmd::PrintUsage() {
   std::cout << "    to prevent special treatment of the ':' character (e.g. "
                "C:\\dir\\file)."
             << std::endl;
+  std::cout << "    A localfile of '-' reads the file from stdin until EOF."
+            << std::endl;
 }
 
 ExecStatus LiteralCmd::Execute(Config& conf) {
@@ -240,14 +598,46 @@ ExecStatus StatusCmd::Execute(Config& conf) {
   std::cout << "\tliteral mode enabled: " << std::boolalpha << conf.literal_mode
             << std::endl;
   std::cout << "\thostname: " << conf.hostname << std::endl;
+  if (conf.servers) {
+    PrintServers(*conf.servers);
+  }
+  std::cout << "\tserver port: " << conf.server_port << std::endl;
   if (conf.ports.start == conf.ports.end) {
-    std::cout << "\tport: " << conf.ports.start << std::endl;
+    std::cout << "\tsource port: " << conf.ports.start << std::endl;
   } else {
-    std::cout << "\tports: " << conf.ports.start << "-" << conf.ports.end
-              << std::endl;
+    std::cout << "\tsource ports: " << conf.ports.start << "-"
+              << conf.ports.end << std::endl;
   }
   std::cout << "\ttransmission timeout (sec): " << conf.timeout << std::endl;
   std::cout << "\trexmt timeout (sec): " << conf.rexmt_timeout << std::endl;
+  std::cout << "\tverbose: " << conf.verbose << std::endl;
+  std::cout << "\ttrace: " << conf.trace << std::endl;
+  std::cout << "\twindow size (blocks): " << conf.windowsize << std::endl;
+  std::cout << "\tcongestion control: "
+            << CongestionModeName(conf.congestion) << std::endl;
+  std::cout << "\tpacing rate (bytes/sec): " << RateName(conf.rate)
+            << " per transfer, "
+            << RateName((conf.global_pacer) ? conf.global_pacer->Rate() : 0)
+            << " total" << std::endl;
+  std::cout << "\trollover: "
+            << ((conf.rollover)
+                    ? std::to_string(static_cast<int>(*conf.rollover))
+                    : "off")
+            << std::endl;
+  std::cout << "\tdirect I/O: " << conf.direct_io << std::endl;
+  std::cout << "\tfsync: " << FsyncPolicyName(conf.fsync) << std::endl;
+  std::cout << "\tbusy poll (usecs): "
+            << ((conf.busy_poll) ? std::to_string(conf.busy_poll) : "off")
+            << std::endl;
+  const SessionStats& stats = *conf.stats;
+  std::cout << "\ttransfers: " << stats.transfers << " (" << stats.failures
+            << " failed)" << std::endl;
+  if (stats.transfers) {
+    std::cout << "\tlast transfer:" << std::endl;
+    PrintStats(stats.last);
+    std::cout << "\tsession totals:" << std::endl;
+    PrintStats(stats.totals);
+  }
 
   return ExecStatus::kSuccessfulExec;
 }
@@ -313,6 +703,403 @@ void RexmtCmd::PrintUsage() {
             << std::endl;
 }
 
+ExecStatus VerboseCmd::Execute(Config& conf) {
+  conf.verbose = !conf.verbose;
+  *conf.console << "Verbose mode " << (conf.verbose ? "on" : "off") << "."
+                << std::endl;
+
+  return ExecStatus::kSuccessfulExec;
+}
+
+ExpectedCmd<VerboseCmd> VerboseCmd::Create() {
+  return std::unique_ptr<VerboseCmd>(new VerboseCmd());
+}
+
+void VerboseCmd::PrintUsage() {
+  std::cout << "verbose" << std::endl;
+  std::cout << "    Toggle verbose mode. When set, a summary of the bytes, "
+               "throughput and"
+            << std::endl;
+  std::cout << "    retransmissions is printed after each transfer."
+            << std::endl;
+}
+
+ExecStatus TraceCmd::Execute(Config& conf) {
+  conf.trace = !conf.trace;
+  *conf.console << "Packet tracing " << (conf.trace ? "on" : "off") << "."
+                << std::endl;
+
+  return ExecStatus::kSuccessfulExec;
+}
+
+ExpectedCmd<TraceCmd> TraceCmd::Create() {
+  return std::unique_ptr<TraceCmd>(new TraceCmd());
+}
+
+void TraceCmd::PrintUsage() {
+  std::cout << "trace" << std::endl;
+  std::cout << "    Toggle packet tracing. When set, every packet sent or "
+               "received is printed."
+            << std::endl;
+}
+
+ExecStatus MulticastCmd::Execute(Config& conf) {
+  conf.multicast = !conf.multicast;
+  *conf.console << "Multicast mode " << (conf.multicast ? "on" : "off") << "."
+                << std::endl;
+
+  return ExecStatus::kSuccessfulExec;
+}
+
+ExpectedCmd<MulticastCmd> MulticastCmd::Create() {
+  return std::unique_ptr<MulticastCmd>(new MulticastCmd());
+}
+
+void MulticastCmd::PrintUsage() {
+  std::cout << "multicast" << std::endl;
+  std::cout << "    Toggle multicast mode (RFC 2090). When set, get asks the "
+               "server to send the"
+            << std::endl;
+  std::cout << "    file to a multicast group shared with other clients. "
+               "Requires binary mode."
+            << std::endl;
+}
+
+ExecStatus WindowSizeCmd::Execute(Config& conf) {
+  conf.windowsize = windowsize_;
+
+  return ExecStatus::kSuccessfulExec;
+}
+
+ExpectedCmd<WindowSizeCmd> WindowSizeCmd::Create(std::string_view cmdline) {
+  TokenList args = Tokenize(cmdline);
+  if (args.size() != 2) {
+    return std::unexpected(ParseStatus::kInvalidNumArgs);
+  }
+
+  auto windowsize = ParseWindowSize(args[1]);
+  if (!windowsize) {
+    return std::unexpected(windowsize.error());
+  }
+
+  return std::unique_ptr<WindowSizeCmd>(new WindowSizeCmd(*windowsize));
+}
+
+void WindowSizeCmd::PrintUsage() {
+  std::cout << "windowsize blocks" << std::endl;
+  std::cout << "    Set the number of blocks to request per window (RFC 7440). "
+               "A value of 1"
+            << std::endl;
+  std::cout << "    disables windowing." << std::endl;
+}
+
+ExecStatus CongestionCmd::Execute(Config& conf) {
+  conf.congestion = mode_;
+
+  return ExecStatus::kSuccessfulExec;
+}
+
+ExpectedCmd<CongestionCmd> CongestionCmd::Create(std::string_view cmdline) {
+  TokenList args = Tokenize(cmdline);
+  if (args.size() != 2) {
+    return std::unexpected(ParseStatus::kInvalidNumArgs);
+  }
+
+  auto mode = ParseCongestionMode(args[1]);
+  if (!mode) {
+    return std::unexpected(mode.error());
+  }
+
+  return std::unique_ptr<CongestionCmd>(new CongestionCmd(*mode));
+}
+
+void CongestionCmd::PrintUsage() {
+  std::cout << "congestion aimd|delay|off" << std::endl;
+  std::cout << "    Set how put sizes its window within the negotiated window "
+               "size. 'aimd'"
+            << std::endl;
+  std::cout << "    grows it by a block per round trip and halves it on loss, "
+               "'delay' also"
+            << std::endl;
+  std::cout << "    backs off as round trip times rise and 'off' always sends "
+               "a full window."
+            << std::endl;
+}
+
+ExecStatus RateCmd::Execute(Config& conf) {
+  conf.rate = rate_;
+  if (global_rate_) {
+    /* Transfers copy the config, so they all end up sharing this bucket. */
+    conf.global_pacer = (*global_rate_)
+                            ? std::make_shared<TokenBucket>(*global_rate_)
+                            : nullptr;
+  }
+
+  return ExecStatus::kSuccessfulExec;
+}
+
+ExpectedCmd<RateCmd> RateCmd::Create(std::string_view cmdline) {
+  TokenList args = Tokenize(cmdline);
+  if (args.size() < 2 || args.size() > 3) {
+    return std::unexpected(ParseStatus::kInvalidNumArgs);
+  }
+
+  auto rate = ParseRate(args[1]);
+  if (!rate) {
+    return std::unexpected(rate.error());
+  }
+
+  std::optional<uint64_t> global_rate;
+  if (args.size() == 3) {
+    auto parsed_global = ParseRate(args[2]);
+    if (!parsed_global) {
+      return std::unexpected(parsed_global.error());
+    }
+    global_rate = *parsed_global;
+  }
+
+  return std::unique_ptr<RateCmd>(new RateCmd(*rate, global_rate));
+}
+
+void RateCmd::PrintUsage() {
+  std::cout << "rate bytes-per-sec [total-bytes-per-sec]" << std::endl;
+  std::cout << "    Pace each transfer's packets to the given rate, e.g. 512k "
+               "or 10M. The"
+            << std::endl;
+  std::cout << "    optional second rate caps all concurrent transfers "
+               "together. 'off'"
+            << std::endl;
+  std::cout << "    removes a cap." << std::endl;
+}
+
+ExecStatus RolloverCmd::Execute(Config& conf) {
+  conf.rollover = rollover_;
+
+  return ExecStatus::kSuccessfulExec;
+}
+
+ExpectedCmd<RolloverCmd> RolloverCmd::Create(std::string_view cmdline) {
+  TokenList args = Tokenize(cmdline);
+  if (args.size() != 2) {
+    return std::unexpected(ParseStatus::kInvalidNumArgs);
+  }
+  if (args[1] == "off") {
+    return std::unique_ptr<RolloverCmd>(new RolloverCmd(std::nullopt));
+  }
+
+  auto rollover = ParseRollover(args[1]);
+  if (!rollover) {
+    return std::unexpected(rollover.error());
+  }
+
+  return std::unique_ptr<RolloverCmd>(new RolloverCmd(*rollover));
+}
+
+void RolloverCmd::PrintUsage() {
+  std::cout << "rollover 0|1|off" << std::endl;
+  std::cout << "    Ask the server to continue block numbers at 0 or 1 after "
+               "65535. With 'off'"
+            << std::endl;
+  std::cout << "    nothing is asked and block numbers wrap to 0, as most "
+               "servers do."
+            << std::endl;
+}
+
+ExecStatus DirectCmd::Execute(Config& conf) {
+  conf.direct_io = !conf.direct_io;
+  *conf.console << "Direct I/O " << (conf.direct_io ? "on" : "off") << "."
+                << std::endl;
+
+  return ExecStatus::kSuccessfulExec;
+}
+
+ExpectedCmd<DirectCmd> DirectCmd::Create() {
+  return std::unique_ptr<DirectCmd>(new DirectCmd());
+}
+
+void DirectCmd::PrintUsage() {
+  std::cout << "direct" << std::endl;
+  std::cout << "    Toggle direct I/O. When set, get writes the file with "
+               "O_DIRECT so huge"
+            << std::endl;
+  std::cout << "    downloads stay out of the page cache. Multicast gets "
+               "are unaffected."
+            << std::endl;
+}
+
+ExecStatus FsyncCmd::Execute(Config& conf) {
+  conf.fsync = policy_;
+
+  return ExecStatus::kSuccessfulExec;
+}
+
+ExpectedCmd<FsyncCmd> FsyncCmd::Create(std::string_view cmdline) {
+  TokenList args = Tokenize(cmdline);
+  if (args.size() != 2) {
+    return std::unexpected(ParseStatus::kInvalidNumArgs);
+  }
+
+  auto policy = ParseFsyncPolicy(args[1]);
+  if (!policy) {
+    return std::unexpected(policy.error());
+  }
+
+  return std::unique_ptr<FsyncCmd>(new FsyncCmd(*policy));
+}
+
+void FsyncCmd::PrintUsage() {
+  std::cout << "fsync never|file|dir" << std::endl;
+  std::cout << "    Set how a downloaded file reaches the disk before it is "
+               "renamed into place."
+            << std::endl;
+  std::cout << "    'never' leaves it to the page cache, 'file' fsyncs the "
+               "file first and 'dir'"
+            << std::endl;
+  std::cout << "    also fsyncs its directory after the rename. sync always "
+               "fsyncs the file."
+            << std::endl;
+}
+
+ExecStatus BusyPollCmd::Execute(Config& conf) {
+  conf.busy_poll = usecs_;
+
+  return ExecStatus::kSuccessfulExec;
+}
+
+ExpectedCmd<BusyPollCmd> BusyPollCmd::Create(std::string_view cmdline) {
+  TokenList args = Tokenize(cmdline);
+  if (args.size() != 2) {
+    return std::unexpected(ParseStatus::kInvalidNumArgs);
+  }
+
+  auto usecs = ParseBusyPoll(args[1]);
+  if (!usecs) {
+    return std::unexpected(usecs.error());
+  }
+  return std::unique_ptr<BusyPollCmd>(new BusyPollCmd(*usecs));
+}
+
+void BusyPollCmd::PrintUsage() {
+  std::cout << "busypoll usecs|off" << std::endl;
+  std::cout << "    Spin for up to usecs microseconds waiting for a packet "
+               "before sleeping."
+            << std::endl;
+  std::cout << "    Burns CPU to cut wakeup latency, which dominates "
+               "transfers of many small"
+            << std::endl;
+  std::cout << "    files. Needs CAP_NET_ADMIN past net.core.busy_read."
+            << std::endl;
+}
+
+ExecStatus SyncCmd::Execute(Config& conf) {
+  auto manifest = ReadManifest(manifest_file_);
+  if (!manifest) {
+    *conf.console << manifest.error() << std::endl;
+    return ExecStatus::kInvalidManifest;
+  }
+
+  /* Entries that only differ in their local name share one transfer. */
+  struct Group {
+    Hostname host;
+    std::vector<ManifestEntry*> entries;
+  };
+  std::vector<Group> groups;
+  for (ManifestEntry& entry : *manifest) {
+    entry.remote = ResolveHost(entry.remote, conf);
+    auto same = std::ranges::find_if(groups, [&](const Group& group) {
+      const ManifestEntry& first = *group.entries[0];
+      return group.host == conf.hostname && first.remote == entry.remote &&
+             first.size == entry.size && first.sha256 == entry.sha256;
+    });
+    if (same == groups.end()) {
+      groups.push_back({.host = conf.hostname, .entries = {&entry}});
+    } else {
+      same->entries.push_back(&entry);
+    }
+  }
+
+  /* Copies are synced like the downloads SyncFile publishes. */
+  FsyncPolicy fsync = std::max(conf.fsync, FsyncPolicy::kFile);
+  std::atomic<std::size_t> current = 0;
+  std::vector<Transfer> jobs;
+  for (const Group& group : groups) {
+    jobs.push_back({.host = group.host,
+                    .run = [&group, &current, fsync](Config& conf) {
+                      /* Checking a big file means hashing it, that too runs
+                         in parallel. */
+                      std::vector<File> stale;
+                      const ManifestEntry* source = nullptr;
+                      for (const ManifestEntry* entry : group.entries) {
+                        if (UpToDate(*entry)) {
+                          current++;
+                          source = entry;
+                        } else {
+                          stale.push_back(entry->local);
+                        }
+                      }
+                      if (stale.empty()) {
+                        return true;
+                      }
+                      /* A good copy on disk saves the transfer. */
+                      if (source) {
+                        return PublishCopies(source->local, stale, fsync,
+                                             *conf.console);
+                      }
+
+                      ManifestEntry entry = *group.entries[0];
+                      entry.local = stale[0];
+                      TransferRecord record = {.direction = CmdId::kGet,
+                                               .host = group.host,
+                                               .file = entry.remote};
+                      auto result = OnServers(
+                          conf, record, true,
+                          [&](const Config& conf, const Hostname& host,
+                              TransferStats& stats) {
+                            return SyncFile(conf, host, conf.server_port,
+                                            entry, stats);
+                          });
+                      if (!result) {
+                        record.err = result.error();
+                      }
+                      return RecordTransfer(conf, "Received", record) &&
+                             PublishCopies(entry.local, stale, fsync,
+                                           *conf.console);
+                    }});
+  }
+
+  bool success = RunTransfers(conf, jobs);
+  if (conf.verbose) {
+    *conf.console << "Synced " << manifest->size() << " files, " << current
+                  << " already up to date." << std::endl;
+  }
+  return (success) ? ExecStatus::kSuccessfulExec : ExecStatus::kTransferFailed;
+}
+
+ExpectedCmd<SyncCmd> SyncCmd::Create(std::string_view cmdline) {
+  TokenList args = Tokenize(cmdline);
+  if (args.size() != 2) {
+    return std::unexpected(ParseStatus::kInvalidNumArgs);
+  }
+
+  return std::unique_ptr<SyncCmd>(new SyncCmd(args[1]));
+}
+
+void SyncCmd::PrintUsage() {
+  std::cout << "sync manifest-file" << std::endl;
+  std::cout << "    Fetch the files listed in manifest-file, one 'remote local "
+               "size [sha256]'"
+            << std::endl;
+  std::cout << "    per line. Files whose local copy already has the size "
+               "and checksum are"
+            << std::endl;
+  std::cout << "    skipped, the rest are fetched in parallel, checked and "
+               "renamed into place."
+            << std::endl;
+  std::cout << "    A remote file listed under several local names is fetched "
+               "once and copied."
+            << std::endl;
+}
+
 ExecStatus HelpCmd::Execute([[gnu::unused]] Config& conf) {
   if (CmdId::kGet == target_cmd_) {
     GetCmd::PrintUsage();
@@ -330,6 +1117,28 @@ ExecStatus HelpCmd::Execute([[gnu::unused]] Config& conf) {
     LiteralCmd::PrintUsage();
   } else if (CmdId::kTimeout == target_cmd_) {
     TimeoutCmd::PrintUsage();
+  } else if (CmdId::kVerbose == target_cmd_) {
+    VerboseCmd::PrintUsage();
+  } else if (CmdId::kTrace == target_cmd_) {
+    TraceCmd::PrintUsage();
+  } else if (CmdId::kMulticast == target_cmd_) {
+    MulticastCmd::PrintUsage();
+  } else if (CmdId::kWindowSize == target_cmd_) {
+    WindowSizeCmd::PrintUsage();
+  } else if (CmdId::kCongestion == target_cmd_) {
+    CongestionCmd::PrintUsage();
+  } else if (CmdId::kRate == target_cmd_) {
+    RateCmd::PrintUsage();
+  } else if (CmdId::kRollover == target_cmd_) {
+    RolloverCmd::PrintUsage();
+  } else if (CmdId::kDirect == target_cmd_) {
+    DirectCmd::PrintUsage();
+  } else if (CmdId::kFsync == target_cmd_) {
+    FsyncCmd::PrintUsage();
+  } else if (CmdId::kBusyPoll == target_cmd_) {
+    BusyPollCmd::PrintUsage();
+  } else if (CmdId::kSync == target_cmd_) {
+    SyncCmd::PrintUsage();
   } else if (CmdId::kHelp == target_cmd_) {
     HelpCmd::PrintUsage();
   } else {
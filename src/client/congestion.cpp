@@ -0,0 +1,109 @@
+#include "client/congestion.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <expected>
+#include <optional>
+#include <string_view>
+
+#include "client/stats.h"
+#include "common/parse.h"
+
+namespace tftp {
+namespace client {
+
+/* Queued blocks a delay based sender aims to keep at the bottleneck. */
+static constexpr double kDelayAlpha = 1.0;
+static constexpr double kDelayBeta = 3.0;
+
+std::expected<CongestionMode, ParseStatus> ParseCongestionMode(
+    std::string_view val) {
+  if (val == "off" || val == "fixed") {
+    return CongestionMode::kFixed;
+  } else if (val == "aimd") {
+    return CongestionMode::kAimd;
+  } else if (val == "delay") {
+    return CongestionMode::kDelay;
+  } else {
+    return std::unexpected(ParseStatus::kUnknownCongestionMode);
+  }
+}
+
+std::string_view CongestionModeName(CongestionMode mode) {
+  switch (mode) {
+    case CongestionMode::kFixed:
+      return "off";
+    case CongestionMode::kAimd:
+      return "aimd";
+    case CongestionMode::kDelay:
+      return "delay";
+  }
+  return "unknown";
+}
+
+CongestionController::CongestionController(CongestionMode mode,
+                                           uint16_t max_window)
+    : mode_(mode),
+      max_window_(std::max<uint16_t>(max_window, 1)),
+      cwnd_((mode == CongestionMode::kFixed)
+                ? max_window_
+                : std::min(kInitialWindow, max_window_)) {}
+
+void CongestionController::OnAck(uint64_t acked,
+                                 std::optional<Micros> rtt) {
+  if (mode_ == CongestionMode::kFixed) {
+    return;
+  }
+
+  if (mode_ == CongestionMode::kDelay && rtt) {
+    SampleDelay(*rtt);
+  }
+
+  /* Grow by one block for every window's worth of blocks acknowledged. */
+  credit_ += acked;
+  while (credit_ >= cwnd_) {
+    credit_ -= cwnd_;
+    if (mode_ == CongestionMode::kAimd) {
+      cwnd_ = std::min<uint16_t>(cwnd_ + 1, max_window_);
+    } else if (rtt_.count() > 0 && base_rtt_ < Micros::max()) {
+      /* Vegas style: estimate how many blocks sit in queues. */
+      double queued = cwnd_ * static_cast<double>((rtt_ - base_rtt_).count()) /
+                      rtt_.count();
+      if (queued < kDelayAlpha) {
+        cwnd_ = std::min<uint16_t>(cwnd_ + 1, max_window_);
+      } else if (queued > kDelayBeta && cwnd_ > 1) {
+        cwnd_--;
+      }
+    }
+  }
+}
+
+void CongestionController::OnDupAck(uint64_t acked_block,
+                                    uint64_t next_block) {
+  /* Blocks sent before the last cut belong to the same loss event. */
+  if (mode_ == CongestionMode::kFixed || acked_block + 1 < recover_) {
+    return;
+  }
+  Decrease(next_block);
+}
+
+void CongestionController::OnTimeout(uint64_t next_block) {
+  if (mode_ == CongestionMode::kFixed) {
+    return;
+  }
+  Decrease(next_block);
+}
+
+void CongestionController::Decrease(uint64_t next_block) {
+  cwnd_ = std::max<uint16_t>(cwnd_ / 2, 1);
+  credit_ = 0;
+  recover_ = next_block;
+}
+
+void CongestionController::SampleDelay(Micros rtt) {
+  base_rtt_ = std::min(base_rtt_, rtt);
+  rtt_ = (rtt_.count()) ? (7 * rtt_ + rtt) / 8 : rtt;
+}
+
+}  // namespace client
+}  // namespace tftp
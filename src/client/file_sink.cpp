@@ -0,0 +1,544 @@
+#include "client/file_sink.h"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <expected>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "client/transfer.h"
+#include "common/types.h"
+
+namespace tftp {
+namespace client {
+
+static std::string Failed(const std::string& what, const std::string& path) {
+  return "unable to " + what + " '" + path + "': " + std::strerror(errno);
+}
+
+/* Disk space for size bytes without changing the file's size. Filesystems
+   that can't preallocate just skip it. */
+static void Preallocate(int fd, uint64_t size) {
+  if (size) {
+    fallocate(fd, FALLOC_FL_KEEP_SIZE, 0, static_cast<off_t>(size));
+  }
+}
+
+static bool WriteAll(int fd, const uint8_t* data, std::size_t len) {
+  while (len) {
+    ssize_t n = ::write(fd, data, len);
+    if (-1 == n && EINTR == errno) {
+      continue;
+    }
+    if (n <= 0) {
+      return false;
+    }
+    data += n;
+    len -= n;
+  }
+  return true;
+}
+
+static bool PWriteAll(int fd, uint64_t offset, const uint8_t* data,
+                      std::size_t len) {
+  while (len) {
+    ssize_t n = ::pwrite(fd, data, len, static_cast<off_t>(offset));
+    if (-1 == n && EINTR == errno) {
+      continue;
+    }
+    if (n <= 0) {
+      return false;
+    }
+    data += n;
+    len -= n;
+    offset += n;
+  }
+  return true;
+}
+
+std::expected<std::unique_ptr<StreamSink>, TransferErr> StreamSink::Open(
+    const std::string& path) {
+  int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (-1 == fd) {
+    return std::unexpected(Failed("open", path));
+  }
+  return std::unique_ptr<StreamSink>(new StreamSink(path, fd));
+}
+
+StreamSink::~StreamSink() {
+  if (fd_ != -1) {
+    close(fd_);
+  }
+}
+
+std::expected<void, TransferErr> StreamSink::Write(const uint8_t* data,
+                                                   std::size_t len) {
+  if (buffer_.size() + len > kBufferSize) {
+    if (auto flushed = Flush(); !flushed) {
+      return flushed;
+    }
+  }
+  if (len >= kBufferSize) {
+    if (!WriteAll(fd_, data, len)) {
+      return std::unexpected(Failed("write", path_));
+    }
+    return {};
+  }
+  buffer_.insert(buffer_.end(), data, data + len);
+  return {};
+}
+
+/* Flushes first so buffered blocks can't later land over this one. */
+std::expected<void, TransferErr> StreamSink::WriteAt(uint64_t offset,
+                                                     const uint8_t* data,
+                                                     std::size_t len) {
+  if (auto flushed = Flush(); !flushed) {
+    return flushed;
+  }
+  if (!PWriteAll(fd_, offset, data, len)) {
+    return std::unexpected(Failed("write", path_));
+  }
+  return {};
+}
+
+void StreamSink::Reserve(uint64_t size) { Preallocate(fd_, size); }
+
+std::expected<void, TransferErr> StreamSink::Flush() {
+  if (!WriteAll(fd_, buffer_.data(), buffer_.size())) {
+    return std::unexpected(Failed("write", path_));
+  }
+  buffer_.clear();
+  return {};
+}
+
+std::expected<void, TransferErr> StreamSink::Close() {
+  if (-1 == fd_) {
+    return {};
+  }
+  if (auto flushed = Flush(); !flushed) {
+    return flushed;
+  }
+  if (close(std::exchange(fd_, -1)) == -1) {
+    return std::unexpected(Failed("close", path_));
+  }
+  return {};
+}
+
+/* The alignment the filesystem wants for O_DIRECT offsets and buffers, 0
+   if it can't do direct I/O on this file after all. */
+static std::size_t DirectAlignment(int fd) {
+#ifdef STATX_DIOALIGN
+  struct statx stx = {};
+  if (statx(fd, "", AT_EMPTY_PATH, STATX_DIOALIGN, &stx) == 0 &&
+      (stx.stx_mask & STATX_DIOALIGN)) {
+    if (!stx.stx_dio_offset_align) {
+      return 0;
+    }
+    return std::max<std::size_t>(
+        {DirectSink::kDefaultAlignment, stx.stx_dio_offset_align,
+         stx.stx_dio_mem_align});
+  }
+#endif
+  return DirectSink::kDefaultAlignment;
+}
+
+std::expected<std::unique_ptr<DirectSink>, TransferErr> DirectSink::Open(
+    const std::string& path) {
+  constexpr int kFlags = O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC;
+  bool direct = true;
+  int fd = open(path.c_str(), kFlags | O_DIRECT, 0644);
+  if (-1 == fd && EINVAL == errno) { /* tmpfs and friends. */
+    direct = false;
+    fd = open(path.c_str(), kFlags, 0644);
+  }
+  if (-1 == fd) {
+    return std::unexpected(Failed("open", path));
+  }
+
+  std::size_t alignment = kDefaultAlignment;
+  if (direct) {
+    alignment = DirectAlignment(fd);
+    if (!alignment || alignment > kChunkSize) {
+      direct = false;
+      alignment = kDefaultAlignment;
+      fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) & ~O_DIRECT);
+    }
+  }
+
+  auto allocate = [alignment] {
+    return Buffer(
+        static_cast<uint8_t*>(std::aligned_alloc(alignment, kChunkSize)));
+  };
+  Buffer front = allocate();
+  Buffer back = allocate();
+  if (!front || !back) {
+    close(fd);
+    return std::unexpected("unable to allocate I/O buffers");
+  }
+  return std::unique_ptr<DirectSink>(new DirectSink(
+      path, fd, direct, alignment, std::move(front), std::move(back)));
+}
+
+DirectSink::DirectSink(const std::string& path, int fd, bool direct,
+                       std::size_t alignment, Buffer front, Buffer back)
+    : path_(path),
+      fd_(fd),
+      direct_(direct),
+      alignment_(alignment),
+      front_(std::move(front)),
+      back_(std::move(back)) {
+  writer_ = std::jthread([this] { Loop(); });
+}
+
+DirectSink::~DirectSink() {
+  {
+    std::lock_guard lock(mutex_);
+    stop_ = true;
+  }
+  cv_.notify_all();
+  writer_.join();
+  if (fd_ != -1) {
+    close(fd_);
+  }
+}
+
+std::expected<void, TransferErr> DirectSink::Write(const uint8_t* data,
+                                                   std::size_t len) {
+  while (len) {
+    std::size_t n = std::min(len, kChunkSize - fill_);
+    std::memcpy(front_.get() + fill_, data, n);
+    fill_ += n;
+    size_ += n;
+    data += n;
+    len -= n;
+    if (fill_ == kChunkSize) {
+      if (auto submitted = Submit(kChunkSize); !submitted) {
+        return submitted;
+      }
+    }
+  }
+  return {};
+}
+
+void DirectSink::Reserve(uint64_t size) {
+  if (fd_ != -1) {
+    Preallocate(fd_, size);
+  }
+}
+
+std::expected<void, TransferErr> DirectSink::Close() {
+  if (closed_) {
+    return {};
+  }
+  closed_ = true;
+
+  /* O_DIRECT only writes whole aligned blocks, pad the tail out and cut
+     the file back to size afterwards. */
+  if (fill_) {
+    std::size_t padded = (fill_ + alignment_ - 1) / alignment_ * alignment_;
+    std::memset(front_.get() + fill_, 0, padded - fill_);
+    if (auto submitted = Submit(padded); !submitted) {
+      return submitted;
+    }
+  }
+  if (auto drained = Drain(); !drained) {
+    return drained;
+  }
+  if (ftruncate(fd_, size_) == -1) {
+    return std::unexpected(Failed("truncate", path_));
+  }
+  if (close(std::exchange(fd_, -1)) == -1) {
+    return std::unexpected(Failed("close", path_));
+  }
+  return {};
+}
+
+std::expected<void, TransferErr> DirectSink::Submit(std::size_t len) {
+  std::unique_lock lock(mutex_);
+  cv_.wait(lock, [this] { return !pending_; });
+  if (error_) {
+    return std::unexpected(*error_);
+  }
+  /* The writer is done with the back buffer, so it can take the front. */
+  pending_ = Chunk{.data = front_.get(), .len = len, .offset = offset_};
+  std::swap(front_, back_);
+  offset_ += len;
+  fill_ = 0;
+  cv_.notify_all();
+  return {};
+}
+
+std::expected<void, TransferErr> DirectSink::Drain() {
+  std::unique_lock lock(mutex_);
+  cv_.wait(lock, [this] { return !pending_; });
+  if (error_) {
+    return std::unexpected(*error_);
+  }
+  return {};
+}
+
+void DirectSink::Loop() {
+  std::unique_lock lock(mutex_);
+  for (;;) {
+    cv_.wait(lock, [this] { return stop_ || pending_; });
+    if (!pending_) {
+      return;
+    }
+    Chunk chunk = *pending_;
+    lock.unlock();
+
+    std::optional<std::string> error;
+    for (std::size_t done = 0; done < chunk.len;) {
+      ssize_t n = pwrite(fd_, chunk.data + done, chunk.len - done,
+                         chunk.offset + done);
+      if (-1 == n && EINTR == errno) {
+        continue;
+      }
+      if (n <= 0) {
+        error = Failed("write", path_);
+        break;
+      }
+      done += n;
+    }
+    if (!error && !direct_) {
+      /* Nothing bypassed the cache, so push the chunk out and drop it. */
+      sync_file_range(fd_, chunk.offset, chunk.len,
+                      SYNC_FILE_RANGE_WAIT_BEFORE | SYNC_FILE_RANGE_WRITE |
+                          SYNC_FILE_RANGE_WAIT_AFTER);
+      posix_fadvise(fd_, chunk.offset, chunk.len, POSIX_FADV_DONTNEED);
+    }
+
+    lock.lock();
+    if (error && !error_) {
+      error_ = std::move(error);
+    }
+    pending_.reset();
+    cv_.notify_all();
+  }
+}
+
+std::expected<std::unique_ptr<PipeSink>, TransferErr> PipeSink::Open(
+    int fd, const std::string& name, std::size_t capacity) {
+  if (fd < 0 || !capacity) {
+    return std::unexpected("unable to open '" + name + "'");
+  }
+  return std::unique_ptr<PipeSink>(new PipeSink(fd, name, capacity));
+}
+
+PipeSink::PipeSink(int fd, const std::string& name, std::size_t capacity)
+    : fd_(fd), name_(name), ring_(capacity) {
+  writer_ = std::jthread([this] { Loop(); });
+}
+
+PipeSink::~PipeSink() {
+  {
+    std::lock_guard lock(mutex_);
+    closing_ = true;
+  }
+  cv_.notify_all();
+}
+
+std::expected<void, TransferErr> PipeSink::Write(const uint8_t* data,
+                                                 std::size_t len) {
+  std::unique_lock lock(mutex_);
+  while (len) {
+    cv_.wait(lock, [&] { return buffered_ < ring_.size() || error_; });
+    if (error_) {
+      return std::unexpected(*error_);
+    }
+    /* The writer only touches bytes from head_, so the free space past
+       them can be filled while it runs. */
+    std::size_t tail = (head_ + buffered_) % ring_.size();
+    std::size_t n = std::min({len, ring_.size() - buffered_,
+                              ring_.size() - tail});
+    std::memcpy(ring_.data() + tail, data, n);
+    buffered_ += n;
+    data += n;
+    len -= n;
+    cv_.notify_all();
+  }
+  return {};
+}
+
+std::expected<void, TransferErr> PipeSink::Close() {
+  {
+    std::lock_guard lock(mutex_);
+    closing_ = true;
+  }
+  cv_.notify_all();
+  if (writer_.joinable()) {
+    writer_.join();
+  }
+  if (error_) {
+    return std::unexpected(*error_);
+  }
+  return {};
+}
+
+void PipeSink::Loop() {
+  std::unique_lock lock(mutex_);
+  for (;;) {
+    cv_.wait(lock, [this] { return buffered_ || closing_; });
+    if (!buffered_) {
+      return;
+    }
+    std::size_t n = std::min(buffered_, ring_.size() - head_);
+    lock.unlock();
+
+    ssize_t written = ::write(fd_, ring_.data() + head_, n);
+    if (-1 == written && EINTR == errno) {
+      written = 0;
+    }
+    std::optional<std::string> error;
+    if (written < 0) {
+      error = Failed("write", name_);
+    }
+
+    lock.lock();
+    if (error) {
+      error_ = std::move(error);
+      cv_.notify_all();
+      return;
+    }
+    head_ = (head_ + written) % ring_.size();
+    buffered_ -= written;
+    cv_.notify_all();
+  }
+}
+
+std::expected<std::unique_ptr<FileSink>, TransferErr> OpenFileSink(
+    const std::string& path, bool direct) {
+  if (path == kStdStream) {
+    auto sink = PipeSink::Open(STDOUT_FILENO, "stdout");
+    if (!sink) {
+      return std::unexpected(sink.error());
+    }
+    return std::move(*sink);
+  }
+  if (direct) {
+    auto sink = DirectSink::Open(path);
+    if (!sink) {
+      return std::unexpected(sink.error());
+    }
+    return std::move(*sink);
+  }
+  auto sink = StreamSink::Open(path);
+  if (!sink) {
+    return std::unexpected(sink.error());
+  }
+  return std::move(*sink);
+}
+
+std::string TempPath(const std::string& path) {
+  static std::atomic<uint64_t> next = 0;
+  return path + "." + std::to_string(getpid()) + "." +
+         std::to_string(next++) + ".part";
+}
+
+std::expected<std::unique_ptr<AtomicSink>, TransferErr> AtomicSink::Open(
+    const std::string& path, bool direct, FsyncPolicy fsync) {
+  std::string temp = TempPath(path);
+  auto out = OpenFileSink(temp, direct);
+  if (!out) {
+    return std::unexpected(out.error());
+  }
+  return std::unique_ptr<AtomicSink>(
+      new AtomicSink(path, temp, fsync, std::move(*out)));
+}
+
+AtomicSink::~AtomicSink() {
+  if (!published_) {
+    out_.reset();
+    unlink(temp_.c_str());
+  }
+}
+
+std::expected<void, TransferErr> AtomicSink::Write(const uint8_t* data,
+                                                   std::size_t len) {
+  return out_->Write(data, len);
+}
+
+/* Opens path read only for an fsync, a directory included. */
+static bool SyncPath(const std::string& path) {
+  int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (-1 == fd) {
+    return false;
+  }
+  bool synced = (fsync(fd) == 0);
+  close(fd);
+  return synced;
+}
+
+std::expected<void, TransferErr> AtomicSink::Publish() {
+  if (fsync_ != FsyncPolicy::kNever && !SyncPath(temp_)) {
+    return std::unexpected(Failed("sync", temp_));
+  }
+  if (std::rename(temp_.c_str(), path_.c_str()) == -1) {
+    return std::unexpected(Failed("rename", temp_));
+  }
+  published_ = true;
+
+  if (fsync_ == FsyncPolicy::kDirectory) {
+    std::string dir = std::filesystem::path(path_).parent_path().string();
+    if (!SyncPath((dir.empty()) ? "." : dir)) {
+      return std::unexpected(Failed("sync", dir));
+    }
+  }
+  return {};
+}
+
+std::expected<void, TransferErr> PublishCopy(const std::string& from,
+                                             const std::string& to,
+                                             FsyncPolicy fsync) {
+  int fd = ::open(from.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd == -1) {
+    return std::unexpected(Failed("open", from));
+  }
+  auto out = AtomicSink::Open(to, false, fsync);
+  if (!out) {
+    ::close(fd);
+    return std::unexpected(out.error());
+  }
+
+  std::vector<uint8_t> buffer(StreamSink::kBufferSize);
+  std::expected<void, TransferErr> result = {};
+  for (;;) {
+    ssize_t len = ::read(fd, buffer.data(), buffer.size());
+    if (len == -1 && errno == EINTR) {
+      continue;
+    }
+    if (len == -1) {
+      result = std::unexpected(Failed("read", from));
+    } else if (len > 0) {
+      result = (*out)->Write(buffer.data(), len);
+    }
+    if (len <= 0 || !result) {
+      break;
+    }
+  }
+  ::close(fd);
+
+  if (result) {
+    result = (*out)->Close();
+  }
+  return (result) ? (*out)->Publish() : result;
+}
+
+}  // namespace client
+}  // namespace tftp
@@ -0,0 +1,377 @@
+#include "client/metrics.h"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <expected>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include "client/stats.h"
+#include "common/histogram.h"
+#include "common/parse.h"
+
+namespace tftp {
+namespace client {
+
+static constexpr std::string_view kFdPrefix = "fd:";
+
+static double ToSeconds(std::chrono::nanoseconds nsecs) {
+  return std::chrono::duration_cast<std::chrono::duration<double>>(nsecs)
+      .count();
+}
+
+static double ToMillis(std::chrono::nanoseconds nsecs) {
+  return std::chrono::duration_cast<std::chrono::duration<double, std::milli>>(
+             nsecs)
+      .count();
+}
+
+struct Latency {
+  const char* name;
+  const char* help;
+  Histogram TransferStats::*hist;
+};
+
+static const Latency kLatencies[] = {
+    {"rtt", "Round trip time of a block and its ACK.", &TransferStats::rtts},
+    {"sendto", "Time spent sending a packet.", &TransferStats::send_time},
+    {"recvfrom", "Time spent receiving a packet, waiting for it included.",
+     &TransferStats::recv_time},
+    {"disk_write", "Time spent writing a block to the local file.",
+     &TransferStats::write_time},
+    {"transfer", "Duration of a transfer.", &TransferStats::transfer_time},
+};
+
+struct Gauge {
+  const char* name;
+  const char* help;
+  double (*value)(const TransferRecord&);
+};
+
+static const Gauge kGauges[] = {
+    {"tftpc_transfer_bytes", "Bytes moved by the last transfer of a series.",
+     [](const TransferRecord& r) { return double(r.stats.bytes); }},
+    {"tftpc_transfer_duration_seconds",
+     "Duration of the last transfer of a series.",
+     [](const TransferRecord& r) { return ToSeconds(r.stats.elapsed); }},
+    {"tftpc_transfer_throughput_bytes_per_second",
+     "Throughput of the last transfer of a series.",
+     [](const TransferRecord& r) { return r.stats.Throughput(); }},
+    {"tftpc_transfer_retransmits",
+     "Packets retransmitted by the last transfer of a series.",
+     [](const TransferRecord& r) { return double(r.stats.retransmits); }},
+    {"tftpc_transfer_cwnd_blocks",
+     "Congestion window at the end of the last transfer of a series.",
+     [](const TransferRecord& r) { return double(r.stats.cwnd); }},
+    {"tftpc_transfer_error_code",
+     "TFTP error code of the last transfer of a series, -1 on success.",
+     [](const TransferRecord& r) {
+       return (r.err) ? double(r.err->code) : -1.0;
+     }},
+};
+
+static std::string EscapeJson(std::string_view str) {
+  std::string escaped;
+  for (char c : str) {
+    if (c == '"' || c == '\\') {
+      escaped += '\\';
+      escaped += c;
+    } else if (static_cast<unsigned char>(c) < 0x20) {
+      char hex[8] = {};
+      std::snprintf(hex, sizeof(hex), "\\u%04x", c);
+      escaped += hex;
+    } else {
+      escaped += c;
+    }
+  }
+  return escaped;
+}
+
+static std::string EscapeLabel(std::string_view str) {
+  std::string escaped;
+  for (char c : str) {
+    if (c == '"' || c == '\\') {
+      escaped += '\\';
+      escaped += c;
+    } else if (c == '\n') {
+      escaped += "\\n";
+    } else {
+      escaped += c;
+    }
+  }
+  return escaped;
+}
+
+std::expected<MetricsFormat, ParseStatus> ParseMetricsFormat(
+    std::string_view val) {
+  if (val == "json") {
+    return MetricsFormat::kJsonLines;
+  } else if (val == "prometheus" || val == "prom") {
+    return MetricsFormat::kPrometheus;
+  } else {
+    return std::unexpected(ParseStatus::kUnknownMetricsFormat);
+  }
+}
+
+std::expected<std::size_t, ParseStatus> ParseFileSeries(std::string_view val) {
+  bool is_num =
+      !val.empty() && std::all_of(val.cbegin(), val.cend(), [](char c) {
+        return std::isdigit(static_cast<unsigned char>(c));
+      });
+  if (!is_num || val.size() > 5) {
+    return std::unexpected(ParseStatus::kFileSeriesOutOfRange);
+  }
+
+  std::size_t series = std::stoul(std::string(val));
+  if (series < 1 || series > kMaxFileSeries) {
+    return std::unexpected(ParseStatus::kFileSeriesOutOfRange);
+  }
+  return series;
+}
+
+std::string FormatJson(const TransferRecord& record) {
+  auto now = std::chrono::system_clock::now().time_since_epoch();
+  const TransferStats& stats = record.stats;
+
+  std::ostringstream os;
+  os << "{\"timestamp\":"
+     << std::chrono::duration_cast<std::chrono::seconds>(now).count()
+     << ",\"direction\":\"" << EscapeJson(record.direction) << "\""
+     << ",\"host\":\"" << EscapeJson(record.host) << "\""
+     << ",\"file\":\"" << EscapeJson(record.file) << "\""
+     << ",\"bytes\":" << stats.bytes << ",\"blocks\":" << stats.blocks
+     << ",\"duration_sec\":" << ToSeconds(stats.elapsed)
+     << ",\"throughput_bytes_per_sec\":"
+     << static_cast<uint64_t>(stats.Throughput())
+     << ",\"retransmits\":" << stats.retransmits
+     << ",\"fast_retransmits\":" << stats.fast_retransmits
+     << ",\"duplicates\":" << stats.duplicates
+     << ",\"timeouts\":" << stats.timeouts << ",\"window\":" << stats.window
+     << ",\"cwnd\":" << stats.cwnd
+     << ",\"recv_buffer\":" << stats.buffers.recv
+     << ",\"send_buffer\":" << stats.buffers.send
+     << ",\"buffer_wanted\":" << stats.buffers.wanted;
+  for (const Latency& latency : kLatencies) {
+    const Histogram& hist = stats.*latency.hist;
+    os << ",\"" << latency.name << "_ms\":{\"count\":" << hist.Count()
+       << ",\"p50\":" << ToMillis(hist.Percentile(50))
+       << ",\"p99\":" << ToMillis(hist.Percentile(99))
+       << ",\"p999\":" << ToMillis(hist.Percentile(99.9))
+       << ",\"max\":" << ToMillis(hist.Max()) << "}";
+  }
+  if (record.err) {
+    os << ",\"status\":\"error\",\"error_code\":" << record.err->code
+       << ",\"error\":\"" << EscapeJson(record.err->msg) << "\"";
+  } else {
+    os << ",\"status\":\"ok\",\"error_code\":null";
+  }
+  os << "}\n";
+  return os.str();
+}
+
+std::expected<std::unique_ptr<MetricsSink>, MetricsErr> MetricsSink::Create(
+    std::string_view target, MetricsFormat format, std::size_t file_series) {
+  int fd = -1;
+  bool owns_fd = false;
+  if (target == "-") {
+    fd = STDOUT_FILENO;
+  } else if (target.starts_with(kFdPrefix)) {
+    std::string fd_str(target.substr(kFdPrefix.size()));
+    char* end = nullptr;
+    long parsed = std::strtol(fd_str.c_str(), &end, 10);
+    if (fd_str.empty() || *end || parsed < 0 || fcntl(parsed, F_GETFD) == -1) {
+      return std::unexpected("invalid metrics file descriptor '" + fd_str +
+                             "'");
+    }
+    fd = static_cast<int>(parsed);
+  } else if (format == MetricsFormat::kPrometheus) {
+    /* Publish the empty set now so a bad path fails before any transfer. */
+    std::unique_ptr<MetricsSink> sink(new MetricsSink(std::string(target)));
+    sink->file_series_ = file_series;
+    if (auto published = sink->Publish(sink->FormatPrometheus());
+        !published) {
+      return std::unexpected(published.error());
+    }
+    return sink;
+  } else {
+    fd = open(std::string(target).c_str(),
+              O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (-1 == fd) {
+      return std::unexpected(std::strerror(errno));
+    }
+    owns_fd = true;
+  }
+
+  /* Prometheus text on a file descriptor is rewritten in place when it can
+     seek. A pipe can't take back what it was sent, so it gets the text once
+     when the sink closes. */
+  bool seekable = (lseek(fd, 0, SEEK_CUR) != -1);
+
+  std::unique_ptr<MetricsSink> sink(
+      new MetricsSink(fd, owns_fd, seekable, format));
+  sink->file_series_ = file_series;
+  return sink;
+}
+
+MetricsSink::~MetricsSink() {
+  if (format_ == MetricsFormat::kPrometheus && path_.empty() && !seekable_) {
+    Emit(FormatPrometheus());
+  }
+  if (owns_fd_ && -1 != fd_) {
+    close(fd_);
+  }
+  fd_ = -1;
+}
+
+void MetricsSink::Write(const TransferRecord& record) {
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  if (format_ == MetricsFormat::kJsonLines) {
+    Emit(FormatJson(record));
+    return;
+  }
+
+  SeriesKey key = {record.direction, record.host,
+                   (file_series_) ? record.file : std::string()};
+  if (file_series_ && !latest_.contains(key) &&
+      latest_.size() >= file_series_) {
+    latest_.erase(std::min_element(
+        latest_.begin(), latest_.end(), [](const auto& a, const auto& b) {
+          return a.second.written < b.second.written;
+        }));
+  }
+
+  /* Render the key's samples once, not on every later write. */
+  Series& series = latest_[key];
+  series.written = writes_++;
+  std::string labels = "{direction=\"" + EscapeLabel(record.direction) +
+                       "\",host=\"" + EscapeLabel(record.host) + "\"";
+  if (file_series_) {
+    labels += ",file=\"" + EscapeLabel(record.file) + "\"";
+  }
+  labels += "} ";
+  for (std::size_t i = 0; i < kNumGauges; ++i) {
+    std::ostringstream os;
+    os << kGauges[i].name << labels << kGauges[i].value(record) << "\n";
+    series.samples[i] = os.str();
+  }
+  totals_.Merge(record.stats, !record.err);
+
+  if (!path_.empty()) {
+    Publish(FormatPrometheus()); /* Best effort like Emit. */
+  } else if (seekable_) {
+    if (ftruncate(fd_, 0) == -1 || lseek(fd_, 0, SEEK_SET) == -1) {
+      return;
+    }
+    Emit(FormatPrometheus());
+  }
+}
+
+std::string MetricsSink::FormatPrometheus() const {
+  static_assert(std::size(kGauges) == kNumGauges);
+
+  std::ostringstream os;
+  for (std::size_t i = 0; i < kNumGauges; ++i) {
+    os << "# HELP " << kGauges[i].name << " " << kGauges[i].help << "\n";
+    os << "# TYPE " << kGauges[i].name << " gauge\n";
+    for (const auto& [key, series] : latest_) {
+      os << series.samples[i];
+    }
+  }
+
+  os << "# HELP tftpc_transfers_total Transfers attempted.\n"
+     << "# TYPE tftpc_transfers_total counter\n"
+     << "tftpc_transfers_total " << totals_.transfers << "\n"
+     << "# HELP tftpc_transfer_failures_total Transfers that failed.\n"
+     << "# TYPE tftpc_transfer_failures_total counter\n"
+     << "tftpc_transfer_failures_total " << totals_.failures << "\n"
+     << "# HELP tftpc_bytes_total Bytes moved by all transfers.\n"
+     << "# TYPE tftpc_bytes_total counter\n"
+     << "tftpc_bytes_total " << totals_.totals.bytes << "\n"
+     << "# HELP tftpc_retransmits_total Packets retransmitted.\n"
+     << "# TYPE tftpc_retransmits_total counter\n"
+     << "tftpc_retransmits_total " << totals_.totals.retransmits << "\n";
+
+  static constexpr std::pair<double, std::string_view> kQuantiles[] = {
+      {50, "0.5"}, {99, "0.99"}, {99.9, "0.999"}, {100, "1"}};
+  for (const Latency& latency : kLatencies) {
+    const Histogram& hist = totals_.totals.*latency.hist;
+    std::string metric = "tftpc_" + std::string(latency.name) + "_seconds";
+    os << "# HELP " << metric << " " << latency.help << "\n"
+       << "# TYPE " << metric << " summary\n";
+    for (const auto& [percent, quantile] : kQuantiles) {
+      os << metric << "{quantile=\"" << quantile << "\"} "
+         << ToSeconds(hist.Percentile(percent)) << "\n";
+    }
+    os << metric << "_sum " << ToSeconds(hist.Sum()) << "\n"
+       << metric << "_count " << hist.Count() << "\n";
+  }
+  return os.str();
+}
+
+/* Writes the text beside the textfile and renames it over, so a collector
+   never reads a truncated or half written file. */
+std::expected<void, MetricsErr> MetricsSink::Publish(const std::string& text) {
+  std::string tmp = path_ + ".XXXXXX";
+  int fd = mkostemp(tmp.data(), O_CLOEXEC);
+  if (-1 == fd) {
+    return std::unexpected(std::strerror(errno));
+  }
+
+  int err = 0;
+  if (fchmod(fd, 0644) == -1) {
+    err = errno;
+  }
+  for (std::size_t offset = 0; !err && offset < text.size();) {
+    ssize_t written = write(fd, text.data() + offset, text.size() - offset);
+    if (-1 == written && EINTR != errno) {
+      err = errno;
+    } else if (-1 != written) {
+      offset += written;
+    }
+  }
+  if (close(fd) == -1 && !err) {
+    err = errno;
+  }
+  if (!err && std::rename(tmp.c_str(), path_.c_str()) == -1) {
+    err = errno;
+  }
+  if (err) {
+    unlink(tmp.c_str());
+    return std::unexpected(std::strerror(err));
+  }
+  return {};
+}
+
+void MetricsSink::Emit(const std::string& text) {
+  std::size_t offset = 0;
+  while (offset < text.size()) {
+    ssize_t written = write(fd_, text.data() + offset, text.size() - offset);
+    if (-1 == written) {
+      if (EINTR == errno) {
+        continue;
+      }
+      return; /* Metrics are best effort, never fail a transfer on them. */
+    }
+    offset += written;
+  }
+}
+
+}  // namespace client
+}  // namespace tftp
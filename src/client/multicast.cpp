@@ -0,0 +1,316 @@
+#include "client/multicast.h"
+
+#include <poll.h>
+
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <expected>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include "client/block_bitmap.h"
+#include "client/config.h"
+#include "client/file_sink.h"
+#include "client/session.h"
+#include "client/stats.h"
+#include "client/transfer.h"
+#include "common/block_seq.h"
+#include "common/codec.h"
+#include "common/pack.h"
+#include "common/parse.h"
+#include "common/types.h"
+#include "common/udp_socket.h"
+
+namespace tftp {
+namespace client {
+
+std::optional<MulticastOption> ParseMulticastOption(std::string_view value) {
+  std::size_t first = value.find(',');
+  std::size_t second = value.find(',', first + 1);
+  if (first == std::string_view::npos || second == std::string_view::npos) {
+    return std::nullopt;
+  }
+
+  /* Later OACKs may leave the group and port empty (RFC 2090). */
+  MulticastOption option = {.group = std::string(value.substr(0, first))};
+  std::string_view port = value.substr(first + 1, second - first - 1);
+  if (!port.empty()) {
+    auto parsed_port = ParsePort(port);
+    if (!parsed_port) {
+      return std::nullopt;
+    }
+    option.port = *parsed_port;
+  }
+
+  std::string_view master = value.substr(second + 1);
+  if (master != "0" && master != "1") {
+    return std::nullopt;
+  }
+  option.master = (master == "1");
+
+  return option;
+}
+
+/* Receive state of one client in a multicast group. Its session is polled
+   alongside the group rather than run on a loop, so each of its sends and
+   receives is waited out in place. */
+class McastReceiver {
+ public:
+  McastReceiver(Session& session, FileSink& out)
+      : session_(session), out_(out) {}
+
+  std::expected<void, TransferErr> OnOptionAck(
+      const codec::OptionAckView& oack);
+  std::expected<void, TransferErr> OnData(const codec::DataView& data);
+  std::expected<void, TransferErr> OnTimeout();
+
+  bool Done() const { return last_block_ && received_.Complete(*last_block_); }
+  bool Joined() const { return group_.has_value(); }
+  UdpSocketMcastRecver& Group() { return *group_; }
+
+ private:
+  std::expected<void, TransferErr> RequestGap();
+
+  Session& session_;
+  FileSink& out_;
+  std::optional<UdpSocketMcastRecver> group_;
+  BlockBitmap received_;
+  std::optional<uint64_t> last_block_;
+  BlockSeq seq_;
+  bool master_ = false;
+  bool negotiated_ = false;
+};
+
+std::expected<void, TransferErr> McastReceiver::OnOptionAck(
+    const codec::OptionAckView& oack) {
+  negotiated_ = true;
+
+  Options options = oack.options.ToOptions();
+  if (auto tsize = NegotiatedTsize(oack)) {
+    last_block_ = *tsize / kDefaultBlockSize + 1;
+    out_.Reserve(*tsize);
+  }
+
+  auto rollover = NegotiatedRollover(oack, session_.Conf());
+  if (!rollover) {
+    return std::unexpected(rollover.error());
+  }
+  seq_ = *rollover;
+
+  auto mcast = options.find(OptionName::kMulticast);
+  if (mcast == options.cend()) {
+    /* The server ignored the option, fall back to a lock-step transfer. */
+    master_ = true;
+    return RequestGap();
+  }
+
+  auto option = ParseMulticastOption(mcast->second);
+  if (!option) {
+    return std::unexpected(TransferErr("malformed multicast option '" +
+                                           mcast->second + "'",
+                                       ErrorCode::kOptionNegotiation));
+  }
+  if (!group_ && !option->group.empty()) {
+    /* Join on the interface that faces the server. */
+    auto iface = session_.LocalAddr();
+    if (!iface) {
+      return std::unexpected(iface.error());
+    }
+    auto group =
+        UdpSocketMcastRecver::Create(option->group, option->port, *iface);
+    if (!group) {
+      return std::unexpected(group.error());
+    }
+    group_ = std::move(*group);
+  }
+
+  master_ = option->master;
+  return (master_) ? RequestGap() : std::expected<void, TransferErr>{};
+}
+
+std::expected<void, TransferErr> McastReceiver::OnData(
+    const codec::DataView& data) {
+  /* A server without option support answers the RRQ with data directly. */
+  if (!negotiated_) {
+    negotiated_ = true;
+    master_ = true;
+  }
+
+  /* Blocks arrive out of order but never far from the first gap. */
+  auto index = seq_.Nearest(data.block_num, received_.FirstMissing());
+  if (!index || !*index) {
+    return {};
+  }
+  uint64_t block = *index;
+  if (!received_.Set(block)) {
+    session_.Stats().duplicates++;
+  } else {
+    if (master_ && block == received_.FirstMissing() - 1) {
+      session_.SampleRtt();
+    }
+    Clock::time_point write_start = Clock::now();
+    auto written = out_.WriteAt((block - 1) * kDefaultBlockSize,
+                                data.data.data(), data.data.size());
+    session_.Stats().write_time.Record(Clock::now() - write_start);
+    if (!written) {
+      return written;
+    }
+    session_.Stats().bytes += data.data.size();
+    session_.Stats().blocks++;
+  }
+
+  if (data.data.size() < kDefaultBlockSize) {
+    last_block_ = block;
+  }
+
+  /* The last ACK tells the server this client is done, master or not. */
+  if (Done()) {
+    return session_.Wait(
+        session_.Send(PackAck({.block_num = seq_.Wire(*last_block_)})));
+  }
+  return (master_) ? RequestGap() : std::expected<void, TransferErr>{};
+}
+
+std::expected<void, TransferErr> McastReceiver::OnTimeout() {
+  /* Until negotiation completes the RRQ itself may have been lost. */
+  if (!negotiated_ || master_) {
+    return session_.Wait(session_.Resend());
+  }
+  return {};
+}
+
+std::expected<void, TransferErr> McastReceiver::RequestGap() {
+  /* ACKing the block before the first gap asks the server to fill it. */
+  return session_.Wait(session_.Send(
+      PackAck({.block_num = seq_.Wire(received_.FirstMissing() - 1)})));
+}
+
+static std::expected<void, TransferErr> GetMulticast(
+    const Config& conf, std::string_view host, uint16_t port,
+    std::string_view remote_file, std::string_view local_file,
+    TransferStats& stats) {
+  if (conf.mode != SendMode::kOctet) {
+    return std::unexpected("multicast transfers require binary mode");
+  }
+
+  /* Blocks land out of order, so no O_DIRECT. The file only replaces the
+     local one once every block is in. */
+  auto out = AtomicSink::Open(std::string(local_file), false, conf.fsync);
+  if (!out) {
+    return std::unexpected(out.error());
+  }
+
+  auto session = Session::Open(conf, host, port, stats);
+  if (!session) {
+    return std::unexpected(session.error());
+  }
+
+  ReadRequestMsg rrq = {
+      .filename = std::string(remote_file),
+      .mode = conf.mode,
+      .options = {{OptionName::kMulticast, ""}, {OptionName::kTsize, "0"}}};
+  if (conf.rollover) {
+    rrq.options[OptionName::kRollover] =
+        std::to_string(static_cast<int>(*conf.rollover));
+  }
+  auto sent = session->Wait(session->Send(PackReadRequest(rrq)));
+  if (!sent) {
+    return std::unexpected(sent.error());
+  }
+
+  McastReceiver receiver(*session, **out);
+  std::vector<uint8_t> buffer(kMaxPacketSize);
+  while (!receiver.Done()) {
+    if (session->Expired()) {
+      return std::unexpected(Unresponsive("transfer timed out"));
+    }
+
+    /* Blocks arrive on the group, OACKs and repairs on our unicast port. */
+    pollfd fds[2] = {{.fd = session->Fd(), .events = POLLIN, .revents = 0},
+                     {.fd = (receiver.Joined()) ? receiver.Group().Fd() : -1,
+                      .events = POLLIN,
+                      .revents = 0}};
+    int ready = poll(fds, 2, session->RexmtMs());
+    if (-1 == ready) {
+      if (EINTR == errno) {
+        continue;
+      }
+      return std::unexpected(std::strerror(errno));
+    }
+
+    std::expected<void, TransferErr> handled = {};
+    if (!ready) {
+      stats.timeouts++;
+      handled = receiver.OnTimeout();
+    }
+
+    if (fds[0].revents & POLLIN) {
+      auto packet = session->Wait(session->Recv());
+      if (!packet) {
+        return std::unexpected(packet.error());
+      }
+      auto msg = codec::Decode(*packet);
+      if (!msg) {
+        /* Not a TFTP message, ignore it. */
+      } else if (auto* err = std::get_if<codec::ErrorView>(&*msg)) {
+        return std::unexpected(ServerError(*err));
+      } else if (auto* oack = std::get_if<codec::OptionAckView>(&*msg)) {
+        handled = receiver.OnOptionAck(*oack);
+      } else if (auto* data = std::get_if<codec::DataView>(&*msg)) {
+        handled = receiver.OnData(*data);
+      }
+    }
+
+    if (handled && (fds[1].revents & POLLIN)) {
+      auto num_bytes = receiver.Group().Recv(buffer.data(), buffer.size());
+      if (!num_bytes) {
+        return std::unexpected(num_bytes.error());
+      }
+      codec::Bytes packet(buffer.data(), *num_bytes);
+      if (conf.trace) {
+        *conf.console << "received " << codec::Describe(packet) << " via "
+                      << receiver.Group().Group() << std::endl;
+      }
+      const SockAddr& sender = receiver.Group().LastSender();
+      session->Record(TraceEvent::kRecv, sender, packet);
+      /* Only the server that sent the OACK may feed the group's blocks,
+         any other host on the group is ignored. */
+      auto data = codec::DecodeAs<codec::DataView>(packet);
+      if (data && SameAddr(sender, session->Peer())) {
+        handled = receiver.OnData(*data);
+      }
+    }
+
+    if (!handled) {
+      return std::unexpected(handled.error());
+    }
+  }
+
+  if (auto closed = (*out)->Close(); !closed) {
+    return closed;
+  }
+  return (*out)->Publish();
+}
+
+std::expected<void, TransferErr> GetFileMulticast(const Config& conf,
+                                                  std::string_view host,
+                                                  uint16_t port,
+                                                  std::string_view remote_file,
+                                                  std::string_view local_file,
+                                                  TransferStats& stats) {
+  Clock::time_point start = Clock::now();
+  auto result = GetMulticast(conf, host, port, remote_file, local_file, stats);
+  stats.Finish(std::chrono::duration_cast<Micros>(Clock::now() - start));
+  return result;
+}
+
+}  // namespace client
+}  // namespace tftp
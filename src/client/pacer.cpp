@@ -0,0 +1,39 @@
+#include "client/pacer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+
+#include "client/stats.h"
+
+namespace tftp {
+namespace client {
+
+TokenBucket::TokenBucket(uint64_t rate, uint64_t burst)
+    : rate_(std::max<uint64_t>(rate, 1)),
+      burst_((burst) ? burst : std::max(rate_ / 1000, kMinBurst)),
+      tokens_(burst_) {}
+
+Micros TokenBucket::Take(std::size_t bytes, Clock::time_point now) {
+  std::lock_guard lock(mutex_);
+  if (!last_) {
+    last_ = now;
+  } else if (now > *last_) {
+    std::chrono::duration<double> elapsed = now - *last_;
+    tokens_ = std::min<double>(tokens_ + elapsed.count() * rate_, burst_);
+    last_ = now;
+  }
+
+  tokens_ -= bytes;
+  if (tokens_ >= 0) {
+    return Micros::zero();
+  }
+  return std::chrono::duration_cast<Micros>(
+      std::chrono::duration<double>(-tokens_ / rate_));
+}
+
+}  // namespace client
+}  // namespace tftp
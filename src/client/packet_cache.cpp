@@ -0,0 +1,152 @@
+#include "client/packet_cache.h"
+
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <istream>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "client/transfer.h"
+#include "common/block_seq.h"
+#include "common/codec.h"
+#include "common/netascii.h"
+#include "common/types.h"
+
+namespace tftp {
+namespace client {
+
+static constexpr std::size_t kFileChunkSize = 4096;
+
+BlockData BlockReader::Next(std::size_t block_size) {
+  std::array<uint8_t, kFileChunkSize> chunk = {};
+  while (pending_.size() < block_size && in_) {
+    in_.read(reinterpret_cast<char*>(chunk.data()), chunk.size());
+    std::size_t len = in_.gcount();
+    if (netascii_) {
+      NetasciiEncode(chunk.data(), len, pending_);
+    } else {
+      pending_.insert(pending_.end(), chunk.cbegin(), chunk.cbegin() + len);
+    }
+  }
+
+  std::size_t len = std::min(block_size, pending_.size());
+  BlockData block(pending_.cbegin(), pending_.cbegin() + len);
+  pending_.erase(pending_.begin(), pending_.begin() + len);
+  return block;
+}
+
+std::shared_ptr<const PacketArena> PacketArena::Build(std::istream& in,
+                                                      bool netascii,
+                                                      BlockSeq seq,
+                                                      std::size_t limit) {
+  std::shared_ptr<PacketArena> arena(new PacketArena(seq));
+  BlockReader reader(in, netascii);
+  for (uint64_t block = 1;; ++block) {
+    BlockData data = reader.Next(kDefaultBlockSize);
+    TftpPacket packet = codec::Encode(
+        codec::DataView{.block_num = seq.Wire(block), .data = data});
+    if (arena->packets_.size() + packet.size() > limit) {
+      return nullptr;
+    }
+    arena->packets_.insert(arena->packets_.end(), packet.cbegin(),
+                           packet.cend());
+    arena->offsets_.push_back(arena->packets_.size());
+    if (data.size() < kDefaultBlockSize) {
+      break;
+    }
+  }
+  if (in.bad()) {
+    return nullptr;
+  }
+  arena->packets_.shrink_to_fit();
+  return arena;
+}
+
+codec::Bytes PacketArena::Packet(uint64_t block) const {
+  std::size_t begin = offsets_[block - 1];
+  return codec::Bytes(packets_.data() + begin, offsets_[block] - begin);
+}
+
+std::optional<PacketCache::FileId> PacketCache::Stat(const std::string& path) {
+  struct stat st = {};
+  if (::stat(path.c_str(), &st) == -1 || !S_ISREG(st.st_mode)) {
+    return std::nullopt;
+  }
+  return std::make_tuple(static_cast<uint64_t>(st.st_dev),
+                         static_cast<uint64_t>(st.st_ino),
+                         static_cast<int64_t>(st.st_size),
+                         static_cast<int64_t>(st.st_mtim.tv_sec),
+                         static_cast<int64_t>(st.st_mtim.tv_nsec));
+}
+
+std::shared_ptr<const PacketArena> PacketCache::Get(const std::string& path,
+                                                    const Mode& mode,
+                                                    BlockSeq seq) {
+  auto id = Stat(path);
+  if (!id) {
+    return nullptr;
+  }
+  std::string key = path + '\0' + mode + '\0' +
+                    static_cast<char>(seq.Mode());
+  {
+    std::lock_guard lock(mutex_);
+    auto it = entries_.find(key);
+    if (it != entries_.end() && it->second.id == *id) {
+      hits_++;
+      it->second.used = ++clock_;
+      return it->second.arena;
+    }
+  }
+
+  /* Built unlocked, concurrent puts of other files need not wait. */
+  std::ifstream in(path, std::ios::binary);
+  if (!in) {
+    return nullptr;
+  }
+  auto arena = PacketArena::Build(in, mode == SendMode::kNetAscii, seq,
+                                  capacity_ / 4);
+  if (!arena || Stat(path) != id) {
+    return nullptr; /* Too big, or changed while it was read. */
+  }
+
+  std::lock_guard lock(mutex_);
+  Entry& entry = entries_[key];
+  if (entry.arena) {
+    size_ -= entry.arena->Size();
+  }
+  entry = {.id = *id, .arena = arena, .used = ++clock_};
+  size_ += arena->Size();
+  Evict();
+  return arena;
+}
+
+void PacketCache::Evict() {
+  while (size_ > capacity_) {
+    auto oldest = std::ranges::min_element(
+        entries_, {}, [](const auto& entry) { return entry.second.used; });
+    size_ -= oldest->second.arena->Size();
+    entries_.erase(oldest);
+  }
+}
+
+std::size_t PacketCache::Size() const {
+  std::lock_guard lock(mutex_);
+  return size_;
+}
+
+uint64_t PacketCache::Hits() const {
+  std::lock_guard lock(mutex_);
+  return hits_;
+}
+
+}  // namespace client
+}  // namespace tftp
@@ -0,0 +1,307 @@
+#include "client/replay.h"
+
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <memory>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "client/config.h"
+#include "client/file_sink.h"
+#include "client/session.h"
+#include "client/stats.h"
+#include "client/transfer.h"
+#include "client/transport.h"
+#include "common/codec.h"
+#include "common/event_loop.h"
+#include "common/pack.h"
+#include "common/tracer.h"
+#include "common/types.h"
+#include "common/udp_socket.h"
+
+namespace tftp {
+namespace client {
+
+static SockAddr Loopback(uint16_t port) {
+  SockAddr addr;
+  auto* in = reinterpret_cast<sockaddr_in*>(&addr.storage);
+  in->sin_family = AF_INET;
+  in->sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  addr.len = sizeof(sockaddr_in);
+  addr.SetPort(port);
+  return addr;
+}
+
+/* Reads the header fields in place, like the tracer does. */
+static ReplaySend Summarize(codec::Bytes packet) {
+  ReplaySend send;
+  if (packet.size() >= 2) {
+    send.opcode = packet[1];
+  }
+  if (packet.size() >= 4 &&
+      (send.opcode == OpCode::kData || send.opcode == OpCode::kAck)) {
+    send.block = static_cast<uint16_t>((packet[2] << 8) | packet[3]);
+  }
+  return send;
+}
+
+static std::string Describe(const ReplaySend& send) {
+  static constexpr std::array<std::string_view, 7> kNames = {
+      "?", "RRQ", "WRQ", "DATA", "ACK", "ERROR", "OACK"};
+  std::string name(
+      (send.opcode < kNames.size()) ? kNames[send.opcode] : kNames[0]);
+  if (send.opcode == OpCode::kData || send.opcode == OpCode::kAck) {
+    name += " " + std::to_string(send.block);
+  }
+  return name;
+}
+
+/* Keeps a download in memory. */
+class MemorySink : public FileSink {
+ public:
+  explicit MemorySink(std::vector<uint8_t>& out) : out_(out) {}
+
+  std::expected<void, TransferErr> Write(const uint8_t* data,
+                                         std::size_t len) override {
+    out_.insert(out_.end(), data, data + len);
+    return {};
+  }
+  std::expected<void, TransferErr> Close() override { return {}; }
+
+ private:
+  std::vector<uint8_t>& out_;
+};
+
+/* Hands the engine a scenario's events in place of a socket, and times
+   the engine between them. */
+class ReplayTransport : public Transport {
+ public:
+  ReplayTransport(const ReplayScenario& scenario, ReplayResult& result)
+      : scenario_(scenario),
+        result_(result),
+        start_(Clock::now()),
+        now_(start_),
+        resumed_(start_),
+        sender_(Loopback(0)) {}
+
+  bool OnLoop() const override { return false; }
+  Clock::time_point Now() const override { return now_; }
+  Task<> Sleep(Micros duration) override {
+    now_ += duration;
+    co_return;
+  }
+
+  Task<std::expected<void, TransferErr>> SendPacket(
+      codec::Bytes packet) override {
+    co_return Send(packet);
+  }
+  /* Counts as a send, strays are part of the scenario. */
+  std::expected<void, TransferErr> SendTo(codec::Bytes packet,
+                                          const SockAddr&) override {
+    return Send(packet);
+  }
+  /* Times out on the virtual clock. */
+  Task<std::expected<TftpPacket, TransferErr>> RecvPacket(
+      Micros timeout) override {
+    co_return Recv(timeout);
+  }
+  const SockAddr& LastSender() const override { return sender_; }
+  std::expected<void, TransferErr> SetPeer(const SockAddr&) override {
+    return {};
+  }
+
+  uint16_t LocalPort() const override { return 0; }
+  int Fd() const override { return -1; }
+  std::expected<std::string, UdpSocketErr> LocalAddr() const override {
+    return "127.0.0.1";
+  }
+
+  /* Ends the timing once the engine returns. */
+  void Finish();
+
+ private:
+  std::expected<void, TransferErr> Send(codec::Bytes packet);
+  std::expected<TftpPacket, TransferErr> Recv(Micros timeout);
+  void Pause();
+
+  const ReplayScenario& scenario_;
+  ReplayResult& result_;
+  std::size_t next_ = 0;
+  Clock::time_point start_;
+  Clock::time_point now_;     /* Virtual. */
+  Clock::time_point resumed_; /* Real, when the engine last got control. */
+  SockAddr sender_;
+};
+
+std::expected<void, TransferErr> ReplayTransport::Send(codec::Bytes packet) {
+  result_.sent.emplace_back(packet.begin(), packet.end());
+
+  const std::vector<ReplaySend>& expected = scenario_.expected;
+  std::size_t i = result_.sent.size() - 1;
+  if (expected.empty() || result_.divergence) {
+    return {};
+  }
+  ReplaySend send = Summarize(packet);
+  if (i >= expected.size()) {
+    result_.divergence = "send " + std::to_string(i) +
+                         ": expected nothing, got " + Describe(send);
+  } else if (send != expected[i]) {
+    result_.divergence = "send " + std::to_string(i) + ": expected " +
+                         Describe(expected[i]) + ", got " + Describe(send);
+  }
+  return {};
+}
+
+std::expected<TftpPacket, TransferErr> ReplayTransport::Recv(Micros timeout) {
+  Pause();
+  if (next_ == scenario_.events.size()) {
+    return std::unexpected("replay ran out of events");
+  }
+  result_.events++;
+
+  const ReplayEvent& event = scenario_.events[next_];
+  Clock::time_point due = start_ + event.at;
+  TftpPacket packet;
+  if (event.kind == ReplayEvent::Kind::kTimeout) {
+    next_++;
+    now_ += timeout;
+  } else if (scenario_.timer_first && due > now_ + timeout) {
+    now_ += timeout;
+  } else {
+    next_++;
+    now_ = std::max(now_, due);
+    sender_.SetPort(event.from_port);
+    packet = event.packet;
+  }
+  resumed_ = Clock::now();
+  return packet;
+}
+
+void ReplayTransport::Pause() {
+  auto busy = Clock::now() - resumed_;
+  result_.busy += busy;
+  result_.slowest = std::max<std::chrono::nanoseconds>(result_.slowest, busy);
+}
+
+void ReplayTransport::Finish() {
+  Pause();
+  result_.stats.Finish(std::chrono::duration_cast<Micros>(now_ - start_));
+  std::size_t expected = scenario_.expected.size();
+  if (!result_.divergence && expected > result_.sent.size()) {
+    result_.divergence = "sent " + std::to_string(result_.sent.size()) +
+                         " packets of " + std::to_string(expected);
+  }
+}
+
+ReplayResult Replay(const Config& conf, const ReplayScenario& scenario) {
+  ReplayResult result;
+  uint32_t rexmt_ms = RexmtTimeoutMs(conf);
+  auto transport = std::make_unique<ReplayTransport>(scenario, result);
+  ReplayTransport& replay = *transport;
+  Session session =
+      Session::Attach(conf, Loopback(kDefaultServerPort), std::move(transport),
+                      rexmt_ms, result.stats);
+
+  if (scenario.direction == ReplayDirection::kGet) {
+    MemorySink out(result.received);
+    result.outcome =
+        session.Wait(ReceiveFile(session, scenario.remote_file, out));
+  } else {
+    std::istringstream in(std::string(scenario.put_size, 'x'));
+    result.outcome =
+        session.Wait(SendFile(session, scenario.remote_file, in));
+  }
+  replay.Finish();
+  return result;
+}
+
+/* Traces keep headers only, so this stands in what the server sent. */
+static std::optional<TftpPacket> TracedPacket(const TraceRecord& record,
+                                              const Config& conf) {
+  switch (record.opcode) {
+    case OpCode::kData:
+      return PackData(
+          {.block_num = record.block,
+           .data = BlockData(std::max<uint16_t>(record.length, 4) - 4)});
+    case OpCode::kAck:
+      return PackAck({.block_num = record.block});
+    case OpCode::kOptionAck:
+      return PackOptionAck({.options = RequestOptions(conf)});
+    case OpCode::kError:
+      return PackError(
+          {.err_code = ErrorCode::kNotDefined, .err_msg = "traced error"});
+  }
+  return std::nullopt;
+}
+
+std::expected<ReplayScenario, TransferErr> ScenarioFromTimeline(
+    const TraceTimeline& timeline, const Config& conf) {
+  const TraceRecord* request =
+      (timeline.events.empty()) ? nullptr : &timeline.events.front();
+  if (!request || request->event != TraceEvent::kSend ||
+      (request->opcode != OpCode::kReadReq &&
+       request->opcode != OpCode::kWriteReq)) {
+    return std::unexpected("the transfer on port " +
+                           std::to_string(timeline.local_port) +
+                           " doesn't start with its request");
+  }
+
+  ReplayScenario scenario;
+  scenario.timer_first = false;
+  scenario.direction = (request->opcode == OpCode::kWriteReq)
+                           ? ReplayDirection::kPut
+                           : ReplayDirection::kGet;
+  /* A put's size follows from its blocks, every one full but the last. */
+  uint64_t blocks = 0;
+  uint64_t last_len = 0;
+  uint16_t next_block = 1;
+  for (const TraceRecord& record : timeline.events) {
+    switch (record.event) {
+      case TraceEvent::kSend:
+      case TraceEvent::kResend:
+        scenario.expected.push_back(
+            {.opcode = record.opcode, .block = record.block});
+        if (record.opcode == OpCode::kData &&
+            (record.block == next_block ||
+             (next_block == 0 && record.block == 1))) {
+          blocks++;
+          last_len = std::max<uint16_t>(record.length, 4) - 4;
+          next_block = record.block + 1;
+        }
+        break;
+      case TraceEvent::kRecv:
+        if (auto packet = TracedPacket(record, conf)) {
+          scenario.events.push_back(
+              {.kind = ReplayEvent::Kind::kDatagram,
+               .at = Micros((record.time_ns - request->time_ns) / 1000),
+               .from_port = record.peer_port,
+               .packet = std::move(*packet)});
+        }
+        break;
+      case TraceEvent::kTimeout:
+        scenario.events.push_back({.kind = ReplayEvent::Kind::kTimeout,
+                                   .at = Micros::zero(),
+                                   .from_port = 0,
+                                   .packet = {}});
+        break;
+    }
+  }
+  if (blocks) {
+    scenario.put_size = (blocks - 1) * kDefaultBlockSize + last_len;
+  }
+  return scenario;
+}
+
+}  // namespace client
+}  // namespace tftp
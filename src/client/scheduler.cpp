@@ -0,0 +1,263 @@
+#include "client/scheduler.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "client/work_deque.h"
+
+namespace tftp {
+namespace client {
+
+/* The pool and slot of the worker running on this thread, if any. */
+static thread_local const TransferScheduler* tls_scheduler = nullptr;
+static thread_local std::size_t tls_worker = 0;
+
+TransferScheduler::TransferScheduler(std::size_t workers,
+                                     SchedulerLimits limits)
+    : limits_(limits) {
+  for (std::size_t i = 0; i < std::max<std::size_t>(workers, 1); ++i) {
+    workers_.push_back(std::make_unique<Worker>());
+  }
+  /* Start the threads only once every deque they might steal from exists. */
+  for (std::size_t i = 0; i < workers_.size(); ++i) {
+    workers_[i]->thread = std::jthread([this, i] { Loop(i); });
+  }
+}
+
+TransferScheduler::~TransferScheduler() {
+  stop_ = true;
+  Signal();
+  for (auto& worker : workers_) {
+    worker->thread.join();
+  }
+}
+
+bool TransferScheduler::Run(std::vector<Job> jobs) {
+  Batch batch;
+  batch.remaining = jobs.size();
+  std::vector<Pending> pending;
+  pending.reserve(jobs.size());
+  for (Job& job : jobs) {
+    pending.push_back(
+        Pending{.job = std::move(job), .batch = &batch, .admitted = false});
+  }
+
+  bool inside = (tls_scheduler == this);
+  if (inside) {
+    /* The owner takes newest first, push in reverse to keep script order. */
+    for (auto it = pending.rbegin(); it != pending.rend(); ++it) {
+      workers_[tls_worker]->deque.Push(&*it);
+    }
+  } else {
+    std::lock_guard lock(injected_mutex_);
+    for (Pending& p : pending) {
+      injected_.push_back(&p);
+    }
+  }
+  Signal();
+
+  /* Nested batches help out rather than tie up their worker. */
+  for (;;) {
+    uint64_t seen = signal_.load(std::memory_order_acquire);
+    if (!batch.remaining.load(std::memory_order_acquire)) {
+      break;
+    }
+    Pending* work = (inside) ? FindWork(tls_worker) : nullptr;
+    if (work) {
+      Execute(tls_worker, work);
+    } else {
+      signal_.wait(seen, std::memory_order_acquire);
+    }
+  }
+  return batch.ok;
+}
+
+void TransferScheduler::Loop(std::size_t self) {
+  tls_scheduler = this;
+  tls_worker = self;
+  while (!stop_) {
+    uint64_t seen = signal_.load(std::memory_order_acquire);
+    if (Pending* work = FindWork(self)) {
+      Execute(self, work);
+    } else if (!stop_) {
+      signal_.wait(seen, std::memory_order_acquire);
+    }
+  }
+}
+
+TransferScheduler::Pending* TransferScheduler::FindWork(std::size_t self) {
+  for (;;) {
+    Pending* work = nullptr;
+    if (auto item = workers_[self]->deque.Take()) {
+      work = *item;
+    }
+
+    if (!work) {
+      std::lock_guard lock(injected_mutex_);
+      if (!injected_.empty()) {
+        work = injected_.front();
+        injected_.pop_front();
+      }
+    }
+
+    /* A steal can lose a race with the owner or another thief, so give each
+       victim a second chance before going to sleep. */
+    for (int attempt = 0; attempt < 2 && !work; ++attempt) {
+      for (std::size_t i = 1; i < workers_.size() && !work; ++i) {
+        auto item = workers_[(self + i) % workers_.size()]->deque.Steal();
+        if (item) {
+          steals_++;
+          work = *item;
+        }
+      }
+    }
+
+    if (!work || Acquire(work)) {
+      return work;
+    }
+  }
+}
+
+bool TransferScheduler::Acquire(Pending* pending) {
+  const std::string& name = pending->job.host;
+  if (name.empty() || pending->admitted) {
+    return true;
+  }
+
+  std::lock_guard lock(limits_mutex_);
+  Host& host = hosts_[name];
+  if (!Admits(host)) {
+    if (host.parked.empty()) {
+      turns_.push_back(name);
+    }
+    host.parked.push_back(pending);
+    return false;
+  }
+  running_++;
+  host.running++;
+  return true;
+}
+
+std::size_t TransferScheduler::Limit(const Host& host) const {
+  if (!host.window) {
+    return limits_.per_host;
+  }
+  auto window = std::max<std::size_t>(1, static_cast<std::size_t>(host.window));
+  return (limits_.per_host) ? std::min(limits_.per_host, window) : window;
+}
+
+bool TransferScheduler::Admits(const Host& host) const {
+  std::size_t limit = Limit(host);
+  return (!limits_.global || running_ < limits_.global) &&
+         (!limit || host.running < limit);
+}
+
+std::size_t TransferScheduler::HostLimit(const std::string& host) {
+  std::lock_guard lock(limits_mutex_);
+  auto it = hosts_.find(host);
+  return (it == hosts_.end()) ? limits_.per_host : Limit(it->second);
+}
+
+void TransferScheduler::Feedback(const std::string& name, uint64_t blocks,
+                                 uint64_t retransmits) {
+  if (name.empty()) {
+    return;
+  }
+  /* A transfer that never got a block in had nothing but retransmits. */
+  double rate = (blocks) ? static_cast<double>(retransmits) / blocks
+                         : static_cast<double>(retransmits > 0);
+
+  std::lock_guard lock(limits_mutex_);
+  Host& host = hosts_[name];
+  bool stale = host.stale > 0;
+  if (stale) {
+    host.stale--;
+  }
+  if (rate > kCongestedRate) {
+    /* Transfers that overlapped the one that backed off saw the same
+       overload, back off once per round like TCP does. */
+    if (!stale) {
+      host.window = std::max(1.0, host.running / 2.0);
+      host.stale = (host.running) ? host.running - 1 : 0;
+    }
+  } else if (host.window) {
+    host.window += 1.0 / host.window;
+    if (limits_.per_host) {
+      host.window = std::min<double>(host.window, limits_.per_host);
+    }
+  }
+}
+
+std::vector<TransferScheduler::Pending*> TransferScheduler::Unpark() {
+  /* Each pass gives every host with room one slot, a host that got one
+     waits behind those that did not. */
+  std::vector<Pending*> unparked;
+  for (bool progress = true; progress;) {
+    progress = false;
+    std::vector<std::string> served;
+    for (auto it = turns_.begin(); it != turns_.end();) {
+      Host& host = hosts_[*it];
+      if (!Admits(host)) {
+        ++it;
+        continue;
+      }
+      Pending* pending = host.parked.front();
+      host.parked.pop_front();
+      pending->admitted = true;
+      running_++;
+      host.running++;
+      unparked.push_back(pending);
+      progress = true;
+
+      if (!host.parked.empty()) {
+        served.push_back(std::move(*it));
+      }
+      it = turns_.erase(it);
+    }
+    turns_.insert(turns_.end(), served.begin(), served.end());
+  }
+  return unparked;
+}
+
+void TransferScheduler::Execute(std::size_t self, Pending* pending) {
+  bool ok = pending->job.task();
+
+  /* A finished transfer frees a slot, hand it to the next parked host in
+     turn. Its window may have grown too, so there may be more than one. */
+  const std::string& name = pending->job.host;
+  if (!name.empty()) {
+    std::vector<Pending*> unparked;
+    {
+      std::lock_guard lock(limits_mutex_);
+      running_--;
+      hosts_[name].running--;
+      unparked = Unpark();
+    }
+    for (Pending* p : unparked) {
+      workers_[self]->deque.Push(p);
+    }
+  }
+
+  /* The batch belongs to the caller of Run, which may return as soon as
+     the count reaches zero. */
+  Batch* batch = pending->batch;
+  if (!ok) {
+    batch->ok = false;
+  }
+  batch->remaining.fetch_sub(1, std::memory_order_acq_rel);
+  Signal();
+}
+
+void TransferScheduler::Signal() {
+  signal_.fetch_add(1, std::memory_order_release);
+  signal_.notify_all();
+}
+
+}  // namespace client
+}  // namespace tftp
@@ -0,0 +1,192 @@
+#include "client/script.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstddef>
+#include <expected>
+#include <iostream>
+#include <set>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "client/cmd.h"
+#include "client/config.h"
+#include "client/scheduler.h"
+#include "client/transfer.h"
+#include "common/parse.h"
+
+namespace tftp {
+namespace client {
+
+static bool IsTransfer(const Cmd& cmd) {
+  return cmd.Id() == CmdId::kGet || cmd.Id() == CmdId::kPut;
+}
+
+static FileList TransferArgs(const Cmd& cmd) {
+  FileList args;
+  if (cmd.Id() == CmdId::kGet) {
+    const auto& get = static_cast<const GetCmd&>(cmd);
+    args = get.Files();
+    args.push_back(get.RemoteFile());
+    args.push_back(get.LocalFile());
+  } else if (cmd.Id() == CmdId::kPut) {
+    const auto& put = static_cast<const PutCmd&>(cmd);
+    args = put.Files();
+    args.push_back(put.RemoteFile());
+    args.push_back(put.LocalFile());
+    args.push_back(put.RemoteDir());
+  }
+  args.erase(std::remove(args.begin(), args.end(), File{}), args.end());
+  return args;
+}
+
+/* A host:file argument changes the default host for later commands. */
+static bool SetsHost(const Cmd& cmd, bool literal_mode) {
+  if (literal_mode) {
+    return false;
+  }
+  FileList args = TransferArgs(cmd);
+  return std::any_of(args.cbegin(), args.cend(), [](const File& arg) {
+    return arg.find(':') != File::npos;
+  });
+}
+
+/* Nothing else may print while a get writes the file to stdout. */
+static bool StreamsToStdout(const Cmd& cmd) {
+  return cmd.Id() == CmdId::kGet &&
+         static_cast<const GetCmd&>(cmd).LocalFile() == kStdStream;
+}
+
+static File Basename(const File& path) {
+  std::size_t seperator = path.find_last_of("/:");
+  return (seperator == File::npos) ? path : path.substr(seperator + 1);
+}
+
+std::expected<std::size_t, ParseStatus> ParseJobs(std::string_view val) {
+  bool is_num =
+      !val.empty() && std::all_of(val.cbegin(), val.cend(), [](char c) {
+        return std::isdigit(static_cast<unsigned char>(c));
+      });
+  if (!is_num || val.size() > 4) {
+    return std::unexpected(ParseStatus::kJobsOutOfRange);
+  }
+
+  std::size_t jobs = std::stoul(std::string(val));
+  if (jobs < 1 || jobs > kMaxJobs) {
+    return std::unexpected(ParseStatus::kJobsOutOfRange);
+  }
+  return jobs;
+}
+
+SchedulerLimits JobLimits(std::size_t jobs, std::size_t host_jobs) {
+  return {.per_host = host_jobs, .global = jobs};
+}
+
+ScriptLines SplitScript(std::string_view script) {
+  ScriptLines lines;
+  std::size_t start = 0;
+  while (start <= script.size()) {
+    std::size_t end = script.find_first_of(";\n", start);
+    if (end == std::string_view::npos) {
+      end = script.size();
+    }
+
+    std::string_view line = script.substr(start, end - start);
+    std::size_t first = line.find_first_not_of(" \t\r");
+    if (first != std::string_view::npos && line[first] != '#') {
+      std::size_t last = line.find_last_not_of(" \t\r");
+      lines.emplace_back(line.substr(first, last - first + 1));
+    }
+    start = end + 1;
+  }
+  return lines;
+}
+
+std::size_t TransferGroupEnd(const CmdList& cmds, std::size_t begin,
+                             bool literal_mode, bool multicast) {
+  if (multicast && begin < cmds.size() && IsTransfer(*cmds[begin])) {
+    return begin + 1;
+  }
+
+  std::set<File> touched;
+  std::size_t end = begin;
+  for (; end < cmds.size() && IsTransfer(*cmds[end]); ++end) {
+    /* Files shared with an earlier transfer in the group order the two. */
+    FileList args = TransferArgs(*cmds[end]);
+    bool conflicts = std::any_of(
+        args.cbegin(), args.cend(),
+        [&touched](const File& arg) { return touched.count(Basename(arg)); });
+    if (end > begin && (conflicts || StreamsToStdout(*cmds[end]))) {
+      break;
+    }
+    for (const File& arg : args) {
+      touched.insert(Basename(arg));
+    }
+
+    if (SetsHost(*cmds[end], literal_mode) || StreamsToStdout(*cmds[end])) {
+      return end + 1;
+    }
+  }
+  return end;
+}
+
+static bool Execute(Cmd& cmd, Config& conf) {
+  auto exec_stat = cmd.Execute(conf);
+  if (exec_stat != ExecStatus::kSuccessfulExec) {
+    /* Stdout may be carrying a file a get streamed to it. */
+    std::cerr << "error: " << kExecStatusToStr[exec_stat] << std::endl;
+    return false;
+  }
+  return true;
+}
+
+/* Runs a group of independent transfers, each on its own copy of conf.
+   The copies share the session stats. */
+static bool RunGroup(const CmdList& cmds, std::size_t begin, std::size_t end,
+                     Config& conf) {
+  std::vector<Config> confs(end - begin, conf);
+
+  bool success = true;
+  if (conf.scheduler) {
+    /* The commands only group transfers, so they take no transfer slot. */
+    std::vector<TransferScheduler::Job> jobs;
+    for (std::size_t i = begin; i < end; ++i) {
+      jobs.push_back({.host = {}, .task = [&, i] {
+                        return Execute(*cmds[i], confs[i - begin]);
+                      }});
+    }
+    success = conf.scheduler->Run(std::move(jobs));
+  } else {
+    for (std::size_t i = begin; i < end; ++i) {
+      success &= Execute(*cmds[i], confs[i - begin]);
+    }
+  }
+
+  /* The last host set in script order sticks. */
+  for (const Config& copy : confs) {
+    conf.hostname = copy.hostname;
+  }
+  return success;
+}
+
+bool RunScript(const CmdList& cmds, Config& conf) {
+  bool success = true;
+  std::size_t i = 0;
+  while (i < cmds.size()) {
+    if (!IsTransfer(*cmds[i])) {
+      success &= Execute(*cmds[i], conf);
+      i++;
+      continue;
+    }
+
+    std::size_t end =
+        TransferGroupEnd(cmds, i, conf.literal_mode, conf.multicast);
+    success &= RunGroup(cmds, i, end, conf);
+    i = end;
+  }
+  return success;
+}
+
+}  // namespace client
+}  // namespace tftp
@@ -0,0 +1,74 @@
+#include "client/send_window.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <utility>
+
+#include "client/session.h"
+#include "client/stats.h"
+#include "common/block_seq.h"
+#include "common/codec.h"
+#include "common/types.h"
+
+namespace tftp {
+namespace client {
+
+void SendWindow::Push(TftpPacket packet) {
+  entries_.push_back({.packet = std::move(packet)});
+  entries_.back().wire = entries_.back().packet;
+}
+
+void SendWindow::Push(codec::Bytes packet) {
+  entries_.push_back({.packet = {}, .wire = packet});
+}
+
+SendWindow::Entry& SendWindow::Advance(Clock::time_point now) {
+  Entry& entry = At(cursor_++);
+  entry.sent_at = now;
+  entry.transmissions++;
+  return entry;
+}
+
+/* Maps a wire block number onto [Base() - 1, Next() - 1], the only blocks
+   an ACK can refer to. Windows are shorter than a rollover cycle so this
+   is exact, even across the wrap. */
+std::optional<uint64_t> SendWindow::Match(BlockNum block_num) const {
+  uint64_t last_acked = base_ - 1;
+  auto block = seq_.After(block_num, last_acked);
+  if (!block || *block - last_acked > entries_.size()) {
+    return std::nullopt;
+  }
+  return block;
+}
+
+/* Karn's rule: a reply to a retransmitted block is ambiguous. */
+std::optional<Micros> SendWindow::Rtt(uint64_t block,
+                                      Clock::time_point now) const {
+  if (block < base_ || block >= Next()) {
+    return std::nullopt;
+  }
+  const Entry& entry = entries_[block - base_];
+  if (entry.transmissions != 1) {
+    return std::nullopt;
+  }
+  return std::chrono::duration_cast<Micros>(now - entry.sent_at);
+}
+
+uint64_t SendWindow::Ack(uint64_t block) {
+  uint64_t acked = 0;
+  while (base_ <= block && !entries_.empty()) {
+    entries_.pop_front();
+    base_++;
+    acked++;
+  }
+  if (acked) {
+    cursor_ = std::max(cursor_, base_);
+    dup_acks_ = 0;
+  }
+  return acked;
+}
+
+}  // namespace client
+}  // namespace tftp
@@ -0,0 +1,165 @@
+#include "client/server_pool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "client/config.h"
+#include "client/session.h"
+#include "client/stats.h"
+#include "client/transport.h"
+#include "common/pack.h"
+#include "common/types.h"
+
+namespace tftp {
+namespace client {
+
+/* Asked for by probes. Any reply will do, most likely file not found. */
+static constexpr const char* kProbeFile = "tftpc-probe";
+
+std::shared_ptr<ServerPool> ServerPool::FromList(std::string_view list) {
+  std::vector<Server> servers;
+  std::size_t start = 0;
+  while (start <= list.size()) {
+    std::size_t end = std::min(list.find(',', start), list.size());
+    std::string_view host = list.substr(start, end - start);
+    bool seen = std::ranges::any_of(
+        servers, [host](const Server& server) { return server.host == host; });
+    if (!host.empty() && !seen) {
+      servers.push_back({.host = Hostname(host),
+                         .srtt = std::nullopt,
+                         .active = 0,
+                         .down_until = std::nullopt});
+    }
+    start = end + 1;
+  }
+  if (servers.size() < 2) {
+    return nullptr;
+  }
+  return std::shared_ptr<ServerPool>(new ServerPool(list, std::move(servers)));
+}
+
+std::vector<ServerPool::Server> ServerPool::Servers() const {
+  std::lock_guard lock(mutex_);
+  return servers_;
+}
+
+ServerPool::Server* ServerPool::Find(const Hostname& host) {
+  auto server = std::ranges::find(servers_, host, &Server::host);
+  return (server == servers_.end()) ? nullptr : &*server;
+}
+
+void ServerPool::SampleRtt(Server& server, Micros rtt) {
+  /* Smoothed the way TCP smooths its RTT, a gain of 1/8. */
+  server.srtt = (server.srtt) ? (*server.srtt * 7 + rtt) / 8 : rtt;
+}
+
+static std::optional<Micros> ProbeServer(const Config& conf,
+                                         const Hostname& host, uint16_t port) {
+  TransferStats stats;
+  auto session = Session::Open(conf, host, port, stats);
+  if (!session) {
+    return std::nullopt;
+  }
+  Clock::time_point start = session->Now();
+  auto sent = session->Wait(session->Send(PackReadRequest(
+      {.filename = kProbeFile, .mode = SendMode::kOctet, .options = {}})));
+  if (!sent) {
+    return std::nullopt;
+  }
+  auto reply = session->Wait(session->Recv());
+  if (!reply || reply->empty()) {
+    return std::nullopt;
+  }
+  auto rtt = std::chrono::duration_cast<Micros>(session->Now() - start);
+
+  /* The file exists after all, stop the server sending it. */
+  if (!UnpackError(*reply)) {
+    (void)session->Wait(session->Send(PackError(
+        {.err_code = ErrorCode::kNotDefined, .err_msg = "probe"})));
+  }
+  return rtt;
+}
+
+void ServerPool::Probe(const Config& conf, uint16_t port) {
+  std::vector<Hostname> hosts;
+  for (const Server& server : Servers()) {
+    hosts.push_back(server.host);
+  }
+
+  std::vector<std::optional<Micros>> rtts(hosts.size());
+  {
+    std::vector<std::jthread> probes;
+    for (std::size_t i = 0; i < hosts.size(); ++i) {
+      probes.emplace_back(
+          [&, i] { rtts[i] = ProbeServer(conf, hosts[i], port); });
+    }
+  }
+
+  std::lock_guard lock(mutex_);
+  Clock::time_point now = Clock::now();
+  for (std::size_t i = 0; i < hosts.size(); ++i) {
+    Server* server = Find(hosts[i]);
+    if (rtts[i]) {
+      SampleRtt(*server, *rtts[i]);
+      server->down_until.reset();
+    } else {
+      server->down_until = now + kDownTime;
+    }
+  }
+}
+
+std::optional<Hostname> ServerPool::Acquire(const std::vector<Hostname>& tried,
+                                            Clock::time_point now) {
+  std::lock_guard lock(mutex_);
+  auto cost = [](const Server& server) {
+    Micros rtt = server.srtt.value_or(Micros::zero()) + Micros(1);
+    return rtt * (server.active + 1);
+  };
+
+  Server* best = nullptr;
+  for (Server& server : servers_) {
+    if (std::ranges::find(tried, server.host) != tried.end() ||
+        (server.down_until && now < *server.down_until)) {
+      continue;
+    }
+    if (!best || cost(server) < cost(*best) ||
+        (cost(server) == cost(*best) && server.active < best->active)) {
+      best = &server;
+    }
+  }
+  if (!best) {
+    return std::nullopt;
+  }
+  best->active++;
+  return best->host;
+}
+
+void ServerPool::Release(const Hostname& host, const TransferStats& stats,
+                         bool down, Clock::time_point now) {
+  std::lock_guard lock(mutex_);
+  Server* server = Find(host);
+  if (!server) {
+    return;
+  }
+  server->active--;
+  if (down) {
+    server->down_until = now + kDownTime;
+    return;
+  }
+  server->down_until.reset();
+  if (stats.rtt_samples) {
+    SampleRtt(*server, stats.RttAvg());
+  }
+}
+
+}  // namespace client
+}  // namespace tftp
@@ -0,0 +1,221 @@
+#include "client/session.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <expected>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include "client/config.h"
+#include "client/pacer.h"
+#include "client/stats.h"
+#include "client/transfer.h"
+#include "client/transport.h"
+#include "common/codec.h"
+#include "common/event_loop.h"
+#include "common/pack.h"
+#include "common/resolver.h"
+#include "common/tracer.h"
+#include "common/types.h"
+#include "common/udp_socket.h"
+
+namespace tftp {
+namespace client {
+
+std::expected<Session, TransferErr> Session::Open(const Config& conf,
+                                                  std::string_view host,
+                                                  uint16_t port,
+                                                  TransferStats& stats,
+                                                  EventLoop* loop) {
+  uint32_t rexmt_ms = RexmtTimeoutMs(conf);
+
+  /* Transfers share the resolver so a batch looks each host up only once. */
+  auto server = (conf.resolver) ? conf.resolver->Resolve(host, port)
+                                : ResolveAddr(host);
+  if (!server) {
+    return std::unexpected(server.error());
+  }
+  server->SetPort(port);
+
+  if (loop) {
+    auto transport = AsyncTransport::Create(*loop, conf, *server);
+    if (!transport) {
+      return std::unexpected(transport.error());
+    }
+    stats.buffers = (*transport)->Buffers();
+    return Attach(conf, *server, std::move(*transport), rexmt_ms, stats);
+  }
+  auto transport = UdpTransport::Create(conf, *server, rexmt_ms);
+  if (!transport) {
+    return std::unexpected(transport.error());
+  }
+  stats.buffers = (*transport)->Buffers();
+  return Attach(conf, *server, std::move(*transport), rexmt_ms, stats);
+}
+
+Session Session::Attach(const Config& conf, const SockAddr& server,
+                        std::unique_ptr<Transport> transport,
+                        uint32_t rexmt_ms, TransferStats& stats) {
+  Session session(conf, server, std::move(transport), rexmt_ms, stats);
+  if (conf.rate) {
+    session.pacer_ = std::make_shared<TokenBucket>(conf.rate);
+  }
+  return session;
+}
+
+Task<std::expected<void, TransferErr>> Session::Send(TftpPacket packet) {
+  co_await Pace(packet.size());
+  last_sent_ = std::move(packet);
+  rexmitted_ = false;
+  sent_at_ = transport_->Now();
+
+  if (conf_->trace) {
+    *conf_->console << "sent " << codec::Describe(last_sent_) << std::endl;
+  }
+  Record(TraceEvent::kSend, peer_, last_sent_);
+
+  co_return co_await Timed(last_sent_);
+}
+
+Task<std::expected<void, TransferErr>> Session::Resend() {
+  co_await Pace(last_sent_.size());
+  rexmitted_ = true;
+  stats_->retransmits++;
+
+  if (conf_->trace) {
+    *conf_->console << "resent " << codec::Describe(last_sent_) << std::endl;
+  }
+  Record(TraceEvent::kResend, peer_, last_sent_);
+
+  co_return co_await Timed(last_sent_);
+}
+
+/* Sends a packet the caller keeps track of, such as a block of a window. */
+Task<std::expected<void, TransferErr>> Session::Transmit(codec::Bytes packet,
+                                                         bool resend) {
+  co_await Pace(packet.size());
+  if (resend) {
+    stats_->retransmits++;
+  }
+
+  if (conf_->trace) {
+    *conf_->console << ((resend) ? "resent " : "sent ")
+                    << codec::Describe(packet) << std::endl;
+  }
+  Record((resend) ? TraceEvent::kResend : TraceEvent::kSend, peer_, packet);
+
+  co_return co_await Timed(packet);
+}
+
+Task<std::expected<TftpPacket, TransferErr>> Session::Recv() {
+  for (;;) {
+    auto recv_start = Clock::now();
+    auto packet =
+        co_await transport_->RecvPacket(std::chrono::milliseconds(rexmt_ms_));
+    stats_->recv_time.Record(Clock::now() - recv_start);
+    if (!packet) {
+      co_return std::unexpected(packet.error());
+    }
+    if (packet->empty()) { /* Timed out, hand back an empty packet. */
+      stats_->timeouts++;
+      if (conf_->trace) {
+        *conf_->console << "timed out" << std::endl;
+      }
+      Record(TraceEvent::kTimeout, peer_);
+      if (!tid_ && conf_->request_retries &&
+          ++unanswered_ > conf_->request_retries) {
+        co_return std::unexpected(Unresponsive("no reply from server"));
+      }
+      co_return TftpPacket{};
+    }
+
+    /* The server answers from a fresh port (its TID), lock onto it. */
+    const SockAddr& sender = transport_->LastSender();
+    if (!tid_) {
+      if (auto locked = transport_->SetPeer(sender); !locked) {
+        co_return std::unexpected(locked.error());
+      }
+      peer_ = sender;
+      tid_ = sender.Port();
+    } else if (!SameAddr(sender, peer_)) { /* Not our transfer. */
+      RejectStray(sender);
+      continue;
+    }
+
+    if (conf_->trace) {
+      *conf_->console << "received " << codec::Describe(*packet) << std::endl;
+    }
+    Record(TraceEvent::kRecv, sender, *packet);
+    co_return std::move(*packet);
+  }
+}
+
+/* Real time, whatever clock the transport keeps. */
+Task<std::expected<void, TransferErr>> Session::Timed(codec::Bytes packet) {
+  auto start = Clock::now();
+  auto sent = co_await transport_->SendPacket(packet);
+  stats_->send_time.Record(Clock::now() - start);
+  co_return sent;
+}
+
+Task<> Session::Pace(std::size_t bytes) {
+  Micros wait = Micros::zero();
+  for (TokenBucket* bucket : {pacer_.get(), conf_->global_pacer.get()}) {
+    if (bucket) {
+      wait = std::max(wait, bucket->Take(bytes, transport_->Now()));
+    }
+  }
+  if (wait >= kMinPacingSleep) {
+    co_await transport_->Sleep(wait);
+  }
+}
+
+/* RFC 1350: a packet from an unknown TID gets an error and the transfer
+   carries on. The error is best effort, so a failed send is ignored. */
+void Session::RejectStray(const SockAddr& sender) {
+  if (conf_->trace) {
+    *conf_->console << "rejected a packet from " << sender.Ip() << ":"
+                    << sender.Port() << std::endl;
+  }
+  TftpPacket error = PackError({.err_code = ErrorCode::kUnknownTransferId,
+                                .err_msg = "unknown transfer ID"});
+  Record(TraceEvent::kSend, sender, error);
+  (void)transport_->SendTo(error, sender);
+}
+
+void Session::SampleRtt() {
+  /* Karn's rule: a reply to a retransmitted packet is ambiguous. */
+  if (!rexmitted_) {
+    stats_->RecordRtt(
+        std::chrono::duration_cast<Micros>(transport_->Now() - sent_at_));
+  }
+}
+
+void Session::Record(TraceEvent event, const SockAddr& peer,
+                     codec::Bytes packet) {
+  if (conf_->tracer) {
+    conf_->tracer->Record(event, transport_->LocalPort(), peer, packet);
+  }
+}
+
+bool Session::Expired() const {
+  return conf_->timeout &&
+         (transport_->Now() - start_) > std::chrono::seconds(conf_->timeout);
+}
+
+uint32_t RexmtTimeoutMs(const Config& conf) {
+  return 1000 * std::max<uint32_t>(conf.rexmt_timeout, 1);
+}
+
+TransferErr ServerError(const codec::ErrorView& err) {
+  return TransferErr("server error " + std::to_string(err.err_code) + ": " +
+                         std::string(err.err_msg),
+                     err.err_code);
+}
+
+}  // namespace client
+}  // namespace tftp
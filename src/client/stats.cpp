@@ -0,0 +1,84 @@
+#include "client/stats.h"
+
+#include <algorithm>
+#include <chrono>
+#include <mutex>
+
+namespace tftp {
+namespace client {
+
+void TransferStats::RecordRtt(Micros rtt) {
+  rtt_min = std::min(rtt_min, rtt);
+  rtt_max = std::max(rtt_max, rtt);
+  rtt_total += rtt;
+  rtt_samples++;
+  rtts.Record(rtt);
+}
+
+void TransferStats::Finish(Micros duration) {
+  elapsed = duration;
+  transfer_time.Record(duration);
+}
+
+void TransferStats::Merge(const TransferStats& other) {
+  bytes += other.bytes;
+  blocks += other.blocks;
+  duplicates += other.duplicates;
+  retransmits += other.retransmits;
+  fast_retransmits += other.fast_retransmits;
+  timeouts += other.timeouts;
+  rtt_samples += other.rtt_samples;
+  rtt_min = std::min(rtt_min, other.rtt_min);
+  rtt_max = std::max(rtt_max, other.rtt_max);
+  rtt_total += other.rtt_total;
+  elapsed += other.elapsed;
+  window = other.window;
+  cwnd = other.cwnd;
+  buffers = other.buffers;
+  rtts.Merge(other.rtts);
+  send_time.Merge(other.send_time);
+  recv_time.Merge(other.recv_time);
+  write_time.Merge(other.write_time);
+  transfer_time.Merge(other.transfer_time);
+}
+
+Micros TransferStats::RttMin() const {
+  return (rtt_samples) ? rtt_min : Micros::zero();
+}
+
+Micros TransferStats::RttAvg() const {
+  if (!rtt_samples) {
+    return Micros::zero();
+  }
+  return Micros(rtt_total.count() / static_cast<Micros::rep>(rtt_samples));
+}
+
+double TransferStats::Throughput() const {
+  using Seconds = std::chrono::duration<double>;
+  double secs = std::chrono::duration_cast<Seconds>(elapsed).count();
+  return (secs > 0) ? bytes / secs : 0;
+}
+
+void SessionStats::Merge(const TransferStats& stats, bool succeeded) {
+  std::lock_guard lock(mutex);
+  transfers++;
+  if (!succeeded) {
+    failures++;
+  }
+  last = stats;
+  totals.Merge(stats);
+}
+
+void SessionStats::Merge(const SessionStats& other) {
+  if (!other.transfers) {
+    return;
+  }
+  std::lock_guard lock(mutex);
+  transfers += other.transfers;
+  failures += other.failures;
+  last = other.last;
+  totals.Merge(other.totals);
+}
+
+}  // namespace client
+}  // namespace tftp
@@ -0,0 +1,195 @@
+#include "client/sync.h"
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <filesystem>
+#include <fstream>
+#include <istream>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+#include "client/config.h"
+#include "client/file_sink.h"
+#include "client/session.h"
+#include "client/stats.h"
+#include "client/transfer.h"
+#include "common/sha256.h"
+#include "common/types.h"
+
+namespace tftp {
+namespace client {
+
+static std::optional<uint64_t> ParseSize(std::string_view val) {
+  uint64_t size = 0;
+  auto [end, ec] = std::from_chars(val.data(), val.data() + val.size(), size);
+  if (ec != std::errc() || end != val.data() + val.size()) {
+    return std::nullopt;
+  }
+  return size;
+}
+
+std::expected<Manifest, SyncErr> ParseManifest(std::istream& in) {
+  Manifest manifest;
+  std::string line;
+  for (std::size_t num = 1; std::getline(in, line); ++num) {
+    std::istringstream fields(line);
+    std::vector<std::string> args;
+    for (std::string arg; fields >> arg;) {
+      args.push_back(arg);
+    }
+    if (args.empty() || args[0].starts_with('#')) {
+      continue;
+    }
+
+    auto fail = [num](const std::string& msg) {
+      return std::unexpected("manifest line " + std::to_string(num) + ": " +
+                             msg);
+    };
+    if (args.size() < 3 || args.size() > 4) {
+      return fail("expected 'remote local size [sha256]'");
+    }
+    ManifestEntry entry = {.remote = args[0], .local = args[1]};
+    auto size = ParseSize(args[2]);
+    if (!size) {
+      return fail("invalid size '" + args[2] + "'");
+    }
+    entry.size = *size;
+    if (args.size() == 4) {
+      entry.sha256 = ParseSha256(args[3]);
+      if (!entry.sha256) {
+        return fail("invalid sha256 '" + args[3] + "'");
+      }
+    }
+    manifest.push_back(std::move(entry));
+  }
+  return manifest;
+}
+
+std::expected<Manifest, SyncErr> ReadManifest(const std::string& path) {
+  std::ifstream in(path);
+  if (!in) {
+    return std::unexpected("unable to open '" + path + "'");
+  }
+  return ParseManifest(in);
+}
+
+static std::optional<Sha256Digest> HashFile(const std::string& path) {
+  std::ifstream in(path, std::ios::binary);
+  if (!in) {
+    return std::nullopt;
+  }
+  Sha256 hash;
+  std::array<char, 1 << 16> buffer;
+  while (in.read(buffer.data(), buffer.size()) || in.gcount()) {
+    hash.Update(reinterpret_cast<const uint8_t*>(buffer.data()), in.gcount());
+  }
+  if (in.bad()) {
+    return std::nullopt;
+  }
+  return hash.Final();
+}
+
+bool UpToDate(const ManifestEntry& entry) {
+  /* The size is a stat away, only read the file when it matches. */
+  std::error_code ec;
+  if (!std::filesystem::is_regular_file(entry.local, ec) ||
+      std::filesystem::file_size(entry.local, ec) != entry.size || ec) {
+    return false;
+  }
+  return !entry.sha256 || HashFile(entry.local) == entry.sha256;
+}
+
+/* Counts and hashes the bytes on their way to the file. */
+class CheckedSink : public FileSink {
+ public:
+  CheckedSink(FileSink& out, bool hash) : out_(out), hash_(hash) {}
+
+  std::expected<void, TransferErr> Write(const uint8_t* data,
+                                         std::size_t len) override {
+    if (hash_) {
+      sha256_.Update(data, len);
+    }
+    size_ += len;
+    return out_.Write(data, len);
+  }
+  void Reserve(uint64_t size) override { out_.Reserve(size); }
+  std::expected<void, TransferErr> Close() override { return out_.Close(); }
+
+  uint64_t Size() const { return size_; }
+  Sha256Digest Digest() { return sha256_.Final(); }
+
+ private:
+  FileSink& out_;
+  bool hash_ = false;
+  Sha256 sha256_;
+  uint64_t size_ = 0;
+};
+
+static std::expected<void, TransferErr> Fetch(const Config& conf,
+                                              std::string_view host,
+                                              uint16_t port,
+                                              const ManifestEntry& entry,
+                                              TransferStats& stats) {
+  /* A synced file is on disk before it replaces the old copy, whatever
+     get is set to do. */
+  FsyncPolicy fsync = std::max(conf.fsync, FsyncPolicy::kFile);
+  auto out = AtomicSink::Open(entry.local, conf.direct_io, fsync);
+  if (!out) {
+    return std::unexpected(out.error());
+  }
+  CheckedSink checked(**out, entry.sha256.has_value());
+
+  /* The manifest's sizes and checksums are of the bytes on the server,
+     netascii would rewrite them on the way in. */
+  Config octet = conf;
+  octet.mode = SendMode::kOctet;
+  auto session = Session::Open(octet, host, port, stats);
+  if (!session) {
+    return std::unexpected(session.error());
+  }
+  auto received = session->Wait(ReceiveFile(*session, entry.remote, checked));
+  if (!received) {
+    return received;
+  }
+
+  if (checked.Size() != entry.size) {
+    return std::unexpected("size mismatch, expected " +
+                           std::to_string(entry.size) + " bytes, got " +
+                           std::to_string(checked.Size()));
+  }
+  if (entry.sha256 && checked.Digest() != *entry.sha256) {
+    return std::unexpected("checksum mismatch");
+  }
+  return (*out)->Publish();
+}
+
+std::expected<void, TransferErr> SyncFile(const Config& conf,
+                                          std::string_view host, uint16_t port,
+                                          const ManifestEntry& entry,
+                                          TransferStats& stats) {
+  std::filesystem::path parent =
+      std::filesystem::path(entry.local).parent_path();
+  std::error_code ec;
+  if (!parent.empty() && !std::filesystem::create_directories(parent, ec) &&
+      ec) {
+    return std::unexpected("unable to create '" + parent.string() +
+                           "': " + ec.message());
+  }
+
+  Clock::time_point start = Clock::now();
+  auto result = Fetch(conf, host, port, entry, stats);
+  stats.Finish(std::chrono::duration_cast<Micros>(Clock::now() - start));
+  return result;
+}
+
+}  // namespace client
+}  // namespace tftp
@@ -0,0 +1,610 @@
+#include "client/transfer.h"
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
+#include <variant>
+
+#include "client/config.h"
+#include "client/congestion.h"
+#include "client/file_sink.h"
+#include "client/packet_cache.h"
+#include "client/send_window.h"
+#include "client/session.h"
+#include "client/stats.h"
+#include "common/block_seq.h"
+#include "common/codec.h"
+#include "common/event_loop.h"
+#include "common/netascii.h"
+#include "common/pack.h"
+#include "common/parse.h"
+#include "common/types.h"
+
+namespace tftp {
+namespace client {
+
+static constexpr uint32_t kDupAckThreshold = 3;
+
+/* Checks the windowsize the server agreed to, RFC 7440. */
+static std::expected<uint16_t, TransferErr> NegotiatedWindow(
+    const codec::OptionAckView& oack, uint16_t requested) {
+  Options options = oack.options.ToOptions();
+  auto it = options.find(OptionName::kWindowSize);
+  if (it == options.cend()) {
+    return 1;
+  }
+
+  auto window = ParseWindowSize(it->second);
+  if (!window || *window > requested) {
+    return std::unexpected(TransferErr(
+        "server negotiated an invalid windowsize '" + it->second + "'",
+        ErrorCode::kOptionNegotiation));
+  }
+  return *window;
+}
+
+/* Servers that ignore the rollover option most often wrap to 0. */
+std::expected<BlockSeq, TransferErr> NegotiatedRollover(
+    const codec::OptionAckView& oack, const Config& conf) {
+  Options options = oack.options.ToOptions();
+  auto it = options.find(OptionName::kRollover);
+  if (it == options.cend()) {
+    return BlockSeq();
+  }
+
+  auto rollover = ParseRollover(it->second);
+  if (!conf.rollover || !rollover) {
+    return std::unexpected(TransferErr(
+        "server negotiated an invalid rollover '" + it->second + "'",
+        ErrorCode::kOptionNegotiation));
+  }
+  return BlockSeq(*rollover);
+}
+
+std::optional<uint64_t> NegotiatedTsize(const codec::OptionAckView& oack) {
+  Options options = oack.options.ToOptions();
+  auto it = options.find(OptionName::kTsize);
+  if (it == options.cend()) {
+    return std::nullopt;
+  }
+
+  uint64_t size = 0;
+  const std::string& value = it->second;
+  auto [end, err] =
+      std::from_chars(value.data(), value.data() + value.size(), size);
+  if (err != std::errc() || end != value.data() + value.size()) {
+    return std::nullopt;
+  }
+  return size;
+}
+
+TransferErr Unresponsive(const std::string& msg) {
+  TransferErr err(msg);
+  err.unresponsive = true;
+  return err;
+}
+
+Options RequestOptions(const Config& conf) {
+  Options options;
+  if (conf.windowsize > 1) {
+    options[OptionName::kWindowSize] = std::to_string(conf.windowsize);
+  }
+  if (conf.rollover) {
+    options[OptionName::kRollover] =
+        std::to_string(static_cast<int>(*conf.rollover));
+  }
+  return options;
+}
+
+/* Refuses an OACK, the server then drops the transfer (RFC 2347). */
+static Task<TransferErr> RejectOptions(Session& session, TransferErr err) {
+  [[maybe_unused]] auto sent = co_await session.Send(
+      PackError({.err_code = err.code, .err_msg = err.msg}));
+  co_return err;
+}
+
+Task<std::expected<void, TransferErr>> ReceiveFile(
+    Session& session, std::string_view remote_file, FileSink& out) {
+  const Config& conf = session.Conf();
+  TransferStats& stats = session.Stats();
+
+  ReadRequestMsg rrq = {.filename = std::string(remote_file),
+                        .mode = conf.mode,
+                        .options = RequestOptions(conf)};
+  /* Ask for the size to preallocate the file with, but only when the
+     server answers with an OACK anyway; on its own the option would cost
+     small files a round trip. Direct I/O is for files big enough not to
+     care. */
+  if (!rrq.options.empty() || conf.direct_io) {
+    rrq.options[OptionName::kTsize] = "0";
+  }
+  auto sent = co_await session.Send(PackReadRequest(rrq));
+  if (!sent) {
+    co_return std::unexpected(sent.error());
+  }
+
+  bool netascii = (conf.mode == SendMode::kNetAscii);
+  NetasciiDecoder decoder;
+  BlockData decoded;
+  BlockSeq seq;
+  uint64_t expected = 1;
+  uint16_t window = 1;
+  uint16_t unacked = 0;
+  /* RFC 7440 senders restart the window on every ACK, so a gap is ACKed
+     once until blocks arrive in order again or the timer fires. */
+  bool gap_acked = false;
+  for (;;) {
+    if (session.Expired()) {
+      co_return std::unexpected(Unresponsive("transfer timed out"));
+    }
+
+    auto packet = co_await session.Recv();
+    if (!packet) {
+      co_return std::unexpected(packet.error());
+    }
+    if (packet->empty()) {
+      gap_acked = false;
+      /* Part of a window arrived, acknowledge what we have in order. */
+      if (unacked) {
+        unacked = 0;
+        sent = co_await session.Send(
+            PackAck({.block_num = seq.Wire(expected - 1)}));
+      } else {
+        sent = co_await session.Resend();
+      }
+      if (!sent) {
+        co_return std::unexpected(sent.error());
+      }
+      continue;
+    }
+
+    auto msg = codec::Decode(*packet);
+    if (!msg) {
+      continue;
+    }
+    if (auto* err = std::get_if<codec::ErrorView>(&*msg)) {
+      co_return std::unexpected(ServerError(*err));
+    }
+
+    if (auto* oack = std::get_if<codec::OptionAckView>(&*msg)) {
+      if (expected != 1) {
+        continue;
+      }
+      auto negotiated = NegotiatedWindow(*oack, conf.windowsize);
+      if (!negotiated) {
+        co_return std::unexpected(
+            co_await RejectOptions(session, negotiated.error()));
+      }
+      auto rollover = NegotiatedRollover(*oack, conf);
+      if (!rollover) {
+        co_return std::unexpected(
+            co_await RejectOptions(session, rollover.error()));
+      }
+      window = *negotiated;
+      seq = *rollover;
+      if (auto tsize = NegotiatedTsize(*oack)) {
+        out.Reserve(*tsize);
+      }
+      session.SampleRtt();
+      sent = co_await session.Send(PackAck({.block_num = 0}));
+      if (!sent) {
+        co_return std::unexpected(sent.error());
+      }
+      continue;
+    }
+
+    auto* data = std::get_if<codec::DataView>(&*msg);
+    if (!data) {
+      continue;
+    }
+
+    if (data->block_num != seq.Wire(expected)) {
+      /* A repeat means our ACK was lost, anything else is a gap. Either way
+         tell the sender the last block we have in order. */
+      bool repeat = (data->block_num == seq.Wire(expected - 1));
+      if (repeat) {
+        stats.duplicates++;
+      }
+      /* In lock-step a repeat is always ACKed again, as RFC 1350 asks. */
+      if (gap_acked && (window > 1 || !repeat)) {
+        continue;
+      }
+      gap_acked = true;
+      unacked = 0;
+      sent = co_await session.Send(
+          PackAck({.block_num = seq.Wire(expected - 1)}));
+      if (!sent) {
+        co_return std::unexpected(sent.error());
+      }
+      continue;
+    }
+
+    gap_acked = false;
+
+    if (!unacked) {
+      session.SampleRtt();
+    }
+    Clock::time_point write_start = Clock::now();
+    std::expected<void, TransferErr> written;
+    if (netascii) {
+      decoded.clear();
+      decoder.Decode(data->data.data(), data->data.size(), decoded);
+      written = out.Write(decoded.data(), decoded.size());
+    } else {
+      written = out.Write(data->data.data(), data->data.size());
+    }
+    stats.write_time.Record(Clock::now() - write_start);
+    if (!written) {
+      co_return std::unexpected(written.error());
+    }
+    stats.bytes += data->data.size();
+    stats.blocks++;
+
+    bool final_block = (data->data.size() < kDefaultBlockSize);
+    if (++unacked >= window || final_block) {
+      unacked = 0;
+      sent = co_await session.Send(PackAck({.block_num = data->block_num}));
+      if (!sent) {
+        co_return std::unexpected(sent.error());
+      }
+    }
+
+    if (final_block) {
+      break;
+    }
+    expected++;
+  }
+  stats.window = window;
+  stats.cwnd = window;
+
+  if (netascii) {
+    decoded.clear();
+    decoder.Flush(decoded);
+    if (auto written = out.Write(decoded.data(), decoded.size());
+        !written) {
+      co_return std::unexpected(written.error());
+    }
+  }
+  co_return out.Close();
+}
+
+struct WriteAccept {
+  uint16_t window = 1;
+  BlockSeq seq;
+};
+
+/* Waits for the server to accept a WRQ with the options it agreed to. */
+static Task<std::expected<WriteAccept, TransferErr>> AwaitWriteAccept(
+    const Config& conf, Session& session) {
+  for (;;) {
+    if (session.Expired()) {
+      co_return std::unexpected(Unresponsive("transfer timed out"));
+    }
+
+    auto packet = co_await session.Recv();
+    if (!packet) {
+      co_return std::unexpected(packet.error());
+    }
+    if (packet->empty()) {
+      if (auto resent = co_await session.Resend(); !resent) {
+        co_return std::unexpected(resent.error());
+      }
+      continue;
+    }
+
+    auto msg = codec::Decode(*packet);
+    if (!msg) {
+      continue;
+    }
+    if (auto* err = std::get_if<codec::ErrorView>(&*msg)) {
+      co_return std::unexpected(ServerError(*err));
+    }
+
+    if (auto* oack = std::get_if<codec::OptionAckView>(&*msg)) {
+      session.SampleRtt();
+      auto window = NegotiatedWindow(*oack, conf.windowsize);
+      if (!window) {
+        co_return std::unexpected(
+            co_await RejectOptions(session, window.error()));
+      }
+      auto rollover = NegotiatedRollover(*oack, conf);
+      if (!rollover) {
+        co_return std::unexpected(
+            co_await RejectOptions(session, rollover.error()));
+      }
+      co_return WriteAccept{.window = *window, .seq = *rollover};
+    }
+
+    auto* ack = std::get_if<codec::AckView>(&*msg);
+    if (ack && !ack->block_num) { /* The server ignored our options. */
+      session.SampleRtt();
+      co_return WriteAccept{};
+    }
+  }
+}
+
+Task<std::expected<void, TransferErr>> SendFile(Session& session,
+                                                std::string_view remote_file,
+                                                std::istream& in,
+                                                const PacketArena* packets) {
+  const Config& conf = session.Conf();
+  TransferStats& stats = session.Stats();
+
+  WriteRequestMsg wrq = {.filename = std::string(remote_file),
+                         .mode = conf.mode,
+                         .options = RequestOptions(conf)};
+  auto sent = co_await session.Send(PackWriteRequest(wrq));
+  if (!sent) {
+    co_return std::unexpected(sent.error());
+  }
+
+  auto accept = co_await AwaitWriteAccept(conf, session);
+  if (!accept) {
+    co_return std::unexpected(accept.error());
+  }
+  uint16_t window = accept->window;
+  stats.window = window;
+
+  /* Past the first wrap the block numbers depend on the rollover the
+     server settled on. */
+  if (packets && packets->Seq().Mode() != accept->seq.Mode() &&
+      packets->Blocks() >= 65535) {
+    packets = nullptr;
+  }
+
+  BlockReader reader(in, conf.mode == SendMode::kNetAscii);
+  CongestionController congestion(conf.congestion, window);
+  SendWindow inflight(accept->seq);
+  std::optional<uint64_t> probe;
+  bool read_all = false;
+  for (;;) {
+    bool filled = false;
+    while (inflight.InFlight() < congestion.Window()) {
+      if (inflight.Cursor() == inflight.Next()) {
+        if (read_all) {
+          break;
+        }
+        if (packets) {
+          codec::Bytes packet = packets->Packet(inflight.Next());
+          read_all = (inflight.Next() == packets->Blocks());
+          stats.bytes += packet.size() - kDataHeaderSize;
+          inflight.Push(packet);
+        } else {
+          BlockData data = reader.Next(kDefaultBlockSize);
+          read_all = (data.size() < kDefaultBlockSize);
+          stats.bytes += data.size();
+          inflight.Push(codec::Encode(codec::DataView{
+              .block_num = accept->seq.Wire(inflight.Next()), .data = data}));
+        }
+        stats.blocks++;
+      }
+
+      SendWindow::Entry& entry = inflight.At(inflight.Cursor());
+      sent = co_await session.Transmit(entry.wire, entry.transmissions > 0);
+      if (!sent) {
+        co_return std::unexpected(sent.error());
+      }
+      inflight.Advance(session.Now()); /* After pacing, RTTs leave it out. */
+      filled = true;
+    }
+    if (!inflight.Outstanding()) {
+      break; /* The final block was acknowledged. */
+    }
+
+    /* A receiver only ACKs once it has a full negotiated window, so when
+       congestion closes the window early, repeat the newest block. RFC 7440
+       receivers answer a block they already have with an ACK. */
+    bool sent_final = read_all && inflight.Cursor() == inflight.Next();
+    if (filled && !sent_final && congestion.Window() < window) {
+      probe = inflight.Cursor() - 1;
+      SendWindow::Entry& entry = inflight.At(*probe);
+      entry.transmissions++; /* Its ACK no longer gives a clean RTT. */
+      sent = co_await session.Transmit(entry.wire, false);
+      if (!sent) {
+        co_return std::unexpected(sent.error());
+      }
+    }
+
+    if (session.Expired()) {
+      co_return std::unexpected(Unresponsive("transfer timed out"));
+    }
+
+    /* A steady stream of duplicate ACKs keeps the socket from ever timing
+       out, so also time the oldest block in flight. */
+    bool stalled = inflight.InFlight() &&
+                   session.Now() - inflight.At(inflight.Base()).sent_at >
+                       std::chrono::milliseconds(session.RexmtMs());
+    if (stalled) {
+      stats.timeouts++;
+    }
+
+    std::expected<TftpPacket, TransferErr> packet = TftpPacket{};
+    if (!stalled) {
+      packet = co_await session.Recv();
+    }
+    if (!packet) {
+      co_return std::unexpected(packet.error());
+    }
+    if (packet->empty()) {
+      /* Go back N from the oldest unacknowledged block. */
+      congestion.OnTimeout(inflight.Next());
+      inflight.Rewind();
+      continue;
+    }
+
+    auto msg = codec::Decode(*packet);
+    if (!msg) {
+      continue;
+    }
+    if (auto* err = std::get_if<codec::ErrorView>(&*msg)) {
+      co_return std::unexpected(ServerError(*err));
+    }
+
+    auto* ack = std::get_if<codec::AckView>(&*msg);
+    if (!ack) {
+      continue;
+    }
+    auto block = inflight.Match(ack->block_num);
+    if (!block) {
+      continue;
+    }
+
+    if (*block < inflight.Base()) {
+      stats.duplicates++;
+      if (block == probe) {
+        probe.reset(); /* The probe and the window crossed paths. */
+        continue;
+      }
+      if (!inflight.Outstanding()) {
+        continue;
+      }
+      congestion.OnDupAck(*block, inflight.Next());
+
+      /* Repeated ACKs of the block before a gap mean the gap was lost, so
+         resend it now rather than wait out the timer. Lock-step transfers
+         never answer a duplicate ACK, see the Sorcerer's Apprentice bug. */
+      if (window > 1 && inflight.CountDupAck() == kDupAckThreshold) {
+        stats.fast_retransmits++;
+        inflight.Rewind();
+      }
+      continue;
+    }
+
+    auto rtt = inflight.Rtt(*block, session.Now());
+    if (rtt) {
+      stats.RecordRtt(*rtt);
+    }
+    congestion.OnAck(inflight.Ack(*block), rtt);
+  }
+  stats.cwnd = congestion.Window();
+  co_return {};
+}
+
+static Task<std::expected<void, TransferErr>> Receive(
+    EventLoop* loop, const Config& conf, std::string_view host, uint16_t port,
+    std::string_view remote_file, FileSink& out, TransferStats& stats) {
+  auto session = Session::Open(conf, host, port, stats, loop);
+  if (!session) {
+    co_return std::unexpected(session.error());
+  }
+  co_return co_await ReceiveFile(*session, remote_file, out);
+}
+
+static Task<std::expected<void, TransferErr>> Get(
+    EventLoop* loop, const Config& conf, std::string_view host, uint16_t port,
+    std::string_view remote_file, std::string_view local_file,
+    TransferStats& stats) {
+  /* What goes to stdout is out of our hands once written. */
+  if (local_file == kStdStream) {
+    auto out = OpenFileSink(std::string(local_file), conf.direct_io);
+    if (!out) {
+      co_return std::unexpected(out.error());
+    }
+    co_return co_await Receive(loop, conf, host, port, remote_file, **out,
+                               stats);
+  }
+
+  auto out =
+      AtomicSink::Open(std::string(local_file), conf.direct_io, conf.fsync);
+  if (!out) {
+    co_return std::unexpected(out.error());
+  }
+  auto received =
+      co_await Receive(loop, conf, host, port, remote_file, **out, stats);
+  if (!received) {
+    co_return received;
+  }
+  co_return (*out)->Publish();
+}
+
+static Task<std::expected<void, TransferErr>> Put(
+    EventLoop* loop, const Config& conf, std::string_view host, uint16_t port,
+    std::string_view local_file, std::string_view remote_file,
+    TransferStats& stats) {
+  /* Blocks from stdin end at its EOF like any file, the size is never
+     needed up front. */
+  std::ifstream file;
+  std::istream* in = &std::cin;
+  if (local_file != kStdStream) {
+    file.open(std::string(local_file), std::ios::binary);
+    if (!file) {
+      co_return std::unexpected("unable to open '" + std::string(local_file) +
+                                "'");
+    }
+    in = &file;
+  }
+
+  /* A file put before, or being put elsewhere, is already in packets. */
+  std::shared_ptr<const PacketArena> packets;
+  if (local_file != kStdStream && conf.packets) {
+    packets = conf.packets->Get(std::string(local_file), conf.mode,
+                                BlockSeq(conf.rollover.value_or(
+                                    Rollover::kToZero)));
+  }
+
+  auto session = Session::Open(conf, host, port, stats, loop);
+  if (!session) {
+    co_return std::unexpected(session.error());
+  }
+  co_return co_await SendFile(*session, remote_file, *in, packets.get());
+}
+
+std::expected<void, TransferErr> GetFile(const Config& conf,
+                                         std::string_view host, uint16_t port,
+                                         std::string_view remote_file,
+                                         std::string_view local_file,
+                                         TransferStats& stats) {
+  Clock::time_point start = Clock::now();
+  /* Get opens its own session off any loop, so it never suspends. */
+  auto result = SyncWait(
+      Get(nullptr, conf, host, port, remote_file, local_file, stats));
+  stats.Finish(std::chrono::duration_cast<Micros>(Clock::now() - start));
+  return result;
+}
+
+std::expected<void, TransferErr> PutFile(const Config& conf,
+                                         std::string_view host, uint16_t port,
+                                         std::string_view local_file,
+                                         std::string_view remote_file,
+                                         TransferStats& stats) {
+  Clock::time_point start = Clock::now();
+  auto result = SyncWait(
+      Put(nullptr, conf, host, port, local_file, remote_file, stats));
+  stats.Finish(std::chrono::duration_cast<Micros>(Clock::now() - start));
+  return result;
+}
+
+Task<std::expected<void, TransferErr>> AsyncGetFile(
+    EventLoop& loop, const Config& conf, std::string host, uint16_t port,
+    std::string remote_file, std::string local_file, TransferStats& stats) {
+  Clock::time_point start = Clock::now();
+  auto result =
+      co_await Get(&loop, conf, host, port, remote_file, local_file, stats);
+  stats.Finish(std::chrono::duration_cast<Micros>(Clock::now() - start));
+  co_return result;
+}
+
+Task<std::expected<void, TransferErr>> AsyncPutFile(
+    EventLoop& loop, const Config& conf, std::string host, uint16_t port,
+    std::string local_file, std::string remote_file, TransferStats& stats) {
+  Clock::time_point start = Clock::now();
+  auto result =
+      co_await Put(&loop, conf, host, port, local_file, remote_file, stats);
+  stats.Finish(std::chrono::duration_cast<Micros>(Clock::now() - start));
+  co_return result;
+}
+
+}  // namespace client
+}  // namespace tftp
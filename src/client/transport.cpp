@@ -0,0 +1,214 @@
+#include "client/transport.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <utility>
+
+#include "client/config.h"
+#include "client/stats.h"
+#include "client/transfer.h"
+#include "common/codec.h"
+#include "common/event_loop.h"
+#include "common/types.h"
+#include "common/udp_socket.h"
+
+namespace tftp {
+namespace client {
+
+/* Room for two full windows, so a burst can land while the previous one
+   is still being read. The defaults already hold small windows. */
+static SocketBuffers SizeBuffers(const Config& conf,
+                                 UdpSocketRecver& recver) {
+  SocketBuffers buffers;
+  buffers.wanted = 2 * conf.windowsize * (kDefaultBlockSize + kDataHeaderSize);
+  buffers.recv = recver.GrowRecvBuffer(buffers.wanted).value_or(0);
+  buffers.send = recver.GrowSendBuffer(buffers.wanted).value_or(0);
+
+  /* The stats carry the sizes per transfer, the hint is said only once. */
+  static std::atomic<bool> reported = false;
+  if (buffers.Clamped() && conf.verbose && !reported.exchange(true)) {
+    *conf.console << "socket buffers clamped to " << buffers.recv << "/"
+                  << buffers.send << " bytes (recv/send) of " << buffers.wanted
+                  << " wanted, raise net.core.rmem_max and net.core.wmem_max"
+                  << std::endl;
+  }
+  return buffers;
+}
+
+/* The first free port in the configured source port range, with room for
+   the window and busy polling if asked for. */
+static std::expected<UdpSocketRecver, TransferErr> BindSource(
+    const Config& conf, uint32_t timeout_ms, SocketBuffers& buffers) {
+  std::expected<UdpSocketRecver, UdpSocketErr> recver =
+      std::unexpected("no source port available");
+  for (uint32_t p = conf.ports.start; p <= conf.ports.end; ++p) {
+    recver = UdpSocketRecver::Create(p, timeout_ms);
+    if (recver) {
+      break;
+    }
+  }
+  if (!recver) {
+    return std::unexpected(recver.error());
+  }
+  buffers = SizeBuffers(conf, *recver);
+  if (conf.busy_poll) {
+    if (auto set = recver->SetBusyPoll(conf.busy_poll); !set) {
+      return std::unexpected("unable to busy poll: " + set.error());
+    }
+  }
+  return std::move(*recver);
+}
+
+std::expected<std::unique_ptr<UdpTransport>, TransferErr> UdpTransport::Create(
+    const Config& conf, const SockAddr& server, uint32_t rexmt_ms) {
+  SocketBuffers buffers;
+  auto recver = BindSource(conf, rexmt_ms, buffers);
+  if (!recver) {
+    return std::unexpected(recver.error());
+  }
+
+  auto sender = UdpSocketSender::Create(server, *recver);
+  if (!sender) {
+    return std::unexpected(sender.error());
+  }
+  if (conf.rate) {
+    /* Let fq smooth the packets out as well where it's the qdisc. */
+    sender->SetMaxPacingRate(conf.rate);
+  }
+  auto transport = std::unique_ptr<UdpTransport>(
+      new UdpTransport(std::move(*recver), std::move(*sender), rexmt_ms));
+  transport->buffers_ = buffers;
+  return transport;
+}
+
+Task<> UdpTransport::Sleep(Micros duration) {
+  std::this_thread::sleep_for(duration);
+  co_return;
+}
+
+Task<std::expected<void, TransferErr>> UdpTransport::SendPacket(
+    codec::Bytes packet) {
+  auto sent = sender_.Send(packet.data(), packet.size());
+  if (!sent) {
+    co_return std::unexpected(sent.error());
+  }
+  co_return {};
+}
+
+/* Rare enough that a sender made for the one packet will do. */
+std::expected<void, TransferErr> UdpTransport::SendTo(codec::Bytes packet,
+                                                      const SockAddr& to) {
+  auto sender = UdpSocketSender::Create(to, recver_);
+  if (!sender) {
+    return std::unexpected(sender.error());
+  }
+  auto sent = sender->Send(packet.data(), packet.size());
+  if (!sent) {
+    return std::unexpected(sent.error());
+  }
+  return {};
+}
+
+Task<std::expected<TftpPacket, TransferErr>> UdpTransport::RecvPacket(
+    Micros timeout) {
+  auto timeout_ms = static_cast<uint32_t>(
+      std::chrono::ceil<std::chrono::milliseconds>(timeout).count());
+  if (timeout_ms != timeout_ms_) {
+    if (auto set = recver_.SetRecvTimeout(timeout_ms); !set) {
+      co_return std::unexpected(set.error());
+    }
+    timeout_ms_ = timeout_ms;
+  }
+
+  auto num_bytes = recver_.Recv(buffer_.data(), buffer_.size());
+  if (!num_bytes) {
+    co_return std::unexpected(num_bytes.error());
+  }
+  co_return TftpPacket(buffer_.cbegin(), buffer_.cbegin() + *num_bytes);
+}
+
+std::expected<void, TransferErr> UdpTransport::SetPeer(const SockAddr& peer) {
+  auto sender = UdpSocketSender::Create(peer, recver_);
+  if (!sender) {
+    return std::unexpected(sender.error());
+  }
+  sender_ = std::move(*sender);
+  return {};
+}
+
+std::expected<std::unique_ptr<AsyncTransport>, TransferErr>
+AsyncTransport::Create(EventLoop& loop, const Config& conf,
+                       const SockAddr& server) {
+  SocketBuffers buffers;
+  auto recver = BindSource(conf, 0, buffers);
+  if (!recver) {
+    return std::unexpected(recver.error());
+  }
+  if (conf.rate) {
+    /* The rate belongs to the socket, whichever sender sets it. */
+    if (auto pacer = UdpSocketSender::Create(server, *recver)) {
+      pacer->SetMaxPacingRate(conf.rate);
+    }
+  }
+
+  auto socket = AsyncSocket::Create(loop, std::move(*recver));
+  if (!socket) {
+    return std::unexpected(socket.error());
+  }
+  if (auto set = socket->SetPeer(server); !set) {
+    return std::unexpected(set.error());
+  }
+  auto transport = std::unique_ptr<AsyncTransport>(
+      new AsyncTransport(loop, std::move(*socket)));
+  transport->buffers_ = buffers;
+  return transport;
+}
+
+Task<> AsyncTransport::Sleep(Micros duration) {
+  co_await loop_->Sleep(duration);
+}
+
+Task<std::expected<void, TransferErr>> AsyncTransport::SendPacket(
+    codec::Bytes packet) {
+  auto sent = co_await socket_.SendPacket(packet);
+  if (!sent) {
+    co_return std::unexpected(sent.error());
+  }
+  co_return {};
+}
+
+std::expected<void, TransferErr> AsyncTransport::SendTo(codec::Bytes packet,
+                                                        const SockAddr& to) {
+  auto sent = socket_.SendPacketTo(packet, to);
+  if (!sent) {
+    return std::unexpected(sent.error());
+  }
+  return {};
+}
+
+Task<std::expected<TftpPacket, TransferErr>> AsyncTransport::RecvPacket(
+    Micros timeout) {
+  auto packet = co_await socket_.RecvPacket(timeout);
+  if (!packet) {
+    co_return std::unexpected(packet.error());
+  }
+  co_return std::move(*packet);
+}
+
+std::expected<void, TransferErr> AsyncTransport::SetPeer(
+    const SockAddr& peer) {
+  auto set = socket_.SetPeer(peer);
+  if (!set) {
+    return std::unexpected(set.error());
+  }
+  return {};
+}
+
+}  // namespace client
+}  // namespace tftp
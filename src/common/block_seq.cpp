@@ -0,0 +1,38 @@
+#include "common/block_seq.h"
+
+#include <cstdint>
+#include <optional>
+
+#include "common/types.h"
+
+namespace tftp {
+
+BlockNum BlockSeq::Wire(uint64_t index) const {
+  if (rollover_ == Rollover::kToZero || !index) {
+    return static_cast<BlockNum>(index);
+  }
+  return static_cast<BlockNum>((index - 1) % Period() + 1);
+}
+
+std::optional<uint64_t> BlockSeq::After(BlockNum block_num,
+                                        uint64_t from) const {
+  if (rollover_ == Rollover::kToZero) {
+    return from + static_cast<BlockNum>(block_num - Wire(from));
+  }
+
+  /* Numbers cycle through 1..65535, so 0 can only be index 0. */
+  if (!block_num) {
+    return (from) ? std::nullopt : std::optional<uint64_t>(0);
+  }
+  uint64_t start = (from) ? from : 1;
+  uint64_t ahead = (block_num + Period() - Wire(start)) % Period();
+  return start + ahead;
+}
+
+std::optional<uint64_t> BlockSeq::Nearest(BlockNum block_num,
+                                          uint64_t near) const {
+  uint64_t half = Period() / 2;
+  return After(block_num, (near > half) ? near - half : 0);
+}
+
+}  // namespace tftp
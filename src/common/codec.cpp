@@ -0,0 +1,108 @@
+#include "common/codec.h"
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <utility>
+#include <variant>
+
+#include "common/types.h"
+
+namespace tftp {
+namespace codec {
+
+static bool IsValidMode(std::string_view candidate) {
+  return ((candidate == SendMode::kNetAscii) ||
+          (candidate == SendMode::kOctet) || (candidate == SendMode::kMail));
+}
+
+bool Validate(const ReadRequestView& view) { return IsValidMode(view.mode); }
+
+bool Validate(const WriteRequestView& view) { return IsValidMode(view.mode); }
+
+/* Option names are case insensitive (RFC 2347), store them lowercase. */
+Options OptionsView::ToOptions() const {
+  Options options;
+  std::size_t offset = 0;
+  while (offset < raw_.size()) {
+    std::string_view name;
+    std::string_view value;
+    offset += *FieldCodec<std::string_view>::Decode(raw_.subspan(offset), name);
+    offset +=
+        *FieldCodec<std::string_view>::Decode(raw_.subspan(offset), value);
+
+    std::string lower(name);
+    std::transform(lower.cbegin(), lower.cend(), lower.begin(),
+                   [](unsigned char c) { return std::tolower(c); });
+    options[lower] = value;
+  }
+  return options;
+}
+
+using Decoder = std::optional<Message> (*)(Bytes);
+
+template <typename L>
+static std::optional<Message> DecodeBody(Bytes body) {
+  auto view = L::DecodeBody(body);
+  if (!view) {
+    return std::nullopt;
+  }
+  return Message(std::move(*view));
+}
+
+/* One slot per opcode so that dispatch is a single indexed load. */
+template <typename... Ls>
+static constexpr auto MakeDecoders(std::tuple<Ls...>*) {
+  std::array<Decoder, std::max({Ls::kOp...}) + 1> decoders = {};
+  ((decoders[Ls::kOp] = &DecodeBody<Ls>), ...);
+  return decoders;
+}
+
+static constexpr auto kDecoders = MakeDecoders(static_cast<Layouts*>(nullptr));
+
+std::optional<Message> Decode(Bytes packet) {
+  uint16_t opcode = 0;
+  if (!FieldCodec<uint16_t>::Decode(packet, opcode) ||
+      opcode >= kDecoders.size() || !kDecoders[opcode]) {
+    return std::nullopt;
+  }
+  return kDecoders[opcode](packet.subspan(sizeof(opcode)));
+}
+
+std::string Describe(Bytes packet) {
+  std::ostringstream os;
+  auto msg = Decode(packet);
+  if (!msg) {
+    os << "??? <" << packet.size() << " bytes>";
+  } else if (auto* rrq = std::get_if<ReadRequestView>(&*msg)) {
+    os << "RRQ <file=" << rrq->filename << ", mode=" << rrq->mode << ">";
+  } else if (auto* wrq = std::get_if<WriteRequestView>(&*msg)) {
+    os << "WRQ <file=" << wrq->filename << ", mode=" << wrq->mode << ">";
+  } else if (auto* data = std::get_if<DataView>(&*msg)) {
+    os << "DATA <block=" << data->block_num << ", " << data->data.size()
+       << " bytes>";
+  } else if (auto* ack = std::get_if<AckView>(&*msg)) {
+    os << "ACK <block=" << ack->block_num << ">";
+  } else if (auto* err = std::get_if<ErrorView>(&*msg)) {
+    os << "ERROR <code=" << err->err_code << ", msg=" << err->err_msg << ">";
+  } else if (auto* oack = std::get_if<OptionAckView>(&*msg)) {
+    const char* seperator = "";
+    os << "OACK <";
+    for (const auto& [name, value] : oack->options.ToOptions()) {
+      os << seperator << name << "=" << value;
+      seperator = ", ";
+    }
+    os << ">";
+  }
+  return os.str();
+}
+
+}  // namespace codec
+}  // namespace tftp
@@ -0,0 +1,284 @@
+#include "common/event_loop.h"
+
+#include <sys/epoll.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <expected>
+#include <memory>
+#include <new>
+#include <utility>
+
+#include "common/types.h"
+#include "common/udp_socket.h"
+
+namespace tftp {
+
+static constexpr std::size_t kMaxEvents = 256;
+static constexpr std::size_t kMaxPacketSize = 65536;
+
+FramePool& FramePool::Local() {
+  static thread_local FramePool pool;
+  return pool;
+}
+
+FramePool::~FramePool() {
+  for (Node* node : free_) {
+    while (node) {
+      ::operator delete(std::exchange(node, node->next));
+    }
+  }
+}
+
+void* FramePool::Allocate(std::size_t size) {
+  std::size_t cls = (size + kQuantum - 1) / kQuantum - 1;
+  if (cls >= kClasses) {
+    return ::operator new(size);
+  }
+  if (Node* node = free_[cls]) {
+    free_[cls] = node->next;
+    reused_++;
+    return node;
+  }
+  fresh_++;
+  return ::operator new((cls + 1) * kQuantum);
+}
+
+void FramePool::Free(void* frame, std::size_t size) {
+  std::size_t cls = (size + kQuantum - 1) / kQuantum - 1;
+  if (cls >= kClasses) {
+    ::operator delete(frame);
+    return;
+  }
+  free_[cls] = new (frame) Node{.next = free_[cls]};
+}
+
+/* Owns a spawned task, its frame frees itself once the task is done. */
+struct Detached {
+  struct promise_type : detail::PooledFrame {
+    Detached get_return_object() {
+      return {std::coroutine_handle<promise_type>::from_promise(*this)};
+    }
+    std::suspend_always initial_suspend() noexcept { return {}; }
+    std::suspend_never final_suspend() noexcept { return {}; }
+    void return_void() {}
+    void unhandled_exception() { std::terminate(); }
+  };
+
+  std::coroutine_handle<promise_type> handle;
+};
+
+static Detached Drive(std::size_t& active, Task<> task) {
+  co_await task;
+  active--;
+}
+
+std::expected<std::unique_ptr<EventLoop>, EventLoopErr> EventLoop::Create() {
+  int epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+  if (-1 == epoll_fd) {
+    return std::unexpected(std::strerror(errno));
+  }
+  return std::unique_ptr<EventLoop>(new EventLoop(epoll_fd));
+}
+
+EventLoop::EventLoop(int epoll_fd)
+    : epoll_fd_(epoll_fd), buffer_(kMaxPacketSize) {}
+
+EventLoop::~EventLoop() { close(epoll_fd_); }
+
+void EventLoop::Spawn(Task<> task) {
+  active_++;
+  ready_.push_back(Drive(active_, std::move(task)).handle);
+}
+
+void EventLoop::Run() {
+  std::array<epoll_event, kMaxEvents> events = {};
+  while (active_) {
+    while (!ready_.empty()) {
+      std::coroutine_handle<> handle = ready_.front();
+      ready_.pop_front();
+      handle.resume();
+    }
+    if (!active_) {
+      break;
+    }
+
+    Clock::time_point now = Clock::now();
+    FireTimers(now);
+    if (!ready_.empty()) {
+      continue;
+    }
+
+    int num_events =
+        epoll_wait(epoll_fd_, events.data(), events.size(), WaitMs(now));
+    for (int i = 0; i < num_events; ++i) {
+      if (auto* waiter = static_cast<Waiter*>(events[i].data.ptr)) {
+        Wake(*waiter, false);
+      }
+    }
+  }
+}
+
+bool EventLoop::Arm(Waiter& waiter, uint32_t events,
+                    Clock::time_point deadline) {
+  waiter.timed_out = false;
+  if (waiter.fd != -1) {
+    /* One shot, so a waiter that timed out is never woken by a late
+       packet after its frame has moved on. */
+    epoll_event event = {.events = events | EPOLLONESHOT,
+                         .data = {.ptr = &waiter}};
+    if (epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, waiter.fd, &event) == -1 &&
+        (errno != ENOENT ||
+         epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, waiter.fd, &event) == -1)) {
+      waiter.timed_out = true;
+      return false;
+    }
+  }
+
+  if (deadline != Clock::time_point::max()) {
+    if (free_slots_.empty()) {
+      free_slots_.push_back(slots_.size());
+      slots_.emplace_back();
+    }
+    waiter.slot = free_slots_.back();
+    free_slots_.pop_back();
+    slots_[waiter.slot].waiter = &waiter;
+    timers_.push({.deadline = deadline,
+                  .slot = waiter.slot,
+                  .gen = slots_[waiter.slot].gen});
+  }
+  return true;
+}
+
+void EventLoop::Wake(Waiter& waiter, bool timed_out) {
+  ReleaseSlot(waiter);
+  if (timed_out && waiter.fd != -1) {
+    /* Errors are reported even when disarmed, so forget the waiter too. */
+    epoll_event event = {.events = 0, .data = {.ptr = nullptr}};
+    epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, waiter.fd, &event);
+  }
+  waiter.timed_out = timed_out;
+  ready_.push_back(waiter.handle);
+}
+
+void EventLoop::ReleaseSlot(Waiter& waiter) {
+  if (waiter.slot == kNoSlot) {
+    return;
+  }
+  Slot& slot = slots_[waiter.slot];
+  slot.waiter = nullptr;
+  slot.gen++;
+  free_slots_.push_back(waiter.slot);
+  waiter.slot = kNoSlot;
+}
+
+void EventLoop::FireTimers(Clock::time_point now) {
+  while (!timers_.empty() && timers_.top().deadline <= now) {
+    Timer timer = timers_.top();
+    timers_.pop();
+    if (slots_[timer.slot].gen == timer.gen) {
+      Wake(*slots_[timer.slot].waiter, true);
+    }
+  }
+}
+
+int EventLoop::WaitMs(Clock::time_point now) const {
+  /* The earliest timer may be stale, waking early only costs a loop. */
+  if (timers_.empty()) {
+    return -1;
+  }
+  auto wait = std::chrono::ceil<std::chrono::milliseconds>(
+      timers_.top().deadline - now);
+  return std::max<int64_t>(wait.count(), 0);
+}
+
+std::expected<AsyncSocket, UdpSocketErr> AsyncSocket::Create(EventLoop& loop,
+                                                             uint16_t port) {
+  auto recver = UdpSocketRecver::Create(port);
+  if (!recver) {
+    return std::unexpected(recver.error());
+  }
+  return Create(loop, std::move(*recver));
+}
+
+std::expected<AsyncSocket, UdpSocketErr> AsyncSocket::Create(
+    EventLoop& loop, UdpSocketRecver recver) {
+  if (auto set = recver.SetNonBlocking(); !set) {
+    return std::unexpected(set.error());
+  }
+  return AsyncSocket(loop, std::move(recver));
+}
+
+std::expected<std::string, UdpSocketErr> AsyncSocket::LocalAddr() const {
+  if (!sender_) {
+    return std::unexpected("no peer to route to");
+  }
+  return sender_->RouteSourceAddr();
+}
+
+std::expected<void, UdpSocketErr> AsyncSocket::SetPeer(const SockAddr& peer) {
+  auto sender = UdpSocketSender::Create(peer, recver_);
+  if (!sender) {
+    return std::unexpected(sender.error());
+  }
+  sender_ = std::move(*sender);
+  peer_ = peer;
+  return {};
+}
+
+Task<std::expected<TftpPacket, UdpSocketErr>> AsyncSocket::RecvPacket(
+    std::chrono::microseconds timeout) {
+  EventLoop::Clock::time_point deadline = EventLoop::Clock::now() + timeout;
+  std::vector<uint8_t>& buffer = loop_->Buffer();
+  for (;;) {
+    auto num_bytes = recver_.Recv(buffer.data(), buffer.size());
+    if (!num_bytes) {
+      co_return std::unexpected(num_bytes.error());
+    }
+    if (*num_bytes > 0) {
+      co_return TftpPacket(buffer.cbegin(), buffer.cbegin() + *num_bytes);
+    }
+    if (!co_await loop_->Readable(Fd(), deadline)) {
+      co_return TftpPacket{};
+    }
+  }
+}
+
+Task<std::expected<void, UdpSocketErr>> AsyncSocket::SendPacket(
+    codec::Bytes packet) {
+  if (!sender_) {
+    co_return std::unexpected("no peer to send to");
+  }
+  for (;;) {
+    auto sent = sender_->Send(packet.data(), packet.size());
+    if (!sent) {
+      co_return std::unexpected(sent.error());
+    }
+    if (*sent > 0) {
+      co_return std::expected<void, UdpSocketErr>{};
+    }
+    co_await loop_->Writable(Fd(), EventLoop::Clock::time_point::max());
+  }
+}
+
+std::expected<void, UdpSocketErr> AsyncSocket::SendPacketTo(
+    codec::Bytes packet, const SockAddr& to) {
+  auto sender = UdpSocketSender::Create(to, recver_);
+  if (!sender) {
+    return std::unexpected(sender.error());
+  }
+  auto sent = sender->Send(packet.data(), packet.size());
+  if (!sent) {
+    return std::unexpected(sent.error());
+  }
+  return {};
+}
+
+}  // namespace tftp
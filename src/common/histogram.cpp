@@ -0,0 +1,73 @@
+#include "common/histogram.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+namespace tftp {
+
+/* Values below 32 have a bucket each. Above that, a value's top six bits
+   pick its bucket within its power of two. */
+std::size_t Histogram::Index(uint64_t value) {
+  if (value < kSubBuckets) {
+    return value;
+  }
+  int width = std::bit_width(value);
+  int shift = width - 1 - kSubBucketBits;
+  uint64_t mantissa = value >> shift;
+  return (shift + 1) * kSubBuckets + (mantissa - kSubBuckets);
+}
+
+uint64_t Histogram::Highest(std::size_t index) {
+  std::size_t group = index >> kSubBucketBits;
+  uint64_t sub = index & (kSubBuckets - 1);
+  if (!group) {
+    return sub;
+  }
+  uint64_t lowest = (kSubBuckets + sub) << (group - 1);
+  return lowest + (uint64_t{1} << (group - 1)) - 1;
+}
+
+void Histogram::Record(Nanos value) {
+  constexpr uint64_t kLimit = (uint64_t{1} << kMaxBits) - 1;
+  uint64_t ns = std::min<uint64_t>(std::max<Nanos::rep>(value.count(), 0),
+                                   kLimit);
+  counts_[Index(ns)]++;
+  count_++;
+  sum_ += ns;
+  max_ = std::max(max_, ns);
+}
+
+void Histogram::Merge(const Histogram& other) {
+  if (!other.count_) {
+    return;
+  }
+  /* Nothing in other sits past the bucket of its largest sample. */
+  for (std::size_t i = 0; i <= Index(other.max_); ++i) {
+    counts_[i] += other.counts_[i];
+  }
+  count_ += other.count_;
+  sum_ += other.sum_;
+  max_ = std::max(max_, other.max_);
+}
+
+Histogram::Nanos Histogram::Percentile(double p) const {
+  if (!count_) {
+    return Nanos::zero();
+  }
+  auto rank = static_cast<uint64_t>(std::ceil(p / 100 * count_));
+  rank = std::clamp<uint64_t>(rank, 1, count_);
+
+  uint64_t seen = 0;
+  for (std::size_t i = 0; i < kBuckets; ++i) {
+    seen += counts_[i];
+    if (seen >= rank) {
+      return Nanos(std::min(Highest(i), max_));
+    }
+  }
+  return Nanos(max_);
+}
+
+}  // namespace tftp
@@ -0,0 +1,58 @@
+#include "common/netascii.h"
+
+#include <cstddef>
+#include <cstdint>
+
+#include "common/types.h"
+
+namespace tftp {
+
+static constexpr uint8_t kCr = '\r';
+static constexpr uint8_t kLf = '\n';
+static constexpr uint8_t kNul = '\0';
+
+void NetasciiEncode(const uint8_t* data, std::size_t len, BlockData& out) {
+  for (std::size_t i = 0; i < len; ++i) {
+    if (data[i] == kLf) { /* LF goes out as CR LF. */
+      out.push_back(kCr);
+      out.push_back(kLf);
+    } else if (data[i] == kCr) { /* A bare CR goes out as CR NUL. */
+      out.push_back(kCr);
+      out.push_back(kNul);
+    } else {
+      out.push_back(data[i]);
+    }
+  }
+}
+
+void NetasciiDecoder::Decode(const uint8_t* data, std::size_t len,
+                             BlockData& out) {
+  for (std::size_t i = 0; i < len; ++i) {
+    if (pending_cr_) {
+      pending_cr_ = false;
+      if (data[i] == kLf) {
+        out.push_back(kLf);
+        continue;
+      }
+      out.push_back(kCr);
+      if (data[i] == kNul) {
+        continue;
+      }
+    }
+
+    if (data[i] == kCr) { /* The CR's meaning depends on the next byte. */
+      pending_cr_ = true;
+    } else {
+      out.push_back(data[i]);
+    }
+  }
+}
+
+void NetasciiDecoder::Flush(BlockData& out) {
+  if (pending_cr_) {
+    out.push_back(kCr);
+    pending_cr_ = false;
+  }
+}
+
+}  // namespace tftp
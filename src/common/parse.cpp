@@ -78,4 +78,95 @@ std::expected<Seconds, ParseStatus> ParseTimeValue(std::string_view num_str) {
   return timeout_tmp;
 }
 
+std::expected<uint16_t, ParseStatus> ParseWindowSize(std::string_view val) {
+  if (val.empty() || val.size() > 5 || !IsPositiveNum(val)) {
+    return std::unexpected(ParseStatus::kWindowSizeOutOfRange);
+  }
+
+  uint64_t window_tmp = std::stoull(std::string(val));
+  if (!window_tmp || window_tmp > std::numeric_limits<uint16_t>::max()) {
+    return std::unexpected(ParseStatus::kWindowSizeOutOfRange);
+  }
+
+  return static_cast<uint16_t>(window_tmp);
+}
+
+std::expected<uint64_t, ParseStatus> ParseRate(std::string_view val) {
+  if (val == "off") {
+    return 0;
+  }
+
+  /* An optional k, m or g suffix scales by powers of 1000, like tc(8). */
+  uint64_t scale = 1;
+  if (!val.empty()) {
+    switch (std::tolower(static_cast<unsigned char>(val.back()))) {
+      case 'k':
+        scale = 1000;
+        break;
+      case 'm':
+        scale = 1000 * 1000;
+        break;
+      case 'g':
+        scale = 1000 * 1000 * 1000;
+        break;
+    }
+  }
+  if (scale > 1) {
+    val.remove_suffix(1);
+  }
+
+  /* Twelve digits keeps the product well clear of overflow. */
+  if (val.empty() || val.size() > 12 || !IsPositiveNum(val)) {
+    return std::unexpected(ParseStatus::kInvalidRate);
+  }
+  return std::stoull(std::string(val)) * scale;
+}
+
+std::expected<Rollover, ParseStatus> ParseRollover(std::string_view val) {
+  if (val == "0") {
+    return Rollover::kToZero;
+  } else if (val == "1") {
+    return Rollover::kToOne;
+  }
+  return std::unexpected(ParseStatus::kInvalidRollover);
+}
+
+std::expected<FsyncPolicy, ParseStatus> ParseFsyncPolicy(std::string_view val) {
+  if (val == "never") {
+    return FsyncPolicy::kNever;
+  } else if (val == "file") {
+    return FsyncPolicy::kFile;
+  } else if (val == "dir") {
+    return FsyncPolicy::kDirectory;
+  }
+  return std::unexpected(ParseStatus::kUnknownFsyncPolicy);
+}
+
+std::string_view FsyncPolicyName(FsyncPolicy policy) {
+  switch (policy) {
+    case FsyncPolicy::kNever:
+      return "never";
+    case FsyncPolicy::kFile:
+      return "file";
+    case FsyncPolicy::kDirectory:
+      return "dir";
+  }
+  return "unknown";
+}
+
+std::expected<uint32_t, ParseStatus> ParseBusyPoll(std::string_view val) {
+  if (val == "off") {
+    return 0;
+  }
+  if (val.empty() || val.size() > 7 || !IsPositiveNum(val)) {
+    return std::unexpected(ParseStatus::kBusyPollOutOfRange);
+  }
+
+  uint64_t usecs = std::stoull(std::string(val));
+  if (!usecs || usecs > 1000000) {
+    return std::unexpected(ParseStatus::kBusyPollOutOfRange);
+  }
+  return static_cast<uint32_t>(usecs);
+}
+
 }  // namespace tftp
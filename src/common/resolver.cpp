@@ -0,0 +1,70 @@
+#include "common/resolver.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <future>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include "common/udp_socket.h"
+
+namespace tftp {
+
+std::expected<SockAddr, UdpSocketErr> ResolverCache::Resolve(
+    std::string_view host, uint16_t port) {
+  std::string key(host);
+  Clock::time_point now = Clock::now();
+
+  std::shared_future<Result> pending;
+  std::promise<Result> promise;
+  uint64_t lookup = 0;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = entries_.find(key);
+    if (it != entries_.end() && it->second.expires > now) {
+      pending = it->second.addr;
+    } else {
+      pending = promise.get_future().share();
+      lookup = ++lookups_;
+      entries_.insert_or_assign(key, Entry{.addr = pending,
+                                           .expires = Clock::time_point::max(),
+                                           .lookup = lookup});
+    }
+  }
+
+  /* Don't hold the lock across the lookup, it may block for seconds. */
+  if (lookup) {
+    Result addr = lookup_(host);
+    auto ttl = (addr) ? ttl_ : negative_ttl_;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      auto it = entries_.find(key);
+      if (it != entries_.end() && it->second.lookup == lookup) {
+        /* From when the answer came, a slow lookup keeps its whole TTL. */
+        it->second.expires = Clock::now() + ttl;
+      }
+    }
+    promise.set_value(std::move(addr));
+  }
+
+  Result addr = pending.get();
+  if (addr) {
+    addr->SetPort(port);
+  }
+  return addr;
+}
+
+void ResolverCache::Clear() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  entries_.clear();
+}
+
+std::size_t ResolverCache::Size() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return entries_.size();
+}
+
+}  // namespace tftp
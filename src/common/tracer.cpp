@@ -0,0 +1,273 @@
+#include "common/tracer.h"
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <expected>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "common/codec.h"
+#include "common/types.h"
+#include "common/udp_socket.h"
+
+namespace tftp {
+
+static std::atomic<uint64_t> next_tracer_id = 1;
+
+std::expected<std::unique_ptr<Tracer>, TracerErr> Tracer::Create(
+    const std::string& path) {
+  int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (-1 == fd) {
+    return std::unexpected("unable to open trace file '" + path +
+                           "': " + std::strerror(errno));
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  TraceHeader header = {
+      .start_unix_ns = static_cast<uint64_t>(
+          std::chrono::duration_cast<std::chrono::nanoseconds>(
+              std::chrono::system_clock::now().time_since_epoch())
+              .count())};
+  if (write(fd, &header, sizeof(header)) != sizeof(header)) {
+    close(fd);
+    return std::unexpected("unable to write trace file '" + path + "'");
+  }
+  return std::unique_ptr<Tracer>(new Tracer(fd, start));
+}
+
+Tracer::Tracer(int fd, std::chrono::steady_clock::time_point start)
+    : id_(next_tracer_id++), fd_(fd), start_(start) {
+  flusher_ = std::jthread([this](std::stop_token stop) { Loop(stop); });
+}
+
+Tracer::~Tracer() {
+  flusher_.request_stop();
+  flusher_.join();
+  std::lock_guard lock(mutex_);
+  Drain();
+  close(fd_);
+}
+
+void Tracer::Record(TraceEvent event, uint16_t local_port,
+                    const SockAddr& peer, codec::Bytes packet) {
+  TraceRecord record = {
+      .time_ns = static_cast<uint64_t>(
+          std::chrono::duration_cast<std::chrono::nanoseconds>(
+              std::chrono::steady_clock::now() - start_)
+              .count()),
+      .local_port = local_port,
+      .peer_port = peer.Port(),
+      .length = static_cast<uint16_t>(
+          std::min<std::size_t>(packet.size(), UINT16_MAX)),
+      .event = event};
+
+  /* Reads the header fields in place, a full decode costs too much here. */
+  if (packet.size() >= 2) {
+    record.opcode = packet[1];
+  }
+  if (packet.size() >= 4 && (record.opcode == OpCode::kData ||
+                             record.opcode == OpCode::kAck)) {
+    record.block = static_cast<uint16_t>((packet[2] << 8) | packet[3]);
+  }
+
+  if (peer.Family() == AF_INET6) {
+    std::memcpy(
+        record.peer.data(),
+        &reinterpret_cast<const sockaddr_in6*>(&peer.storage)->sin6_addr,
+        record.peer.size());
+  } else if (peer.Family() == AF_INET) {
+    record.peer[10] = 0xff;
+    record.peer[11] = 0xff;
+    std::memcpy(&record.peer[12],
+                &reinterpret_cast<const sockaddr_in*>(&peer.storage)->sin_addr,
+                4);
+  }
+
+  Ring& ring = LocalRing();
+  uint64_t head = ring.head.load(std::memory_order_relaxed);
+  if (head - ring.tail.load(std::memory_order_acquire) == kRingSize) {
+    dropped_.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+  ring.records[head % kRingSize] = record;
+  ring.head.store(head + 1, std::memory_order_release);
+}
+
+Tracer::Ring& Tracer::LocalRing() {
+  /* There's one tracer per process in practice, a thread that records
+     into another one just takes a new ring there. */
+  static thread_local uint64_t owner = 0;
+  static thread_local Ring* ring = nullptr;
+  if (owner != id_) {
+    std::lock_guard lock(mutex_);
+    rings_.push_back(std::make_unique<Ring>());
+    ring = rings_.back().get();
+    owner = id_;
+  }
+  return *ring;
+}
+
+void Tracer::Loop(std::stop_token stop) {
+  std::unique_lock lock(mutex_);
+  while (!stop.stop_requested()) {
+    cv_.wait_for(lock, stop, kFlushInterval, [] { return false; });
+    Drain();
+  }
+}
+
+void Tracer::Drain() {
+  for (auto& ring : rings_) {
+    uint64_t tail = ring->tail.load(std::memory_order_relaxed);
+    uint64_t head = ring->head.load(std::memory_order_acquire);
+    for (uint64_t i = tail; i < head; ++i) {
+      batch_.push_back(ring->records[i % kRingSize]);
+    }
+    ring->tail.store(head, std::memory_order_release);
+  }
+
+  const auto* data = reinterpret_cast<const char*>(batch_.data());
+  std::size_t len = batch_.size() * sizeof(TraceRecord);
+  while (len) {
+    ssize_t n = write(fd_, data, len);
+    if (-1 == n && EINTR == errno) {
+      continue;
+    }
+    if (n <= 0) { /* What didn't make it to the file is lost. */
+      dropped_ += len / sizeof(TraceRecord);
+      break;
+    }
+    data += n;
+    len -= n;
+  }
+  batch_.clear();
+}
+
+std::expected<Trace, TracerErr> ReadTrace(const std::string& path) {
+  std::ifstream in(path, std::ios::binary);
+  if (!in) {
+    return std::unexpected("unable to open '" + path + "'");
+  }
+
+  TraceHeader header;
+  TraceHeader expected;
+  in.read(reinterpret_cast<char*>(&header), sizeof(header));
+  if (!in || header.magic != expected.magic) {
+    return std::unexpected("'" + path + "' is not a trace file");
+  }
+
+  /* A trailing partial record means the tracer died mid-write, skip it. */
+  Trace trace = {.start_unix_ns = header.start_unix_ns, .records = {}};
+  TraceRecord record;
+  while (in.read(reinterpret_cast<char*>(&record), sizeof(record))) {
+    trace.records.push_back(record);
+  }
+  std::ranges::stable_sort(trace.records, {}, &TraceRecord::time_ns);
+  return trace;
+}
+
+std::vector<TraceTimeline> BuildTimelines(const Trace& trace,
+                                          uint64_t gap_ns) {
+  struct Sent {
+    uint64_t time_ns = 0;
+    bool resent = false;
+  };
+  struct State {
+    std::size_t index = 0;
+    std::unordered_map<uint16_t, Sent> data; /* DATA sent by block. */
+    std::optional<Sent> other;               /* Any other packet sent. */
+  };
+
+  std::vector<TraceTimeline> timelines;
+  std::unordered_map<uint16_t, State> open;
+  for (const TraceRecord& record : trace.records) {
+    /* A request starts a new transfer even on a port used before. */
+    bool request = record.event == TraceEvent::kSend &&
+                   (record.opcode == OpCode::kReadReq ||
+                    record.opcode == OpCode::kWriteReq);
+    auto it = open.find(record.local_port);
+    if (it == open.end() || request) {
+      timelines.emplace_back().local_port = record.local_port;
+      it = open.insert_or_assign(record.local_port, State()).first;
+      it->second.index = timelines.size() - 1;
+    }
+    State& state = it->second;
+    TraceTimeline& timeline = timelines[state.index];
+
+    if (!timeline.events.empty()) {
+      uint64_t prev = timeline.events.back().time_ns;
+      if (record.time_ns - prev >= gap_ns) {
+        timeline.gaps.push_back(
+            {.after_ns = prev, .length_ns = record.time_ns - prev});
+      }
+    }
+    timeline.events.push_back(record);
+
+    switch (record.event) {
+      case TraceEvent::kSend:
+      case TraceEvent::kResend: {
+        bool resent = (record.event == TraceEvent::kResend);
+        (resent ? timeline.resent : timeline.sent)++;
+        Sent sent = {.time_ns = record.time_ns, .resent = resent};
+        if (record.opcode == OpCode::kData) {
+          auto [at, added] = state.data.try_emplace(record.block, sent);
+          at->second.resent |= resent || !added;
+          at->second.time_ns = record.time_ns;
+        } else {
+          state.other = sent;
+        }
+        break;
+      }
+      case TraceEvent::kRecv: {
+        timeline.received++;
+        std::optional<Sent> sent;
+        if (auto at = state.data.find(record.block);
+            record.opcode == OpCode::kAck && at != state.data.end()) {
+          sent = at->second;
+          state.data.erase(at);
+        } else if (state.other) {
+          sent = std::exchange(state.other, std::nullopt);
+        }
+        if (sent && !sent->resent) {
+          timeline.rtts_ns.push_back(record.time_ns - sent->time_ns);
+        }
+        break;
+      }
+      case TraceEvent::kTimeout:
+        timeline.timeouts++;
+        break;
+    }
+  }
+  return timelines;
+}
+
+std::string TracePeer(const TraceRecord& record) {
+  static constexpr std::array<uint8_t, 12> kMapped = {0, 0, 0, 0, 0,    0,
+                                                      0, 0, 0, 0, 0xff, 0xff};
+  char addr[INET6_ADDRSTRLEN] = {};
+  std::string port = std::to_string(record.peer_port);
+  if (std::equal(kMapped.cbegin(), kMapped.cend(), record.peer.cbegin())) {
+    inet_ntop(AF_INET, &record.peer[12], addr, sizeof(addr));
+    return std::string(addr) + ":" + port;
+  }
+  inet_ntop(AF_INET6, record.peer.data(), addr, sizeof(addr));
+  return "[" + std::string(addr) + "]:" + port;
+}
+
+}  // namespace tftp
@@ -2,6 +2,7 @@
 
 #include <arpa/inet.h>
 #include <asm-generic/socket.h>
+#include <fcntl.h>
 #include <netdb.h>
 #include <netinet/in.h>
 #include <sys/socket.h>
@@ -17,6 +18,82 @@
 
 namespace tftp {
 
+static uint16_t SenderPort(const sockaddr_storage& sender_addr) {
+  if (sender_addr.ss_family == AF_INET6) {
+    return ntohs(
+        reinterpret_cast<const sockaddr_in6*>(&sender_addr)->sin6_port);
+  } else if (sender_addr.ss_family == AF_INET) {
+    return ntohs(reinterpret_cast<const sockaddr_in*>(&sender_addr)->sin_port);
+  }
+  return 0;
+}
+
+uint16_t SockAddr::Port() const {
+  return SenderPort(storage);
+}
+
+void SockAddr::SetPort(uint16_t port) {
+  if (storage.ss_family == AF_INET6) {
+    reinterpret_cast<sockaddr_in6*>(&storage)->sin6_port = htons(port);
+  } else if (storage.ss_family == AF_INET) {
+    reinterpret_cast<sockaddr_in*>(&storage)->sin_port = htons(port);
+  }
+}
+
+std::string SockAddr::Ip() const {
+  char addr_str[INET6_ADDRSTRLEN] = {};
+  if (storage.ss_family == AF_INET6) {
+    inet_ntop(AF_INET6,
+              &reinterpret_cast<const sockaddr_in6*>(&storage)->sin6_addr,
+              addr_str, sizeof(addr_str));
+  } else if (storage.ss_family == AF_INET) {
+    inet_ntop(AF_INET,
+              &reinterpret_cast<const sockaddr_in*>(&storage)->sin_addr,
+              addr_str, sizeof(addr_str));
+  }
+  return addr_str;
+}
+
+bool SameAddr(const SockAddr& a, const SockAddr& b) {
+  if (a.Family() != b.Family() || a.Port() != b.Port()) {
+    return false;
+  }
+  if (a.Family() == AF_INET6) {
+    const auto* in_a = reinterpret_cast<const sockaddr_in6*>(&a.storage);
+    const auto* in_b = reinterpret_cast<const sockaddr_in6*>(&b.storage);
+    return 0 == std::memcmp(&in_a->sin6_addr, &in_b->sin6_addr,
+                            sizeof(in6_addr));
+  }
+  if (a.Family() == AF_INET) {
+    const auto* in_a = reinterpret_cast<const sockaddr_in*>(&a.storage);
+    const auto* in_b = reinterpret_cast<const sockaddr_in*>(&b.storage);
+    return in_a->sin_addr.s_addr == in_b->sin_addr.s_addr;
+  }
+  return false;
+}
+
+std::expected<SockAddr, UdpSocketErr> ResolveAddr(std::string_view host) {
+  struct addrinfo* servinfo = nullptr;
+  struct addrinfo hints = {};
+  hints.ai_family = AF_INET;
+  hints.ai_socktype = SOCK_DGRAM;
+
+  int retcode =
+      getaddrinfo(std::string(host).c_str(), nullptr, &hints, &servinfo);
+  if (retcode == EAI_SYSTEM) {
+    return std::unexpected(std::strerror(errno));
+  } else if (retcode) {
+    return std::unexpected(gai_strerror(retcode));
+  }
+
+  /* Take the first address, the same one socket() would have used. */
+  SockAddr addr;
+  std::memcpy(&addr.storage, servinfo->ai_addr, servinfo->ai_addrlen);
+  addr.len = servinfo->ai_addrlen;
+  freeaddrinfo(servinfo);
+  return addr;
+}
+
 UdpSocketRecver::~UdpSocketRecver() {
   if (-1 != socket_) {
     close(socket_);
@@ -24,7 +101,7 @@ UdpSocketRecver::~UdpSocketRecver() {
 
   socket_ = -1;
   port_ = 0;
-  last_sender_port_ = 0;
+  last_sender_ = {};
 }
 
 UdpSocketRecver::UdpSocketRecver(UdpSocketRecver&& other) : UdpSocketRecver() {
@@ -93,6 +170,17 @@ std::expected<UdpSocketRecver, UdpSocketErr> UdpSocketRecver::Create(
     }
   }
 
+  /* Port 0 asks the kernel for a free port, find out which one it gave. */
+  if (!port) {
+    SockAddr bound = {.len = sizeof(sockaddr_storage)};
+    if (getsockname(sockfd, reinterpret_cast<sockaddr*>(&bound.storage),
+                    &bound.len) == -1) {
+      close(sockfd);
+      return std::unexpected(std::strerror(errno));
+    }
+    port = bound.Port();
+  }
+
   return UdpSocketRecver(sockfd, port);
 }
 
@@ -111,42 +199,198 @@ std::expected<ssize_t, UdpSocketErr> UdpSocketRecver::Recv(void* buffer,
     }
   }
 
-  /* Save the port of the sender. */
-  if (sender_addr.ss_family == AF_INET6) {
-    last_sender_port_ =
-        ntohs(reinterpret_cast<sockaddr_in6*>(&sender_addr)->sin6_port);
-  } else if (sender_addr.ss_family == AF_INET) {
-    last_sender_port_ =
-        ntohs(reinterpret_cast<sockaddr_in*>(&sender_addr)->sin_port);
-  } else {
-    std::unexpected("protocol is not IPv4 or IPv6");
-  }
+  /* Save the address of the sender. */
+  last_sender_ = {.storage = sender_addr, .len = addr_len};
 
   return num_bytes;
 }
 
+/* Recv then reports no data as zero bytes instead of waiting. Senders
+   created from this socket share the flag. */
+std::expected<void, UdpSocketErr> UdpSocketRecver::SetNonBlocking() {
+  int flags = fcntl(socket_, F_GETFL);
+  if (flags == -1 || fcntl(socket_, F_SETFL, flags | O_NONBLOCK) == -1) {
+    return std::unexpected(std::strerror(errno));
+  }
+  return {};
+}
+
+std::expected<void, UdpSocketErr> UdpSocketRecver::SetRecvTimeout(
+    uint32_t timeout_ms) {
+  struct timeval tv = {.tv_sec = 1000 * timeout_ms / 1000000,
+                       .tv_usec = 1000 * timeout_ms % 1000000};
+  if (setsockopt(socket_, SOL_SOCKET, SO_RCVTIMEO,
+                 reinterpret_cast<const char*>(&tv), sizeof(tv)) == -1) {
+    return std::unexpected(std::strerror(errno));
+  }
+  return {};
+}
+
+/* The kernel doubles a buffer size it is given to leave room for its own
+   bookkeeping and reports the doubled size back, halve it again. Only a
+   privileged process gets past net.core.[rw]mem_max, with the FORCE
+   option, everyone else is clamped to it. */
+static std::expected<int, UdpSocketErr> GrowBuffer(int fd, int opt,
+                                                   int force_opt, int bytes) {
+  auto current = [fd, opt]() -> std::expected<int, UdpSocketErr> {
+    int size = 0;
+    socklen_t len = sizeof(size);
+    if (getsockopt(fd, SOL_SOCKET, opt, &size, &len) == -1) {
+      return std::unexpected(std::strerror(errno));
+    }
+    return size / 2;
+  };
+
+  auto size = current();
+  if (!size || *size >= bytes) {
+    return size;
+  }
+  if (setsockopt(fd, SOL_SOCKET, force_opt, &bytes, sizeof(bytes)) == -1 &&
+      setsockopt(fd, SOL_SOCKET, opt, &bytes, sizeof(bytes)) == -1) {
+    return std::unexpected(std::strerror(errno));
+  }
+  return current();
+}
+
+std::expected<int, UdpSocketErr> UdpSocketRecver::GrowRecvBuffer(int bytes) {
+  return GrowBuffer(socket_, SO_RCVBUF, SO_RCVBUFFORCE, bytes);
+}
+
+std::expected<int, UdpSocketErr> UdpSocketRecver::GrowSendBuffer(int bytes) {
+  return GrowBuffer(socket_, SO_SNDBUF, SO_SNDBUFFORCE, bytes);
+}
+
+/* Reads spin on the device queue for up to usecs before sleeping, trading
+   CPU for wakeup latency. Going past net.core.busy_read takes
+   CAP_NET_ADMIN. SO_PREFER_BUSY_POLL is left alone, it only steers
+   epoll/NAPI busy polling and needs CAP_NET_ADMIN to set at all. */
+std::expected<void, UdpSocketErr> UdpSocketRecver::SetBusyPoll(
+    uint32_t usecs) {
+  int value = static_cast<int>(usecs);
+  if (setsockopt(socket_, SOL_SOCKET, SO_BUSY_POLL, &value, sizeof(value)) ==
+      -1) {
+    return std::unexpected(std::strerror(errno));
+  }
+  return {};
+}
+
 void Swap(UdpSocketRecver& r1, UdpSocketRecver& r2) {
   using std::swap;
 
   swap(r1.socket_, r2.socket_);
   swap(r1.port_, r2.port_);
-  swap(r1.last_sender_port_, r2.last_sender_port_);
+  swap(r1.last_sender_, r2.last_sender_);
 }
 
-UdpSocketSender::~UdpSocketSender() {
+UdpSocketMcastRecver::~UdpSocketMcastRecver() {
   if (-1 != socket_) {
+    setsockopt(socket_, IPPROTO_IP, IP_DROP_MEMBERSHIP, &membership_,
+               sizeof(membership_));
     close(socket_);
   }
 
-  if (servinfo_) {
-    freeaddrinfo(servinfo_);
+  socket_ = -1;
+  group_ = "";
+  port_ = 0;
+  last_sender_ = {};
+}
+
+UdpSocketMcastRecver::UdpSocketMcastRecver(UdpSocketMcastRecver&& other)
+    : UdpSocketMcastRecver() {
+  Swap(*this, other);
+}
+
+UdpSocketMcastRecver& UdpSocketMcastRecver::operator=(
+    UdpSocketMcastRecver&& other) {
+  UdpSocketMcastRecver tmp(std::move(other));
+  Swap(*this, tmp);
+  return *this;
+}
+
+std::expected<UdpSocketMcastRecver, UdpSocketErr> UdpSocketMcastRecver::Create(
+    std::string_view group, uint16_t port, std::string_view iface_addr) {
+  ip_mreq membership = {};
+  if (inet_pton(AF_INET, std::string(group).c_str(),
+                &membership.imr_multiaddr) != 1 ||
+      !IN_MULTICAST(ntohl(membership.imr_multiaddr.s_addr))) {
+    return std::unexpected("'" + std::string(group) +
+                           "' is not an IPv4 multicast group");
+  }
+  if (inet_pton(AF_INET, std::string(iface_addr).c_str(),
+                &membership.imr_interface) != 1) {
+    return std::unexpected("'" + std::string(iface_addr) +
+                           "' is not an IPv4 interface address");
+  }
+
+  int sockfd = socket(AF_INET, SOCK_DGRAM, 0);
+  if (-1 == sockfd) {
+    return std::unexpected(std::strerror(errno));
+  }
+
+  /* Every client on this host listens on the same group port. */
+  int yes = 1;
+  if (setsockopt(sockfd, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes)) == -1) {
+    close(sockfd);
+    return std::unexpected(std::strerror(errno));
+  }
+
+  /* Bind to the group so unicast traffic to the port is not picked up. */
+  sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  addr.sin_addr = membership.imr_multiaddr;
+  if (bind(sockfd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == -1) {
+    close(sockfd);
+    return std::unexpected(std::strerror(errno));
+  }
+
+  if (setsockopt(sockfd, IPPROTO_IP, IP_ADD_MEMBERSHIP, &membership,
+                 sizeof(membership)) == -1) {
+    close(sockfd);
+    return std::unexpected(std::strerror(errno));
+  }
+
+  return UdpSocketMcastRecver(sockfd, group, port, membership);
+}
+
+std::expected<ssize_t, UdpSocketErr> UdpSocketMcastRecver::Recv(
+    void* buffer, std::size_t len) {
+  struct sockaddr_storage sender_addr = {};
+  socklen_t addr_len = sizeof(sender_addr);
+  ssize_t num_bytes =
+      recvfrom(socket_, reinterpret_cast<char*>(buffer), len, 0,
+               reinterpret_cast<struct sockaddr*>(&sender_addr), &addr_len);
+  if (-1 == num_bytes) {
+    if (EAGAIN == errno) {
+      num_bytes = 0;
+    } else {
+      return std::unexpected(std::strerror(errno));
+    }
+  }
+
+  last_sender_ = {.storage = sender_addr, .len = addr_len};
+
+  return num_bytes;
+}
+
+void Swap(UdpSocketMcastRecver& r1, UdpSocketMcastRecver& r2) {
+  using std::swap;
+
+  swap(r1.socket_, r2.socket_);
+  swap(r1.group_, r2.group_);
+  swap(r1.port_, r2.port_);
+  swap(r1.last_sender_, r2.last_sender_);
+  swap(r1.membership_, r2.membership_);
+}
+
+UdpSocketSender::~UdpSocketSender() {
+  if (-1 != socket_) {
+    close(socket_);
   }
 
   socket_ = -1;
   ip_addr_ = "";
-  port_ = 0;
-  servinfo_ = nullptr;
-  addr_ = nullptr;
+  addr_ = {};
 }
 
 UdpSocketSender::UdpSocketSender(UdpSocketSender&& other) : UdpSocketSender() {
@@ -161,63 +405,135 @@ UdpSocketSender& UdpSocketSender::operator=(UdpSocketSender&& other) {
 
 std::expected<UdpSocketSender, UdpSocketErr> UdpSocketSender::Create(
     std::string_view ip_addr, uint16_t port) {
-  struct addrinfo* servinfo = nullptr;
-  struct addrinfo hints = {};
-  hints.ai_family = AF_INET;
-  hints.ai_socktype = SOCK_DGRAM;
+  auto addr = ResolveAddr(ip_addr);
+  if (!addr) {
+    return std::unexpected(addr.error());
+  }
+  addr->SetPort(port);
 
-  int retcode = getaddrinfo(ip_addr.data(), std::to_string(port).c_str(),
-                            &hints, &servinfo);
-  if (retcode == -1) {
-    return std::unexpected(std::strerror(errno));
-  } else if (retcode) {
-    return std::unexpected(gai_strerror(retcode));
+  auto sender = Create(*addr);
+  if (sender) {
+    sender->ip_addr_ = ip_addr;
   }
+  return sender;
+}
 
-  /* Create a socket from the first valid address. */
-  int sockfd = 0;
-  struct addrinfo* it = nullptr;
-  for (it = servinfo; it; it = it->ai_next) {
-    sockfd = socket(it->ai_family, it->ai_socktype, it->ai_protocol);
-    if (-1 == sockfd) {
-      continue;
-    }
-    break;
+std::expected<UdpSocketSender, UdpSocketErr> UdpSocketSender::Create(
+    std::string_view ip_addr, uint16_t port, const UdpSocketRecver& src) {
+  auto addr = ResolveAddr(ip_addr);
+  if (!addr) {
+    return std::unexpected(addr.error());
   }
+  addr->SetPort(port);
 
-  if (!it) {
-    freeaddrinfo(servinfo);
-    return std::unexpected("failed to create socket");
+  auto sender = Create(*addr, src);
+  if (sender) {
+    sender->ip_addr_ = ip_addr;
+  }
+  return sender;
+}
+
+std::expected<UdpSocketSender, UdpSocketErr> UdpSocketSender::Create(
+    const SockAddr& addr) {
+  int sockfd = socket(addr.Family(), SOCK_DGRAM, 0);
+  if (-1 == sockfd) {
+    return std::unexpected(std::strerror(errno));
   }
 
   /* Don't wait for the kernel to release the resource. Allow port reuse. */
   int yes = 1;
   if (setsockopt(sockfd, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes)) == -1) {
     close(sockfd);
-    freeaddrinfo(servinfo);
     return std::unexpected(std::strerror(errno));
   }
 
-  return UdpSocketSender(sockfd, ip_addr, port, servinfo, it);
+  return UdpSocketSender(sockfd, addr.Ip(), addr);
 }
 
-std::expected<ssize_t, UdpSocketErr> UdpSocketSender::Send(void* buffer,
-                                                           std::size_t len) {
-  ssize_t num_bytes = sendto(socket_, reinterpret_cast<char*>(buffer), len, 0,
-                             addr_->ai_addr, addr_->ai_addrlen);
+std::expected<UdpSocketSender, UdpSocketErr> UdpSocketSender::Create(
+    const SockAddr& addr, const UdpSocketRecver& src) {
+  /* Send from the receiver's bound socket so that peer replies land on it. */
+  int sockfd = dup(src.Fd());
+  if (-1 == sockfd) {
+    return std::unexpected(std::strerror(errno));
+  }
+
+  return UdpSocketSender(sockfd, addr.Ip(), addr);
+}
+
+std::expected<ssize_t, UdpSocketErr> UdpSocketSender::Send(
+    const void* buffer, std::size_t len) {
+  ssize_t num_bytes =
+      sendto(socket_, reinterpret_cast<const char*>(buffer), len, 0,
+             addr_.Addr(), addr_.len);
   if (-1 == num_bytes) {
+    if (EAGAIN == errno) { /* A non-blocking socket's buffer is full. */
+      return 0;
+    }
     return std::unexpected(std::strerror(errno));
   }
   return num_bytes;
 }
 
+std::expected<void, UdpSocketErr> UdpSocketSender::SetMulticastInterface(
+    std::string_view iface_addr, bool loop) {
+  in_addr iface = {};
+  if (inet_pton(AF_INET, std::string(iface_addr).c_str(), &iface) != 1) {
+    return std::unexpected("'" + std::string(iface_addr) +
+                           "' is not an IPv4 interface address");
+  }
+  if (setsockopt(socket_, IPPROTO_IP, IP_MULTICAST_IF, &iface,
+                 sizeof(iface)) == -1) {
+    return std::unexpected(std::strerror(errno));
+  }
+
+  unsigned char enable_loop = loop;
+  if (setsockopt(socket_, IPPROTO_IP, IP_MULTICAST_LOOP, &enable_loop,
+                 sizeof(enable_loop)) == -1) {
+    return std::unexpected(std::strerror(errno));
+  }
+  return {};
+}
+
+/* Only the fq qdisc honors this, elsewhere the kernel accepts and ignores
+   it. The rate is per socket so it outlives a switch to the peer's TID. */
+std::expected<void, UdpSocketErr> UdpSocketSender::SetMaxPacingRate(
+    uint64_t rate) {
+  if (setsockopt(socket_, SOL_SOCKET, SO_MAX_PACING_RATE, &rate,
+                 sizeof(rate)) == -1) {
+    return std::unexpected(std::strerror(errno));
+  }
+  return {};
+}
+
+std::expected<std::string, UdpSocketErr> UdpSocketSender::RouteSourceAddr()
+    const {
+  /* Connecting a scratch socket makes the kernel pick the route for us. */
+  int sockfd = socket(addr_.Family(), SOCK_DGRAM, 0);
+  if (-1 == sockfd) {
+    return std::unexpected(std::strerror(errno));
+  }
+
+  sockaddr_in local = {};
+  socklen_t local_len = sizeof(local);
+  if (connect(sockfd, addr_.Addr(), addr_.len) == -1 ||
+      getsockname(sockfd, reinterpret_cast<sockaddr*>(&local), &local_len) ==
+          -1) {
+    close(sockfd);
+    return std::unexpected(std::strerror(errno));
+  }
+  close(sockfd);
+
+  char addr_str[INET_ADDRSTRLEN] = {};
+  inet_ntop(AF_INET, &local.sin_addr, addr_str, sizeof(addr_str));
+  return std::string(addr_str);
+}
+
 void Swap(UdpSocketSender& r1, UdpSocketSender& r2) {
   using std::swap;
 
   swap(r1.socket_, r2.socket_);
   swap(r1.ip_addr_, r2.ip_addr_);
-  swap(r1.port_, r2.port_);
-  swap(r1.servinfo_, r2.servinfo_);
   swap(r1.addr_, r2.addr_);
 }
 
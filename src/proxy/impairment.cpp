@@ -0,0 +1,165 @@
+#include "proxy/impairment.h"
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <system_error>
+
+namespace tftp {
+namespace proxy {
+
+static std::optional<ImpairmentProfile> Preset(std::string_view name) {
+  using std::chrono::microseconds;
+  using std::chrono::milliseconds;
+
+  if (name == "clean") {
+    return ImpairmentProfile{};
+  } else if (name == "lan") {
+    return ImpairmentProfile{.delay = microseconds(500),
+                             .jitter = microseconds(100)};
+  } else if (name == "wan") {
+    return ImpairmentProfile{
+        .loss = 0.005, .delay = milliseconds(40), .jitter = milliseconds(5)};
+  } else if (name == "lossy") {
+    return ImpairmentProfile{.loss = 0.05,
+                             .duplicate = 0.01,
+                             .reorder = 0.02,
+                             .delay = milliseconds(10),
+                             .jitter = milliseconds(5)};
+  }
+  return std::nullopt;
+}
+
+static std::optional<double> ParseNum(std::string_view val) {
+  double num = 0.0;
+  auto [end, ec] = std::from_chars(val.data(), val.data() + val.size(), num);
+  if (ec != std::errc() || end != val.data() + val.size() || num < 0.0) {
+    return std::nullopt;
+  }
+  return num;
+}
+
+static std::expected<void, ProfileErr> ApplySetting(ImpairmentProfile& profile,
+                                                    std::string_view key,
+                                                    std::string_view val) {
+  auto num = ParseNum(val);
+  if (!num) {
+    return std::unexpected("invalid value for '" + std::string(key) + "'");
+  }
+
+  double* prob = nullptr;
+  Micros* time = nullptr;
+  if (key == "loss") {
+    prob = &profile.loss;
+  } else if (key == "dup" || key == "duplicate") {
+    prob = &profile.duplicate;
+  } else if (key == "reorder") {
+    prob = &profile.reorder;
+  } else if (key == "delay") {
+    time = &profile.delay;
+  } else if (key == "jitter") {
+    time = &profile.jitter;
+  } else if (key == "hold") {
+    time = &profile.hold;
+  } else if (key == "seed") {
+    profile.seed = static_cast<uint64_t>(*num);
+    return {};
+  } else {
+    return std::unexpected("unknown setting '" + std::string(key) + "'");
+  }
+
+  if (prob) {
+    if (*num > 1.0) {
+      return std::unexpected("'" + std::string(key) +
+                             "' is out of range [0, 1]");
+    }
+    *prob = *num;
+  } else {
+    *time = Micros(static_cast<int64_t>(*num * 1000.0));
+  }
+  return {};
+}
+
+std::expected<ImpairmentProfile, ProfileErr> ParseProfile(
+    std::string_view spec) {
+  ImpairmentProfile profile;
+  bool first = true;
+  while (!spec.empty()) {
+    std::size_t comma = spec.find(',');
+    std::string_view item = spec.substr(0, comma);
+    spec = (comma == std::string_view::npos) ? "" : spec.substr(comma + 1);
+
+    std::size_t equals = item.find('=');
+    if (equals == std::string_view::npos) {
+      auto preset = (first) ? Preset(item) : std::nullopt;
+      if (!preset) {
+        return std::unexpected("unknown profile '" + std::string(item) + "'");
+      }
+      profile = *preset;
+    } else {
+      auto applied = ApplySetting(profile, item.substr(0, equals),
+                                  item.substr(equals + 1));
+      if (!applied) {
+        return std::unexpected(applied.error());
+      }
+    }
+    first = false;
+  }
+  return profile;
+}
+
+std::string FormatProfile(const ImpairmentProfile& profile) {
+  auto ms = [](Micros time) { return time.count() / 1000.0; };
+
+  std::ostringstream oss;
+  oss << "loss=" << profile.loss << ",dup=" << profile.duplicate
+      << ",reorder=" << profile.reorder << ",delay=" << ms(profile.delay)
+      << ",jitter=" << ms(profile.jitter) << ",hold=" << ms(profile.hold)
+      << ",seed=" << profile.seed;
+  return oss.str();
+}
+
+/* Build the double by hand, the standard distributions may differ between
+   library implementations and we want a seed to mean the same run. */
+double Impairer::Uniform() {
+  return static_cast<double>(rng_() >> 11) * 0x1.0p-53;
+}
+
+Micros Impairer::Delay(double draw) const {
+  Micros jitter = std::chrono::duration_cast<Micros>(
+      profile_.jitter * (2.0 * draw - 1.0));
+  return std::max(profile_.delay + jitter, Micros::zero());
+}
+
+Verdict Impairer::Next() {
+  double loss = Uniform();
+  double duplicate = Uniform();
+  double reorder = Uniform();
+  double delay = Uniform();
+  double copy_delay = Uniform();
+
+  Verdict verdict = {.drop = loss < profile_.loss};
+  if (verdict.drop) {
+    return verdict;
+  }
+
+  verdict.delay = Delay(delay);
+  if (reorder < profile_.reorder) { /* Let the packets behind overtake it. */
+    verdict.reordered = true;
+    verdict.delay += profile_.hold;
+  }
+  if (duplicate < profile_.duplicate) {
+    verdict.duplicate = Delay(copy_delay);
+  }
+  return verdict;
+}
+
+}  // namespace proxy
+}  // namespace tftp
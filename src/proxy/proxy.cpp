@@ -0,0 +1,239 @@
+#include "proxy/proxy.h"
+
+#include <poll.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <expected>
+#include <iomanip>
+#include <ostream>
+#include <utility>
+
+#include "common/codec.h"
+#include "common/types.h"
+#include "common/udp_socket.h"
+#include "proxy/impairment.h"
+
+namespace tftp {
+namespace proxy {
+
+static uint16_t OpcodeOf(const TftpPacket& packet) {
+  return (packet.size() < 2) ? 0 : (packet[0] << 8) | packet[1];
+}
+
+static bool IsRequest(const TftpPacket& packet) {
+  uint16_t opcode = OpcodeOf(packet);
+  return opcode == OpCode::kReadReq || opcode == OpCode::kWriteReq;
+}
+
+std::expected<Proxy, UdpSocketErr> Proxy::Create(
+    uint16_t listen_port, const SockAddr& server,
+    const ImpairmentProfile& profile, std::ostream* log) {
+  auto downstream = UdpSocketRecver::Create(listen_port);
+  if (!downstream) {
+    return std::unexpected(downstream.error());
+  }
+  auto upstream = UdpSocketRecver::Create(0);
+  if (!upstream) {
+    return std::unexpected(upstream.error());
+  }
+
+  if (log) {
+    *log << "proxying port " << downstream->RecvPort() << " to "
+         << server.Ip() << ":" << server.Port() << " with "
+         << FormatProfile(profile) << std::endl;
+  }
+  return Proxy(std::move(*downstream), std::move(*upstream), server, profile,
+               log);
+}
+
+std::expected<void, UdpSocketErr> Proxy::Poll(Micros max_wait) {
+  Clock::time_point now = Clock::now();
+  Micros wait = max_wait;
+  if (!pending_.empty()) {
+    wait = std::clamp(
+        std::chrono::duration_cast<Micros>(pending_.top().due - now),
+        Micros::zero(), max_wait);
+  }
+
+  std::array<pollfd, 2> fds = {
+      pollfd{.fd = downstream_.Fd(), .events = POLLIN, .revents = 0},
+      pollfd{.fd = upstream_.Fd(), .events = POLLIN, .revents = 0},
+  };
+  auto secs = std::chrono::duration_cast<std::chrono::seconds>(wait);
+  timespec timeout = {
+      .tv_sec = secs.count(),
+      .tv_nsec = std::chrono::duration_cast<std::chrono::nanoseconds>(wait -
+                                                                      secs)
+                     .count()};
+  if (ppoll(fds.data(), fds.size(), &timeout, nullptr) == -1 &&
+      errno != EINTR) {
+    return std::unexpected(std::strerror(errno));
+  }
+
+  if (fds[0].revents & POLLIN) {
+    auto received = Receive(Direction::kToServer);
+    if (!received) {
+      return received;
+    }
+  }
+  if (fds[1].revents & POLLIN) {
+    auto received = Receive(Direction::kToClient);
+    if (!received) {
+      return received;
+    }
+  }
+
+  now = Clock::now();
+  while (!pending_.empty() && pending_.top().due <= now) {
+    auto delivered = Deliver(pending_.top());
+    pending_.pop();
+    if (!delivered) {
+      return delivered;
+    }
+  }
+  return {};
+}
+
+std::expected<void, UdpSocketErr> Proxy::Run(const std::atomic<bool>& stop) {
+  while (!stop) {
+    auto polled = Poll(std::chrono::milliseconds(100));
+    if (!polled) {
+      return polled;
+    }
+  }
+  return {};
+}
+
+std::expected<void, UdpSocketErr> Proxy::Receive(Direction dir) {
+  UdpSocketRecver& recver =
+      (dir == Direction::kToServer) ? downstream_ : upstream_;
+  auto num_bytes = recver.Recv(buffer_.data(), buffer_.size());
+  if (!num_bytes) {
+    return std::unexpected(num_bytes.error());
+  }
+  if (*num_bytes <= 0) {
+    return {};
+  }
+  TftpPacket packet(buffer_.cbegin(), buffer_.cbegin() + *num_bytes);
+
+  if (dir == Direction::kToServer) {
+    /* A request starts a new transfer, possibly from a new client. */
+    if (IsRequest(packet)) {
+      if (!SameAddr(client_, recver.LastSender())) {
+        client_ = recver.LastSender();
+        to_client_.reset();
+      }
+      server_tid_ = 0;
+    } else if (!SameAddr(client_, recver.LastSender())) {
+      return {};
+    }
+  } else {
+    /* The server's first reply comes from its TID, the rest must too. */
+    if (!server_tid_) {
+      server_tid_ = recver.LastSenderPort();
+    } else if (recver.LastSenderPort() != server_tid_) {
+      return {};
+    }
+  }
+
+  stats_.received++;
+  Schedule(dir, std::move(packet));
+  return {};
+}
+
+void Proxy::Schedule(Direction dir, TftpPacket packet) {
+  Verdict verdict = impairer_.Next();
+  Log(dir, packet, verdict);
+  if (verdict.drop) {
+    stats_.dropped++;
+    return;
+  }
+  if (verdict.reordered) {
+    stats_.reordered++;
+  }
+
+  /* Jitter alone never lets a packet overtake the one before it, only a
+     reordered packet is allowed to fall behind. */
+  Clock::time_point now = Clock::now();
+  Clock::time_point& last_due = last_due_[static_cast<int>(dir)];
+  Clock::time_point due = now + verdict.delay;
+  if (!verdict.reordered) {
+    due = std::max(due, last_due);
+    last_due = due;
+  }
+  pending_.push(
+      Pending{.due = due, .seq = seq_++, .dir = dir, .packet = packet});
+
+  if (verdict.duplicate) {
+    stats_.duplicated++;
+    last_due = std::max(now + *verdict.duplicate, last_due);
+    pending_.push(Pending{.due = last_due,
+                          .seq = seq_++,
+                          .dir = dir,
+                          .packet = std::move(packet)});
+  }
+}
+
+std::expected<void, UdpSocketErr> Proxy::Deliver(const Pending& pending) {
+  std::optional<UdpSocketSender>* sender = &to_client_;
+  SockAddr dest = client_;
+  UdpSocketRecver* src = &downstream_;
+  if (pending.dir == Direction::kToServer) {
+    sender = &to_server_;
+    dest = server_;
+    src = &upstream_;
+    if (server_tid_ && !IsRequest(pending.packet)) {
+      dest.SetPort(server_tid_);
+    }
+  }
+
+  if (!*sender || !SameAddr((*sender)->Addr(), dest)) {
+    auto created = UdpSocketSender::Create(dest, *src);
+    if (!created) {
+      return std::unexpected(created.error());
+    }
+    sender->emplace(std::move(*created));
+  }
+
+  auto sent = (*sender)->Send(pending.packet.data(), pending.packet.size());
+  if (!sent) {
+    return std::unexpected(sent.error());
+  }
+  stats_.forwarded++;
+  return {};
+}
+
+void Proxy::Log(Direction dir, const TftpPacket& packet,
+                const Verdict& verdict) {
+  if (!log_) {
+    return;
+  }
+
+  auto ms = [](auto time) {
+    return std::chrono::duration<double, std::milli>(time).count();
+  };
+  *log_ << std::fixed << std::setprecision(3) << ms(Clock::now() - start_)
+        << ((dir == Direction::kToServer) ? " c>s " : " s>c ")
+        << codec::Describe(packet);
+  if (verdict.drop) {
+    *log_ << " dropped";
+  } else {
+    *log_ << " delayed " << ms(verdict.delay) << "ms";
+    if (verdict.reordered) {
+      *log_ << " reordered";
+    }
+    if (verdict.duplicate) {
+      *log_ << " duplicated " << ms(*verdict.duplicate) << "ms";
+    }
+  }
+  *log_ << std::defaultfloat << std::endl;
+}
+
+}  // namespace proxy
+}  // namespace tftp
@@ -0,0 +1,264 @@
+#include <gtest/gtest.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <string>
+#include <variant>
+#include <vector>
+
+#include "client/config.h"
+#include "client/session.h"
+#include "client/stats.h"
+#include "client/transfer.h"
+#include "common/block_seq.h"
+#include "common/codec.h"
+#include "common/event_loop.h"
+#include "common/pack.h"
+#include "common/parse.h"
+#include "common/types.h"
+
+using namespace std::chrono_literals;
+using tftp::AsyncSocket;
+using tftp::EventLoop;
+using tftp::Task;
+using tftp::TftpPacket;
+
+/* The test server's files are named for their size in bytes. */
+static std::string Contents(const std::string& filename) {
+  return std::string(std::stoul(filename), filename.back());
+}
+
+/* Serves one read request in lock-step from a fresh port, as a server
+   would, honoring a requested rollover. */
+static Task<> ServeRead(EventLoop& loop, tftp::SockAddr client,
+                        std::string filename, tftp::Options options) {
+  auto socket = AsyncSocket::Create(loop);
+  EXPECT_TRUE(socket && socket->SetPeer(client));
+
+  tftp::BlockSeq seq;
+  if (auto it = options.find(tftp::OptionName::kRollover);
+      it != options.cend()) {
+    seq = tftp::BlockSeq(*tftp::ParseRollover(it->second));
+    TftpPacket oack = tftp::PackOptionAck({.options = {*it}});
+    EXPECT_TRUE(co_await socket->SendPacket(oack));
+    auto ack = co_await socket->RecvPacket(5s);
+    EXPECT_TRUE(ack && !ack->empty());
+  }
+
+  std::string contents = Contents(filename);
+  for (uint64_t block = 1;; ++block) {
+    std::size_t offset = (block - 1) * tftp::client::kDefaultBlockSize;
+    std::size_t len = std::min(tftp::client::kDefaultBlockSize,
+                               contents.size() - offset);
+    TftpPacket data = tftp::PackData(
+        {.block_num = seq.Wire(block),
+         .data = tftp::BlockData(contents.cbegin() + offset,
+                                 contents.cbegin() + offset + len)});
+    EXPECT_TRUE(co_await socket->SendPacket(data));
+
+    auto ack = co_await socket->RecvPacket(5s);
+    EXPECT_TRUE(ack && !ack->empty());
+    if (len < tftp::client::kDefaultBlockSize) {
+      co_return;
+    }
+  }
+}
+
+/* Takes one write request in lock-step from a fresh port. */
+static Task<> ServeWrite(EventLoop& loop, tftp::SockAddr client,
+                         std::string& received) {
+  auto socket = AsyncSocket::Create(loop);
+  EXPECT_TRUE(socket && socket->SetPeer(client));
+  EXPECT_TRUE(co_await socket->SendPacket(tftp::PackAck({.block_num = 0})));
+
+  for (uint16_t block = 1;;) {
+    auto packet = co_await socket->RecvPacket(5s);
+    EXPECT_TRUE(packet && !packet->empty());
+    if (!packet || packet->empty()) {
+      co_return;
+    }
+    auto data = tftp::codec::DecodeAs<tftp::codec::DataView>(*packet);
+    EXPECT_TRUE(data);
+    if (!data) {
+      co_return;
+    }
+    if (data->block_num == block) {
+      received.append(data->data.begin(), data->data.end());
+      block++;
+    }
+    EXPECT_TRUE(co_await socket->SendPacket(
+        tftp::PackAck({.block_num = data->block_num})));
+    if (data->data.size() < tftp::client::kDefaultBlockSize) {
+      co_return;
+    }
+  }
+}
+
+/* Hands each request to a coroutine of its own, uploads land in puts. */
+static Task<> Listen(EventLoop& loop, AsyncSocket& socket, int requests,
+                     std::map<std::string, std::string>& puts) {
+  for (int i = 0; i < requests; ++i) {
+    auto packet = co_await socket.RecvPacket(5s);
+    EXPECT_TRUE(packet && !packet->empty());
+    if (!packet || packet->empty()) {
+      co_return;
+    }
+    auto msg = tftp::codec::Decode(*packet);
+    EXPECT_TRUE(msg);
+    if (!msg) {
+      continue;
+    }
+    if (auto* rrq = std::get_if<tftp::codec::ReadRequestView>(&*msg)) {
+      loop.Spawn(ServeRead(loop, socket.LastSender(),
+                           std::string(rrq->filename),
+                           rrq->options.ToOptions()));
+    } else if (auto* wrq = std::get_if<tftp::codec::WriteRequestView>(&*msg)) {
+      loop.Spawn(ServeWrite(loop, socket.LastSender(),
+                            puts[std::string(wrq->filename)]));
+    } else {
+      ADD_FAILURE() << "not a request";
+    }
+  }
+}
+
+class AsyncTransferTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    dir_ = std::filesystem::temp_directory_path() /
+           ("async_transfer_test_" + std::to_string(::getpid()));
+    std::filesystem::create_directories(dir_);
+  }
+  void TearDown() override { std::filesystem::remove_all(dir_); }
+
+  std::filesystem::path dir_;
+  std::map<std::string, std::string> puts_;
+};
+
+static Task<> Get(EventLoop& loop, const tftp::client::Config& conf,
+                  uint16_t port, std::string remote, std::string local,
+                  tftp::client::TransferStats& stats, int& done) {
+  auto result = co_await tftp::client::AsyncGetFile(loop, conf, "127.0.0.1",
+                                                    port, remote, local, stats);
+  EXPECT_TRUE(result) << result.error().msg;
+  done += result.has_value();
+}
+
+static Task<> Put(EventLoop& loop, const tftp::client::Config& conf,
+                  uint16_t port, std::string local, std::string remote,
+                  tftp::client::TransferStats& stats, int& done) {
+  auto result = co_await tftp::client::AsyncPutFile(loop, conf, "127.0.0.1",
+                                                    port, local, remote, stats);
+  EXPECT_TRUE(result) << result.error().msg;
+  done += result.has_value();
+}
+
+TEST_F(AsyncTransferTest, ConcurrentGetsAndPutsOnOneThread) {
+  constexpr int kTransfers = 100;
+  auto loop = EventLoop::Create();
+  ASSERT_TRUE(loop);
+  auto listener = AsyncSocket::Create(**loop);
+  ASSERT_TRUE(listener);
+
+  tftp::client::Config conf(tftp::SendMode::kOctet, {.start = 0, .end = 0},
+                            false, "127.0.0.1", 10, 1);
+  std::vector<tftp::client::TransferStats> stats(2 * kTransfers);
+  int done = 0;
+  (*loop)->Spawn(Listen(**loop, *listener, 2 * kTransfers, puts_));
+  for (int i = 0; i < kTransfers; ++i) {
+    std::string name = std::to_string(1000 + 97 * i);
+    (*loop)->Spawn(Get(**loop, conf, listener->Port(), name,
+                       (dir_ / name).string(), stats[i], done));
+
+    std::string local = (dir_ / ("put_" + name)).string();
+    std::ofstream(local, std::ios::binary) << Contents(name);
+    (*loop)->Spawn(Put(**loop, conf, listener->Port(), local, name,
+                       stats[kTransfers + i], done));
+  }
+  (*loop)->Run();
+
+  ASSERT_EQ(done, 2 * kTransfers);
+  for (int i = 0; i < kTransfers; ++i) {
+    std::string name = std::to_string(1000 + 97 * i);
+    std::ifstream in(dir_ / name, std::ios::binary);
+    std::string contents(std::istreambuf_iterator<char>(in), {});
+    ASSERT_EQ(contents, Contents(name));
+    ASSERT_EQ(stats[i].bytes, contents.size());
+    ASSERT_EQ(puts_[name], Contents(name));
+    ASSERT_EQ(stats[kTransfers + i].bytes, contents.size());
+  }
+}
+
+TEST_F(AsyncTransferTest, GetCrossesTheRolloverPoint) {
+  auto loop = EventLoop::Create();
+  ASSERT_TRUE(loop);
+  auto listener = AsyncSocket::Create(**loop);
+  ASSERT_TRUE(listener);
+
+  tftp::client::Config conf(tftp::SendMode::kOctet, {.start = 0, .end = 0},
+                            false, "127.0.0.1", 60, 1);
+  conf.rollover = tftp::Rollover::kToOne;
+  std::string name = std::to_string(65540 * tftp::client::kDefaultBlockSize);
+  tftp::client::TransferStats stats;
+  int done = 0;
+  (*loop)->Spawn(Listen(**loop, *listener, 1, puts_));
+  (*loop)->Spawn(Get(**loop, conf, listener->Port(), name,
+                     (dir_ / name).string(), stats, done));
+  (*loop)->Run();
+
+  ASSERT_EQ(done, 1);
+  ASSERT_EQ(stats.blocks, 65541);
+  ASSERT_EQ(stats.duplicates, 0);
+  std::ifstream in(dir_ / name, std::ios::binary);
+  std::string contents(std::istreambuf_iterator<char>(in), {});
+  ASSERT_EQ(contents, Contents(name));
+}
+
+TEST_F(AsyncTransferTest, UnansweredGetTimesOut) {
+  auto loop = EventLoop::Create();
+  ASSERT_TRUE(loop);
+  auto silent = AsyncSocket::Create(**loop);
+  ASSERT_TRUE(silent);
+
+  tftp::client::Config conf(tftp::SendMode::kOctet, {.start = 0, .end = 0},
+                            false, "127.0.0.1", 1, 1);
+  tftp::client::TransferStats stats;
+  bool failed = false;
+  auto get = [](EventLoop& loop, const tftp::client::Config& conf,
+                uint16_t port, std::string local,
+                tftp::client::TransferStats& stats, bool& failed) -> Task<> {
+    auto result = co_await tftp::client::AsyncGetFile(
+        loop, conf, "127.0.0.1", port, "missing", local, stats);
+    failed = !result && result.error().msg == "transfer timed out";
+  };
+  (*loop)->Spawn(get(**loop, conf, silent->Port(), (dir_ / "missing").string(),
+                     stats, failed));
+  (*loop)->Run();
+
+  ASSERT_TRUE(failed);
+  ASSERT_GE(stats.retransmits, 1);
+}
+
+TEST_F(AsyncTransferTest, LoopSessionRefusesToBeWaitedOnInPlace) {
+  auto loop = EventLoop::Create();
+  ASSERT_TRUE(loop);
+  auto silent = AsyncSocket::Create(**loop);
+  ASSERT_TRUE(silent);
+
+  tftp::client::Config conf(tftp::SendMode::kOctet, {.start = 0, .end = 0},
+                            false, "127.0.0.1", 1, 1);
+  tftp::client::TransferStats stats;
+  auto session = tftp::client::Session::Open(conf, "127.0.0.1",
+                                             silent->Port(), stats, &**loop);
+  ASSERT_TRUE(session);
+
+  /* Its receive would suspend until the loop runs, so it isn't started. */
+  auto packet = session->Wait(session->Recv());
+  ASSERT_FALSE(packet);
+  ASSERT_EQ(stats.timeouts, 0);
+}
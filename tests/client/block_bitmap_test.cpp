@@ -0,0 +1,45 @@
+#include "client/block_bitmap.h"
+
+#include <gtest/gtest.h>
+
+TEST(BlockBitmapTest, EmptyBitmapIsMissingTheFirstBlock) {
+  tftp::client::BlockBitmap bitmap;
+
+  ASSERT_EQ(bitmap.FirstMissing(), 1);
+  ASSERT_EQ(bitmap.Count(), 0);
+  ASSERT_FALSE(bitmap.Test(1));
+  ASSERT_FALSE(bitmap.Complete(1));
+}
+
+TEST(BlockBitmapTest, SetReportsDuplicates) {
+  tftp::client::BlockBitmap bitmap;
+
+  ASSERT_TRUE(bitmap.Set(3));
+  ASSERT_FALSE(bitmap.Set(3));
+  ASSERT_EQ(bitmap.Count(), 1);
+}
+
+TEST(BlockBitmapTest, FirstMissingTracksTheGap) {
+  tftp::client::BlockBitmap bitmap;
+
+  bitmap.Set(1);
+  bitmap.Set(3);
+  bitmap.Set(4);
+  ASSERT_EQ(bitmap.FirstMissing(), 2);
+
+  bitmap.Set(2);
+  ASSERT_EQ(bitmap.FirstMissing(), 5);
+  ASSERT_TRUE(bitmap.Complete(4));
+}
+
+TEST(BlockBitmapTest, SetGrowsAcrossWords) {
+  tftp::client::BlockBitmap bitmap;
+
+  for (uint64_t block = 1; block <= 200; ++block) {
+    bitmap.Set(block);
+  }
+
+  ASSERT_EQ(bitmap.Count(), 200);
+  ASSERT_EQ(bitmap.FirstMissing(), 201);
+  ASSERT_TRUE(bitmap.Test(130));
+}
@@ -4,6 +4,7 @@
 #include <string>
 
 #include "client/cmd.h"
+#include "client/transfer.h"
 
 TEST(CmdParseTest, CreateValidConnectCmdWithoutPortReturnsSuccess) {
   std::string cmdline = "connect localhost";
@@ -25,6 +26,25 @@ TEST(CmdParseTest, CreateValidConnectCmdWithPortReturnsSuccess) {
   ASSERT_EQ((*conn_cmd)->Port(), 5555);
 }
 
+TEST(CmdParseTest, ConnectSetsTheServerPortNotTheSourcePorts) {
+  tftp::client::Config conf(tftp::SendMode::kOctet,
+                            {.start = 2048, .end = 4096}, false, "localhost",
+                            1, 1);
+  ASSERT_EQ(conf.server_port, tftp::client::kDefaultServerPort);
+
+  ASSERT_EQ((*tftp::client::ConnectCmd::Create("connect server 6969"))
+                ->Execute(conf),
+            tftp::client::ExecStatus::kSuccessfulExec);
+  ASSERT_EQ(conf.hostname, "server");
+  ASSERT_EQ(conf.server_port, 6969);
+  ASSERT_EQ(conf.ports.start, 2048);
+  ASSERT_EQ(conf.ports.end, 4096);
+
+  /* Without a port the server keeps the one it had. */
+  (*tftp::client::ConnectCmd::Create("connect other"))->Execute(conf);
+  ASSERT_EQ(conf.server_port, 6969);
+}
+
 TEST(CmdParseTest, CreateConnectCmdWithInvalidArgCountReturnsInvalidNumArgs) {
   std::string too_many_args = "connect localhost 5555 foo";
   std::string too_few_args = "connect";
@@ -282,3 +302,103 @@ TEST(CmdParseTest, CreatePutCmdMultiFileAndRemoteDirReturnsSuccess) {
   }
   ASSERT_EQ((*put_cmd)->RemoteDir(), kFiles.back());
 }
+
+TEST(CmdParseTest, CreatePutCmdFromStdinNeedsRemoteName) {
+  auto named_cmd = tftp::client::PutCmd::Create("put - /remote/file");
+  ASSERT_TRUE(named_cmd);
+  ASSERT_EQ((*named_cmd)->LocalFile(), tftp::client::kStdStream);
+
+  ASSERT_EQ(tftp::client::PutCmd::Create("put -").error(),
+            tftp::ParseStatus::kStdinNeedsRemoteName);
+  ASSERT_EQ(tftp::client::PutCmd::Create("put foo - /remote/dir").error(),
+            tftp::ParseStatus::kStdinNeedsRemoteName);
+}
+
+TEST(CmdParseTest, CreateWindowSizeCmdWithValidArgReturnsSuccess) {
+  auto window_cmd = tftp::client::WindowSizeCmd::Create("windowsize 16");
+
+  ASSERT_TRUE(window_cmd);
+  ASSERT_EQ((*window_cmd)->WindowSize(), 16);
+}
+
+TEST(CmdParseTest, CreateWindowSizeCmdWithZeroReturnsOutOfRange) {
+  auto window_cmd = tftp::client::WindowSizeCmd::Create("windowsize 0");
+
+  ASSERT_FALSE(window_cmd);
+  ASSERT_EQ(window_cmd.error(), tftp::ParseStatus::kWindowSizeOutOfRange);
+}
+
+TEST(CmdParseTest, CreateCongestionCmdParsesModes) {
+  auto aimd_cmd = tftp::client::CongestionCmd::Create("congestion aimd");
+  auto delay_cmd = tftp::client::CongestionCmd::Create("congestion delay");
+  auto bad_cmd = tftp::client::CongestionCmd::Create("congestion cubic");
+
+  ASSERT_EQ((*aimd_cmd)->Mode(), tftp::client::CongestionMode::kAimd);
+  ASSERT_EQ((*delay_cmd)->Mode(), tftp::client::CongestionMode::kDelay);
+  ASSERT_EQ(bad_cmd.error(), tftp::ParseStatus::kUnknownCongestionMode);
+}
+
+TEST(CmdParseTest, CreateRateCmdParsesPerTransferAndTotalRates) {
+  auto rate_cmd = tftp::client::RateCmd::Create("rate 512k");
+  auto both_cmd = tftp::client::RateCmd::Create("rate off 10M");
+
+  ASSERT_TRUE(rate_cmd);
+  ASSERT_EQ((*rate_cmd)->Rate(), 512000);
+  ASSERT_FALSE((*rate_cmd)->GlobalRate());
+  ASSERT_TRUE(both_cmd);
+  ASSERT_EQ((*both_cmd)->Rate(), 0);
+  ASSERT_EQ((*both_cmd)->GlobalRate(), 10000000);
+}
+
+TEST(CmdParseTest, CreateRateCmdWithBadArgsFails) {
+  ASSERT_EQ(tftp::client::RateCmd::Create("rate").error(),
+            tftp::ParseStatus::kInvalidNumArgs);
+  ASSERT_EQ(tftp::client::RateCmd::Create("rate 1k 2k 3k").error(),
+            tftp::ParseStatus::kInvalidNumArgs);
+  ASSERT_EQ(tftp::client::RateCmd::Create("rate fast").error(),
+            tftp::ParseStatus::kInvalidRate);
+}
+
+TEST(CmdParseTest, CreateRolloverCmdParsesValueOrOff) {
+  auto one_cmd = tftp::client::RolloverCmd::Create("rollover 1");
+  auto off_cmd = tftp::client::RolloverCmd::Create("rollover off");
+
+  ASSERT_TRUE(one_cmd);
+  ASSERT_EQ((*one_cmd)->Value(), tftp::Rollover::kToOne);
+  ASSERT_TRUE(off_cmd);
+  ASSERT_FALSE((*off_cmd)->Value());
+  ASSERT_EQ(tftp::client::RolloverCmd::Create("rollover 7").error(),
+            tftp::ParseStatus::kInvalidRollover);
+}
+
+TEST(CmdParseTest, CreateSyncCmdTakesOneManifest) {
+  auto cmd = tftp::client::SyncCmd::Create("sync files.txt");
+
+  ASSERT_TRUE(cmd);
+  ASSERT_EQ((*cmd)->ManifestFile(), "files.txt");
+  ASSERT_EQ(tftp::client::SyncCmd::Create("sync").error(),
+            tftp::ParseStatus::kInvalidNumArgs);
+  ASSERT_EQ(tftp::client::SyncCmd::Create("sync a b").error(),
+            tftp::ParseStatus::kInvalidNumArgs);
+}
+
+TEST(CmdParseTest, CreateFsyncCmdParsesPolicy) {
+  auto cmd = tftp::client::FsyncCmd::Create("fsync dir");
+
+  ASSERT_TRUE(cmd);
+  ASSERT_EQ((*cmd)->Policy(), tftp::FsyncPolicy::kDirectory);
+  ASSERT_EQ(tftp::client::FsyncCmd::Create("fsync sometimes").error(),
+            tftp::ParseStatus::kUnknownFsyncPolicy);
+}
+
+TEST(CmdParseTest, CreateBusyPollCmdParsesMicroseconds) {
+  auto cmd = tftp::client::BusyPollCmd::Create("busypoll 50");
+
+  ASSERT_TRUE(cmd);
+  ASSERT_EQ((*cmd)->Usecs(), 50);
+  ASSERT_EQ((*tftp::client::BusyPollCmd::Create("busypoll off"))->Usecs(), 0);
+  ASSERT_EQ(tftp::client::BusyPollCmd::Create("busypoll").error(),
+            tftp::ParseStatus::kInvalidNumArgs);
+  ASSERT_EQ(tftp::client::BusyPollCmd::Create("busypoll 0").error(),
+            tftp::ParseStatus::kBusyPollOutOfRange);
+}
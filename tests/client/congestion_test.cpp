@@ -0,0 +1,86 @@
+#include "client/congestion.h"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <optional>
+
+using namespace std::chrono_literals;
+
+TEST(CongestionTest, FixedModeAlwaysUsesFullWindow) {
+  tftp::client::CongestionController cc(tftp::client::CongestionMode::kFixed,
+                                        32);
+
+  cc.OnTimeout(10);
+  cc.OnDupAck(5, 10);
+
+  ASSERT_EQ(cc.Window(), 32);
+}
+
+TEST(CongestionTest, AimdGrowsByOneBlockPerWindow) {
+  tftp::client::CongestionController cc(tftp::client::CongestionMode::kAimd,
+                                        32);
+  ASSERT_EQ(cc.Window(), tftp::client::CongestionController::kInitialWindow);
+
+  cc.OnAck(4, std::nullopt);
+  ASSERT_EQ(cc.Window(), 5);
+  cc.OnAck(4, std::nullopt);
+  ASSERT_EQ(cc.Window(), 5);
+  cc.OnAck(1, std::nullopt);
+  ASSERT_EQ(cc.Window(), 6);
+}
+
+TEST(CongestionTest, AimdIsCappedAtNegotiatedWindow) {
+  tftp::client::CongestionController cc(tftp::client::CongestionMode::kAimd,
+                                        6);
+
+  for (int i = 0; i < 100; ++i) {
+    cc.OnAck(1, std::nullopt);
+  }
+
+  ASSERT_EQ(cc.Window(), 6);
+}
+
+TEST(CongestionTest, AimdHalvesOncePerLossEvent) {
+  tftp::client::CongestionController cc(tftp::client::CongestionMode::kAimd,
+                                        64);
+  for (int i = 0; i < 100; ++i) {
+    cc.OnAck(1, std::nullopt);
+  }
+  uint16_t before = cc.Window();
+
+  cc.OnDupAck(50, 60);
+  cc.OnDupAck(50, 62); /* Same gap, same loss event. */
+
+  ASSERT_EQ(cc.Window(), before / 2);
+
+  cc.OnDupAck(70, 80); /* A block sent after the cut was lost. */
+  ASSERT_EQ(cc.Window(), before / 4);
+}
+
+TEST(CongestionTest, TimeoutNeverShrinksBelowOneBlock) {
+  tftp::client::CongestionController cc(tftp::client::CongestionMode::kAimd,
+                                        8);
+
+  for (int i = 0; i < 10; ++i) {
+    cc.OnTimeout(i);
+  }
+
+  ASSERT_EQ(cc.Window(), 1);
+}
+
+TEST(CongestionTest, DelayModeBacksOffWhenRttRises) {
+  tftp::client::CongestionController cc(tftp::client::CongestionMode::kDelay,
+                                        64);
+  for (int i = 0; i < 200; ++i) {
+    cc.OnAck(1, 1ms);
+  }
+  uint16_t grown = cc.Window();
+  ASSERT_GT(grown, tftp::client::CongestionController::kInitialWindow);
+
+  for (int i = 0; i < 200; ++i) {
+    cc.OnAck(1, 10ms);
+  }
+
+  ASSERT_LT(cc.Window(), grown);
+}
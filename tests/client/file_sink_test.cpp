@@ -0,0 +1,253 @@
+#include "client/file_sink.h"
+
+#include <fcntl.h>
+#include <gtest/gtest.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <csignal>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std::chrono_literals;
+using tftp::client::DirectSink;
+using tftp::client::PipeSink;
+
+class FileSinkTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    dir_ = std::filesystem::temp_directory_path() /
+           ("file_sink_test_" + std::to_string(::getpid()));
+    std::filesystem::create_directories(dir_);
+  }
+  void TearDown() override { std::filesystem::remove_all(dir_); }
+
+  std::string Path(const std::string& name) const {
+    return (dir_ / name).string();
+  }
+
+  std::filesystem::path dir_;
+};
+
+static std::vector<uint8_t> Pattern(std::size_t size) {
+  std::vector<uint8_t> data(size);
+  for (std::size_t i = 0; i < size; ++i) {
+    data[i] = static_cast<uint8_t>(i * 31 + i / 251);
+  }
+  return data;
+}
+
+/* Writes the data a block at a time, as a download would. */
+static void WriteBlocks(tftp::client::FileSink& sink,
+                        const std::vector<uint8_t>& data) {
+  for (std::size_t offset = 0; offset < data.size(); offset += 512) {
+    std::size_t len = std::min<std::size_t>(512, data.size() - offset);
+    ASSERT_TRUE(sink.Write(data.data() + offset, len));
+  }
+}
+
+static std::vector<uint8_t> ReadFile(const std::string& path) {
+  std::ifstream in(path, std::ios::binary);
+  return std::vector<uint8_t>(std::istreambuf_iterator<char>(in), {});
+}
+
+TEST_F(FileSinkTest, DirectSinkKeepsTheUnalignedTail) {
+  for (std::size_t size :
+       {std::size_t{0}, std::size_t{1}, DirectSink::kDefaultAlignment,
+        DirectSink::kChunkSize, 2 * DirectSink::kChunkSize + 123}) {
+    std::string path = Path(std::to_string(size));
+    auto sink = DirectSink::Open(path);
+    ASSERT_TRUE(sink) << sink.error().msg;
+
+    std::vector<uint8_t> data = Pattern(size);
+    WriteBlocks(**sink, data);
+    ASSERT_TRUE((*sink)->Close());
+    ASSERT_EQ(std::filesystem::file_size(path), size);
+    ASSERT_EQ(ReadFile(path), data);
+  }
+}
+
+TEST_F(FileSinkTest, DirectSinkStaysOutOfThePageCache) {
+  constexpr std::size_t kSize = 16 * DirectSink::kChunkSize + 7;
+  std::string path = Path("big");
+  auto sink = DirectSink::Open(path);
+  ASSERT_TRUE(sink) << sink.error().msg;
+  WriteBlocks(**sink, Pattern(kSize));
+  ASSERT_TRUE((*sink)->Close());
+
+  int fd = open(path.c_str(), O_RDONLY);
+  ASSERT_NE(fd, -1);
+  void* map = mmap(nullptr, kSize, PROT_READ, MAP_SHARED, fd, 0);
+  ASSERT_NE(map, MAP_FAILED);
+  std::size_t page = sysconf(_SC_PAGESIZE);
+  std::vector<unsigned char> resident((kSize + page - 1) / page);
+  ASSERT_EQ(mincore(map, kSize, resident.data()), 0);
+  munmap(map, kSize);
+  close(fd);
+
+  std::size_t cached = 0;
+  for (unsigned char r : resident) {
+    cached += r & 1;
+  }
+  ASSERT_LE(cached * page, DirectSink::kChunkSize);
+}
+
+TEST_F(FileSinkTest, OpenFileSinkPicksTheSink) {
+  auto buffered = tftp::client::OpenFileSink(Path("buffered"), false);
+  auto direct = tftp::client::OpenFileSink(Path("direct"), true);
+  ASSERT_TRUE(buffered && direct);
+  ASSERT_EQ(dynamic_cast<DirectSink*>(buffered->get()), nullptr);
+  ASSERT_NE(dynamic_cast<DirectSink*>(direct->get()), nullptr);
+
+  std::vector<uint8_t> data = Pattern(3000);
+  WriteBlocks(**buffered, data);
+  ASSERT_TRUE((*buffered)->Close());
+  ASSERT_EQ(ReadFile(Path("buffered")), data);
+}
+
+TEST_F(FileSinkTest, OpenFailsForAMissingDirectory) {
+  auto sink = DirectSink::Open(Path("missing/file"));
+  ASSERT_FALSE(sink);
+  ASSERT_NE(sink.error().msg.find("unable to open"), std::string::npos);
+}
+
+TEST_F(FileSinkTest, StreamSinkReservesWithoutGrowingTheFile) {
+  auto sink = tftp::client::StreamSink::Open(Path("f"));
+  ASSERT_TRUE(sink);
+  (*sink)->Reserve(8 << 20);
+
+  std::vector<uint8_t> data = Pattern(tftp::client::StreamSink::kBufferSize +
+                                      3000);
+  WriteBlocks(**sink, data);
+  /* Whole buffers are written behind the transfer, the rest at Close. */
+  ASSERT_EQ(std::filesystem::file_size(Path("f")),
+            tftp::client::StreamSink::kBufferSize);
+  ASSERT_TRUE((*sink)->Close());
+  ASSERT_EQ(ReadFile(Path("f")), data);
+}
+
+TEST_F(FileSinkTest, AtomicSinkPublishesTheWholeFile) {
+  std::ofstream(Path("f")) << "old";
+  auto sink = tftp::client::AtomicSink::Open(Path("f"), false,
+                                             tftp::FsyncPolicy::kDirectory);
+  ASSERT_TRUE(sink);
+  auto other = tftp::client::AtomicSink::Open(Path("f"), false,
+                                              tftp::FsyncPolicy::kNever);
+  ASSERT_NE((*sink)->Temp(), (*other)->Temp());
+
+  std::vector<uint8_t> data = Pattern(3000);
+  WriteBlocks(**sink, data);
+  ASSERT_TRUE((*sink)->Close());
+  ASSERT_EQ(ReadFile(Path("f")).size(), 3);
+  ASSERT_TRUE((*sink)->Publish());
+  ASSERT_EQ(ReadFile(Path("f")), data);
+  ASSERT_FALSE(std::filesystem::exists((*sink)->Temp()));
+
+  /* Dropped unpublished, the other leaves nothing behind. */
+  std::string temp = (*other)->Temp();
+  other->reset();
+  ASSERT_FALSE(std::filesystem::exists(temp));
+  ASSERT_EQ(ReadFile(Path("f")), data);
+}
+
+TEST_F(FileSinkTest, AtomicSinkTakesBlocksOutOfOrder) {
+  std::ofstream(Path("f")) << "old";
+  auto sink = tftp::client::AtomicSink::Open(Path("f"), false,
+                                             tftp::FsyncPolicy::kNever);
+  ASSERT_TRUE(sink);
+
+  /* As multicast blocks arrive, last one first. */
+  std::vector<uint8_t> data = Pattern(1300);
+  for (std::size_t offset : {1024, 0, 512}) {
+    std::size_t len = std::min<std::size_t>(512, data.size() - offset);
+    ASSERT_TRUE((*sink)->WriteAt(offset, data.data() + offset, len));
+  }
+  ASSERT_TRUE((*sink)->Close());
+  ASSERT_EQ(ReadFile(Path("f")).size(), 3);
+  ASSERT_TRUE((*sink)->Publish());
+  ASSERT_EQ(ReadFile(Path("f")), data);
+}
+
+TEST_F(FileSinkTest, PipeSinkBlocksOnASlowReader) {
+  constexpr std::size_t kCapacity = 64 << 10;
+  constexpr std::size_t kSize = 4 << 20;
+  int fds[2];
+  ASSERT_EQ(pipe(fds), 0);
+  auto sink = PipeSink::Open(fds[1], "pipe", kCapacity);
+  ASSERT_TRUE(sink);
+
+  std::vector<uint8_t> data = Pattern(kSize);
+  std::atomic<std::size_t> accepted = 0;
+  std::jthread producer([&] {
+    for (std::size_t offset = 0; offset < kSize; offset += 512) {
+      ASSERT_TRUE((*sink)->Write(data.data() + offset, 512));
+      accepted += 512;
+    }
+    ASSERT_TRUE((*sink)->Close());
+  });
+
+  /* Nobody reads yet, so only the pipe and the ring buffer can fill. */
+  std::this_thread::sleep_for(100ms);
+  std::size_t pipe_size = fcntl(fds[0], F_GETPIPE_SZ);
+  ASSERT_LE(accepted, pipe_size + kCapacity + 512);
+
+  std::vector<uint8_t> received;
+  std::vector<uint8_t> chunk(8192);
+  while (received.size() < kSize) {
+    ssize_t n = read(fds[0], chunk.data(), chunk.size());
+    ASSERT_GT(n, 0);
+    received.insert(received.end(), chunk.begin(), chunk.begin() + n);
+  }
+  producer.join();
+  close(fds[0]);
+  close(fds[1]);
+  ASSERT_EQ(received, data);
+}
+
+TEST_F(FileSinkTest, PipeSinkReportsAClosedReader) {
+  int fds[2];
+  ASSERT_EQ(pipe(fds), 0);
+  close(fds[0]);
+  auto sink = PipeSink::Open(fds[1], "pipe", 4096);
+  ASSERT_TRUE(sink);
+
+  /* EPIPE rather than a signal, as under a shell that ignores SIGPIPE. */
+  std::signal(SIGPIPE, SIG_IGN);
+  std::vector<uint8_t> data = Pattern(512);
+  ASSERT_TRUE((*sink)->Write(data.data(), data.size()));
+  auto closed = (*sink)->Close();
+  std::signal(SIGPIPE, SIG_DFL);
+  close(fds[1]);
+  ASSERT_FALSE(closed);
+  ASSERT_NE(closed.error().msg.find("unable to write 'pipe'"),
+            std::string::npos);
+}
+
+TEST_F(FileSinkTest, PublishCopyReplacesTheTarget) {
+  std::vector<uint8_t> data =
+      Pattern(tftp::client::StreamSink::kBufferSize + 100);
+  {
+    auto sink = tftp::client::StreamSink::Open(Path("src"));
+    ASSERT_TRUE(sink);
+    WriteBlocks(**sink, data);
+    ASSERT_TRUE((*sink)->Close());
+  }
+  std::ofstream(Path("dst")) << "old";
+
+  ASSERT_TRUE(tftp::client::PublishCopy(Path("src"), Path("dst"),
+                                        tftp::FsyncPolicy::kFile));
+  ASSERT_EQ(ReadFile(Path("dst")), data);
+  ASSERT_FALSE(tftp::client::PublishCopy(Path("missing"), Path("dst"),
+                                         tftp::FsyncPolicy::kNever));
+  ASSERT_EQ(ReadFile(Path("dst")), data);
+  ASSERT_EQ(std::distance(std::filesystem::directory_iterator(dir_), {}), 2);
+}
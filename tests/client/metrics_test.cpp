@@ -0,0 +1,270 @@
+#include "client/metrics.h"
+
+#include <fcntl.h>
+#include <gtest/gtest.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <string>
+
+#include "common/parse.h"
+#include "common/types.h"
+
+static std::string ReadFile(const std::string& path) {
+  std::ifstream in(path);
+  std::stringstream buffer;
+  buffer << in.rdbuf();
+  return buffer.str();
+}
+
+static tftp::client::TransferRecord MakeRecord(const std::string& file) {
+  tftp::client::TransferRecord record = {
+      .direction = "get", .host = "localhost", .file = file};
+  record.stats.bytes = 1024;
+  record.stats.retransmits = 3;
+  record.stats.elapsed = std::chrono::seconds(2);
+  return record;
+}
+
+TEST(MetricsTest, ParseMetricsFormatAcceptsKnownFormats) {
+  ASSERT_EQ(*tftp::client::ParseMetricsFormat("json"),
+            tftp::client::MetricsFormat::kJsonLines);
+  ASSERT_EQ(*tftp::client::ParseMetricsFormat("prometheus"),
+            tftp::client::MetricsFormat::kPrometheus);
+  ASSERT_EQ(tftp::client::ParseMetricsFormat("xml").error(),
+            tftp::ParseStatus::kUnknownMetricsFormat);
+}
+
+TEST(MetricsTest, FormatJsonReportsSuccess) {
+  std::string line = tftp::client::FormatJson(MakeRecord("a\"b"));
+
+  ASSERT_NE(line.find("\"file\":\"a\\\"b\""), std::string::npos);
+  ASSERT_NE(line.find("\"bytes\":1024"), std::string::npos);
+  ASSERT_NE(line.find("\"throughput_bytes_per_sec\":512"), std::string::npos);
+  ASSERT_NE(line.find("\"retransmits\":3"), std::string::npos);
+  ASSERT_NE(line.find("\"error_code\":null"), std::string::npos);
+  ASSERT_EQ(line.back(), '\n');
+}
+
+TEST(MetricsTest, FormatJsonReportsSocketBuffers) {
+  auto record = MakeRecord("big");
+  record.stats.buffers = {.wanted = 8256, .recv = 4128, .send = 8256};
+
+  std::string line = tftp::client::FormatJson(record);
+
+  ASSERT_NE(line.find("\"recv_buffer\":4128"), std::string::npos);
+  ASSERT_NE(line.find("\"send_buffer\":8256"), std::string::npos);
+  ASSERT_NE(line.find("\"buffer_wanted\":8256"), std::string::npos);
+}
+
+TEST(MetricsTest, FormatJsonReportsErrorCode) {
+  auto record = MakeRecord("missing");
+  record.err = tftp::client::TransferErr("not found",
+                                         tftp::ErrorCode::kFileNotFound);
+
+  std::string line = tftp::client::FormatJson(record);
+
+  ASSERT_NE(line.find("\"status\":\"error\""), std::string::npos);
+  ASSERT_NE(line.find("\"error_code\":1"), std::string::npos);
+}
+
+TEST(MetricsTest, FormatJsonReportsLatencyPercentiles) {
+  auto record = MakeRecord("a");
+  record.stats.RecordRtt(std::chrono::milliseconds(2));
+  record.stats.RecordRtt(std::chrono::milliseconds(4));
+
+  std::string line = tftp::client::FormatJson(record);
+
+  /* Percentiles are the top of their bucket, max is exact. */
+  ASSERT_NE(line.find("\"rtt_ms\":{\"count\":2,\"p50\":2.03"),
+            std::string::npos);
+  ASSERT_NE(line.find("\"max\":4}"), std::string::npos);
+  ASSERT_NE(line.find("\"disk_write_ms\":{\"count\":0,"), std::string::npos);
+}
+
+TEST(MetricsTest, JsonSinkAppendsOneLinePerTransfer) {
+  std::string path = testing::TempDir() + "metrics_test.jsonl";
+  std::remove(path.c_str());
+  {
+    auto sink = tftp::client::MetricsSink::Create(
+        path, tftp::client::MetricsFormat::kJsonLines);
+    ASSERT_TRUE(sink);
+    (*sink)->Write(MakeRecord("a"));
+    (*sink)->Write(MakeRecord("b"));
+  }
+
+  std::istringstream lines(ReadFile(path));
+  std::string line;
+  int count = 0;
+  while (std::getline(lines, line)) {
+    count++;
+  }
+  ASSERT_EQ(count, 2);
+}
+
+TEST(MetricsTest, PrometheusSinkRewritesLatestSeries) {
+  std::string path = testing::TempDir() + "metrics_test.prom";
+  auto sink = tftp::client::MetricsSink::Create(
+      path, tftp::client::MetricsFormat::kPrometheus);
+  ASSERT_TRUE(sink);
+
+  (*sink)->Write(MakeRecord("a"));
+  (*sink)->Write(MakeRecord("a"));
+  std::string text = ReadFile(path);
+
+  std::string series =
+      "tftpc_transfer_bytes{direction=\"get\",host=\"localhost\"} 1024\n";
+  ASSERT_NE(text.find(series), std::string::npos);
+  ASSERT_EQ(text.find(series), text.rfind(series));
+  ASSERT_NE(text.find("tftpc_transfers_total 2\n"), std::string::npos);
+}
+
+TEST(MetricsTest, PrometheusSinkReplacesTheFileWhole) {
+  std::string dir = testing::TempDir() + "metrics_replace_test";
+  std::filesystem::remove_all(dir);
+  std::filesystem::create_directory(dir);
+  std::string path = dir + "/tftpc.prom";
+  auto sink = tftp::client::MetricsSink::Create(
+      path, tftp::client::MetricsFormat::kPrometheus);
+  ASSERT_TRUE(sink);
+  (*sink)->Write(MakeRecord("a"));
+
+  /* A collector midway through the old file keeps reading all of it. */
+  std::ifstream collector(path);
+  std::string before = ReadFile(path);
+  (*sink)->Write(MakeRecord("b"));
+  std::stringstream seen;
+  seen << collector.rdbuf();
+
+  ASSERT_EQ(seen.str(), before);
+  ASSERT_NE(ReadFile(path).find("tftpc_transfers_total 2\n"),
+            std::string::npos);
+  ASSERT_EQ(std::distance(std::filesystem::directory_iterator(dir),
+                          std::filesystem::directory_iterator()),
+            1);
+}
+
+TEST(MetricsTest, PrometheusSinkKeepsOneSeriesPerHost) {
+  std::string path = testing::TempDir() + "metrics_host_test.prom";
+  auto sink = tftp::client::MetricsSink::Create(
+      path, tftp::client::MetricsFormat::kPrometheus);
+  ASSERT_TRUE(sink);
+
+  for (int i = 0; i < 100; ++i) {
+    (*sink)->Write(MakeRecord("file" + std::to_string(i)));
+  }
+  auto other = MakeRecord("file0");
+  other.host = "mirror";
+  (*sink)->Write(other);
+  std::string text = ReadFile(path);
+
+  int series = 0;
+  std::istringstream lines(text);
+  std::string line;
+  while (std::getline(lines, line)) {
+    series += line.starts_with("tftpc_transfer_bytes{");
+  }
+  ASSERT_EQ(series, 2);
+  ASSERT_EQ(text.find("file="), std::string::npos);
+  ASSERT_NE(text.find("tftpc_transfers_total 101\n"), std::string::npos);
+}
+
+TEST(MetricsTest, PrometheusSinkKeepsBoundedSeriesPerFile) {
+  std::string path = testing::TempDir() + "metrics_file_test.prom";
+  auto sink = tftp::client::MetricsSink::Create(
+      path, tftp::client::MetricsFormat::kPrometheus, 2);
+  ASSERT_TRUE(sink);
+
+  (*sink)->Write(MakeRecord("a"));
+  (*sink)->Write(MakeRecord("b"));
+  (*sink)->Write(MakeRecord("a"));
+  (*sink)->Write(MakeRecord("c"));
+  std::string text = ReadFile(path);
+
+  /* b was written least recently, so c took its place. */
+  std::string prefix =
+      "tftpc_transfer_bytes{direction=\"get\",host=\"localhost\",file=";
+  ASSERT_NE(text.find(prefix + "\"a\"} 1024\n"), std::string::npos);
+  ASSERT_NE(text.find(prefix + "\"c\"} 1024\n"), std::string::npos);
+  ASSERT_EQ(text.find(prefix + "\"b\"}"), std::string::npos);
+  ASSERT_NE(text.find("tftpc_transfers_total 4\n"), std::string::npos);
+}
+
+TEST(MetricsTest, ParseFileSeriesChecksTheRange) {
+  ASSERT_EQ(*tftp::client::ParseFileSeries("100"), 100);
+  ASSERT_EQ(tftp::client::ParseFileSeries("0").error(),
+            tftp::ParseStatus::kFileSeriesOutOfRange);
+  ASSERT_EQ(tftp::client::ParseFileSeries("10001").error(),
+            tftp::ParseStatus::kFileSeriesOutOfRange);
+  ASSERT_EQ(tftp::client::ParseFileSeries("x").error(),
+            tftp::ParseStatus::kFileSeriesOutOfRange);
+}
+
+TEST(MetricsTest, PrometheusOnAPipeIsWrittenOnceAtClose) {
+  int fds[2] = {-1, -1};
+  ASSERT_EQ(pipe2(fds, O_NONBLOCK), 0);
+  auto sink = tftp::client::MetricsSink::Create(
+      "fd:" + std::to_string(fds[1]),
+      tftp::client::MetricsFormat::kPrometheus);
+  ASSERT_TRUE(sink);
+
+  (*sink)->Write(MakeRecord("a"));
+  (*sink)->Write(MakeRecord("b"));
+  char buffer[16384];
+  ASSERT_EQ(read(fds[0], buffer, sizeof(buffer)), -1);
+  sink->reset();
+  ssize_t n = read(fds[0], buffer, sizeof(buffer));
+  close(fds[0]);
+  close(fds[1]);
+
+  ASSERT_GT(n, 0);
+  std::string text(buffer, n);
+  std::string type = "# TYPE tftpc_transfer_bytes gauge\n";
+  ASSERT_NE(text.find(type), std::string::npos);
+  ASSERT_EQ(text.find(type), text.rfind(type));
+  ASSERT_NE(text.find("tftpc_transfers_total 2\n"), std::string::npos);
+}
+
+TEST(MetricsTest, CreateOnAMissingDirectoryFails) {
+  auto sink = tftp::client::MetricsSink::Create(
+      testing::TempDir() + "no/such/dir/tftpc.prom",
+      tftp::client::MetricsFormat::kPrometheus);
+
+  ASSERT_FALSE(sink);
+}
+
+TEST(MetricsTest, PrometheusSinkSummarizesLatencies) {
+  std::string path = testing::TempDir() + "metrics_latency_test.prom";
+  auto sink = tftp::client::MetricsSink::Create(
+      path, tftp::client::MetricsFormat::kPrometheus);
+  ASSERT_TRUE(sink);
+
+  auto record = MakeRecord("a");
+  record.stats.Finish(std::chrono::seconds(2));
+  (*sink)->Write(record);
+  record.stats = {};
+  record.stats.Finish(std::chrono::seconds(4));
+  (*sink)->Write(record);
+  std::string text = ReadFile(path);
+
+  ASSERT_NE(text.find("# TYPE tftpc_transfer_seconds summary\n"),
+            std::string::npos);
+  ASSERT_NE(text.find("tftpc_transfer_seconds{quantile=\"0.5\"} 2.0"),
+            std::string::npos);
+  ASSERT_NE(text.find("tftpc_transfer_seconds{quantile=\"1\"} 4\n"),
+            std::string::npos);
+  ASSERT_NE(text.find("tftpc_transfer_seconds_sum 6\n"), std::string::npos);
+  ASSERT_NE(text.find("tftpc_transfer_seconds_count 2\n"), std::string::npos);
+  ASSERT_NE(text.find("tftpc_rtt_seconds_count 0\n"), std::string::npos);
+}
+
+TEST(MetricsTest, CreateWithInvalidFdFails) {
+  auto sink = tftp::client::MetricsSink::Create(
+      "fd:9999", tftp::client::MetricsFormat::kJsonLines);
+
+  ASSERT_FALSE(sink);
+}
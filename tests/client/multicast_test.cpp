@@ -0,0 +1,306 @@
+#include "client/multicast.h"
+
+#include <arpa/inet.h>
+#include <gtest/gtest.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "client/config.h"
+#include "client/stats.h"
+#include "common/pack.h"
+#include "common/types.h"
+#include "common/udp_socket.h"
+
+static constexpr const char* kGroup = "239.255.0.2";
+static constexpr uint16_t kGroupPort = 17582;
+
+static sockaddr_in Addr(const std::string& ip, uint16_t port) {
+  sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  inet_pton(AF_INET, ip.c_str(), &addr.sin_addr);
+  return addr;
+}
+
+/* The server side of a multicast download over loopback. Blocks go to the
+   group and OACKs and repairs to the client, all from one TID. */
+class McastServer {
+ public:
+  McastServer() : listen_(Bind()), tid_(Bind()) {
+    in_addr iface = Addr("127.0.0.1", 0).sin_addr;
+    setsockopt(tid_, IPPROTO_IP, IP_MULTICAST_IF, &iface, sizeof(iface));
+    unsigned char loop = 1;
+    setsockopt(tid_, IPPROTO_IP, IP_MULTICAST_LOOP, &loop, sizeof(loop));
+  }
+  ~McastServer() {
+    close(listen_);
+    close(tid_);
+  }
+
+  uint16_t Port() const { return LocalPort(listen_); }
+  uint16_t TidPort() const { return LocalPort(tid_); }
+
+  /* Waits for the RRQ and answers from the TID from then on. */
+  std::optional<tftp::ReadRequestMsg> AwaitRequest() {
+    auto packet = Recv(listen_, 1000);
+    if (!packet) {
+      return std::nullopt;
+    }
+    return tftp::UnpackReadRequest(*packet);
+  }
+
+  /* The block of the next ACK from the client, -1 for anything else. */
+  int NextAck(int timeout_ms = 1000) {
+    auto packet = Recv(tid_, timeout_ms);
+    if (!packet || packet->size() != 4 || (*packet)[1] != tftp::OpCode::kAck) {
+      return -1;
+    }
+    return ((*packet)[2] << 8) | (*packet)[3];
+  }
+
+  bool Silent(int timeout_ms) { return !Recv(tid_, timeout_ms); }
+
+  void ToClient(const tftp::TftpPacket& packet) {
+    sendto(tid_, packet.data(), packet.size(), 0,
+           reinterpret_cast<const sockaddr*>(&client_), sizeof(client_));
+  }
+
+  void ToGroup(const tftp::TftpPacket& packet) { ToGroup(tid_, packet); }
+
+  /* From another host that took the TID's port. */
+  void ToGroupFrom(const std::string& ip, const tftp::TftpPacket& packet) {
+    int fd = Bind(ip, TidPort());
+    in_addr iface = Addr("127.0.0.1", 0).sin_addr;
+    setsockopt(fd, IPPROTO_IP, IP_MULTICAST_IF, &iface, sizeof(iface));
+    ToGroup(fd, packet);
+    close(fd);
+  }
+
+ private:
+  static int Bind(const std::string& ip = "127.0.0.1", uint16_t port = 0) {
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    sockaddr_in addr = Addr(ip, port);
+    EXPECT_EQ(bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)), 0);
+    return fd;
+  }
+
+  static uint16_t LocalPort(int fd) {
+    sockaddr_in addr = {};
+    socklen_t len = sizeof(addr);
+    getsockname(fd, reinterpret_cast<sockaddr*>(&addr), &len);
+    return ntohs(addr.sin_port);
+  }
+
+  static void ToGroup(int fd, const tftp::TftpPacket& packet) {
+    sockaddr_in group = Addr(kGroup, kGroupPort);
+    sendto(fd, packet.data(), packet.size(), 0,
+           reinterpret_cast<const sockaddr*>(&group), sizeof(group));
+  }
+
+  std::optional<tftp::TftpPacket> Recv(int fd, int timeout_ms) {
+    pollfd pfd = {.fd = fd, .events = POLLIN, .revents = 0};
+    if (poll(&pfd, 1, timeout_ms) != 1) {
+      return std::nullopt;
+    }
+    tftp::TftpPacket packet(1024);
+    socklen_t len = sizeof(client_);
+    ssize_t n = recvfrom(fd, packet.data(), packet.size(), 0,
+                         reinterpret_cast<sockaddr*>(&client_), &len);
+    if (n < 0) {
+      return std::nullopt;
+    }
+    packet.resize(n);
+    return packet;
+  }
+
+  int listen_ = -1;
+  int tid_ = -1;
+  sockaddr_in client_ = {};
+};
+
+static tftp::TftpPacket OptionAck(const std::string& multicast,
+                                  std::optional<uint64_t> tsize = {}) {
+  tftp::OptionAckMsg oack = {
+      .options = {{tftp::OptionName::kMulticast, multicast}}};
+  if (tsize) {
+    oack.options[tftp::OptionName::kTsize] = std::to_string(*tsize);
+  }
+  return tftp::PackOptionAck(oack);
+}
+
+static tftp::TftpPacket Block(const std::vector<uint8_t>& file,
+                              uint16_t block) {
+  auto begin = file.begin() + (block - 1) * 512;
+  auto end = (file.end() - begin > 512) ? begin + 512 : file.end();
+  return tftp::PackData(
+      {.block_num = block, .data = tftp::BlockData(begin, end)});
+}
+
+TEST(MulticastTest, ParseMulticastOptionReturnsGroupPortAndMaster) {
+  auto option = tftp::client::ParseMulticastOption("239.255.0.1,1758,1");
+
+  ASSERT_TRUE(option);
+  ASSERT_EQ(option->group, "239.255.0.1");
+  ASSERT_EQ(option->port, 1758);
+  ASSERT_TRUE(option->master);
+}
+
+TEST(MulticastTest, ParseMulticastOptionAcceptsEmptyGroupAndPort) {
+  auto option = tftp::client::ParseMulticastOption(",,0");
+
+  ASSERT_TRUE(option);
+  ASSERT_TRUE(option->group.empty());
+  ASSERT_EQ(option->port, 0);
+  ASSERT_FALSE(option->master);
+}
+
+TEST(MulticastTest, ParseMulticastOptionRejectsMalformedValues) {
+  ASSERT_FALSE(tftp::client::ParseMulticastOption(""));
+  ASSERT_FALSE(tftp::client::ParseMulticastOption("239.255.0.1,1758"));
+  ASSERT_FALSE(tftp::client::ParseMulticastOption("239.255.0.1,99999,1"));
+  ASSERT_FALSE(tftp::client::ParseMulticastOption("239.255.0.1,1758,2"));
+}
+
+TEST(MulticastTest, McastRecverRejectsUnicastGroup) {
+  ASSERT_FALSE(tftp::UdpSocketMcastRecver::Create("127.0.0.1", 17580));
+}
+
+TEST(MulticastTest, McastRecverReceivesLoopedBackDatagram) {
+  constexpr uint16_t kPort = 17581;
+  auto recver =
+      tftp::UdpSocketMcastRecver::Create("239.255.0.1", kPort, "127.0.0.1");
+  if (!recver) {
+    GTEST_SKIP() << "multicast unavailable: " << recver.error();
+  }
+  auto sender = tftp::UdpSocketSender::Create("239.255.0.1", kPort);
+  ASSERT_TRUE(sender);
+  ASSERT_TRUE(sender->SetMulticastInterface("127.0.0.1", true));
+
+  std::array<uint8_t, 4> out = {0x0, 0x3, 0x0, 0x1};
+  ASSERT_TRUE(sender->Send(out.data(), out.size()));
+
+  std::array<uint8_t, 16> in = {};
+  auto num_bytes = recver->Recv(in.data(), in.size());
+  ASSERT_TRUE(num_bytes);
+  ASSERT_EQ(*num_bytes, out.size());
+  ASSERT_EQ(in[3], 0x1);
+}
+
+TEST(MulticastTest, GetFileMulticastFillsGapsAndAcksAsMaster) {
+  if (!tftp::UdpSocketMcastRecver::Create(kGroup, kGroupPort, "127.0.0.1")) {
+    GTEST_SKIP() << "multicast unavailable";
+  }
+  std::vector<uint8_t> file(4 * 512 + 100);
+  for (std::size_t i = 0; i < file.size(); ++i) {
+    file[i] = static_cast<uint8_t>(i % 251);
+  }
+  std::string local = testing::TempDir() + "multicast_get_test";
+  std::filesystem::remove(local);
+
+  McastServer server;
+  std::optional<tftp::ReadRequestMsg> rrq;
+  std::vector<int> acks;
+  bool silent = false;
+  bool published_early = true;
+  std::jthread script([&] {
+    rrq = server.AwaitRequest();
+    server.ToClient(OptionAck(std::string(kGroup) + "," +
+                                  std::to_string(kGroupPort) + ",1",
+                              file.size()));
+    acks.push_back(server.NextAck());
+    /* Block 2 is lost and 5 overtakes 3 and 4. */
+    for (uint16_t block : {1, 3, 5}) {
+      server.ToGroup(Block(file, block));
+      acks.push_back(server.NextAck());
+    }
+    /* Another client takes over as master, this one keeps quiet. */
+    server.ToClient(OptionAck(",,0"));
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    server.ToGroup(Block(file, 2));
+    silent = server.Silent(300);
+    /* Back to master, it asks for what it still lacks. */
+    server.ToClient(OptionAck(",,1"));
+    acks.push_back(server.NextAck());
+    published_early = std::filesystem::exists(local);
+    server.ToClient(Block(file, 4));
+    acks.push_back(server.NextAck());
+  });
+
+  tftp::client::Config conf(tftp::SendMode::kOctet, {.start = 0, .end = 0},
+                            false, "127.0.0.1", 5, 1);
+  tftp::client::TransferStats stats;
+  auto result = tftp::client::GetFileMulticast(conf, "127.0.0.1",
+                                               server.Port(), "file", local,
+                                               stats);
+  script.join();
+
+  ASSERT_TRUE(result) << result.error().msg;
+  ASSERT_TRUE(rrq);
+  ASSERT_TRUE(rrq->options.contains(tftp::OptionName::kMulticast));
+  /* The gap ACKs hold at block 1 while block 2 is missing, the final ACK
+     names the last block. */
+  ASSERT_EQ(acks, (std::vector<int>{0, 1, 1, 1, 3, 5}));
+  ASSERT_TRUE(silent);
+  ASSERT_FALSE(published_early);
+  std::ifstream in(local, std::ios::binary);
+  std::vector<uint8_t> written((std::istreambuf_iterator<char>(in)),
+                               std::istreambuf_iterator<char>());
+  ASSERT_EQ(written, file);
+  ASSERT_EQ(stats.blocks, 5);
+  ASSERT_EQ(stats.duplicates, 0);
+}
+
+TEST(MulticastTest, GetFileMulticastIgnoresBlocksFromOtherHosts) {
+  if (!tftp::UdpSocketMcastRecver::Create(kGroup, kGroupPort, "127.0.0.1")) {
+    GTEST_SKIP() << "multicast unavailable";
+  }
+  std::vector<uint8_t> file(100, 'a');
+  std::vector<uint8_t> forged(100, 'x');
+  std::string local = testing::TempDir() + "multicast_forged_test";
+  std::filesystem::remove(local);
+
+  McastServer server;
+  std::vector<int> acks;
+  std::jthread script([&] {
+    server.AwaitRequest();
+    server.ToClient(OptionAck(std::string(kGroup) + "," +
+                                  std::to_string(kGroupPort) + ",1",
+                              file.size()));
+    acks.push_back(server.NextAck());
+    /* Same port as the TID, different address: not the server. */
+    server.ToGroupFrom("127.0.0.2", Block(forged, 1));
+    acks.push_back(server.NextAck(300));
+    server.ToGroup(Block(file, 1));
+    acks.push_back(server.NextAck());
+  });
+
+  tftp::client::Config conf(tftp::SendMode::kOctet, {.start = 0, .end = 0},
+                            false, "127.0.0.1", 5, 1);
+  tftp::client::TransferStats stats;
+  auto result = tftp::client::GetFileMulticast(conf, "127.0.0.1",
+                                               server.Port(), "file", local,
+                                               stats);
+  script.join();
+
+  ASSERT_TRUE(result) << result.error().msg;
+  /* The forged block got no ACK, the real one did. */
+  ASSERT_EQ(acks, (std::vector<int>{0, -1, 1}));
+  std::ifstream in(local, std::ios::binary);
+  std::vector<uint8_t> written((std::istreambuf_iterator<char>(in)),
+                               std::istreambuf_iterator<char>());
+  ASSERT_EQ(written, file);
+  ASSERT_EQ(stats.blocks, 1);
+}
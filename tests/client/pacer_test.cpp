@@ -0,0 +1,66 @@
+#include "client/pacer.h"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+
+using namespace std::chrono_literals;
+using tftp::client::TokenBucket;
+
+TEST(PacerTest, DefaultBurstIsAMillisecondOrOneFrame) {
+  ASSERT_EQ(TokenBucket(10'000'000).Burst(), 10'000);
+  ASSERT_EQ(TokenBucket(64'000).Burst(), TokenBucket::kMinBurst);
+  ASSERT_EQ(TokenBucket(64'000, 4096).Burst(), 4096);
+}
+
+TEST(PacerTest, BurstGoesOutImmediately) {
+  auto now = TokenBucket::Clock::now();
+  TokenBucket bucket(100'000, 1000);
+
+  ASSERT_EQ(bucket.Take(500, now), 0us);
+  ASSERT_EQ(bucket.Take(500, now), 0us);
+}
+
+TEST(PacerTest, OverdraftWaitsAtTheRate) {
+  auto now = TokenBucket::Clock::now();
+  TokenBucket bucket(100'000, 1000);
+
+  ASSERT_EQ(bucket.Take(1000, now), 0us);
+  ASSERT_EQ(bucket.Take(500, now), 5ms);
+  ASSERT_EQ(bucket.Take(500, now), 10ms); /* Queued behind the first. */
+}
+
+TEST(PacerTest, RefillsOverTimeUpToTheBurst) {
+  auto now = TokenBucket::Clock::now();
+  TokenBucket bucket(100'000, 1000);
+
+  ASSERT_EQ(bucket.Take(1000, now), 0us);
+  ASSERT_EQ(bucket.Take(1000, now + 10ms), 0us);
+  ASSERT_EQ(bucket.Take(1000, now + 1s), 0us);
+  ASSERT_EQ(bucket.Take(1000, now + 1s), 10ms);
+}
+
+TEST(PacerTest, SustainedRateMatches) {
+  auto start = TokenBucket::Clock::now();
+  auto now = start;
+  TokenBucket bucket(1'000'000, 1500);
+
+  /* Send each packet as soon as the bucket allows, 1 MB in all. */
+  for (int i = 0; i < 1000; ++i) {
+    now += bucket.Take(1000, now);
+  }
+
+  /* The first 1500 bytes ride on the initial burst. */
+  std::chrono::duration<double> elapsed = now - start;
+  ASSERT_NEAR(elapsed.count(), 0.9985, 0.001);
+}
+
+TEST(PacerTest, RunsOnTheCallersClock) {
+  /* A virtual clock that starts long before the bucket was built. */
+  TokenBucket bucket(100'000, 1000);
+  auto now = TokenBucket::Clock::time_point{};
+
+  ASSERT_EQ(bucket.Take(1000, now), 0us);
+  ASSERT_EQ(bucket.Take(1000, now), 10ms);
+  ASSERT_EQ(bucket.Take(1000, now + 30ms), 0us);
+}
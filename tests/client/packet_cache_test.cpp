@@ -0,0 +1,108 @@
+#include "client/packet_cache.h"
+
+#include <gtest/gtest.h>
+#include <unistd.h>
+
+#include <cstddef>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#include "common/block_seq.h"
+#include "common/codec.h"
+#include "common/types.h"
+
+using tftp::BlockSeq;
+using tftp::client::PacketArena;
+using tftp::client::PacketCache;
+
+class PacketCacheTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    dir_ = std::filesystem::temp_directory_path() /
+           ("packet_cache_test_" + std::to_string(::getpid()));
+    std::filesystem::create_directories(dir_);
+  }
+  void TearDown() override { std::filesystem::remove_all(dir_); }
+
+  std::string Write(const std::string& name, std::size_t size) const {
+    std::string path = (dir_ / name).string();
+    std::ofstream(path, std::ios::binary) << std::string(size, 'x');
+    return path;
+  }
+
+  std::filesystem::path dir_;
+};
+
+TEST_F(PacketCacheTest, ArenaHoldsEveryDataPacket) {
+  std::istringstream in(std::string(1100, 'x'));
+  auto arena = PacketArena::Build(in, false, BlockSeq(), 1 << 20);
+  ASSERT_TRUE(arena);
+  ASSERT_EQ(arena->Blocks(), 3);
+  ASSERT_EQ(arena->Size(), 1100 + 3 * 4);
+
+  auto last = tftp::codec::DecodeAs<tftp::codec::DataView>(arena->Packet(3));
+  ASSERT_TRUE(last);
+  ASSERT_EQ(last->block_num, 3);
+  ASSERT_EQ(last->data.size(), 76);
+
+  /* A file of whole blocks ends with an empty one. */
+  std::istringstream whole(std::string(1024, 'x'));
+  arena = PacketArena::Build(whole, false, BlockSeq(), 1 << 20);
+  ASSERT_EQ(arena->Blocks(), 3);
+  ASSERT_EQ(arena->Packet(3).size(), 4);
+
+  std::istringstream big(std::string(1100, 'x'));
+  ASSERT_FALSE(PacketArena::Build(big, false, BlockSeq(), 1000));
+}
+
+TEST_F(PacketCacheTest, ArenaEncodesNetascii) {
+  std::istringstream in("a\nb");
+  auto arena = PacketArena::Build(in, true, BlockSeq(), 1 << 20);
+  auto data = tftp::codec::DecodeAs<tftp::codec::DataView>(arena->Packet(1));
+  ASSERT_TRUE(data);
+  ASSERT_EQ(std::string(data->data.begin(), data->data.end()), "a\r\nb");
+}
+
+TEST_F(PacketCacheTest, HitsUntilTheFileChanges) {
+  PacketCache cache;
+  std::string path = Write("f", 2000);
+  auto first = cache.Get(path, tftp::SendMode::kOctet, BlockSeq());
+  ASSERT_TRUE(first);
+  ASSERT_EQ(cache.Get(path, tftp::SendMode::kOctet, BlockSeq()), first);
+  ASSERT_EQ(cache.Hits(), 1);
+
+  /* Each mode and rollover has its own packets. */
+  ASSERT_NE(cache.Get(path, tftp::SendMode::kNetAscii, BlockSeq()), first);
+  ASSERT_NE(cache.Get(path, tftp::SendMode::kOctet,
+                      BlockSeq(tftp::Rollover::kToOne)),
+            first);
+  ASSERT_EQ(cache.Hits(), 1);
+
+  Write("f", 3000);
+  auto second = cache.Get(path, tftp::SendMode::kOctet, BlockSeq());
+  ASSERT_NE(second, first);
+  ASSERT_EQ(second->Blocks(), 6);
+  ASSERT_EQ(first->Blocks(), 4);
+}
+
+TEST_F(PacketCacheTest, EvictsTheLeastRecentlyUsed) {
+  PacketCache cache(4000);
+  ASSERT_FALSE(cache.Get(Write("big", 1000), tftp::SendMode::kOctet,
+                         BlockSeq()));
+  ASSERT_FALSE(cache.Get((dir_ / "missing").string(), tftp::SendMode::kOctet,
+                         BlockSeq()));
+
+  /* 608 bytes of packets each, the seventh pushes the first out. */
+  for (int i = 0; i < 7; ++i) {
+    auto path = Write(std::to_string(i), 600);
+    ASSERT_TRUE(cache.Get(path, tftp::SendMode::kOctet, BlockSeq()));
+    ASSERT_LE(cache.Size(), 4000);
+  }
+  ASSERT_EQ(cache.Size(), 6 * 608);
+  cache.Get((dir_ / "1").string(), tftp::SendMode::kOctet, BlockSeq());
+  ASSERT_EQ(cache.Hits(), 1);
+  cache.Get((dir_ / "0").string(), tftp::SendMode::kOctet, BlockSeq());
+  ASSERT_EQ(cache.Hits(), 1);
+}
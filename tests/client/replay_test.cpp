@@ -0,0 +1,262 @@
+#include "client/replay.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "client/config.h"
+#include "client/transfer.h"
+#include "common/codec.h"
+#include "common/pack.h"
+#include "common/tracer.h"
+#include "common/types.h"
+
+using namespace std::chrono_literals;
+using tftp::OpCode;
+using tftp::client::Replay;
+using tftp::client::ReplayDirection;
+using tftp::client::ReplayEvent;
+using tftp::client::ReplayResult;
+using tftp::client::ReplayScenario;
+using tftp::client::ReplaySend;
+
+static tftp::client::Config OctetConfig() {
+  /* A 1 s retransmit timeout and 10 s overall, on the virtual clock. */
+  return tftp::client::Config(tftp::SendMode::kOctet, {.start = 0, .end = 0},
+                              false, "127.0.0.1", 10, 1);
+}
+
+static ReplayEvent Datagram(std::chrono::milliseconds at, uint16_t port,
+                            tftp::TftpPacket packet) {
+  return {.kind = ReplayEvent::Kind::kDatagram,
+          .at = at,
+          .from_port = port,
+          .packet = std::move(packet)};
+}
+
+static ReplayEvent Timeout() {
+  return {.kind = ReplayEvent::Kind::kTimeout,
+          .at = {},
+          .from_port = 0,
+          .packet = {}};
+}
+
+static tftp::TftpPacket Data(uint16_t block, std::size_t len) {
+  return tftp::PackData({.block_num = block, .data = tftp::BlockData(len)});
+}
+
+static ReplaySend Sent(uint8_t opcode, uint16_t block = 0) {
+  return {.opcode = opcode, .block = block};
+}
+
+/* Three blocks with the second lost once. */
+static ReplayScenario LossyGet() {
+  ReplayScenario scenario;
+  scenario.events = {Datagram(1ms, 5000, Data(1, 512)), Timeout(),
+                     Datagram(1003ms, 5000, Data(2, 512)),
+                     Datagram(1005ms, 5000, Data(3, 100))};
+  scenario.expected = {Sent(OpCode::kReadReq), Sent(OpCode::kAck, 1),
+                       Sent(OpCode::kAck, 1), Sent(OpCode::kAck, 2),
+                       Sent(OpCode::kAck, 3)};
+  return scenario;
+}
+
+TEST(ReplayTest, GetRecoversFromALostBlock) {
+  auto conf = OctetConfig();
+  ReplayResult result = Replay(conf, LossyGet());
+  ASSERT_TRUE(result.outcome) << result.outcome.error().msg;
+  ASSERT_FALSE(result.divergence) << *result.divergence;
+  ASSERT_EQ(result.received.size(), 1124);
+  ASSERT_EQ(result.events, 4);
+  ASSERT_EQ(result.stats.timeouts, 1);
+  ASSERT_EQ(result.stats.retransmits, 1);
+  ASSERT_EQ(result.stats.elapsed, 1005ms);
+  ASSERT_GT(result.busy.count(), 0);
+}
+
+TEST(ReplayTest, ALateDatagramTimesOutOnTheVirtualClock) {
+  auto conf = OctetConfig();
+  ReplayScenario scenario;
+  scenario.events = {Datagram(1ms, 5000, Data(1, 512)),
+                     Datagram(2500ms, 5000, Data(2, 0))};
+  ReplayResult result = Replay(conf, scenario);
+  ASSERT_TRUE(result.outcome);
+  ASSERT_EQ(result.stats.timeouts, 2);
+  ASSERT_EQ(result.stats.elapsed, 2500ms);
+  /* Timeouts are events the engine handles too. */
+  ASSERT_EQ(result.events, 4);
+}
+
+TEST(ReplayTest, LockStepGetAcksARepeatedBlockAgain) {
+  auto conf = OctetConfig();
+  ReplayScenario scenario;
+  /* The ACK for block 1 is lost, so the server sends block 1 again. */
+  scenario.events = {Datagram(1ms, 5000, Data(1, 512)),
+                     Datagram(1001ms, 5000, Data(1, 512)),
+                     Datagram(1002ms, 5000, Data(2, 100))};
+  scenario.expected = {Sent(OpCode::kReadReq), Sent(OpCode::kAck, 1),
+                       Sent(OpCode::kAck, 1), Sent(OpCode::kAck, 2)};
+  ReplayResult result = Replay(conf, scenario);
+  ASSERT_TRUE(result.outcome) << result.outcome.error().msg;
+  ASSERT_FALSE(result.divergence) << *result.divergence;
+  ASSERT_EQ(result.received.size(), 612);
+  ASSERT_EQ(result.stats.duplicates, 1);
+}
+
+TEST(ReplayTest, PutRejectsStrayPackets) {
+  auto conf = OctetConfig();
+  ReplayScenario scenario;
+  scenario.direction = ReplayDirection::kPut;
+  scenario.put_size = 522;
+  scenario.events = {Datagram(1ms, 5000, tftp::PackAck({.block_num = 0})),
+                     Datagram(2ms, 6000, tftp::PackAck({.block_num = 1})),
+                     Datagram(3ms, 5000, tftp::PackAck({.block_num = 1})),
+                     Datagram(4ms, 5000, tftp::PackAck({.block_num = 2}))};
+  /* The stray gets an ERROR 5 and the transfer carries on. */
+  scenario.expected = {Sent(OpCode::kWriteReq), Sent(OpCode::kData, 1),
+                       Sent(OpCode::kError), Sent(OpCode::kData, 2)};
+  ReplayResult result = Replay(conf, scenario);
+  ASSERT_TRUE(result.outcome) << result.outcome.error().msg;
+  ASSERT_FALSE(result.divergence) << *result.divergence;
+  ASSERT_EQ(result.stats.blocks, 2);
+  ASSERT_EQ(result.stats.bytes, 522);
+}
+
+TEST(ReplayTest, GetAcksAGapInAWindowOnce) {
+  auto conf = OctetConfig();
+  conf.windowsize = 4;
+  ReplayScenario scenario;
+  /* Block 2 is lost, 3 and 4 land after the gap. The server restarts the
+     window at 2 on the one gap ACK. */
+  scenario.events = {
+      Datagram(1ms, 5000,
+               tftp::PackOptionAck(
+                   {.options = {{tftp::OptionName::kWindowSize, "4"}}})),
+      Datagram(2ms, 5000, Data(1, 512)), Datagram(2ms, 5000, Data(3, 512)),
+      Datagram(2ms, 5000, Data(4, 512)), Datagram(3ms, 5000, Data(2, 512)),
+      Datagram(3ms, 5000, Data(3, 512)), Datagram(3ms, 5000, Data(4, 512)),
+      Datagram(3ms, 5000, Data(5, 512)), Datagram(4ms, 5000, Data(6, 100))};
+  scenario.expected = {Sent(OpCode::kReadReq), Sent(OpCode::kAck, 0),
+                       Sent(OpCode::kAck, 1), Sent(OpCode::kAck, 5),
+                       Sent(OpCode::kAck, 6)};
+  ReplayResult result = Replay(conf, scenario);
+  ASSERT_TRUE(result.outcome) << result.outcome.error().msg;
+  ASSERT_FALSE(result.divergence) << *result.divergence;
+  ASSERT_EQ(result.received.size(), 5 * 512 + 100);
+  ASSERT_EQ(result.stats.window, 4);
+}
+
+TEST(ReplayTest, ReportsWhereTheEngineDiverged) {
+  auto conf = OctetConfig();
+  ReplayScenario scenario = LossyGet();
+  scenario.expected[2] = Sent(OpCode::kAck, 2);
+  ReplayResult result = Replay(conf, scenario);
+  ASSERT_TRUE(result.outcome);
+  ASSERT_EQ(result.divergence, "send 2: expected ACK 2, got ACK 1");
+
+  scenario = LossyGet();
+  scenario.expected.push_back(Sent(OpCode::kAck, 4));
+  result = Replay(conf, scenario);
+  ASSERT_EQ(result.divergence, "sent 5 packets of 6");
+}
+
+TEST(ReplayTest, RunningOutOfEventsFailsTheTransfer) {
+  auto conf = OctetConfig();
+  ReplayScenario scenario = LossyGet();
+  scenario.events.pop_back();
+  ReplayResult result = Replay(conf, scenario);
+  ASSERT_FALSE(result.outcome);
+  ASSERT_EQ(result.outcome.error().msg, "replay ran out of events");
+}
+
+TEST(ReplayTest, ReplaysAreDeterministic) {
+  auto conf = OctetConfig();
+  ReplayScenario scenario = LossyGet();
+  ReplayResult first = Replay(conf, scenario);
+  for (int i = 0; i < 1000; ++i) {
+    ReplayResult result = Replay(conf, scenario);
+    ASSERT_EQ(result.sent, first.sent);
+    ASSERT_EQ(result.stats.elapsed, first.stats.elapsed);
+    ASSERT_EQ(result.received, first.received);
+  }
+}
+
+static tftp::TraceRecord Event(uint64_t ms, tftp::TraceEvent event,
+                               uint8_t opcode = 0, uint16_t block = 0,
+                               uint16_t length = 0) {
+  tftp::TraceRecord record;
+  record.time_ns = ms * 1000000;
+  record.local_port = 1000;
+  bool request = (opcode == OpCode::kReadReq || opcode == OpCode::kWriteReq);
+  record.peer_port = (request) ? 69 : 5000;
+  record.block = block;
+  record.length = length;
+  record.event = event;
+  record.opcode = opcode;
+  return record;
+}
+
+TEST(ReplayTest, ReplaysATracedGet) {
+  using tftp::TraceEvent;
+  tftp::Trace trace;
+  trace.records = {Event(0, TraceEvent::kSend, OpCode::kReadReq, 0, 12),
+                   Event(2, TraceEvent::kRecv, OpCode::kData, 1, 516),
+                   Event(3, TraceEvent::kSend, OpCode::kAck, 1, 4),
+                   Event(1003, TraceEvent::kTimeout),
+                   Event(1003, TraceEvent::kResend, OpCode::kAck, 1, 4),
+                   Event(1005, TraceEvent::kRecv, OpCode::kData, 2, 20),
+                   Event(1006, TraceEvent::kSend, OpCode::kAck, 2, 4)};
+  auto timelines = tftp::BuildTimelines(trace, UINT64_MAX);
+  ASSERT_EQ(timelines.size(), 1);
+
+  auto conf = OctetConfig();
+  auto scenario = tftp::client::ScenarioFromTimeline(timelines[0], conf);
+  ASSERT_TRUE(scenario);
+  ASSERT_EQ(scenario->direction, ReplayDirection::kGet);
+  ASSERT_EQ(scenario->events.size(), 3);
+  ASSERT_EQ(scenario->expected.size(), 4);
+
+  ReplayResult result = Replay(conf, *scenario);
+  ASSERT_TRUE(result.outcome) << result.outcome.error().msg;
+  ASSERT_FALSE(result.divergence) << *result.divergence;
+  ASSERT_EQ(result.received.size(), 528);
+}
+
+TEST(ReplayTest, ReplaysATracedPutWithItsOptions) {
+  using tftp::TraceEvent;
+  tftp::Trace trace;
+  trace.records = {Event(0, TraceEvent::kSend, OpCode::kWriteReq, 0, 30),
+                   Event(1, TraceEvent::kRecv, OpCode::kOptionAck, 0, 16),
+                   Event(2, TraceEvent::kSend, OpCode::kData, 1, 516),
+                   Event(2, TraceEvent::kSend, OpCode::kData, 2, 516),
+                   Event(3, TraceEvent::kSend, OpCode::kData, 3, 104),
+                   Event(5, TraceEvent::kRecv, OpCode::kAck, 3, 4)};
+  auto timelines = tftp::BuildTimelines(trace, UINT64_MAX);
+
+  auto conf = OctetConfig();
+  conf.windowsize = 4;
+  auto scenario = tftp::client::ScenarioFromTimeline(timelines[0], conf);
+  ASSERT_TRUE(scenario);
+  ASSERT_EQ(scenario->direction, ReplayDirection::kPut);
+  ASSERT_EQ(scenario->put_size, 1124);
+
+  ReplayResult result = Replay(conf, *scenario);
+  ASSERT_TRUE(result.outcome) << result.outcome.error().msg;
+  ASSERT_FALSE(result.divergence) << *result.divergence;
+  ASSERT_EQ(result.stats.window, 4);
+}
+
+TEST(ReplayTest, ATimelineMustStartWithItsRequest) {
+  tftp::TraceTimeline timeline;
+  timeline.local_port = 1000;
+  timeline.events = {Event(0, tftp::TraceEvent::kRecv, OpCode::kData, 1, 4)};
+  auto scenario =
+      tftp::client::ScenarioFromTimeline(timeline, OctetConfig());
+  ASSERT_FALSE(scenario);
+  ASSERT_EQ(scenario.error().msg,
+            "the transfer on port 1000 doesn't start with its request");
+}
@@ -0,0 +1,289 @@
+#include "client/scheduler.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "client/script.h"
+#include "client/work_deque.h"
+
+using namespace std::chrono_literals;
+using tftp::client::SchedulerLimits;
+using tftp::client::TransferScheduler;
+using tftp::client::WorkDeque;
+
+TEST(WorkDequeTest, OwnerTakesNewestThievesStealOldest) {
+  WorkDeque<int> deque;
+  deque.Push(1);
+  deque.Push(2);
+  deque.Push(3);
+
+  ASSERT_EQ(deque.Size(), 3);
+  ASSERT_EQ(deque.Steal(), 1);
+  ASSERT_EQ(deque.Take(), 3);
+  ASSERT_EQ(deque.Take(), 2);
+  ASSERT_FALSE(deque.Take());
+  ASSERT_FALSE(deque.Steal());
+}
+
+TEST(WorkDequeTest, GrowsPastItsCapacity) {
+  WorkDeque<int> deque(2);
+  for (int i = 0; i < 100; ++i) {
+    deque.Push(i);
+  }
+
+  ASSERT_EQ(deque.Size(), 100);
+  for (int i = 99; i >= 0; --i) {
+    ASSERT_EQ(deque.Take(), i);
+  }
+}
+
+TEST(WorkDequeTest, EveryItemIsTakenExactlyOnce) {
+  constexpr int kItems = 100'000;
+  WorkDeque<int> deque(4);
+  std::vector<std::atomic<int>> seen(kItems);
+  std::atomic<bool> done = false;
+
+  std::vector<std::jthread> thieves;
+  for (int i = 0; i < 3; ++i) {
+    thieves.emplace_back([&] {
+      while (!done || deque.Size()) {
+        if (auto item = deque.Steal()) {
+          seen[*item]++;
+        }
+      }
+    });
+  }
+  for (int i = 0; i < kItems; ++i) {
+    deque.Push(i);
+    if (i % 3 == 0) {
+      if (auto item = deque.Take()) {
+        seen[*item]++;
+      }
+    }
+  }
+  while (auto item = deque.Take()) {
+    seen[*item]++;
+  }
+  done = true;
+  thieves.clear();
+
+  for (int i = 0; i < kItems; ++i) {
+    ASSERT_EQ(seen[i], 1) << "item " << i;
+  }
+}
+
+/* Tracks how many jobs overlap and the most that ever did. */
+struct Overlap {
+  std::atomic<int> now = 0;
+  std::atomic<int> max = 0;
+
+  void Enter() {
+    int current = ++now;
+    int prev = max;
+    while (prev < current && !max.compare_exchange_weak(prev, current)) {
+    }
+  }
+  void Leave() { now--; }
+};
+
+TEST(SchedulerTest, RunsEveryJob) {
+  TransferScheduler scheduler(4);
+  std::atomic<int> ran = 0;
+  std::vector<TransferScheduler::Job> jobs;
+  for (int i = 0; i < 64; ++i) {
+    jobs.push_back({.host = "host", .task = [&] {
+                      ran++;
+                      return true;
+                    }});
+  }
+
+  ASSERT_TRUE(scheduler.Run(std::move(jobs)));
+  ASSERT_EQ(ran, 64);
+}
+
+TEST(SchedulerTest, AnyFailureFailsTheBatch) {
+  TransferScheduler scheduler(2);
+  std::vector<TransferScheduler::Job> jobs;
+  for (int i = 0; i < 8; ++i) {
+    jobs.push_back({.host = "host", .task = [i] { return i != 5; }});
+  }
+
+  ASSERT_FALSE(scheduler.Run(std::move(jobs)));
+  ASSERT_TRUE(scheduler.Run({}));
+}
+
+TEST(SchedulerTest, HonorsPerHostLimit) {
+  TransferScheduler scheduler(8, {.per_host = 2});
+  Overlap a;
+  Overlap b;
+  std::vector<TransferScheduler::Job> jobs;
+  for (int i = 0; i < 16; ++i) {
+    Overlap& overlap = (i % 2) ? a : b;
+    jobs.push_back({.host = (i % 2) ? "a" : "b", .task = [&overlap] {
+                      overlap.Enter();
+                      std::this_thread::sleep_for(2ms);
+                      overlap.Leave();
+                      return true;
+                    }});
+  }
+
+  ASSERT_TRUE(scheduler.Run(std::move(jobs)));
+  ASSERT_LE(a.max, 2);
+  ASSERT_LE(b.max, 2);
+}
+
+TEST(SchedulerTest, HonorsGlobalLimit) {
+  TransferScheduler scheduler(8, {.global = 3});
+  Overlap overlap;
+  std::vector<TransferScheduler::Job> jobs;
+  for (int i = 0; i < 24; ++i) {
+    jobs.push_back({.host = std::to_string(i), .task = [&overlap] {
+                      overlap.Enter();
+                      std::this_thread::sleep_for(1ms);
+                      overlap.Leave();
+                      return true;
+                    }});
+  }
+
+  ASSERT_TRUE(scheduler.Run(std::move(jobs)));
+  ASSERT_LE(overlap.max, 3);
+  ASSERT_GT(overlap.max, 1);
+}
+
+TEST(SchedulerTest, JobsCapTransfersAcrossHosts) {
+  SchedulerLimits limits = tftp::client::JobLimits(2, 1);
+  ASSERT_EQ(limits.global, 2);
+  ASSERT_EQ(limits.per_host, 1);
+
+  /* Groups of transfers to different hosts, the way a script runs them, on
+     more workers than the cap. */
+  TransferScheduler scheduler(6, limits);
+  Overlap overlap;
+  auto transfer = [&overlap] {
+    overlap.Enter();
+    std::this_thread::sleep_for(2ms);
+    overlap.Leave();
+    return true;
+  };
+  std::vector<TransferScheduler::Job> groups;
+  for (int g = 0; g < 3; ++g) {
+    groups.push_back({.host = {}, .task = [&, g] {
+                        std::vector<TransferScheduler::Job> jobs;
+                        for (int i = 0; i < 4; ++i) {
+                          jobs.push_back({.host = std::to_string(g * 4 + i),
+                                          .task = transfer});
+                        }
+                        return scheduler.Run(std::move(jobs));
+                      }});
+  }
+
+  ASSERT_TRUE(scheduler.Run(std::move(groups)));
+  ASSERT_LE(overlap.max, 2);
+  ASSERT_GT(overlap.max, 0);
+}
+
+TEST(SchedulerTest, NestedRunsCompleteOnASingleWorker) {
+  TransferScheduler scheduler(1, {.per_host = 1});
+  std::atomic<int> ran = 0;
+  std::vector<TransferScheduler::Job> groups;
+  for (int i = 0; i < 4; ++i) {
+    groups.push_back({.host = {}, .task = [&] {
+      std::vector<TransferScheduler::Job> jobs;
+      for (int j = 0; j < 4; ++j) {
+        jobs.push_back({.host = "host", .task = [&] {
+                          ran++;
+                          return true;
+                        }});
+      }
+      return scheduler.Run(std::move(jobs));
+    }});
+  }
+
+  ASSERT_TRUE(scheduler.Run(std::move(groups)));
+  ASSERT_EQ(ran, 16);
+}
+
+TEST(SchedulerTest, IdleWorkersStealNestedJobs) {
+  TransferScheduler scheduler(4);
+  Overlap overlap;
+  std::vector<TransferScheduler::Job> groups;
+  groups.push_back({.host = {}, .task = [&] {
+    std::vector<TransferScheduler::Job> jobs;
+    for (int i = 0; i < 8; ++i) {
+      jobs.push_back({.host = "host", .task = [&overlap] {
+                        overlap.Enter();
+                        std::this_thread::sleep_for(5ms);
+                        overlap.Leave();
+                        return true;
+                      }});
+    }
+    return scheduler.Run(std::move(jobs));
+  }});
+
+  ASSERT_TRUE(scheduler.Run(std::move(groups)));
+  ASSERT_GT(scheduler.Steals(), 0);
+  ASSERT_GT(overlap.max, 1);
+}
+
+TEST(SchedulerTest, ParkedHostsTakeTurns) {
+  TransferScheduler scheduler(4, {.global = 1});
+  std::mutex mutex;
+  std::vector<std::string> order;
+  std::vector<TransferScheduler::Job> jobs;
+  for (std::string host : {"a", "a", "a", "b", "b", "b"}) {
+    jobs.push_back({.host = host, .task = [&, host] {
+                      {
+                        std::lock_guard lock(mutex);
+                        order.push_back(host);
+                      }
+                      std::this_thread::sleep_for(20ms);
+                      return true;
+                    }});
+  }
+
+  /* Everything but the first is parked before it finishes. */
+  ASSERT_TRUE(scheduler.Run(std::move(jobs)));
+  ASSERT_EQ(order.size(), 6);
+  for (std::size_t i = 1; i < 4; ++i) {
+    ASSERT_NE(order[i], order[i + 1]) << "at " << i;
+  }
+}
+
+TEST(SchedulerTest, BacksOffHostsThatRetransmit) {
+  TransferScheduler scheduler(8, {.per_host = 4});
+  ASSERT_EQ(scheduler.HostLimit("a"), 4);
+  scheduler.Feedback("a", 100, 10);
+  ASSERT_EQ(scheduler.HostLimit("a"), 1);
+  ASSERT_EQ(scheduler.HostLimit("b"), 4);
+
+  /* Overloaded transfers keep the host to one at a time. */
+  Overlap overlap;
+  std::vector<TransferScheduler::Job> jobs;
+  for (int i = 0; i < 8; ++i) {
+    jobs.push_back({.host = "a", .task = [&] {
+                      overlap.Enter();
+                      std::this_thread::sleep_for(1ms);
+                      overlap.Leave();
+                      scheduler.Feedback("a", 0, 3);
+                      return true;
+                    }});
+  }
+  ASSERT_TRUE(scheduler.Run(std::move(jobs)));
+  ASSERT_EQ(overlap.max, 1);
+
+  /* Clean transfers open the window back up to the configured limit. */
+  scheduler.Feedback("a", 100, 0);
+  ASSERT_EQ(scheduler.HostLimit("a"), 2);
+  for (int i = 0; i < 8; ++i) {
+    scheduler.Feedback("a", 100, 1);
+  }
+  ASSERT_EQ(scheduler.HostLimit("a"), 4);
+}
@@ -0,0 +1,76 @@
+#include "client/script.h"
+
+#include <gtest/gtest.h>
+
+#include <string>
+
+#include "client/cmd.h"
+#include "common/parse.h"
+
+static tftp::client::CmdList MakeCmds(const tftp::client::ScriptLines& lines) {
+  tftp::client::CmdList cmds;
+  for (const std::string& line : lines) {
+    if (line.starts_with(tftp::client::CmdId::kGet)) {
+      cmds.push_back(std::move(*tftp::client::GetCmd::Create(line)));
+    } else if (line.starts_with(tftp::client::CmdId::kPut)) {
+      cmds.push_back(std::move(*tftp::client::PutCmd::Create(line)));
+    } else {
+      cmds.push_back(std::move(*tftp::client::ModeCmd::Create(line)));
+    }
+  }
+  return cmds;
+}
+
+TEST(ScriptTest, SplitScriptSeparatesOnSemicolonsAndNewlines) {
+  auto lines =
+      tftp::client::SplitScript(" mode binary ;get a\n\n# comment\nput b ;");
+
+  tftp::client::ScriptLines expected = {"mode binary", "get a", "put b"};
+  ASSERT_EQ(lines, expected);
+}
+
+TEST(ScriptTest, IndependentTransfersShareAGroup) {
+  auto cmds = MakeCmds({"get a", "get b", "put c", "mode binary", "get d"});
+
+  ASSERT_EQ(tftp::client::TransferGroupEnd(cmds, 0, false), 3);
+  ASSERT_EQ(tftp::client::TransferGroupEnd(cmds, 4, false), 5);
+}
+
+TEST(ScriptTest, TransfersOnTheSameFileAreOrdered) {
+  auto cmds = MakeCmds({"get a", "get dir/b", "put b remote"});
+
+  ASSERT_EQ(tftp::client::TransferGroupEnd(cmds, 0, false), 2);
+}
+
+TEST(ScriptTest, HostChangeEndsTheGroup) {
+  auto cmds = MakeCmds({"get a", "get host:b", "get c"});
+
+  ASSERT_EQ(tftp::client::TransferGroupEnd(cmds, 0, false), 2);
+  ASSERT_EQ(tftp::client::TransferGroupEnd(cmds, 0, true), 3);
+}
+
+TEST(ScriptTest, MulticastRunsEachTransferAlone) {
+  auto cmds = MakeCmds({"get a", "get b", "put c"});
+
+  ASSERT_EQ(tftp::client::TransferGroupEnd(cmds, 0, false, true), 1);
+  ASSERT_EQ(tftp::client::TransferGroupEnd(cmds, 1, false, true), 2);
+  ASSERT_EQ(tftp::client::TransferGroupEnd(cmds, 2, false, true), 3);
+}
+
+TEST(ScriptTest, StreamingToStdoutRunsAlone) {
+  auto cmds = MakeCmds({"get a", "get b -", "get c", "put - d", "get e"});
+
+  ASSERT_EQ(tftp::client::TransferGroupEnd(cmds, 0, false), 1);
+  ASSERT_EQ(tftp::client::TransferGroupEnd(cmds, 1, false), 2);
+  ASSERT_EQ(tftp::client::TransferGroupEnd(cmds, 2, false), 5);
+}
+
+TEST(ScriptTest, ParseJobsRejectsOutOfRangeCounts) {
+  ASSERT_EQ(*tftp::client::ParseJobs("8"), 8);
+  ASSERT_EQ(tftp::client::ParseJobs("0").error(),
+            tftp::ParseStatus::kJobsOutOfRange);
+  ASSERT_EQ(tftp::client::ParseJobs("2000").error(),
+            tftp::ParseStatus::kJobsOutOfRange);
+  ASSERT_EQ(tftp::client::ParseJobs("-1").error(),
+            tftp::ParseStatus::kJobsOutOfRange);
+}
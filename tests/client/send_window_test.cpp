@@ -0,0 +1,107 @@
+#include "client/send_window.h"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstdint>
+
+#include "client/session.h"
+#include "common/block_seq.h"
+#include "common/types.h"
+
+using namespace std::chrono_literals;
+
+static void Fill(tftp::client::SendWindow& window, uint64_t count,
+                 tftp::client::Clock::time_point now) {
+  for (uint64_t i = 0; i < count; ++i) {
+    window.Push(tftp::TftpPacket(4, 0));
+    window.Advance(now);
+  }
+}
+
+TEST(SendWindowTest, AckSlidesWindow) {
+  tftp::client::SendWindow window;
+  Fill(window, 8, tftp::client::Clock::now());
+
+  ASSERT_EQ(window.Ack(5), 5);
+  ASSERT_EQ(window.Base(), 6);
+  ASSERT_EQ(window.Next(), 9);
+  ASSERT_EQ(window.Outstanding(), 3);
+  ASSERT_EQ(window.InFlight(), 3);
+}
+
+TEST(SendWindowTest, MatchOnlyAcceptsBlocksInFlight) {
+  tftp::client::SendWindow window;
+  Fill(window, 4, tftp::client::Clock::now());
+  window.Ack(2);
+
+  ASSERT_EQ(window.Match(2), 2); /* The last block acknowledged. */
+  ASSERT_EQ(window.Match(4), 4);
+  ASSERT_FALSE(window.Match(5));
+  ASSERT_FALSE(window.Match(1));
+}
+
+TEST(SendWindowTest, MatchHandlesWireWrap) {
+  tftp::client::SendWindow window;
+  Fill(window, 65540, tftp::client::Clock::now());
+  window.Ack(65534);
+
+  ASSERT_EQ(window.Match(65535), 65535);
+  ASSERT_EQ(window.Match(0), 65536);
+  ASSERT_EQ(window.Match(3), 65539);
+}
+
+TEST(SendWindowTest, MatchHandlesRolloverToOne) {
+  tftp::client::SendWindow window(tftp::BlockSeq(tftp::Rollover::kToOne));
+  Fill(window, 65540, tftp::client::Clock::now());
+  window.Ack(65533);
+
+  ASSERT_EQ(window.Match(65534), 65534);
+  ASSERT_EQ(window.Match(65535), 65535);
+  ASSERT_EQ(window.Match(1), 65536);
+  ASSERT_EQ(window.Match(5), 65540);
+  ASSERT_FALSE(window.Match(0)); /* Only ever the OACK's ACK. */
+}
+
+TEST(SendWindowTest, RewindQueuesEveryUnackedBlockAgain) {
+  tftp::client::SendWindow window;
+  Fill(window, 6, tftp::client::Clock::now());
+  window.Ack(2);
+
+  window.Rewind();
+
+  ASSERT_EQ(window.Cursor(), 3);
+  ASSERT_EQ(window.InFlight(), 0);
+  ASSERT_EQ(window.Advance(tftp::client::Clock::now()).transmissions, 2);
+  ASSERT_EQ(window.Cursor(), 4);
+}
+
+TEST(SendWindowTest, LateAckMovesCursorPastRewind) {
+  tftp::client::SendWindow window;
+  Fill(window, 6, tftp::client::Clock::now());
+  window.Rewind();
+
+  window.Ack(4);
+
+  ASSERT_EQ(window.Cursor(), 5);
+}
+
+TEST(SendWindowTest, DupAckCountResetsWhenWindowSlides) {
+  tftp::client::SendWindow window;
+  Fill(window, 4, tftp::client::Clock::now());
+
+  window.CountDupAck();
+  ASSERT_EQ(window.CountDupAck(), 2);
+  window.Ack(1);
+  ASSERT_EQ(window.CountDupAck(), 1);
+}
+
+TEST(SendWindowTest, RttSkipsRetransmittedBlocks) {
+  tftp::client::SendWindow window;
+  auto sent_at = tftp::client::Clock::now();
+  Fill(window, 2, sent_at);
+  window.At(2).transmissions++;
+
+  ASSERT_EQ(window.Rtt(1, sent_at + 5ms), std::chrono::microseconds(5000));
+  ASSERT_FALSE(window.Rtt(2, sent_at + 5ms));
+}
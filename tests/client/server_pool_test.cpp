@@ -0,0 +1,131 @@
+#include "client/server_pool.h"
+
+#include <arpa/inet.h>
+#include <gtest/gtest.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "client/config.h"
+#include "client/stats.h"
+#include "client/transport.h"
+#include "common/pack.h"
+#include "common/types.h"
+
+using namespace std::chrono_literals;
+using tftp::client::Micros;
+using tftp::client::ServerPool;
+using tftp::client::TransferStats;
+
+static TransferStats Rtt(Micros rtt) {
+  TransferStats stats;
+  stats.RecordRtt(rtt);
+  return stats;
+}
+
+/* Sets a server's latency by running a transfer on it. */
+static void Measure(ServerPool& pool, const tftp::Hostname& host, Micros rtt) {
+  std::vector<tftp::Hostname> others;
+  for (const auto& server : pool.Servers()) {
+    if (server.host != host) {
+      others.push_back(server.host);
+    }
+  }
+  ASSERT_EQ(pool.Acquire(others), host);
+  pool.Release(host, Rtt(rtt), false);
+}
+
+TEST(ServerPoolTest, FromListNeedsSeveralHosts) {
+  ASSERT_FALSE(ServerPool::FromList("a"));
+  ASSERT_FALSE(ServerPool::FromList("a,,a"));
+
+  auto pool = ServerPool::FromList("a,b,a,c");
+  ASSERT_TRUE(pool);
+  ASSERT_EQ(pool->Name(), "a,b,a,c");
+  auto servers = pool->Servers();
+  ASSERT_EQ(servers.size(), 3);
+  ASSERT_EQ(servers[2].host, "c");
+  ASSERT_FALSE(servers[0].srtt);
+}
+
+TEST(ServerPoolTest, PrefersTheFastestServer) {
+  auto pool = ServerPool::FromList("a,b,c");
+  Measure(*pool, "a", 3ms);
+  Measure(*pool, "b", 1ms);
+  Measure(*pool, "c", 2ms);
+
+  ASSERT_EQ(pool->Acquire({}), "b");
+  ASSERT_EQ(pool->Servers()[1].active, 1);
+  pool->Release("b", TransferStats{}, false);
+  ASSERT_EQ(pool->Servers()[1].active, 0);
+}
+
+TEST(ServerPoolTest, SpreadsConcurrentTransfers) {
+  auto pool = ServerPool::FromList("a,b");
+  Measure(*pool, "a", 1ms);
+  Measure(*pool, "b", 3ms);
+
+  /* a stays cheaper until it runs three transfers to b's one. */
+  std::vector<tftp::Hostname> picked;
+  for (int i = 0; i < 4; ++i) {
+    picked.push_back(*pool->Acquire({}));
+  }
+  ASSERT_EQ(picked, (std::vector<tftp::Hostname>{"a", "a", "b", "a"}));
+}
+
+TEST(ServerPoolTest, SkipsTriedAndDownServersUntilTheyRecover) {
+  auto pool = ServerPool::FromList("a,b");
+  auto now = tftp::client::Clock::now();
+  ASSERT_EQ(pool->Acquire({}, now), "a");
+  pool->Release("a", TransferStats{}, true, now);
+
+  ASSERT_EQ(pool->Acquire({}, now), "b");
+  ASSERT_FALSE(pool->Acquire({"b"}, now));
+  ASSERT_EQ(pool->Acquire({"b"}, now + ServerPool::kDownTime), "a");
+}
+
+TEST(ServerPoolTest, ProbeTimesTheFirstReply) {
+  int fd = socket(AF_INET, SOCK_DGRAM, 0);
+  ASSERT_NE(fd, -1);
+  sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  ASSERT_EQ(bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)), 0);
+  socklen_t len = sizeof(addr);
+  getsockname(fd, reinterpret_cast<sockaddr*>(&addr), &len);
+
+  /* Answers the probe's request like a server without the file. */
+  std::jthread server([fd] {
+    uint8_t buffer[512];
+    sockaddr_in peer = {};
+    socklen_t peer_len = sizeof(peer);
+    if (recvfrom(fd, buffer, sizeof(buffer), 0,
+                 reinterpret_cast<sockaddr*>(&peer), &peer_len) > 0) {
+      auto err = tftp::PackError(
+          {.err_code = tftp::ErrorCode::kFileNotFound, .err_msg = "nope"});
+      sendto(fd, err.data(), err.size(), 0,
+             reinterpret_cast<sockaddr*>(&peer), peer_len);
+    }
+  });
+
+  /* Nothing answers on 127.0.0.2, it is down after the 1 s timeout. */
+  auto pool = ServerPool::FromList("127.0.0.1,127.0.0.2");
+  tftp::client::Config conf(tftp::SendMode::kOctet, {.start = 0, .end = 0},
+                            false, pool->Name(), 0, 1);
+  pool->Probe(conf, ntohs(addr.sin_port));
+  server.join();
+  close(fd);
+
+  auto servers = pool->Servers();
+  ASSERT_TRUE(servers[0].srtt);
+  ASSERT_FALSE(servers[0].down_until);
+  ASSERT_TRUE(servers[1].down_until);
+  ASSERT_EQ(pool->Acquire({}), "127.0.0.1");
+  ASSERT_FALSE(pool->Acquire({"127.0.0.1"}));
+}
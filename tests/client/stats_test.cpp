@@ -0,0 +1,158 @@
+#include "client/stats.h"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "client/config.h"
+#include "client/session.h"
+
+using tftp::client::Micros;
+
+TEST(StatsTest, RecordRttTracksMinAvgMax) {
+  tftp::client::TransferStats stats;
+
+  stats.RecordRtt(Micros(100));
+  stats.RecordRtt(Micros(300));
+  stats.RecordRtt(Micros(200));
+
+  ASSERT_EQ(stats.rtt_samples, 3);
+  ASSERT_EQ(stats.RttMin(), Micros(100));
+  ASSERT_EQ(stats.RttAvg(), Micros(200));
+  ASSERT_EQ(stats.rtt_max, Micros(300));
+}
+
+TEST(StatsTest, RttIsZeroWithoutSamples) {
+  tftp::client::TransferStats stats;
+
+  ASSERT_EQ(stats.RttMin(), Micros::zero());
+  ASSERT_EQ(stats.RttAvg(), Micros::zero());
+}
+
+TEST(StatsTest, ThroughputIsBytesPerSecond) {
+  tftp::client::TransferStats stats;
+  stats.bytes = 1000;
+  stats.elapsed = std::chrono::seconds(2);
+
+  ASSERT_DOUBLE_EQ(stats.Throughput(), 500.0);
+}
+
+TEST(StatsTest, MergeAccumulatesCounters) {
+  tftp::client::TransferStats first;
+  first.bytes = 10;
+  first.retransmits = 1;
+  first.RecordRtt(Micros(50));
+  tftp::client::TransferStats second;
+  second.bytes = 20;
+  second.duplicates = 2;
+  second.RecordRtt(Micros(150));
+
+  first.Merge(second);
+
+  ASSERT_EQ(first.bytes, 30);
+  ASSERT_EQ(first.retransmits, 1);
+  ASSERT_EQ(first.duplicates, 2);
+  ASSERT_EQ(first.RttMin(), Micros(50));
+  ASSERT_EQ(first.rtt_max, Micros(150));
+  ASSERT_EQ(first.RttAvg(), Micros(100));
+}
+
+TEST(StatsTest, MergeCombinesLatencyHistograms) {
+  tftp::client::TransferStats first;
+  first.RecordRtt(Micros(100));
+  first.Finish(std::chrono::seconds(1));
+  tftp::client::TransferStats second;
+  second.RecordRtt(Micros(300));
+  second.send_time.Record(std::chrono::microseconds(5));
+  second.Finish(std::chrono::seconds(3));
+
+  first.Merge(second);
+
+  ASSERT_EQ(first.rtts.Count(), 2);
+  ASSERT_EQ(first.rtts.Max(), Micros(300));
+  ASSERT_EQ(first.send_time.Count(), 1);
+  ASSERT_EQ(first.transfer_time.Count(), 2);
+  ASSERT_GE(first.transfer_time.Percentile(50), std::chrono::seconds(1));
+  ASSERT_LT(first.transfer_time.Percentile(50), std::chrono::seconds(2));
+  ASSERT_EQ(first.elapsed, std::chrono::seconds(4));
+}
+
+TEST(StatsTest, MergeKeepsTheLatestSocketBuffers) {
+  tftp::client::TransferStats first;
+  first.buffers = {.wanted = 2064, .recv = 4128, .send = 4128};
+  tftp::client::TransferStats second;
+  second.buffers = {.wanted = 8256, .recv = 4128, .send = 8256};
+
+  first.Merge(second);
+
+  ASSERT_EQ(first.buffers.wanted, 8256);
+  ASSERT_EQ(first.buffers.recv, 4128);
+  ASSERT_TRUE(first.buffers.Clamped());
+}
+
+TEST(StatsTest, OpeningASessionRecordsItsSocketBuffers) {
+  tftp::client::Config conf(tftp::SendMode::kOctet, {.start = 0, .end = 0},
+                            false, "127.0.0.1", 1, 1);
+  conf.windowsize = 8;
+  tftp::client::TransferStats stats;
+
+  auto session = tftp::client::Session::Open(conf, "127.0.0.1", 69, stats);
+
+  ASSERT_TRUE(session) << session.error().msg;
+  ASSERT_EQ(stats.buffers.wanted, 2 * 8 * 516);
+  ASSERT_GT(stats.buffers.recv, 0);
+  ASSERT_GT(stats.buffers.send, 0);
+}
+
+TEST(StatsTest, SessionMergeCountsFailures) {
+  tftp::client::SessionStats session;
+  tftp::client::TransferStats stats;
+  stats.bytes = 42;
+
+  session.Merge(stats, true);
+  session.Merge(stats, false);
+
+  ASSERT_EQ(session.transfers, 2);
+  ASSERT_EQ(session.failures, 1);
+  ASSERT_EQ(session.last.bytes, 42);
+  ASSERT_EQ(session.totals.bytes, 84);
+}
+
+TEST(StatsTest, ConfigCopiesShareTheSessionStats) {
+  tftp::client::Config conf(tftp::SendMode::kOctet, {.start = 0, .end = 0},
+                            false, "127.0.0.1", 1, 1);
+  std::vector<tftp::client::Config> copies(4, conf);
+  tftp::client::TransferStats stats;
+  stats.bytes = 1;
+
+  std::vector<std::jthread> threads;
+  for (tftp::client::Config& copy : copies) {
+    threads.emplace_back([&copy, &stats] {
+      for (int i = 0; i < 100; ++i) {
+        copy.stats->Merge(stats, true);
+      }
+    });
+  }
+  threads.clear();
+
+  ASSERT_EQ(conf.stats->transfers, 400);
+  ASSERT_EQ(conf.stats->totals.bytes, 400);
+}
+
+TEST(StatsTest, SessionMergeFoldsOtherSession) {
+  tftp::client::SessionStats session;
+  tftp::client::SessionStats other;
+  tftp::client::TransferStats stats;
+  stats.bytes = 7;
+  other.Merge(stats, false);
+
+  session.Merge(other);
+  session.Merge(tftp::client::SessionStats{});
+
+  ASSERT_EQ(session.transfers, 1);
+  ASSERT_EQ(session.failures, 1);
+  ASSERT_EQ(session.last.bytes, 7);
+  ASSERT_EQ(session.totals.bytes, 7);
+}
@@ -0,0 +1,261 @@
+#include "client/sync.h"
+
+#include <arpa/inet.h>
+#include <gtest/gtest.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cstdint>
+#include <expected>
+#include <iterator>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "client/cmd.h"
+#include "client/config.h"
+#include "client/stats.h"
+#include "common/sha256.h"
+#include "common/types.h"
+
+using tftp::client::Manifest;
+using tftp::client::ManifestEntry;
+using tftp::client::ParseManifest;
+
+/* sha256("abc"). */
+static constexpr const char* kAbcSha256 =
+    "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad";
+
+static std::expected<Manifest, tftp::client::SyncErr> Parse(
+    const std::string& text) {
+  std::istringstream in(text);
+  return ParseManifest(in);
+}
+
+/* Serves every RRQ on ip:port with one short DATA block of contents from
+   a fresh TID, until it goes away. */
+class OneBlockServer {
+ public:
+  OneBlockServer(const std::string& ip, uint16_t port,
+                 const std::string& contents)
+      : contents_(contents) {
+    fd_ = Bind(ip, port);
+    sockaddr_in addr = {};
+    socklen_t len = sizeof(addr);
+    getsockname(fd_, reinterpret_cast<sockaddr*>(&addr), &len);
+    ip_ = ip;
+    port_ = ntohs(addr.sin_port);
+    thread_ = std::jthread([this](std::stop_token stop) { Serve(stop); });
+  }
+  ~OneBlockServer() {
+    thread_.request_stop();
+    thread_.join();
+    close(fd_);
+  }
+
+  uint16_t Port() const { return port_; }
+  int Requests() const { return requests_; }
+
+ private:
+  static int Bind(const std::string& ip, uint16_t port) {
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    inet_pton(AF_INET, ip.c_str(), &addr.sin_addr);
+    EXPECT_EQ(bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)), 0);
+    return fd;
+  }
+
+  void Serve(std::stop_token stop) {
+    std::vector<uint8_t> buffer(1024);
+    while (!stop.stop_requested()) {
+      pollfd pfd = {.fd = fd_, .events = POLLIN, .revents = 0};
+      if (poll(&pfd, 1, 20) != 1) {
+        continue;
+      }
+      sockaddr_in client = {};
+      socklen_t len = sizeof(client);
+      ssize_t n = recvfrom(fd_, buffer.data(), buffer.size(), 0,
+                           reinterpret_cast<sockaddr*>(&client), &len);
+      if (n < 2 || buffer[1] != 1) { /* Only RRQs. */
+        continue;
+      }
+      requests_++;
+
+      std::vector<uint8_t> data = {0, 3, 0, 1};
+      data.insert(data.end(), contents_.begin(), contents_.end());
+      int tid = Bind(ip_, 0);
+      sendto(tid, data.data(), data.size(), 0,
+             reinterpret_cast<sockaddr*>(&client), len);
+      pollfd ack = {.fd = tid, .events = POLLIN, .revents = 0};
+      poll(&ack, 1, 1000);
+      close(tid);
+    }
+  }
+
+  std::string contents_;
+  std::string ip_;
+  int fd_ = -1;
+  uint16_t port_ = 0;
+  std::atomic<int> requests_ = 0;
+  std::jthread thread_;
+};
+
+class SyncTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    dir_ = std::filesystem::temp_directory_path() /
+           ("sync_test_" + std::to_string(::getpid()));
+    std::filesystem::create_directories(dir_);
+  }
+  void TearDown() override { std::filesystem::remove_all(dir_); }
+
+  std::string Path(const std::string& name) const {
+    return (dir_ / name).string();
+  }
+
+  void WriteFile(const std::string& path, const std::string& contents) {
+    std::ofstream(path, std::ios::binary) << contents;
+  }
+
+  std::filesystem::path dir_;
+};
+
+TEST(ManifestTest, ParsesEntriesAndSkipsComments) {
+  auto manifest = Parse(
+      "# firmware\n"
+      "\n"
+      "fw/a.bin a.bin 3 " +
+      std::string(kAbcSha256) +
+      "\n"
+      "  b.bin   out/b.bin 0  \n");
+  ASSERT_TRUE(manifest) << manifest.error();
+  ASSERT_EQ(manifest->size(), 2);
+  ASSERT_EQ((*manifest)[0].remote, "fw/a.bin");
+  ASSERT_EQ((*manifest)[0].local, "a.bin");
+  ASSERT_EQ((*manifest)[0].size, 3);
+  ASSERT_EQ(tftp::ToHex(*(*manifest)[0].sha256), kAbcSha256);
+  ASSERT_EQ((*manifest)[1].local, "out/b.bin");
+  ASSERT_FALSE((*manifest)[1].sha256);
+}
+
+TEST(ManifestTest, ReportsTheBadLine) {
+  ASSERT_EQ(Parse("a a 1\na b\n").error(),
+            "manifest line 2: expected 'remote local size [sha256]'");
+  ASSERT_EQ(Parse("a a 1k\n").error(), "manifest line 1: invalid size '1k'");
+  ASSERT_EQ(Parse("# x\na a 1 abc\n").error(),
+            "manifest line 2: invalid sha256 'abc'");
+}
+
+TEST_F(SyncTest, UpToDateChecksSizeThenChecksum) {
+  WriteFile(Path("f"), "abc");
+  ManifestEntry entry = {.remote = "f", .local = Path("f"), .size = 3};
+  ASSERT_TRUE(UpToDate(entry));
+
+  entry.sha256 = tftp::ParseSha256(kAbcSha256);
+  ASSERT_TRUE(UpToDate(entry));
+
+  WriteFile(Path("f"), "abd");
+  ASSERT_FALSE(UpToDate(entry));
+
+  entry.size = 4;
+  entry.sha256.reset();
+  ASSERT_FALSE(UpToDate(entry));
+
+  entry.local = Path("missing");
+  ASSERT_FALSE(UpToDate(entry));
+}
+
+TEST_F(SyncTest, AFailedFetchKeepsTheOldCopy) {
+  WriteFile(Path("f"), "old");
+  ManifestEntry entry = {.remote = "f", .local = Path("f"), .size = 3};
+
+  /* Nothing listens on the port, the transfer can't succeed. */
+  tftp::client::Config conf(tftp::SendMode::kOctet, {.start = 0, .end = 0},
+                            false, "127.0.0.1", 1, 1);
+  tftp::client::TransferStats stats;
+  ASSERT_FALSE(SyncFile(conf, "127.0.0.1", 9, entry, stats));
+
+  std::ifstream in(Path("f"));
+  std::string contents;
+  in >> contents;
+  ASSERT_EQ(contents, "old");
+  /* Its temporary is gone. */
+  ASSERT_EQ(std::distance(std::filesystem::directory_iterator(dir_), {}), 1);
+}
+
+TEST_F(SyncTest, EntriesOnDifferentHostsComeFromTheirOwnHost) {
+  OneBlockServer a("127.0.0.1", 0, "aaa");
+  OneBlockServer b("127.0.0.2", a.Port(), "bbb");
+
+  /* The same remote name, size and no checksum on two hosts. */
+  WriteFile(Path("manifest"), "127.0.0.1:img " + Path("a") +
+                                  " 3\n"
+                                  "127.0.0.2:img " +
+                                  Path("b") + " 3\n");
+  tftp::client::Config conf(tftp::SendMode::kOctet, {.start = 0, .end = 0},
+                            false, "127.0.0.1", 2, 1);
+  conf.server_port = a.Port();
+  auto sync = tftp::client::SyncCmd::Create("sync " + Path("manifest"));
+  ASSERT_TRUE(sync);
+
+  ASSERT_EQ((*sync)->Execute(conf), tftp::client::ExecStatus::kSuccessfulExec);
+  std::ifstream in_a(Path("a"));
+  std::ifstream in_b(Path("b"));
+  std::string got_a;
+  std::string got_b;
+  in_a >> got_a;
+  in_b >> got_b;
+  ASSERT_EQ(got_a, "aaa");
+  ASSERT_EQ(got_b, "bbb");
+  ASSERT_EQ(a.Requests(), 1);
+  ASSERT_EQ(b.Requests(), 1);
+}
+
+TEST_F(SyncTest, ReportsToTheConsole) {
+  tftp::client::Config conf(tftp::SendMode::kOctet, {.start = 0, .end = 0},
+                            false, "127.0.0.1", 1, 1);
+  std::ostringstream console;
+  conf.console = &console;
+  auto sync = tftp::client::SyncCmd::Create("sync " + Path("missing"));
+  ASSERT_TRUE(sync);
+
+  ASSERT_EQ((*sync)->Execute(conf),
+            tftp::client::ExecStatus::kInvalidManifest);
+  ASSERT_EQ(console.str(), "unable to open '" + Path("missing") + "'\n");
+
+  WriteFile(Path("f"), "abc");
+  WriteFile(Path("manifest"), "f " + Path("f") + " 3\n");
+  conf.verbose = true;
+  console.str("");
+  sync = tftp::client::SyncCmd::Create("sync " + Path("manifest"));
+  ASSERT_EQ((*sync)->Execute(conf), tftp::client::ExecStatus::kSuccessfulExec);
+  ASSERT_EQ(console.str(), "Synced 1 files, 1 already up to date.\n");
+}
+
+TEST_F(SyncTest, TransfersInOctetWhateverTheClientMode) {
+  /* Netascii would turn these into "\n" and "\r" on the way in. */
+  const std::string bin("a\r\nb\r\0c", 7);
+  OneBlockServer server("127.0.0.1", 0, bin);
+  WriteFile(Path("manifest"), "bin " + Path("bin") + " 7\n");
+
+  /* The client's default mode. */
+  tftp::client::Config conf(tftp::SendMode::kNetAscii, {.start = 0, .end = 0},
+                            false, "127.0.0.1", 2, 1);
+  conf.server_port = server.Port();
+  auto sync = tftp::client::SyncCmd::Create("sync " + Path("manifest"));
+  ASSERT_TRUE(sync);
+
+  ASSERT_EQ((*sync)->Execute(conf), tftp::client::ExecStatus::kSuccessfulExec);
+  std::ifstream in(Path("bin"), std::ios::binary);
+  std::string got((std::istreambuf_iterator<char>(in)), {});
+  ASSERT_EQ(got, bin);
+  ASSERT_EQ(conf.mode, tftp::SendMode::kNetAscii);
+}
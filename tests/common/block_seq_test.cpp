@@ -0,0 +1,56 @@
+#include "common/block_seq.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+
+#include "common/types.h"
+
+using tftp::BlockSeq;
+using tftp::Rollover;
+
+TEST(BlockSeqTest, RolloverToZeroWrapsLikeAUint16) {
+  BlockSeq seq(Rollover::kToZero);
+
+  ASSERT_EQ(seq.Wire(1), 1);
+  ASSERT_EQ(seq.Wire(65535), 65535);
+  ASSERT_EQ(seq.Wire(65536), 0);
+  ASSERT_EQ(seq.Wire(65537), 1);
+  ASSERT_EQ(seq.Wire(5ULL << 32), 0);
+}
+
+TEST(BlockSeqTest, RolloverToOneSkipsZero) {
+  BlockSeq seq(Rollover::kToOne);
+
+  ASSERT_EQ(seq.Wire(0), 0);
+  ASSERT_EQ(seq.Wire(65535), 65535);
+  ASSERT_EQ(seq.Wire(65536), 1);
+  ASSERT_EQ(seq.Wire(2 * 65535), 65535);
+  ASSERT_EQ(seq.Wire(2 * 65535 + 1), 1);
+}
+
+TEST(BlockSeqTest, AfterFindsTheNextIndexAcrossTheWrap) {
+  BlockSeq zero(Rollover::kToZero);
+  BlockSeq one(Rollover::kToOne);
+
+  ASSERT_EQ(zero.After(0, 0), 0);
+  ASSERT_EQ(zero.After(3, 0), 3);
+  ASSERT_EQ(zero.After(2, 65534), 65538);
+  ASSERT_EQ(zero.After(65534, 65534), 65534);
+  ASSERT_EQ(one.After(0, 0), 0);
+  ASSERT_EQ(one.After(3, 0), 3);
+  ASSERT_EQ(one.After(2, 65534), 65537);
+  ASSERT_FALSE(one.After(0, 65534));
+}
+
+TEST(BlockSeqTest, RoundTripsLargeIndices) {
+  for (Rollover rollover : {Rollover::kToZero, Rollover::kToOne}) {
+    BlockSeq seq(rollover);
+    for (uint64_t index : {1ULL, 65535ULL, 65536ULL, 70000ULL, 1ULL << 33}) {
+      ASSERT_EQ(seq.After(seq.Wire(index), index - 1), index);
+      ASSERT_EQ(seq.Nearest(seq.Wire(index), index + 30000), index);
+      uint64_t behind = (index > 30000) ? index - 30000 : 0;
+      ASSERT_EQ(seq.Nearest(seq.Wire(index), behind), index);
+    }
+  }
+}
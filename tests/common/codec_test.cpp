@@ -0,0 +1,104 @@
+#include "common/codec.h"
+
+#include <gtest/gtest.h>
+
+#include <string_view>
+#include <variant>
+
+#include "common/pack.h"
+#include "common/types.h"
+
+TEST(CodecTest, DecodeDispatchesOnOpcode) {
+  tftp::TftpPacket rrq_packet = tftp::PackReadRequest(
+      {.filename = "foo.txt", .mode = tftp::SendMode::kOctet});
+  tftp::TftpPacket ack_packet = tftp::PackAck({.block_num = 7});
+  tftp::TftpPacket err_packet = tftp::PackError(
+      {.err_code = tftp::ErrorCode::kFileNotFound, .err_msg = "nope"});
+
+  auto rrq = tftp::codec::Decode(rrq_packet);
+  auto ack = tftp::codec::Decode(ack_packet);
+  auto err = tftp::codec::Decode(err_packet);
+
+  ASSERT_TRUE(rrq &&
+              std::holds_alternative<tftp::codec::ReadRequestView>(*rrq));
+  ASSERT_TRUE(ack && std::holds_alternative<tftp::codec::AckView>(*ack));
+  ASSERT_EQ(std::get<tftp::codec::AckView>(*ack).block_num, 7);
+  ASSERT_TRUE(err && std::holds_alternative<tftp::codec::ErrorView>(*err));
+  ASSERT_EQ(std::get<tftp::codec::ErrorView>(*err).err_msg, "nope");
+}
+
+TEST(CodecTest, DecodeRejectsUnknownOpcode) {
+  tftp::TftpPacket zero = {0x00, 0x00, 0x00, 0x01};
+  tftp::TftpPacket large = {0x00, 0x07, 0x00, 0x01};
+  tftp::TftpPacket short_packet = {0x00};
+
+  ASSERT_FALSE(tftp::codec::Decode(zero));
+  ASSERT_FALSE(tftp::codec::Decode(large));
+  ASSERT_FALSE(tftp::codec::Decode(short_packet));
+}
+
+TEST(CodecTest, DataViewPointsIntoPacket) {
+  tftp::TftpPacket packet =
+      tftp::PackData({.block_num = 2, .data = {0xDE, 0xAD, 0xBE, 0xEF}});
+
+  auto data = tftp::codec::DecodeAs<tftp::codec::DataView>(packet);
+
+  ASSERT_TRUE(data);
+  ASSERT_EQ(data->block_num, 2);
+  ASSERT_EQ(data->data.size(), 4);
+  ASSERT_EQ(data->data.data(), packet.data() + 4);
+}
+
+TEST(CodecTest, DecodeAsRejectsOtherMessages) {
+  tftp::TftpPacket packet = tftp::PackAck({.block_num = 1});
+
+  ASSERT_FALSE(tftp::codec::DecodeAs<tftp::codec::DataView>(packet));
+  ASSERT_TRUE(tftp::codec::DecodeAs<tftp::codec::AckView>(packet));
+}
+
+TEST(CodecTest, EncodeMatchesWireFormat) {
+  tftp::TftpPacket packet =
+      tftp::codec::Encode(tftp::codec::ErrorView{
+          .err_code = tftp::ErrorCode::kDiskFullOrAllocExceeded,
+          .err_msg = "full"});
+
+  tftp::TftpPacket expected = {0x00, 0x05, 0x00, 0x03, 'f', 'u', 'l', 'l', 0};
+  ASSERT_EQ(packet, expected);
+}
+
+TEST(CodecTest, RequestWithUnknownModeIsRejected) {
+  tftp::TftpPacket packet =
+      tftp::codec::Encode(tftp::codec::WriteRequestView{
+          .filename = "foo.txt", .mode = "binary"});
+
+  ASSERT_FALSE(tftp::codec::Decode(packet));
+}
+
+TEST(CodecTest, OptionsWithoutValueAreRejected) {
+  tftp::TftpPacket packet = {0x00, 0x06, 'b', 'l', 'k', 's', 'i', 'z', 'e', 0};
+
+  ASSERT_FALSE(tftp::codec::Decode(packet));
+}
+
+TEST(CodecTest, OptionNamesAreLowercased) {
+  tftp::TftpPacket packet = tftp::PackOptionAck(
+      {.options = {{"TSize", "1024"}, {"multicast", "239.0.0.1,1758,1"}}});
+
+  auto oack = tftp::codec::DecodeAs<tftp::codec::OptionAckView>(packet);
+
+  ASSERT_TRUE(oack);
+  tftp::Options options = oack->options.ToOptions();
+  ASSERT_EQ(options.size(), 2);
+  ASSERT_EQ(options["tsize"], "1024");
+  ASSERT_EQ(options["multicast"], "239.0.0.1,1758,1");
+}
+
+TEST(CodecTest, DescribeSummarizesPackets) {
+  tftp::BlockData payload(512, 0);
+  tftp::TftpPacket data = tftp::codec::Encode(
+      tftp::codec::DataView{.block_num = 7, .data = payload});
+  tftp::TftpPacket junk = {0x00, 0x09, 0x01};
+
+  ASSERT_EQ(tftp::codec::Describe(data), "DATA <block=7, 512 bytes>");
+  ASSERT_EQ(tftp::codec::Describe(junk), "??? <3 bytes>");
+}
@@ -0,0 +1,182 @@
+#include "common/event_loop.h"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include "common/types.h"
+#include "common/udp_socket.h"
+
+using namespace std::chrono_literals;
+using tftp::AsyncSocket;
+using tftp::EventLoop;
+using tftp::FramePool;
+using tftp::Task;
+
+static std::unique_ptr<EventLoop> NewLoop() {
+  auto loop = EventLoop::Create();
+  EXPECT_TRUE(loop);
+  return std::move(*loop);
+}
+
+static tftp::SockAddr Loopback(uint16_t port) {
+  auto addr = tftp::ResolveAddr("127.0.0.1");
+  EXPECT_TRUE(addr);
+  addr->SetPort(port);
+  return *addr;
+}
+
+TEST(FramePoolTest, RecyclesFramesBySizeClass) {
+  FramePool pool;
+  void* small = pool.Allocate(100);
+  pool.Free(small, 100);
+
+  ASSERT_EQ(pool.Allocate(FramePool::kQuantum), small);
+  ASSERT_EQ(pool.Fresh(), 1);
+  ASSERT_EQ(pool.Reused(), 1);
+
+  void* large = pool.Allocate(FramePool::kQuantum + 1);
+  ASSERT_NE(large, small);
+  pool.Free(large, FramePool::kQuantum + 1);
+  pool.Free(small, FramePool::kQuantum);
+}
+
+static Task<int> Square(int n) { co_return n * n; }
+
+static Task<> SumSquares(int n, int& sum) {
+  for (int i = 1; i <= n; ++i) {
+    sum += co_await Square(i);
+  }
+}
+
+TEST(EventLoopTest, TasksChainResults) {
+  auto loop = NewLoop();
+  int sum = 0;
+  loop->Spawn(SumSquares(4, sum));
+  loop->Run();
+
+  ASSERT_EQ(sum, 1 + 4 + 9 + 16);
+  ASSERT_EQ(loop->Active(), 0);
+}
+
+TEST(EventLoopTest, SyncWaitRunsATaskWithoutALoop) {
+  int sum = 0;
+  tftp::SyncWait(SumSquares(3, sum));
+  ASSERT_EQ(sum, 1 + 4 + 9);
+  ASSERT_EQ(tftp::SyncWait(Square(7)), 49);
+}
+
+TEST(EventLoopTest, FramesAreReused) {
+  auto loop = NewLoop();
+  int sum = 0;
+  std::size_t reused = FramePool::Local().Reused();
+  loop->Spawn(SumSquares(100, sum));
+  loop->Run();
+
+  ASSERT_GE(FramePool::Local().Reused() - reused, 99);
+}
+
+static Task<> SleepThenRecord(EventLoop& loop, std::chrono::milliseconds ms,
+                              std::vector<int>& order) {
+  EXPECT_FALSE(co_await loop.Sleep(ms)); /* Sleeps always time out. */
+  order.push_back(ms.count());
+}
+
+TEST(EventLoopTest, SleepersWakeInDeadlineOrder) {
+  auto loop = NewLoop();
+  std::vector<int> order;
+  for (int ms : {30, 10, 20}) {
+    loop->Spawn(SleepThenRecord(*loop, std::chrono::milliseconds(ms), order));
+  }
+  loop->Run();
+
+  ASSERT_EQ(order, std::vector<int>({10, 20, 30}));
+}
+
+static Task<> ExpectTimeout(AsyncSocket& socket, bool& timed_out) {
+  auto packet = co_await socket.RecvPacket(20ms);
+  EXPECT_TRUE(packet);
+  timed_out = packet && packet->empty();
+}
+
+TEST(EventLoopTest, RecvTimesOutWithAnEmptyPacket) {
+  auto loop = NewLoop();
+  auto socket = AsyncSocket::Create(*loop);
+  ASSERT_TRUE(socket);
+
+  bool timed_out = false;
+  auto start = EventLoop::Clock::now();
+  loop->Spawn(ExpectTimeout(*socket, timed_out));
+  loop->Run();
+
+  ASSERT_TRUE(timed_out);
+  ASSERT_GE(EventLoop::Clock::now() - start, 20ms);
+}
+
+TEST(EventLoopTest, SendWithoutPeerFails) {
+  auto loop = NewLoop();
+  auto socket = AsyncSocket::Create(*loop);
+  ASSERT_TRUE(socket);
+
+  std::optional<bool> sent;
+  auto send = [](AsyncSocket& socket, std::optional<bool>& sent) -> Task<> {
+    tftp::TftpPacket packet = {1, 2, 3};
+    sent = (co_await socket.SendPacket(packet)).has_value();
+  };
+  loop->Spawn(send(*socket, sent));
+  loop->Run();
+
+  ASSERT_EQ(sent, false);
+}
+
+/* Answers every packet to its sender until told how many to expect. */
+static Task<> Echo(AsyncSocket& socket, int packets) {
+  for (int i = 0; i < packets; ++i) {
+    auto packet = co_await socket.RecvPacket(5s);
+    EXPECT_TRUE(packet && !packet->empty());
+    if (!packet || packet->empty()) {
+      co_return;
+    }
+    EXPECT_TRUE(socket.SetPeer(socket.LastSender()));
+    EXPECT_TRUE(co_await socket.SendPacket(*packet));
+  }
+}
+
+static Task<> Ping(EventLoop& loop, uint16_t echo_port, uint8_t id, int rounds,
+                   int& replies) {
+  auto socket = AsyncSocket::Create(loop);
+  EXPECT_TRUE(socket);
+  EXPECT_TRUE(socket->SetPeer(Loopback(echo_port)));
+  for (int i = 0; i < rounds; ++i) {
+    tftp::TftpPacket packet = {id, static_cast<uint8_t>(i)};
+    EXPECT_TRUE(co_await socket->SendPacket(packet));
+    auto reply = co_await socket->RecvPacket(5s);
+    EXPECT_TRUE(reply);
+    if (reply && *reply == packet) {
+      replies++;
+    }
+  }
+}
+
+TEST(EventLoopTest, ManySessionsShareOneThread) {
+  constexpr int kSessions = 200;
+  constexpr int kRounds = 10;
+  auto loop = NewLoop();
+  auto echo = AsyncSocket::Create(*loop);
+  ASSERT_TRUE(echo);
+
+  int replies = 0;
+  loop->Spawn(Echo(*echo, kSessions * kRounds));
+  for (int i = 0; i < kSessions; ++i) {
+    loop->Spawn(Ping(*loop, echo->Port(), i, kRounds, replies));
+  }
+  loop->Run();
+
+  ASSERT_EQ(replies, kSessions * kRounds);
+}
@@ -0,0 +1,112 @@
+#include "common/histogram.h"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstdint>
+
+using namespace std::chrono_literals;
+using tftp::Histogram;
+
+TEST(HistogramTest, EmptyReportsZero) {
+  Histogram hist;
+  ASSERT_EQ(hist.Count(), 0);
+  ASSERT_EQ(hist.Percentile(50), 0ns);
+  ASSERT_EQ(hist.Max(), 0ns);
+}
+
+TEST(HistogramTest, SmallValuesAreExact) {
+  Histogram hist;
+  for (int i = 1; i <= 10; ++i) {
+    hist.Record(std::chrono::nanoseconds(i));
+  }
+  ASSERT_EQ(hist.Count(), 10);
+  ASSERT_EQ(hist.Sum(), 55ns);
+  ASSERT_EQ(hist.Percentile(50), 5ns);
+  ASSERT_EQ(hist.Percentile(90), 9ns);
+  ASSERT_EQ(hist.Percentile(100), 10ns);
+}
+
+TEST(HistogramTest, PercentilesAreWithinTheBucketPrecision) {
+  Histogram hist;
+  for (int64_t us = 1; us <= 100000; ++us) {
+    hist.Record(std::chrono::microseconds(us));
+  }
+  for (double p : {50.0, 90.0, 99.0, 99.9}) {
+    auto exact = std::chrono::microseconds(static_cast<int64_t>(p * 1000));
+    auto reported = hist.Percentile(p);
+    ASSERT_GE(reported, exact) << p;
+    ASSERT_LE(reported, exact * 33 / 32) << p;
+  }
+  ASSERT_EQ(hist.Max(), 100ms);
+  ASSERT_EQ(hist.Percentile(100), 100ms);
+}
+
+TEST(HistogramTest, TheTailIsNotAveragedAway) {
+  Histogram hist;
+  for (int i = 0; i < 990; ++i) {
+    hist.Record(1ms);
+  }
+  for (int i = 0; i < 10; ++i) {
+    hist.Record(1s);
+  }
+  ASSERT_LE(hist.Percentile(50), 1000us * 33 / 32);
+  ASSERT_LE(hist.Percentile(99), 1000us * 33 / 32);
+  ASSERT_GE(hist.Percentile(99.9), 1s);
+  ASSERT_EQ(hist.Max(), 1s);
+}
+
+TEST(HistogramTest, OutOfRangeValuesAreClamped) {
+  Histogram hist;
+  hist.Record(-5ns);
+  hist.Record(std::chrono::hours(24));
+  ASSERT_EQ(hist.Count(), 2);
+  ASSERT_EQ(hist.Percentile(1), 0ns);
+  ASSERT_EQ(hist.Max().count(), (int64_t{1} << Histogram::kMaxBits) - 1);
+}
+
+TEST(HistogramTest, MergeAddsCounts) {
+  Histogram first;
+  Histogram second;
+  first.Record(10us);
+  second.Record(20us);
+  second.Record(30us);
+
+  first.Merge(second);
+
+  ASSERT_EQ(first.Count(), 3);
+  ASSERT_EQ(first.Sum(), 60us);
+  ASSERT_EQ(first.Max(), 30us);
+  ASSERT_GE(first.Percentile(50), 20us);
+  ASSERT_LT(first.Percentile(50), 21us);
+}
+
+TEST(HistogramTest, MergeIntoAnEmptyHistogram) {
+  Histogram empty;
+  Histogram other;
+  other.Record(10us);
+  other.Record(20us);
+
+  empty.Merge(Histogram{});
+  empty.Merge(other);
+
+  ASSERT_EQ(empty.Count(), 2);
+  ASSERT_GE(empty.Percentile(100), 20us);
+  ASSERT_LT(empty.Percentile(100), 21us);
+}
+
+TEST(HistogramTest, ACopyCountsOnItsOwn) {
+  /* Transfer stats are copied per job and folded back afterwards. */
+  Histogram original;
+  original.Record(10us);
+  Histogram copy = original;
+
+  copy.Record(2s);
+  original.Record(20us);
+
+  ASSERT_EQ(original.Count(), 2);
+  ASSERT_EQ(original.Max(), 20us);
+  ASSERT_EQ(copy.Count(), 2);
+  ASSERT_EQ(copy.Max(), 2s);
+  ASSERT_LT(copy.Percentile(50), 11us);
+}
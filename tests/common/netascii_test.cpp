@@ -0,0 +1,56 @@
+#include "common/netascii.h"
+
+#include <gtest/gtest.h>
+
+#include <string_view>
+
+#include "common/types.h"
+
+static tftp::BlockData ToBlock(std::string_view str) {
+  return tftp::BlockData(str.cbegin(), str.cend());
+}
+
+TEST(NetasciiTest, EncodeTranslatesLineEndings) {
+  tftp::BlockData in = ToBlock("a\nb\rc");
+  tftp::BlockData out;
+
+  tftp::NetasciiEncode(in.data(), in.size(), out);
+
+  tftp::BlockData expected = {'a', '\r', '\n', 'b', '\r', '\0', 'c'};
+  ASSERT_EQ(out, expected);
+}
+
+TEST(NetasciiTest, DecodeRestoresLineEndings) {
+  tftp::BlockData in = {'a', '\r', '\n', 'b', '\r', '\0', 'c'};
+  tftp::BlockData out;
+  tftp::NetasciiDecoder decoder;
+
+  decoder.Decode(in.data(), in.size(), out);
+  decoder.Flush(out);
+
+  ASSERT_EQ(out, ToBlock("a\nb\rc"));
+}
+
+TEST(NetasciiTest, DecodeHandlesCrSplitAcrossBlocks) {
+  tftp::BlockData first = {'a', '\r'};
+  tftp::BlockData second = {'\n', 'b'};
+  tftp::BlockData out;
+  tftp::NetasciiDecoder decoder;
+
+  decoder.Decode(first.data(), first.size(), out);
+  decoder.Decode(second.data(), second.size(), out);
+  decoder.Flush(out);
+
+  ASSERT_EQ(out, ToBlock("a\nb"));
+}
+
+TEST(NetasciiTest, FlushEmitsTrailingCr) {
+  tftp::BlockData in = {'a', '\r'};
+  tftp::BlockData out;
+  tftp::NetasciiDecoder decoder;
+
+  decoder.Decode(in.data(), in.size(), out);
+  decoder.Flush(out);
+
+  ASSERT_EQ(out, ToBlock("a\r"));
+}
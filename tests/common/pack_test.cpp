@@ -239,3 +239,62 @@ TEST(CommonTest, UnpackErrorReturnsNulloptOnInvalidErrCode) {
 TEST(CommonTest, UnpackErrorReturnsNulloptOnEmptyPacket) {
   ASSERT_FALSE(tftp::UnpackError({}));
 }
+
+TEST(CommonTest, PackReadRequestWithOptionsReturnsValidPacket) {
+  tftp::ReadRequestMsg rrq = {.op = tftp::OpCode::kReadReq,
+                              .filename = "f",
+                              .mode = tftp::SendMode::kOctet,
+                              .options = {{"blksize", "1024"}}};
+
+  tftp::TftpPacket actual_packet = tftp::PackReadRequest(rrq);
+  tftp::TftpPacket expected_packet = {
+      0x0, 0x1, 'f', 0x0, 'o', 'c', 't', 'e', 't', 0x0, 'b', 'l', 'k',
+      's', 'i', 'z', 'e', 0x0, '1', '0', '2', '4', 0x0};
+
+  ASSERT_EQ(actual_packet, expected_packet);
+}
+
+TEST(CommonTest, UnpackReadRequestReturnsLowercaseOptions) {
+  tftp::TftpPacket rrq_packet = {0x0, 0x1, 'f', 0x0, 'o', 'c', 't', 'e',
+                                 't', 0x0, 'T', 'S', 'i', 'z', 'e', 0x0,
+                                 '0', 0x0};
+  auto actual_msg = tftp::UnpackReadRequest(rrq_packet);
+  ASSERT_TRUE(actual_msg);
+
+  tftp::Options expected_options = {{"tsize", "0"}};
+  ASSERT_EQ(actual_msg->options, expected_options);
+}
+
+TEST(CommonTest, UnpackWriteRequestReturnsNulloptOnUnterminatedOption) {
+  tftp::TftpPacket wrq_packet = {0x0, 0x2, 'f', 0x0, 'o', 'c', 't', 'e',
+                                 't', 0x0, 't', 's', 'i', 'z', 'e', 0x0,
+                                 '0'};
+
+  ASSERT_FALSE(tftp::UnpackWriteRequest(wrq_packet));
+}
+
+TEST(CommonTest, PackOptionAckReturnsValidPacket) {
+  tftp::OptionAckMsg oack = {.op = tftp::OpCode::kOptionAck,
+                             .options = {{"tsize", "42"}}};
+
+  tftp::TftpPacket actual_packet = tftp::PackOptionAck(oack);
+  tftp::TftpPacket expected_packet = {0x0, 0x6, 't', 's', 'i', 'z',
+                                      'e', 0x0, '4', '2', 0x0};
+
+  ASSERT_EQ(actual_packet, expected_packet);
+}
+
+TEST(CommonTest, UnpackOptionAckReturnsValidMsg) {
+  tftp::TftpPacket oack_packet = {0x0, 0x6, 't', 's', 'i', 'z',
+                                  'e', 0x0, '4', '2', 0x0};
+  auto actual_msg = tftp::UnpackOptionAck(oack_packet);
+  ASSERT_TRUE(actual_msg);
+
+  tftp::Options expected_options = {{"tsize", "42"}};
+  ASSERT_EQ(actual_msg->op, tftp::OpCode::kOptionAck);
+  ASSERT_EQ(actual_msg->options, expected_options);
+}
+
+TEST(CommonTest, UnpackOptionAckReturnsNulloptOnEmptyPacket) {
+  ASSERT_FALSE(tftp::UnpackOptionAck({}));
+}
@@ -132,3 +132,66 @@ TEST(ParseTest,
   ASSERT_EQ(tftp::ParseStatus::kPortRangeMissingSeperator,
             parsed_range.error());
 }
+
+TEST(ParseTest, ParseWindowSizeReturnsWindowWhenInRange) {
+  auto parsed_window = tftp::ParseWindowSize("64");
+
+  ASSERT_TRUE(parsed_window);
+  ASSERT_EQ(*parsed_window, 64);
+}
+
+TEST(ParseTest, ParseWindowSizeReturnsOutOfRangeOnZeroOrOverflow) {
+  ASSERT_EQ(tftp::ParseWindowSize("0").error(),
+            tftp::ParseStatus::kWindowSizeOutOfRange);
+  ASSERT_EQ(tftp::ParseWindowSize("65536").error(),
+            tftp::ParseStatus::kWindowSizeOutOfRange);
+  ASSERT_EQ(tftp::ParseWindowSize("-4").error(),
+            tftp::ParseStatus::kWindowSizeOutOfRange);
+}
+
+TEST(ParseTest, ParseRateAcceptsSuffixesAndOff) {
+  ASSERT_EQ(*tftp::ParseRate("1500"), 1500);
+  ASSERT_EQ(*tftp::ParseRate("512k"), 512000);
+  ASSERT_EQ(*tftp::ParseRate("10M"), 10000000);
+  ASSERT_EQ(*tftp::ParseRate("1g"), 1000000000);
+  ASSERT_EQ(*tftp::ParseRate("off"), 0);
+  ASSERT_EQ(*tftp::ParseRate("0"), 0);
+}
+
+TEST(ParseTest, ParseRateRejectsMalformedRates) {
+  ASSERT_EQ(tftp::ParseRate("").error(), tftp::ParseStatus::kInvalidRate);
+  ASSERT_EQ(tftp::ParseRate("k").error(), tftp::ParseStatus::kInvalidRate);
+  ASSERT_EQ(tftp::ParseRate("10x").error(), tftp::ParseStatus::kInvalidRate);
+  ASSERT_EQ(tftp::ParseRate("-5").error(), tftp::ParseStatus::kInvalidRate);
+  ASSERT_EQ(tftp::ParseRate("1000000000000000").error(),
+            tftp::ParseStatus::kInvalidRate);
+}
+
+TEST(ParseTest, ParseRolloverAcceptsZeroOrOne) {
+  ASSERT_EQ(*tftp::ParseRollover("0"), tftp::Rollover::kToZero);
+  ASSERT_EQ(*tftp::ParseRollover("1"), tftp::Rollover::kToOne);
+  ASSERT_EQ(tftp::ParseRollover("2").error(),
+            tftp::ParseStatus::kInvalidRollover);
+  ASSERT_EQ(tftp::ParseRollover("").error(),
+            tftp::ParseStatus::kInvalidRollover);
+}
+
+TEST(ParseTest, ParseFsyncPolicyAcceptsNeverFileOrDir) {
+  ASSERT_EQ(*tftp::ParseFsyncPolicy("never"), tftp::FsyncPolicy::kNever);
+  ASSERT_EQ(*tftp::ParseFsyncPolicy("file"), tftp::FsyncPolicy::kFile);
+  ASSERT_EQ(*tftp::ParseFsyncPolicy("dir"), tftp::FsyncPolicy::kDirectory);
+  ASSERT_EQ(tftp::FsyncPolicyName(tftp::FsyncPolicy::kDirectory), "dir");
+  ASSERT_EQ(tftp::ParseFsyncPolicy("always").error(),
+            tftp::ParseStatus::kUnknownFsyncPolicy);
+}
+
+TEST(ParseTest, ParseBusyPollAcceptsMicrosecondsOrOff) {
+  ASSERT_EQ(*tftp::ParseBusyPoll("50"), 50);
+  ASSERT_EQ(*tftp::ParseBusyPoll("off"), 0);
+  ASSERT_EQ(tftp::ParseBusyPoll("0").error(),
+            tftp::ParseStatus::kBusyPollOutOfRange);
+  ASSERT_EQ(tftp::ParseBusyPoll("1000001").error(),
+            tftp::ParseStatus::kBusyPollOutOfRange);
+  ASSERT_EQ(tftp::ParseBusyPoll("fast").error(),
+            tftp::ParseStatus::kBusyPollOutOfRange);
+}
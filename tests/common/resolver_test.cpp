@@ -0,0 +1,138 @@
+#include "common/resolver.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <expected>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "common/udp_socket.h"
+
+using namespace std::chrono_literals;
+
+static tftp::ResolverCache::Lookup CountingLookup(std::atomic<int>& calls) {
+  return [&calls](std::string_view host)
+             -> std::expected<tftp::SockAddr, tftp::UdpSocketErr> {
+    calls++;
+    if (host == "nowhere") {
+      return std::unexpected("host not found");
+    }
+    return tftp::ResolveAddr("127.0.0.1");
+  };
+}
+
+TEST(ResolverTest, ResolveAddrParsesLiteral) {
+  auto addr = tftp::ResolveAddr("127.0.0.1");
+
+  ASSERT_TRUE(addr);
+  ASSERT_EQ(addr->Ip(), "127.0.0.1");
+  addr->SetPort(6969);
+  ASSERT_EQ(addr->Port(), 6969);
+}
+
+TEST(ResolverTest, CacheHitSkipsLookup) {
+  std::atomic<int> calls = 0;
+  tftp::ResolverCache cache(1min, 1min, CountingLookup(calls));
+
+  auto first = cache.Resolve("server", 69);
+  auto second = cache.Resolve("server", 6969);
+
+  ASSERT_TRUE(first);
+  ASSERT_TRUE(second);
+  ASSERT_EQ(calls, 1);
+  ASSERT_EQ(first->Port(), 69);
+  ASSERT_EQ(second->Port(), 6969);
+  ASSERT_EQ(cache.Size(), 1);
+}
+
+TEST(ResolverTest, FailuresAreCachedNegatively) {
+  std::atomic<int> calls = 0;
+  tftp::ResolverCache cache(1min, 1min, CountingLookup(calls));
+
+  ASSERT_EQ(cache.Resolve("nowhere", 69).error(), "host not found");
+  ASSERT_EQ(cache.Resolve("nowhere", 69).error(), "host not found");
+  ASSERT_EQ(calls, 1);
+}
+
+TEST(ResolverTest, ExpiredEntriesAreLookedUpAgain) {
+  std::atomic<int> calls = 0;
+  tftp::ResolverCache cache(0ms, 0ms, CountingLookup(calls));
+
+  ASSERT_TRUE(cache.Resolve("server", 69));
+  ASSERT_TRUE(cache.Resolve("server", 69));
+  ASSERT_EQ(calls, 2);
+}
+
+TEST(ResolverTest, ClearDropsEntries) {
+  std::atomic<int> calls = 0;
+  tftp::ResolverCache cache(1min, 1min, CountingLookup(calls));
+
+  ASSERT_TRUE(cache.Resolve("server", 69));
+  cache.Clear();
+  ASSERT_EQ(cache.Size(), 0);
+  ASSERT_TRUE(cache.Resolve("server", 69));
+  ASSERT_EQ(calls, 2);
+}
+
+TEST(ResolverTest, SharedAcrossThreads) {
+  std::atomic<int> calls = 0;
+  tftp::ResolverCache cache(1min, 1min, CountingLookup(calls));
+  ASSERT_TRUE(cache.Resolve("server", 69));
+
+  std::vector<std::jthread> workers;
+  std::atomic<int> resolved = 0;
+  for (int i = 0; i < 8; ++i) {
+    workers.emplace_back([&cache, &resolved] {
+      for (int j = 0; j < 100; ++j) {
+        if (cache.Resolve("server", 69)) {
+          resolved++;
+        }
+      }
+    });
+  }
+  workers.clear();
+
+  ASSERT_EQ(resolved, 800);
+  ASSERT_EQ(calls, 1);
+}
+
+TEST(ResolverTest, ConcurrentMissesShareOneLookup) {
+  std::atomic<int> calls = 0;
+  auto slow = [&calls](std::string_view host) {
+    std::this_thread::sleep_for(50ms);
+    return CountingLookup(calls)(host);
+  };
+  tftp::ResolverCache cache(1min, 1min, slow);
+
+  std::vector<std::jthread> workers;
+  std::atomic<int> resolved = 0;
+  for (int i = 0; i < 8; ++i) {
+    workers.emplace_back([&cache, &resolved, i] {
+      auto addr = cache.Resolve("server", 69 + i);
+      if (addr && addr->Port() == 69 + i) {
+        resolved++;
+      }
+    });
+  }
+  workers.clear();
+
+  ASSERT_EQ(resolved, 8);
+  ASSERT_EQ(calls, 1);
+}
+
+TEST(ResolverTest, TtlStartsWhenTheLookupAnswers) {
+  std::atomic<int> calls = 0;
+  auto slow = [&calls](std::string_view host) {
+    std::this_thread::sleep_for(100ms);
+    return CountingLookup(calls)(host);
+  };
+  /* Slower than the negative TTL, yet the failure still gets cached. */
+  tftp::ResolverCache cache(1min, 50ms, slow);
+
+  ASSERT_FALSE(cache.Resolve("nowhere", 69));
+  ASSERT_FALSE(cache.Resolve("nowhere", 69));
+  ASSERT_EQ(calls, 1);
+}
@@ -0,0 +1,54 @@
+#include "common/sha256.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+static std::string Hash(std::string_view data) {
+  tftp::Sha256 hash;
+  hash.Update(reinterpret_cast<const uint8_t*>(data.data()), data.size());
+  return tftp::ToHex(hash.Final());
+}
+
+TEST(Sha256Test, MatchesKnownDigests) {
+  ASSERT_EQ(Hash(""),
+            "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855");
+  ASSERT_EQ(Hash("abc"),
+            "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+  /* 56 bytes, the padding spills into a second block. */
+  ASSERT_EQ(Hash("abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq"),
+            "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1");
+}
+
+TEST(Sha256Test, UpdatesInPiecesMatchOneUpdate) {
+  std::vector<uint8_t> data(1000);
+  for (std::size_t i = 0; i < data.size(); ++i) {
+    data[i] = static_cast<uint8_t>(i * 7);
+  }
+  tftp::Sha256 whole;
+  whole.Update(data.data(), data.size());
+  tftp::Sha256Digest expected = whole.Final();
+
+  for (std::size_t piece : {1, 3, 63, 64, 65, 500}) {
+    tftp::Sha256 hash;
+    for (std::size_t i = 0; i < data.size(); i += piece) {
+      hash.Update(data.data() + i, std::min(piece, data.size() - i));
+    }
+    ASSERT_EQ(hash.Final(), expected) << piece;
+  }
+}
+
+TEST(Sha256Test, ParsesHexInEitherCase) {
+  auto digest = tftp::ParseSha256(
+      "BA7816BF8F01CFEA414140DE5DAE2223B00361A396177A9CB410FF61F20015AD");
+  ASSERT_TRUE(digest);
+  ASSERT_EQ(tftp::ToHex(*digest),
+            "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+  ASSERT_FALSE(tftp::ParseSha256("ba78"));
+  ASSERT_FALSE(tftp::ParseSha256(std::string(64, 'g')));
+}
@@ -0,0 +1,178 @@
+#include "common/tracer.h"
+
+#include <gtest/gtest.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "common/pack.h"
+#include "common/types.h"
+#include "common/udp_socket.h"
+
+using tftp::TraceEvent;
+using tftp::Tracer;
+using tftp::TraceRecord;
+
+class TracerTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    path_ = std::filesystem::temp_directory_path() /
+            ("tracer_test_" + std::to_string(::getpid()));
+  }
+  void TearDown() override { std::filesystem::remove(path_); }
+
+  std::filesystem::path path_;
+};
+
+static tftp::SockAddr Peer(const char* host, uint16_t port) {
+  auto addr = tftp::ResolveAddr(host);
+  EXPECT_TRUE(addr);
+  addr->SetPort(port);
+  return *addr;
+}
+
+TEST_F(TracerTest, RecordsRoundTripThroughTheFile) {
+  tftp::TftpPacket rrq = tftp::PackReadRequest(
+      {.filename = "file", .mode = tftp::SendMode::kOctet, .options = {}});
+  tftp::TftpPacket data =
+      tftp::PackData({.block_num = 7, .data = tftp::BlockData(100)});
+  {
+    auto tracer = Tracer::Create(path_.string());
+    ASSERT_TRUE(tracer);
+    (*tracer)->Record(TraceEvent::kSend, 4000, Peer("127.0.0.1", 69), rrq);
+    (*tracer)->Record(TraceEvent::kRecv, 4000, Peer("127.0.0.1", 5000),
+                      data);
+    (*tracer)->Record(TraceEvent::kTimeout, 4000, Peer("127.0.0.1", 5000));
+  }
+
+  auto trace = tftp::ReadTrace(path_.string());
+  ASSERT_TRUE(trace) << trace.error();
+  ASSERT_GT(trace->start_unix_ns, 0);
+  ASSERT_EQ(trace->records.size(), 3);
+
+  const TraceRecord& sent = trace->records[0];
+  ASSERT_EQ(sent.event, TraceEvent::kSend);
+  ASSERT_EQ(sent.opcode, tftp::OpCode::kReadReq);
+  ASSERT_EQ(sent.length, rrq.size());
+  ASSERT_EQ(sent.local_port, 4000);
+  ASSERT_EQ(tftp::TracePeer(sent), "127.0.0.1:69");
+
+  const TraceRecord& received = trace->records[1];
+  ASSERT_EQ(received.opcode, tftp::OpCode::kData);
+  ASSERT_EQ(received.block, 7);
+  ASSERT_EQ(received.length, 104);
+  ASSERT_LE(sent.time_ns, received.time_ns);
+
+  ASSERT_EQ(trace->records[2].event, TraceEvent::kTimeout);
+  ASSERT_EQ(trace->records[2].length, 0);
+}
+
+TEST_F(TracerTest, EveryThreadRecordsIntoItsOwnRing) {
+  constexpr int kThreads = 4;
+  constexpr int kRecords = 5000;
+  uint64_t dropped = 0;
+  {
+    auto tracer = Tracer::Create(path_.string());
+    ASSERT_TRUE(tracer);
+    tftp::TftpPacket ack = tftp::PackAck({.block_num = 1});
+    std::vector<std::jthread> threads;
+    for (int t = 0; t < kThreads; ++t) {
+      threads.emplace_back([&, t] {
+        for (int i = 0; i < kRecords; ++i) {
+          (*tracer)->Record(TraceEvent::kSend, 1000 + t,
+                            Peer("127.0.0.1", 69), ack);
+        }
+      });
+    }
+    threads.clear();
+    dropped = (*tracer)->Dropped();
+  }
+
+  auto trace = tftp::ReadTrace(path_.string());
+  ASSERT_TRUE(trace);
+  ASSERT_EQ(trace->records.size() + dropped, kThreads * kRecords);
+  for (std::size_t i = 1; i < trace->records.size(); ++i) {
+    ASSERT_LE(trace->records[i - 1].time_ns, trace->records[i].time_ns);
+  }
+}
+
+TEST_F(TracerTest, ReadTraceRejectsOtherFiles) {
+  std::ofstream(path_) << "not a trace";
+  auto trace = tftp::ReadTrace(path_.string());
+  ASSERT_FALSE(trace);
+  ASSERT_NE(trace.error().find("is not a trace file"), std::string::npos);
+}
+
+static TraceRecord Event(uint64_t ms, uint16_t port, TraceEvent event,
+                         uint8_t opcode = 0, uint16_t block = 0) {
+  TraceRecord record;
+  record.time_ns = ms * 1000000;
+  record.local_port = port;
+  record.block = block;
+  record.event = event;
+  record.opcode = opcode;
+  return record;
+}
+
+TEST(TraceTimelineTest, PairsPacketsForRttsAndFindsGaps) {
+  using tftp::OpCode;
+  tftp::Trace trace;
+  /* A get that times out once. */
+  trace.records.push_back(Event(0, 1000, TraceEvent::kSend, OpCode::kReadReq));
+  trace.records.push_back(Event(2, 1000, TraceEvent::kRecv, OpCode::kData, 1));
+  trace.records.push_back(Event(3, 1000, TraceEvent::kSend, OpCode::kAck, 1));
+  trace.records.push_back(Event(500, 1000, TraceEvent::kTimeout));
+  trace.records.push_back(
+      Event(500, 1000, TraceEvent::kResend, OpCode::kAck, 1));
+  trace.records.push_back(
+      Event(504, 1000, TraceEvent::kRecv, OpCode::kData, 2));
+  /* A windowed put. */
+  trace.records.push_back(
+      Event(10, 2000, TraceEvent::kSend, OpCode::kWriteReq));
+  trace.records.push_back(Event(11, 2000, TraceEvent::kRecv, OpCode::kAck, 0));
+  trace.records.push_back(Event(12, 2000, TraceEvent::kSend, OpCode::kData, 1));
+  trace.records.push_back(Event(13, 2000, TraceEvent::kSend, OpCode::kData, 2));
+  trace.records.push_back(Event(16, 2000, TraceEvent::kRecv, OpCode::kAck, 2));
+  std::ranges::stable_sort(trace.records, {}, &TraceRecord::time_ns);
+
+  auto timelines = tftp::BuildTimelines(trace, 100 * 1000000);
+  ASSERT_EQ(timelines.size(), 2);
+
+  const tftp::TraceTimeline& get = timelines[0];
+  ASSERT_EQ(get.local_port, 1000);
+  ASSERT_EQ(get.events.size(), 6);
+  ASSERT_EQ(get.sent, 2);
+  ASSERT_EQ(get.resent, 1);
+  ASSERT_EQ(get.received, 2);
+  ASSERT_EQ(get.timeouts, 1);
+  /* The DATA answering the resent ACK is ambiguous and skipped. */
+  ASSERT_EQ(get.rtts_ns, std::vector<uint64_t>({2000000}));
+  ASSERT_EQ(get.gaps.size(), 1);
+  ASSERT_EQ(get.gaps[0].after_ns, 3000000);
+  ASSERT_EQ(get.gaps[0].length_ns, 497000000);
+
+  const tftp::TraceTimeline& put = timelines[1];
+  ASSERT_EQ(put.local_port, 2000);
+  ASSERT_EQ(put.rtts_ns, std::vector<uint64_t>({1000000, 3000000}));
+  ASSERT_TRUE(put.gaps.empty());
+}
+
+TEST(TraceTimelineTest, ARequestStartsANewTransferOnAReusedPort) {
+  using tftp::OpCode;
+  tftp::Trace trace;
+  trace.records = {Event(0, 1000, TraceEvent::kSend, OpCode::kReadReq),
+                   Event(1, 1000, TraceEvent::kRecv, OpCode::kData, 1),
+                   Event(2, 1000, TraceEvent::kSend, OpCode::kReadReq),
+                   Event(3, 1000, TraceEvent::kRecv, OpCode::kData, 1)};
+
+  auto timelines = tftp::BuildTimelines(trace, UINT64_MAX);
+  ASSERT_EQ(timelines.size(), 2);
+  ASSERT_EQ(timelines[0].events.size(), 2);
+  ASSERT_EQ(timelines[1].events.size(), 2);
+}
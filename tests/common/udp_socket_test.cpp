@@ -0,0 +1,28 @@
+#include "common/udp_socket.h"
+
+#include <gtest/gtest.h>
+#include <unistd.h>
+
+#include <cstdlib>
+
+/* Enables busy polling as an unprivileged user, dropping to nobody first
+   when the tests run as root. */
+static void BusyPollAsNobody() {
+  if (geteuid() == 0 && (setgid(65534) == -1 || setuid(65534) == -1)) {
+    std::exit(2);
+  }
+
+  auto recver = tftp::UdpSocketRecver::Create(0);
+  std::exit((recver && recver->SetBusyPoll(50)) ? 0 : 1);
+}
+
+TEST(UdpSocketTest, BusyPollNeedsNoPrivileges) {
+  ASSERT_EXIT(BusyPollAsNobody(), testing::ExitedWithCode(0), "");
+}
+
+TEST(UdpSocketTest, BusyPollCanBeTurnedOff) {
+  auto recver = tftp::UdpSocketRecver::Create(0);
+  ASSERT_TRUE(recver);
+  ASSERT_TRUE(recver->SetBusyPoll(50));
+  ASSERT_TRUE(recver->SetBusyPoll(0));
+}
@@ -0,0 +1,118 @@
+#include "proxy/impairment.h"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cmath>
+#include <vector>
+
+using namespace std::chrono_literals;
+
+static tftp::proxy::Verdict Tally(tftp::proxy::Impairer& impairer, int count,
+                                  int& dropped, int& duplicated,
+                                  int& reordered) {
+  tftp::proxy::Verdict last;
+  for (int i = 0; i < count; ++i) {
+    last = impairer.Next();
+    dropped += last.drop;
+    duplicated += last.duplicate.has_value();
+    reordered += last.reordered;
+  }
+  return last;
+}
+
+TEST(ImpairmentTest, ParsePresetWithOverrides) {
+  auto profile = tftp::proxy::ParseProfile("wan,loss=0.25,jitter=1.5,seed=7");
+
+  ASSERT_TRUE(profile);
+  ASSERT_DOUBLE_EQ(profile->loss, 0.25);
+  ASSERT_EQ(profile->delay, 40ms);
+  ASSERT_EQ(profile->jitter, 1500us);
+  ASSERT_EQ(profile->seed, 7);
+}
+
+TEST(ImpairmentTest, ParseSettingsOnly) {
+  auto profile = tftp::proxy::ParseProfile("dup=0.5,reorder=1,hold=3");
+
+  ASSERT_TRUE(profile);
+  ASSERT_DOUBLE_EQ(profile->loss, 0.0);
+  ASSERT_DOUBLE_EQ(profile->duplicate, 0.5);
+  ASSERT_DOUBLE_EQ(profile->reorder, 1.0);
+  ASSERT_EQ(profile->hold, 3ms);
+}
+
+TEST(ImpairmentTest, ParseRejectsBadSpecs) {
+  ASSERT_FALSE(tftp::proxy::ParseProfile("satellite"));
+  ASSERT_FALSE(tftp::proxy::ParseProfile("loss=0.1,wan"));
+  ASSERT_FALSE(tftp::proxy::ParseProfile("loss=1.5"));
+  ASSERT_FALSE(tftp::proxy::ParseProfile("loss=-0.1"));
+  ASSERT_FALSE(tftp::proxy::ParseProfile("delay=ten"));
+  ASSERT_FALSE(tftp::proxy::ParseProfile("bandwidth=10"));
+}
+
+TEST(ImpairmentTest, FormatRoundTrips) {
+  auto profile = tftp::proxy::ParseProfile("lossy,seed=3");
+  ASSERT_TRUE(profile);
+
+  auto reparsed =
+      tftp::proxy::ParseProfile(tftp::proxy::FormatProfile(*profile));
+
+  ASSERT_TRUE(reparsed);
+  ASSERT_DOUBLE_EQ(reparsed->loss, profile->loss);
+  ASSERT_DOUBLE_EQ(reparsed->duplicate, profile->duplicate);
+  ASSERT_DOUBLE_EQ(reparsed->reorder, profile->reorder);
+  ASSERT_EQ(reparsed->delay, profile->delay);
+  ASSERT_EQ(reparsed->jitter, profile->jitter);
+  ASSERT_EQ(reparsed->seed, profile->seed);
+}
+
+TEST(ImpairmentTest, CleanProfilePassesEverything) {
+  tftp::proxy::Impairer impairer({});
+  int dropped = 0, duplicated = 0, reordered = 0;
+
+  auto last = Tally(impairer, 1000, dropped, duplicated, reordered);
+
+  ASSERT_EQ(dropped + duplicated + reordered, 0);
+  ASSERT_EQ(last.delay, 0us);
+}
+
+TEST(ImpairmentTest, SameSeedSameVerdicts) {
+  auto profile = tftp::proxy::ParseProfile("lossy,seed=42");
+  ASSERT_TRUE(profile);
+  tftp::proxy::Impairer first(*profile);
+  tftp::proxy::Impairer second(*profile);
+
+  for (int i = 0; i < 1000; ++i) {
+    auto a = first.Next();
+    auto b = second.Next();
+    ASSERT_EQ(a.drop, b.drop);
+    ASSERT_EQ(a.reordered, b.reordered);
+    ASSERT_EQ(a.delay, b.delay);
+    ASSERT_EQ(a.duplicate, b.duplicate);
+  }
+}
+
+TEST(ImpairmentTest, RatesFollowProfile) {
+  tftp::proxy::Impairer impairer(
+      {.loss = 0.1, .duplicate = 0.05, .reorder = 0.2, .seed = 9});
+  int dropped = 0, duplicated = 0, reordered = 0;
+
+  Tally(impairer, 20000, dropped, duplicated, reordered);
+
+  /* Duplicates and reordering only apply to packets that got through. */
+  ASSERT_NEAR(dropped / 20000.0, 0.1, 0.01);
+  ASSERT_NEAR(duplicated / 18000.0, 0.05, 0.01);
+  ASSERT_NEAR(reordered / 18000.0, 0.2, 0.01);
+}
+
+TEST(ImpairmentTest, DelayStaysWithinJitter) {
+  tftp::proxy::Impairer impairer(
+      {.reorder = 0.5, .delay = 10ms, .jitter = 2ms, .hold = 50ms});
+
+  for (int i = 0; i < 1000; ++i) {
+    auto verdict = impairer.Next();
+    auto base = verdict.delay - ((verdict.reordered) ? 50ms : 0ms);
+    ASSERT_GE(base, 8ms);
+    ASSERT_LE(base, 12ms);
+  }
+}
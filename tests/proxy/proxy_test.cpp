@@ -0,0 +1,163 @@
+#include "proxy/proxy.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "common/codec.h"
+#include "common/types.h"
+#include "common/udp_socket.h"
+#include "proxy/impairment.h"
+
+using namespace std::chrono_literals;
+
+/* Runs a proxy on a free port in front of a socket playing the server. */
+class ProxyTest : public ::testing::Test {
+ protected:
+  void Start(const tftp::proxy::ImpairmentProfile& profile) {
+    auto server = tftp::UdpSocketRecver::Create(0, 500);
+    ASSERT_TRUE(server);
+    server_.emplace(std::move(*server));
+
+    auto addr = tftp::ResolveAddr("127.0.0.1");
+    ASSERT_TRUE(addr);
+    addr->SetPort(server_->RecvPort());
+    auto proxy = tftp::proxy::Proxy::Create(0, *addr, profile);
+    ASSERT_TRUE(proxy);
+    proxy_.emplace(std::move(*proxy));
+    thread_ = std::thread([this] { ASSERT_TRUE(proxy_->Run(stop_)); });
+
+    auto client = tftp::UdpSocketRecver::Create(0, 500);
+    ASSERT_TRUE(client);
+    client_.emplace(std::move(*client));
+  }
+
+  void TearDown() override {
+    stop_ = true;
+    if (thread_.joinable()) {
+      thread_.join();
+    }
+  }
+
+  const tftp::proxy::ProxyStats& Stop() {
+    TearDown();
+    return proxy_->Stats();
+  }
+
+  /* Sends from the client's socket to the proxy. */
+  void ClientSend(const tftp::TftpPacket& packet) {
+    auto addr = tftp::ResolveAddr("127.0.0.1");
+    ASSERT_TRUE(addr);
+    addr->SetPort(proxy_->Port());
+    auto sender = tftp::UdpSocketSender::Create(*addr, *client_);
+    ASSERT_TRUE(sender);
+    ASSERT_TRUE(sender->Send(packet.data(), packet.size()));
+  }
+
+  static std::optional<tftp::TftpPacket> Recv(tftp::UdpSocketRecver& recver) {
+    std::vector<uint8_t> buffer(1024);
+    auto num_bytes = recver.Recv(buffer.data(), buffer.size());
+    if (!num_bytes || *num_bytes <= 0) {
+      return std::nullopt;
+    }
+    buffer.resize(*num_bytes);
+    return buffer;
+  }
+
+  static tftp::TftpPacket Rrq() {
+    return tftp::codec::Encode(
+        tftp::codec::ReadRequestView{.filename = "a.txt", .mode = "octet"});
+  }
+
+  std::optional<tftp::UdpSocketRecver> server_;
+  std::optional<tftp::UdpSocketRecver> client_;
+  std::optional<tftp::proxy::Proxy> proxy_;
+  std::atomic<bool> stop_ = false;
+  std::thread thread_;
+};
+
+TEST_F(ProxyTest, RelaysBothWaysAndFollowsServerTid) {
+  Start({});
+
+  ClientSend(Rrq());
+  auto rrq = Recv(*server_);
+  ASSERT_EQ(rrq, Rrq());
+
+  /* Answer from a new socket, the way a server picks its TID. */
+  auto tid = tftp::UdpSocketRecver::Create(0, 500);
+  ASSERT_TRUE(tid);
+  auto reply = tftp::UdpSocketSender::Create(server_->LastSender(), *tid);
+  ASSERT_TRUE(reply);
+  tftp::BlockData payload = {'h', 'i'};
+  tftp::TftpPacket data = tftp::codec::Encode(
+      tftp::codec::DataView{.block_num = 1, .data = payload});
+  ASSERT_TRUE(reply->Send(data.data(), data.size()));
+
+  ASSERT_EQ(Recv(*client_), data);
+  ASSERT_EQ(client_->LastSenderPort(), proxy_->Port());
+
+  tftp::TftpPacket ack =
+      tftp::codec::Encode(tftp::codec::AckView{.block_num = 1});
+  ClientSend(ack);
+  ASSERT_EQ(Recv(*tid), ack);
+
+  const auto& stats = Stop();
+  ASSERT_EQ(stats.received, 3);
+  ASSERT_EQ(stats.forwarded, 3);
+}
+
+TEST_F(ProxyTest, DropsEverythingAtFullLoss) {
+  Start({.loss = 1.0});
+
+  ClientSend(Rrq());
+  ASSERT_FALSE(Recv(*server_));
+
+  const auto& stats = Stop();
+  ASSERT_EQ(stats.dropped, 1);
+  ASSERT_EQ(stats.forwarded, 0);
+}
+
+TEST_F(ProxyTest, DuplicatesPackets) {
+  Start({.duplicate = 1.0});
+
+  ClientSend(Rrq());
+  ASSERT_EQ(Recv(*server_), Rrq());
+  ASSERT_EQ(Recv(*server_), Rrq());
+
+  const auto& stats = Stop();
+  ASSERT_EQ(stats.duplicated, 1);
+  ASSERT_EQ(stats.forwarded, 2);
+}
+
+TEST_F(ProxyTest, DelaysPackets) {
+  Start({.delay = 50ms});
+
+  auto start = tftp::proxy::Clock::now();
+  ClientSend(Rrq());
+  ASSERT_TRUE(Recv(*server_));
+
+  ASSERT_GE(tftp::proxy::Clock::now() - start, 50ms);
+}
+
+TEST_F(ProxyTest, JitterKeepsOrder) {
+  Start({.delay = 5ms, .jitter = 5ms});
+  ClientSend(Rrq());
+  ASSERT_EQ(Recv(*server_), Rrq());
+
+  for (uint16_t block = 1; block <= 20; ++block) {
+    ClientSend(tftp::codec::Encode(tftp::codec::AckView{.block_num = block}));
+  }
+  for (uint16_t block = 1; block <= 20; ++block) {
+    auto ack = Recv(*server_);
+    ASSERT_TRUE(ack);
+    auto view = tftp::codec::DecodeAs<tftp::codec::AckView>(*ack);
+    ASSERT_TRUE(view);
+    ASSERT_EQ(view->block_num, block);
+  }
+}